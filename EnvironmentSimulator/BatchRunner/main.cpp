@@ -0,0 +1,534 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+ /*
+  * This application runs batches of scenarios headless and as fast as possible, e.g. for regression testing.
+  *
+  * Scenarios are given as a list of files or wildcard patterns. Each scenario is run once for each combination
+  * of specified parameter values (the parameter matrix). Runs are distributed over a pool of worker threads,
+  * idle workers stealing runs from busy ones. Each run is stepped with a fixed timestep, no viewer and no sleeps.
+  * When all runs are done a summary is printed, optionally also saved as a CSV file.
+  *
+  * SUMO is a process wide singleton, hence scenarios involving SUMO controllers are all run one after the other
+  * by the first worker. Other workers can not steal them.
+  */
+
+#include "ScenarioEngine.hpp"
+#include "CommonMini.hpp"
+#include "pugixml.hpp"
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+using namespace scenarioengine;
+
+#define DEFAULT_TIMESTEP 0.05
+#define DEFAULT_MAX_TIME 3600.0
+
+typedef enum
+{
+	RUN_NOT_STARTED,
+	RUN_STOP_TRIGGER,   // scenario ended by its stop trigger
+	RUN_TIMEOUT,        // max simulation time reached
+	RUN_ERROR,          // failed to load scenario
+} RunStatus;
+
+typedef struct
+{
+	std::string filename;
+	std::vector<ParameterStruct> parameters;
+	RunStatus status;
+	double sim_time;
+	int n_steps;
+	double wall_time;   // seconds
+	std::string end_state;  // road and world position of each object at end of run
+	bool sumo;          // scenario involves SUMO controlled vehicles
+} BatchRun;
+
+/*
+  Work stealing queue of runs. Each worker takes runs from the front of its own deque, when empty it steals from
+  the back of other workers' deques. Runs vary a lot in duration, so this keeps all workers busy to the end.
+  Pinned runs are only taken by the worker they were added to, e.g. to never run two SUMO scenarios in parallel.
+*/
+class BatchQueue
+{
+public:
+	BatchQueue(int n_workers) : queue_(n_workers), pinned_(n_workers), mutex_(n_workers) {}
+
+	void Add(int worker, int run, bool pinned = false)
+	{
+		if (pinned)
+		{
+			pinned_[worker].push_back(run);
+		}
+		else
+		{
+			queue_[worker].push_back(run);
+		}
+	}
+
+	// @return Index of next run for given worker, -1 if no runs left
+	int Get(int worker)
+	{
+		for (size_t i = 0; i < queue_.size(); i++)
+		{
+			int w = (int)((worker + i) % queue_.size());
+			int run = -1;
+
+			mutex_[w].Lock();
+			if (w == worker && !pinned_[w].empty())
+			{
+				run = pinned_[w].front();
+				pinned_[w].pop_front();
+			}
+			else if (!queue_[w].empty())
+			{
+				if (w == worker)
+				{
+					run = queue_[w].front();
+					queue_[w].pop_front();
+				}
+				else
+				{
+					run = queue_[w].back();
+					queue_[w].pop_back();
+				}
+			}
+			mutex_[w].Unlock();
+
+			if (run >= 0)
+			{
+				return run;
+			}
+		}
+
+		return -1;
+	}
+
+private:
+	std::vector<std::deque<int> > queue_;
+	std::vector<std::deque<int> > pinned_;
+	std::vector<SE_Mutex> mutex_;
+};
+
+typedef struct
+{
+	int id;
+	BatchQueue *queue;
+	std::vector<BatchRun> *runs;
+	double timestep;
+	double max_time;
+	SE_Thread thread;
+} BatchWorker;
+
+// Same criteria as ScenarioReader, any scenario object with an ObjectController is handed over to SUMO
+static bool UsesSumo(std::string filename)
+{
+	pugi::xml_document doc;
+	if (!doc.load_file(filename.c_str()))
+	{
+		return false;  // error reported when the run fails to load
+	}
+
+	for (pugi::xml_node obj = doc.child("OpenSCENARIO").child("Entities").child("ScenarioObject"); obj;
+		obj = obj.next_sibling("ScenarioObject"))
+	{
+		if (obj.child("ObjectController"))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void Run(BatchRun *run, double timestep, double max_time)
+{
+	// Own road network context per run, shared between runs of same OpenDRIVE file
+	roadmanager::OpenDriveContext odr_context;
+	odr_context.Activate();
+
+	SE_SystemTimer timer;
+	timer.Start();
+
+	try
+	{
+		ScenarioEngine engine(run->filename, run->parameters);
+
+		// Zero time step, just to reach and report init state of all vehicles
+		engine.step(0.0, true);
+
+		run->n_steps = 0;
+		while (!engine.GetQuitFlag() && engine.getSimulationTime() < max_time)
+		{
+			engine.step(timestep);
+			run->n_steps++;
+		}
+
+		run->status = engine.GetQuitFlag() ? RUN_STOP_TRIGGER : RUN_TIMEOUT;
+		run->sim_time = engine.getSimulationTime();
+
+		// For comparing outcome with other runs, e.g. the last frame of esmini --csv_logger
+		for (size_t i = 0; i < engine.entities.object_.size(); i++)
+		{
+			Object *obj = engine.entities.object_[i];
+			char buf[256];
+			snprintf(buf, sizeof(buf), "%s%s %d %d %.3f %.3f %.3f", i > 0 ? "; " : "", obj->name_.c_str(),
+				obj->pos_.GetTrackId(), obj->pos_.GetLaneId(), obj->pos_.GetS(), obj->pos_.GetX(), obj->pos_.GetY());
+			run->end_state += buf;
+		}
+	}
+	catch (const std::exception &e)
+	{
+		LOG("%s: %s", run->filename.c_str(), e.what());
+		run->status = RUN_ERROR;
+	}
+
+	run->wall_time = timer.DurationS();
+}
+
+static void worker_thread(void *args)
+{
+	BatchWorker *worker = (BatchWorker*)args;
+	int run;
+
+	while ((run = worker->queue->Get(worker->id)) >= 0)
+	{
+		Run(&(*worker->runs)[run], worker->timestep, worker->max_time);
+	}
+}
+
+static bool WildcardMatch(const char *pattern, const char *str)
+{
+	if (*pattern == 0)
+	{
+		return *str == 0;
+	}
+	else if (*pattern == '*')
+	{
+		return WildcardMatch(pattern + 1, str) || (*str != 0 && WildcardMatch(pattern, str + 1));
+	}
+	else if (*str != 0 && (*pattern == '?' || *pattern == *str))
+	{
+		return WildcardMatch(pattern + 1, str + 1);
+	}
+
+	return false;
+}
+
+// Expand wildcards (* and ?) in filename part of pattern, in case not already done by the shell
+static std::vector<std::string> ExpandFilePattern(std::string pattern)
+{
+	std::vector<std::string> files;
+
+	if (pattern.find_first_of("*?") == std::string::npos)
+	{
+		files.push_back(pattern);
+		return files;
+	}
+
+	std::string file_pattern = FileNameOf(pattern);
+	std::string dir = DirNameOf(pattern);
+	std::string prefix = file_pattern == pattern ? "" : dir + "/";
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE handle = FindFirstFileA((dir + "/*").c_str(), &data);
+	if (handle != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (WildcardMatch(file_pattern.c_str(), data.cFileName))
+			{
+				files.push_back(prefix + data.cFileName);
+			}
+		} while (FindNextFileA(handle, &data));
+		FindClose(handle);
+	}
+#else
+	DIR *d = opendir(dir.c_str());
+	if (d)
+	{
+		struct dirent *entry;
+		while ((entry = readdir(d)) != 0)
+		{
+			if (WildcardMatch(file_pattern.c_str(), entry->d_name))
+			{
+				files.push_back(prefix + entry->d_name);
+			}
+		}
+		closedir(d);
+	}
+#endif
+
+	std::sort(files.begin(), files.end());
+
+	return files;
+}
+
+static const char *RunStatus2Str(RunStatus status)
+{
+	if (status == RUN_STOP_TRIGGER) return "stop";
+	else if (status == RUN_TIMEOUT) return "timeout";
+	else if (status == RUN_ERROR) return "error";
+	else return "not run";
+}
+
+static std::string Parameters2Str(std::vector<ParameterStruct> &parameters)
+{
+	std::string str;
+
+	for (size_t i = 0; i < parameters.size(); i++)
+	{
+		str += (i > 0 ? " " : "") + parameters[i].name + "=" + parameters[i].value;
+	}
+
+	return str;
+}
+
+int main(int argc, char *argv[])
+{
+	SE_Options opt;
+	std::string arg_str;
+	std::vector<std::pair<std::string, std::vector<std::string> > > matrix;
+
+	opt.AddOption("param", "Parameter values, e.g. --param Speed=10,20,30. Repeat for several parameters, all combinations are run", "name=values");
+	opt.AddOption("fixed_timestep", "Simulation timestep (default 0.05)", "timestep");
+	opt.AddOption("max_time", "Stop any scenario still running at this simulation time (default 3600)", "time");
+	opt.AddOption("threads", "Number of worker threads (default number of hardware threads)", "number");
+	opt.AddOption("csv", "Save summary, including end state of each object (name road lane s x y), in specified CSV file", "filename");
+	opt.AddOption("profile", "Measure time spent in hot paths over all runs, save statistics and histograms (JSON)", "filename");
+
+	if (argc < 2)
+	{
+		printf("Usage: %s [options] scenario files or patterns, e.g. ../resources/xosc/*.xosc\n", FileNameOf(argv[0]).c_str());
+		opt.PrintUsage();
+		return -1;
+	}
+
+	// Parameters may be repeated, which the option parser does not support. Extract them first.
+	for (int i = 1; i < argc - 1;)
+	{
+		if (std::string(argv[i]) == OPT_PREFIX "param")
+		{
+			std::string param = argv[i + 1];
+			size_t eq = param.find('=');
+			if (eq == std::string::npos || eq == 0)
+			{
+				printf("Invalid parameter argument: %s\n", param.c_str());
+				return -1;
+			}
+			matrix.push_back(std::make_pair(param.substr(0, eq), SplitString(param.substr(eq + 1), ',')));
+
+			for (int j = i; j < argc - 2; j++)
+			{
+				argv[j] = argv[j + 2];
+			}
+			argc -= 2;
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	opt.ParseArgs(&argc, argv);
+
+	double timestep = DEFAULT_TIMESTEP;
+	if ((arg_str = opt.GetOptionArg("fixed_timestep")) != "")
+	{
+		timestep = atof(arg_str.c_str());
+	}
+
+	double max_time = DEFAULT_MAX_TIME;
+	if ((arg_str = opt.GetOptionArg("max_time")) != "")
+	{
+		max_time = atof(arg_str.c_str());
+	}
+
+	int n_threads = (int)std::thread::hardware_concurrency();
+	if ((arg_str = opt.GetOptionArg("threads")) != "")
+	{
+		n_threads = atoi(arg_str.c_str());
+	}
+	n_threads = MAX(n_threads, 1);
+
+	if (timestep <= 0.0)
+	{
+		printf("Invalid timestep %.3f\n", timestep);
+		return -1;
+	}
+
+	// Remaining arguments are scenario files
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++)
+	{
+		std::vector<std::string> expanded = ExpandFilePattern(argv[i]);
+		if (expanded.empty())
+		{
+			printf("No files matching %s\n", argv[i]);
+		}
+		files.insert(files.end(), expanded.begin(), expanded.end());
+	}
+
+	// One run per file and combination of parameter values
+	std::vector<BatchRun> runs;
+	int n_sumo = 0;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		bool sumo = UsesSumo(files[i]);
+		std::vector<size_t> idx(matrix.size(), 0);
+		for (;;)
+		{
+			BatchRun run;
+			run.filename = files[i];
+			run.status = RUN_NOT_STARTED;
+			run.sim_time = 0.0;
+			run.n_steps = 0;
+			run.wall_time = 0.0;
+			run.sumo = sumo;
+			n_sumo += sumo ? 1 : 0;
+			for (size_t j = 0; j < matrix.size(); j++)
+			{
+				ParameterStruct param;
+				param.name = matrix[j].first;
+				param.type = "string";
+				param.value = matrix[j].second[idx[j]];
+				run.parameters.push_back(param);
+			}
+			runs.push_back(run);
+
+			// Next combination, first parameter varying fastest
+			size_t j = 0;
+			for (; j < matrix.size() && ++idx[j] == matrix[j].second.size(); j++)
+			{
+				idx[j] = 0;
+			}
+			if (j == matrix.size())
+			{
+				break;
+			}
+		}
+	}
+
+	if (runs.empty())
+	{
+		printf("No scenarios to run\n");
+		return -1;
+	}
+
+	n_threads = MIN(n_threads, (int)runs.size());
+	printf("Running %d scenarios on %d threads\n", (int)runs.size(), n_threads);
+	if (n_sumo > 0)
+	{
+		printf("%d of them involve SUMO, run one at a time on thread 0\n", n_sumo);
+	}
+
+	BatchQueue queue(n_threads);
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		if (runs[i].sumo)
+		{
+			queue.Add(0, (int)i, true);
+		}
+		else
+		{
+			queue.Add((int)(i % n_threads), (int)i);
+		}
+	}
+
+	std::string profile_filename = opt.GetOptionArg("profile");
+	if (!profile_filename.empty())
+	{
+		SE_Profiler::Inst().Enable(true);
+	}
+
+	SE_SystemTimer timer;
+	timer.Start();
+
+	std::vector<BatchWorker> workers(n_threads);
+	for (int i = 0; i < n_threads; i++)
+	{
+		workers[i].id = i;
+		workers[i].queue = &queue;
+		workers[i].runs = &runs;
+		workers[i].timestep = timestep;
+		workers[i].max_time = max_time;
+		workers[i].thread.Start(worker_thread, &workers[i]);
+	}
+	for (int i = 0; i < n_threads; i++)
+	{
+		workers[i].thread.Wait();
+	}
+
+	double wall_time = timer.DurationS();
+
+	if (!profile_filename.empty() && SE_Profiler::Inst().WriteJSON(profile_filename) == 0)
+	{
+		printf("Profile written to %s\n", profile_filename.c_str());
+	}
+
+	// Summary
+	FILE *csv = 0;
+	if ((arg_str = opt.GetOptionArg("csv")) != "")
+	{
+		if ((csv = fopen(arg_str.c_str(), "w")) == 0)
+		{
+			printf("Failed to create %s\n", arg_str.c_str());
+		}
+		else
+		{
+			fprintf(csv, "scenario, parameters, status, sim_time, steps, wall_time, steps_per_s, end_state\n");
+		}
+	}
+
+	int n_errors = 0;
+	long long n_steps = 0;
+	printf("\n%-8s %10s %10s %10s %12s  %s\n", "status", "sim time", "steps", "wall time", "steps/s", "scenario");
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		BatchRun *run = &runs[i];
+		double steps_per_s = run->wall_time > SMALL_NUMBER ? run->n_steps / run->wall_time : 0.0;
+		std::string params = Parameters2Str(run->parameters);
+
+		printf("%-8s %10.2f %10d %10.3f %12.0f  %s %s\n", RunStatus2Str(run->status), run->sim_time, run->n_steps,
+			run->wall_time, steps_per_s, run->filename.c_str(), params.c_str());
+
+		if (csv)
+		{
+			fprintf(csv, "%s, %s, %s, %.3f, %d, %.3f, %.0f, %s\n", run->filename.c_str(), params.c_str(),
+				RunStatus2Str(run->status), run->sim_time, run->n_steps, run->wall_time, steps_per_s, run->end_state.c_str());
+		}
+
+		if (run->status == RUN_ERROR)
+		{
+			n_errors++;
+		}
+		n_steps += run->n_steps;
+	}
+
+	printf("\n%d runs, %d errors, %.3f s wall time, %.0f steps/s on %d threads\n", (int)runs.size(), n_errors, wall_time,
+		wall_time > SMALL_NUMBER ? n_steps / wall_time : 0.0, n_threads);
+
+	if (csv)
+	{
+		fclose(csv);
+	}
+
+	return n_errors > 0 ? -1 : 0;
+}
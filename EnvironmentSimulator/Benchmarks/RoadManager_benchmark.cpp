@@ -0,0 +1,511 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+ /*
+  * Performance benchmarks of the RoadManager: loading, positioning and routing
+  * Run with e.g. --benchmark_out=result.json --benchmark_out_format=json for machine readable output
+  */
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <stdio.h>
+#include "RoadManager.hpp"
+#include "CommonMini.hpp"
+
+using namespace roadmanager;
+
+#define N_SAMPLES 1000
+#define N_CACHED_PATHS 32  // start/target pairs cycled through when benchmarking the road path cache, well below its capacity
+
+#ifndef BENCHMARK_OUTPUT_DIR
+#define BENCHMARK_OUTPUT_DIR "."
+#endif
+
+typedef struct
+{
+	int road_id;
+	int lane_id;
+	double s;
+	double x;
+	double y;
+	double h;
+} SamplePos;
+
+// Bundled road networks plus synthetic ones of given number of roads
+static const char *network_name[] = { "e6mini", "soderleden", "multi_intersections", "synthetic_100", "synthetic_1000" };
+static const int synthetic_n_roads[] = { 0, 0, 0, 100, 1000 };
+#define N_NETWORKS (sizeof(network_name) / sizeof(char*))
+
+/*
+  Create a long chain of roads, alternating straight and curved segments, three lanes in each direction.
+  Written to file in the benchmark output directory. Returns filename.
+*/
+static std::string CreateSyntheticNetwork(int n_roads)
+{
+	std::string filename = std::string(BENCHMARK_OUTPUT_DIR) + "/synthetic_" + std::to_string(n_roads) + ".xodr";
+	FILE *file = fopen(filename.c_str(), "w");
+
+	if (file == 0)
+	{
+		LOG("Failed to create %s", filename.c_str());
+		return "";
+	}
+
+	const double line_length = 50.0;
+	const double arc_length = 50.0;
+	double x = 0.0;
+	double y = 0.0;
+	double h = 0.0;
+
+	fprintf(file, "<?xml version=\"1.0\" standalone=\"yes\"?>\n<OpenDRIVE>\n");
+	fprintf(file, "<header revMajor=\"1\" revMinor=\"4\" name=\"synthetic\" version=\"1.00\"/>\n");
+
+	for (int i = 0; i < n_roads; i++)
+	{
+		int id = i + 1;
+		double curvature = (i % 2 == 0) ? 0.01 : -0.01;
+
+		fprintf(file, "<road name=\"\" length=\"%.6f\" id=\"%d\" junction=\"-1\">\n<link>\n", line_length + arc_length, id);
+		if (i > 0)
+		{
+			fprintf(file, "<predecessor elementType=\"road\" elementId=\"%d\" contactPoint=\"end\"/>\n", id - 1);
+		}
+		if (i < n_roads - 1)
+		{
+			fprintf(file, "<successor elementType=\"road\" elementId=\"%d\" contactPoint=\"start\"/>\n", id + 1);
+		}
+		fprintf(file, "</link>\n<planView>\n");
+
+		fprintf(file, "<geometry s=\"0.0\" x=\"%.6f\" y=\"%.6f\" hdg=\"%.9f\" length=\"%.6f\"><line/></geometry>\n", x, y, h, line_length);
+		x += line_length * cos(h);
+		y += line_length * sin(h);
+
+		fprintf(file, "<geometry s=\"%.6f\" x=\"%.6f\" y=\"%.6f\" hdg=\"%.9f\" length=\"%.6f\"><arc curvature=\"%.6f\"/></geometry>\n",
+			line_length, x, y, h, arc_length, curvature);
+		double h_end = h + curvature * arc_length;
+		x += (sin(h_end) - sin(h)) / curvature;
+		y += (cos(h) - cos(h_end)) / curvature;
+		h = h_end;
+
+		fprintf(file, "</planView>\n<lanes>\n<laneSection s=\"0.0\">\n");
+		for (int side = 1; side >= -1; side -= 2)
+		{
+			fprintf(file, side > 0 ? "<left>\n" : "<right>\n");
+			for (int j = 3; j >= 1; j--)
+			{
+				int lane_id = side > 0 ? j : -(4 - j);
+				fprintf(file, "<lane id=\"%d\" type=\"driving\" level=\"false\">\n", lane_id);
+				fprintf(file, "<link><predecessor id=\"%d\"/><successor id=\"%d\"/></link>\n", lane_id, lane_id);
+				fprintf(file, "<width sOffset=\"0.0\" a=\"3.5\" b=\"0.0\" c=\"0.0\" d=\"0.0\"/>\n");
+				fprintf(file, "<roadMark sOffset=\"0.0\" type=\"%s\" weight=\"standard\" color=\"standard\" width=\"0.12\"/>\n",
+					(lane_id == 3 || lane_id == -3) ? "solid" : "broken");
+				fprintf(file, "</lane>\n");
+			}
+			if (side > 0)
+			{
+				fprintf(file, "</left>\n<center>\n<lane id=\"0\" type=\"driving\" level=\"false\">\n");
+				fprintf(file, "<roadMark sOffset=\"0.0\" type=\"solid\" weight=\"standard\" color=\"standard\" width=\"0.12\"/>\n");
+				fprintf(file, "</lane>\n</center>\n");
+			}
+			else
+			{
+				fprintf(file, "</right>\n");
+			}
+		}
+		fprintf(file, "</laneSection>\n</lanes>\n</road>\n");
+	}
+	fprintf(file, "</OpenDRIVE>\n");
+	fclose(file);
+
+	return filename;
+}
+
+static std::string GetNetworkFilename(size_t index)
+{
+	static std::string synthetic_filename[N_NETWORKS];
+
+	if (synthetic_n_roads[index] > 0)
+	{
+		if (synthetic_filename[index].empty())
+		{
+			synthetic_filename[index] = CreateSyntheticNetwork(synthetic_n_roads[index]);
+		}
+		return synthetic_filename[index];
+	}
+
+	return std::string(BENCHMARK_RESOURCES_DIR) + "/xodr/" + network_name[index] + ".xodr";
+}
+
+// Load network as the global one used by Position objects, unless already loaded
+static OpenDrive *LoadNetwork(benchmark::State &state, size_t index)
+{
+	static std::string loaded_filename;
+	std::string filename = GetNetworkFilename(index);
+
+	state.SetLabel(network_name[index]);
+
+	if (filename != loaded_filename)
+	{
+		if (filename.empty() || !Position::LoadOpenDrive(filename.c_str()))
+		{
+			state.SkipWithError("Failed to load road network");
+			return 0;
+		}
+		loaded_filename = filename;
+	}
+
+	return Position::GetOpenDrive();
+}
+
+// Random positions in driving lanes, same for every run
+static std::vector<SamplePos> SamplePositions(OpenDrive *odr, int n)
+{
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> dist(0.0, 1.0);
+	std::vector<SamplePos> samples;
+
+	for (int i = 0; (int)samples.size() < n && i < 100 * n; i++)
+	{
+		Road *road = odr->GetRoadByIdx(gen() % odr->GetNumOfRoads());
+		double s = dist(gen) * road->GetLength();
+		int n_lanes = road->GetNumberOfDrivingLanes(s);
+		if (n_lanes == 0)
+		{
+			continue;
+		}
+
+		Lane *lane = road->GetDrivingLaneByIdx(s, gen() % n_lanes);
+		Position pos;
+		if (lane == 0 || pos.SetLanePos(road->GetId(), lane->GetId(), s, 0) != 0)
+		{
+			continue;
+		}
+
+		SamplePos sample = { road->GetId(), lane->GetId(), s, pos.GetX(), pos.GetY(), pos.GetH() };
+		samples.push_back(sample);
+	}
+
+	return samples;
+}
+
+static void NetworkArgs(benchmark::internal::Benchmark *b)
+{
+	for (size_t i = 0; i < N_NETWORKS; i++)
+	{
+		b->Arg((int)i);
+	}
+}
+
+// Parse OpenDRIVE file and build road data structures, including OSI points and road grid
+static void BM_LoadOpenDrive(benchmark::State &state)
+{
+	std::string filename = GetNetworkFilename(state.range(0));
+	int n_roads = 0;
+
+	state.SetLabel(network_name[state.range(0)]);
+	for (auto _ : state)
+	{
+		OpenDrive odr(filename.c_str());
+		n_roads = odr.GetNumOfRoads();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.counters["roads"] = n_roads;
+}
+BENCHMARK(BM_LoadOpenDrive)->Apply(NetworkArgs)->Unit(benchmark::kMillisecond);
+
+/*
+  Map random world coordinates to road coordinates, no coherence between lookups. Second argument:
+  1 = candidate roads from the road grid (default)
+  0 = exhaustive search over all roads, for comparison
+*/
+static void BM_XYZH2TrackPos_Random(benchmark::State &state)
+{
+	OpenDrive *odr = LoadNetwork(state, state.range(0));
+	if (odr == 0)
+	{
+		return;
+	}
+
+	std::vector<SamplePos> samples = SamplePositions(odr, N_SAMPLES);
+	Position pos;
+	size_t i = 0;
+
+	odr->SetUseRoadGrid(state.range(1) != 0);
+	for (auto _ : state)
+	{
+		SamplePos &p = samples[i++ % samples.size()];
+		benchmark::DoNotOptimize(pos.XYZH2TrackPos(p.x, p.y, 0, p.h));
+	}
+	odr->SetUseRoadGrid(true);
+
+	state.SetItemsProcessed(state.iterations());
+}
+static void RoadGridArgs(benchmark::internal::Benchmark *b)
+{
+	for (size_t i = 0; i < N_NETWORKS; i++)
+	{
+		b->Args({ (int)i, 1 });
+		b->Args({ (int)i, 0 });
+	}
+}
+BENCHMARK(BM_XYZH2TrackPos_Random)->Apply(RoadGridArgs);
+
+// Map world coordinates to road coordinates along a driven path, as when following externally controlled vehicles
+static void BM_XYZH2TrackPos_Tracking(benchmark::State &state)
+{
+	OpenDrive *odr = LoadNetwork(state, state.range(0));
+	if (odr == 0)
+	{
+		return;
+	}
+
+	// Record a path by driving 1 m steps from a few random starting points
+	std::vector<SamplePos> starts = SamplePositions(odr, 10);
+	std::vector<SamplePos> path;
+	for (size_t i = 0; i < starts.size(); i++)
+	{
+		Position pos;
+		pos.SetLanePos(starts[i].road_id, starts[i].lane_id, starts[i].s, 0);
+		for (int j = 0; j < N_SAMPLES / 10 && pos.MoveAlongS(1.0, 0, Junction::STRAIGHT) == 0; j++)
+		{
+			SamplePos sample = { pos.GetTrackId(), pos.GetLaneId(), pos.GetS(), pos.GetX(), pos.GetY(), pos.GetH() };
+			path.push_back(sample);
+		}
+	}
+	if (path.empty())
+	{
+		state.SkipWithError("No path");
+		return;
+	}
+
+	Position pos;
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		SamplePos &p = path[i++ % path.size()];
+		benchmark::DoNotOptimize(pos.XYZH2TrackPos(p.x, p.y, 0, p.h));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_XYZH2TrackPos_Tracking)->Apply(NetworkArgs);
+
+// Move 1 m along the lane, restarting at a new random position when reaching end of road network
+static void BM_MoveAlongS(benchmark::State &state)
+{
+	OpenDrive *odr = LoadNetwork(state, state.range(0));
+	if (odr == 0)
+	{
+		return;
+	}
+
+	std::vector<SamplePos> samples = SamplePositions(odr, N_SAMPLES);
+	Position pos;
+	size_t i = 0;
+
+	pos.SetLanePos(samples[0].road_id, samples[0].lane_id, samples[0].s, 0);
+	for (auto _ : state)
+	{
+		if (pos.MoveAlongS(1.0) != 0)
+		{
+			SamplePos &p = samples[++i % samples.size()];
+			pos.SetLanePos(p.road_id, p.lane_id, p.s, 0);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MoveAlongS)->Apply(NetworkArgs);
+
+/*
+  Evaluate position and heading along a geometry, at random distances. Arguments:
+  0 = highway like clothoid (Spiral, Fresnel integrals), 1 = ParamPoly3 curve
+  0 = exact evaluation, 1 = geometry lookup table of default tolerance
+*/
+static void BM_EvaluateDS(benchmark::State &state)
+{
+	Spiral spiral(0, 100, -50, 0.3, 150, 0.0, 0.004);
+	ParamPoly3 ppoly(0, 5, 5, 1.0, 120, 0, 1, 0.3, -0.1, 0, 0, 0.5, -0.2, ParamPoly3::P_RANGE_NORMALIZED);
+	Geometry *geom = state.range(0) == 0 ? (Geometry*)&spiral : (Geometry*)&ppoly;
+
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> dist(0.0, geom->GetLength());
+	std::vector<double> ds(N_SAMPLES);
+	for (size_t j = 0; j < ds.size(); j++)
+	{
+		ds[j] = dist(gen);
+	}
+
+	Geometry::SetUseLookupTable(state.range(1) != 0);
+	geom->UpdateLookupTable();
+	state.SetLabel(state.range(0) == 0 ? "spiral" : "parampoly3");
+
+	double x, y, h;
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		geom->EvaluateDS(ds[i++ % ds.size()], &x, &y, &h);
+		benchmark::DoNotOptimize(x);
+	}
+	Geometry::SetUseLookupTable(false);
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EvaluateDS)->Args({ 0, 0 })->Args({ 0, 1 })->Args({ 1, 0 })->Args({ 1, 1 });
+
+/*
+  Road to world coordinates of random lane positions, in random order. Second argument:
+  1 = all positions in one OpenDrive::EvaluateLanePositions call
+  0 = one by one by Position::SetLanePos, for comparison
+*/
+static void BM_EvaluateLanePositions(benchmark::State &state)
+{
+	OpenDrive *odr = LoadNetwork(state, state.range(0));
+	if (odr == 0)
+	{
+		return;
+	}
+
+	std::vector<SamplePos> samples = SamplePositions(odr, N_SAMPLES);
+	std::vector<LanePositionQuery> query(samples.size());
+	for (size_t j = 0; j < samples.size(); j++)
+	{
+		query[j] = { samples[j].road_id, samples[j].lane_id, samples[j].s, 0.0 };
+	}
+	std::vector<LanePositionResult> result(query.size());
+	Position pos;
+	bool batch = state.range(1) != 0;
+
+	for (auto _ : state)
+	{
+		if (batch)
+		{
+			odr->EvaluateLanePositions(query.data(), result.data(), (int)query.size());
+		}
+		else
+		{
+			for (size_t j = 0; j < query.size(); j++)
+			{
+				pos.SetLanePos(query[j].road_id, query[j].lane_id, query[j].s, query[j].offset);
+			}
+		}
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * query.size());
+}
+static void LanePositionArgs(benchmark::internal::Benchmark *b)
+{
+	for (size_t i = 0; i < N_NETWORKS; i++)
+	{
+		b->Args({ (int)i, 1 });
+		b->Args({ (int)i, 0 });
+	}
+}
+BENCHMARK(BM_EvaluateLanePositions)->Apply(LanePositionArgs);
+
+// Look up road by id, random ids of roads in the network
+static void BM_GetRoadById(benchmark::State &state)
+{
+	OpenDrive *odr = LoadNetwork(state, state.range(0));
+	if (odr == 0)
+	{
+		return;
+	}
+
+	std::mt19937 gen(1);
+	std::vector<int> ids(N_SAMPLES);
+	for (size_t j = 0; j < ids.size(); j++)
+	{
+		ids[j] = odr->GetRoadByIdx(gen() % odr->GetNumOfRoads())->GetId();
+	}
+
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(odr->GetRoadById(ids[i++ % ids.size()]));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetRoadById)->Apply(NetworkArgs);
+
+/*
+  Shortest path between random positions. Second argument:
+  0 = clear road path cache before each search, i.e. always a full search
+  1 = cycle through a few start/target pairs, all fitting in the cache, i.e. cache hits once warmed up
+*/
+static void BM_RoadPath(benchmark::State &state)
+{
+	OpenDrive *odr = LoadNetwork(state, state.range(0));
+	if (odr == 0)
+	{
+		return;
+	}
+
+	bool cached = state.range(1) != 0;
+	std::vector<SamplePos> samples = SamplePositions(odr, 100);
+	std::vector<Position> positions(samples.size());
+	for (size_t j = 0; j < samples.size(); j++)
+	{
+		positions[j].SetLanePos(samples[j].road_id, samples[j].lane_id, samples[j].s, 0);
+	}
+
+	// Pairs of position indices, all combinations in uncached case, a small fixed set in cached case
+	std::vector<std::pair<size_t, size_t> > pairs;
+	for (size_t j = 0; j < positions.size() * positions.size(); j++)
+	{
+		size_t start = j % positions.size();
+		size_t target = (start + 1 + j / positions.size()) % positions.size();
+		pairs.push_back(std::make_pair(start, target));
+	}
+	if (cached && pairs.size() > N_CACHED_PATHS)
+	{
+		pairs.resize(N_CACHED_PATHS);
+	}
+
+	RoadPathCache *cache = odr->GetRoadPathCache();
+	cache->Clear();
+	size_t i = 0;
+	int n_found = 0;
+	for (auto _ : state)
+	{
+		if (!cached)
+		{
+			cache->Clear();
+		}
+
+		double dist;
+		std::pair<size_t, size_t> &pair = pairs[i++ % pairs.size()];
+		RoadPath path(&positions[pair.first], &positions[pair.second]);
+		if (path.Calculate(dist) == 0)
+		{
+			n_found++;
+		}
+	}
+	int hits = cache->GetNumberOfHits();
+	int misses = cache->GetNumberOfMisses();
+
+	state.SetItemsProcessed(state.iterations());
+	state.counters["found"] = benchmark::Counter(n_found, benchmark::Counter::kAvgIterations);
+	state.counters["cache_hit_rate"] = hits + misses > 0 ? (double)hits / (hits + misses) : 0.0;
+}
+static void RoadPathArgs(benchmark::internal::Benchmark *b)
+{
+	for (size_t i = 0; i < N_NETWORKS; i++)
+	{
+		b->Args({ (int)i, 0 });
+		b->Args({ (int)i, 1 });
+	}
+}
+BENCHMARK(BM_RoadPath)->Apply(RoadPathArgs);
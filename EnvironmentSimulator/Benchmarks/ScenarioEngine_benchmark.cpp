@@ -0,0 +1,135 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+ /*
+  * Performance benchmarks of complete scenario steps and OSI serialization, through the ScenarioEngineDLL API
+  * Run with e.g. --benchmark_out=result.json --benchmark_out_format=json for machine readable output
+  */
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include "scenarioenginedll.hpp"
+
+#define STEP_DT 0.05f
+#define OSI_WARMUP_STEPS 20
+
+static const char *scenario_name[] = { "cut-in", "highway_merge" };
+#define N_SCENARIOS (sizeof(scenario_name) / sizeof(char*))
+
+static std::string GetScenarioFilename(int index)
+{
+	return std::string(BENCHMARK_RESOURCES_DIR) + "/xosc/" + scenario_name[index] + ".xosc";
+}
+
+static void ScenarioArgs(benchmark::internal::Benchmark *b)
+{
+	for (int i = 0; i < (int)N_SCENARIOS; i++)
+	{
+		b->Arg(i);
+	}
+}
+
+// One full scenario step: storyboard, object update, gateway and OSI ground truth
+static void BM_ScenarioStep(benchmark::State& state)
+{
+	std::string filename = GetScenarioFilename((int)state.range(0));
+	double sim_time = 0.0;
+
+	if (SE_Init(filename.c_str(), 0, 0, 0, 0, 0.0f) != 0)
+	{
+		state.SkipWithError(("Failed to load " + filename).c_str());
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		if (SE_GetQuitFlag())
+		{
+			// Scenario ended, restart it outside the measurement
+			state.PauseTiming();
+			SE_Close();
+			SE_Init(filename.c_str(), 0, 0, 0, 0, 0.0f);
+			state.ResumeTiming();
+		}
+		SE_StepDT(STEP_DT);
+		sim_time += STEP_DT;
+	}
+
+	state.counters["objects"] = SE_GetNumberOfObjects();
+	state.counters["sim_seconds"] = benchmark::Counter(sim_time, benchmark::Counter::kIsRate);
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(scenario_name[state.range(0)]);
+
+	SE_Close();
+}
+BENCHMARK(BM_ScenarioStep)->Apply(ScenarioArgs)->Unit(benchmark::kMicrosecond);
+
+// Update and serialize the OSI SensorView of a scenario in mid-run state
+static void BM_OSISensorView(benchmark::State& state)
+{
+	std::string filename = GetScenarioFilename((int)state.range(0));
+	int size = 0;
+
+	if (SE_Init(filename.c_str(), 0, 0, 0, 0, 0.0f) != 0)
+	{
+		state.SkipWithError(("Failed to load " + filename).c_str());
+		return;
+	}
+
+	for (int i = 0; i < OSI_WARMUP_STEPS; i++)
+	{
+		SE_StepDT(STEP_DT);
+	}
+
+	for (auto _ : state)
+	{
+		SE_UpdateOSISensorView();
+		benchmark::DoNotOptimize(SE_GetOSISensorView(&size));
+	}
+
+	state.counters["msg_bytes"] = size;
+	state.SetBytesProcessed(state.iterations() * (int64_t)size);
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(scenario_name[state.range(0)]);
+
+	SE_Close();
+}
+BENCHMARK(BM_OSISensorView)->Apply(ScenarioArgs)->Unit(benchmark::kMicrosecond);
+
+// Update the OSI SensorView and access it in-process, without serialization
+static void BM_OSISensorViewRaw(benchmark::State& state)
+{
+	std::string filename = GetScenarioFilename((int)state.range(0));
+
+	if (SE_Init(filename.c_str(), 0, 0, 0, 0, 0.0f) != 0)
+	{
+		state.SkipWithError(("Failed to load " + filename).c_str());
+		return;
+	}
+
+	for (int i = 0; i < OSI_WARMUP_STEPS; i++)
+	{
+		SE_StepDT(STEP_DT);
+	}
+
+	for (auto _ : state)
+	{
+		SE_UpdateOSISensorView();
+		benchmark::DoNotOptimize(SE_GetOSISensorViewRaw());
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(scenario_name[state.range(0)]);
+
+	SE_Close();
+}
+BENCHMARK(BM_OSISensorViewRaw)->Apply(ScenarioArgs)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,183 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+ /*
+  * Latency of publishing a message, e.g. serialized OSI SensorView, to a reader on the same host:
+  * shared memory ring buffer versus fragmented UDP over loopback.
+  * Each iteration publishes one message and waits until the reader thread has it. Reported latency_us
+  * is the one-way time measured by the reader, from the send time stamped into the message payload
+  * to available, the same way for both transports and regardless of any transport header.
+  */
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include "CommonMini.hpp"
+#include "SharedMemory.hpp"
+#include "UDP.hpp"
+
+#define TRANSPORT_SHM_NAME "esmini_benchmark"
+#define TRANSPORT_UDP_PORT 48299
+#define TRANSPORT_TIMEOUT 1000000  // us, give up waiting for a message
+
+static void MessageSizeArgs(benchmark::internal::Benchmark *b)
+{
+	// small message, OSI SensorView of a typical scenario, large road network
+	b->Arg(1 << 10)->Arg(64 << 10)->Arg(2 << 20);
+}
+
+// Put current time first in the message, just before it is sent
+static void StampMessage(std::vector<char> &msg)
+{
+	__int64 now = SE_getSystemTimeUs();
+	memcpy(msg.data(), &now, sizeof(now));
+}
+
+// Time (us) since message was stamped
+static __int64 GetMessageAge(const char *data)
+{
+	__int64 send_time;
+	memcpy(&send_time, data, sizeof(send_time));
+	return SE_getSystemTimeUs() - send_time;
+}
+
+// Main thread publishes, waits for reader thread to count the message as received
+static bool WaitForReader(std::atomic<unsigned long long> &n_received, unsigned long long n_sent)
+{
+	__int64 start_time = SE_getSystemTimeUs();
+
+	while (n_received.load(std::memory_order_acquire) < n_sent)
+	{
+		if (SE_getSystemTimeUs() - start_time > TRANSPORT_TIMEOUT)
+		{
+			return false;
+		}
+		std::this_thread::yield();  // let the reader run also on a single core
+	}
+
+	return true;
+}
+
+static void BM_TransportSharedMemory(benchmark::State& state)
+{
+	unsigned int size = (unsigned int)state.range(0);
+	std::vector<char> msg(size, 1);
+	SE_SharedMemoryWriter writer;
+	SE_SharedMemoryReader reader;
+
+	if (writer.Open(TRANSPORT_SHM_NAME, size, 0, SE_SHM_N_SLOTS) != 0 || reader.Open(TRANSPORT_SHM_NAME) != 0)
+	{
+		state.SkipWithError("Failed to open shared memory");
+		return;
+	}
+	reader.SetSpinTime(TRANSPORT_TIMEOUT);  // lowest possible latency
+
+	std::atomic<unsigned long long> n_received(0);
+	std::atomic<bool> quit(false);
+	__int64 latency_sum = 0;
+	int checksum = 0;
+
+	std::thread reader_thread([&]()
+	{
+		while (!quit.load(std::memory_order_relaxed))
+		{
+			if (reader.Acquire(100) > 0)
+			{
+				// read in place, just touch the data
+				__int64 latency = GetMessageAge(reader.GetMessageData());
+				checksum += reader.GetMessageData()[reader.GetMessageSize() - 1];
+				if (reader.Validate())
+				{
+					latency_sum += latency;
+					n_received.fetch_add(1, std::memory_order_release);
+				}
+			}
+		}
+	});
+
+	unsigned long long n_sent = 0;
+	for (auto _ : state)
+	{
+		StampMessage(msg);
+		writer.Write(0.0, 0, 0, msg.data(), size);
+		if (!WaitForReader(n_received, ++n_sent))
+		{
+			state.SkipWithError("Message lost");
+			break;
+		}
+	}
+
+	quit = true;
+	reader_thread.join();
+
+	state.counters["latency_us"] = n_received > 0 ? (double)latency_sum / n_received : 0.0;
+	state.SetBytesProcessed(state.iterations() * (int64_t)size);
+	benchmark::DoNotOptimize(checksum);
+}
+BENCHMARK(BM_TransportSharedMemory)->Apply(MessageSizeArgs)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_TransportUDP(benchmark::State& state)
+{
+	unsigned int size = (unsigned int)state.range(0);
+	std::vector<char> msg(size, 1);
+	SE_UDPFragmentSender sender;
+	SE_UDPFragmentReceiver receiver;
+
+	if (receiver.Open(TRANSPORT_UDP_PORT, 100) != 0 || sender.Open("127.0.0.1", TRANSPORT_UDP_PORT) != 0)
+	{
+		state.SkipWithError("Failed to open UDP sockets");
+		return;
+	}
+
+	std::atomic<unsigned long long> n_received(0);
+	std::atomic<bool> quit(false);
+	__int64 latency_sum = 0;
+	int checksum = 0;
+
+	std::thread receiver_thread([&]()
+	{
+		while (!quit.load(std::memory_order_relaxed))
+		{
+			int ret = receiver.Receive();
+			if (ret > 0)
+			{
+				// GetLatency() covers fragmented messages only, use the time stamp in the payload instead
+				latency_sum += GetMessageAge(receiver.GetMessageData());
+				checksum += receiver.GetMessageData()[ret - 1];
+				n_received.fetch_add(1, std::memory_order_release);
+			}
+		}
+	});
+
+	unsigned long long n_sent = 0;
+	for (auto _ : state)
+	{
+		StampMessage(msg);
+		sender.Send(msg.data(), size);
+		if (!WaitForReader(n_received, ++n_sent))
+		{
+			state.SkipWithError("Message lost");
+			break;
+		}
+	}
+
+	quit = true;
+	receiver_thread.join();
+
+	state.counters["latency_us"] = n_received > 0 ? (double)latency_sum / n_received : 0.0;
+	state.counters["dropped"] = (double)receiver.GetNumberOfDropped();
+	state.SetBytesProcessed(state.iterations() * (int64_t)size);
+	benchmark::DoNotOptimize(checksum);
+}
+BENCHMARK(BM_TransportUDP)->Apply(MessageSizeArgs)->Unit(benchmark::kMicrosecond)->UseRealTime();
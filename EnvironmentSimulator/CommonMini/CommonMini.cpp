@@ -13,6 +13,7 @@
 #include <stdarg.h> 
 #include <stdio.h>
 #include <iostream>
+#include <climits>
 
 #include "CommonMini.hpp"
 
@@ -330,6 +331,38 @@ void SwapByteOrder(unsigned char *buf, int data_type_size, int buf_size)
 		return timeGetTime();
 	}
 
+	__int64 SE_getSystemTimeUs()
+	{
+		static LARGE_INTEGER frequency = { 0 };
+		LARGE_INTEGER counter;
+
+		if (frequency.QuadPart == 0)
+		{
+			QueryPerformanceFrequency(&frequency);
+		}
+		QueryPerformanceCounter(&counter);
+
+		// split to avoid overflow
+		return (__int64)((counter.QuadPart / frequency.QuadPart) * 1000000 +
+			(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+	}
+
+	__int64 SE_getSystemTimeNs()
+	{
+		static LARGE_INTEGER frequency = { 0 };
+		LARGE_INTEGER counter;
+
+		if (frequency.QuadPart == 0)
+		{
+			QueryPerformanceFrequency(&frequency);
+		}
+		QueryPerformanceCounter(&counter);
+
+		// split to avoid overflow
+		return (__int64)((counter.QuadPart / frequency.QuadPart) * 1000000000 +
+			(counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart);
+	}
+
 	void SE_sleep(unsigned int msec)
 	{
 		Sleep(msec);
@@ -346,6 +379,16 @@ void SwapByteOrder(unsigned char *buf, int data_type_size, int buf_size)
 		return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
 	}
 
+	__int64 SE_getSystemTimeUs()
+	{
+		return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	__int64 SE_getSystemTimeNs()
+	{
+		return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
 	void SE_sleep(unsigned int msec)
 	{
 		std::this_thread::sleep_for(std::chrono::milliseconds((int)(msec)));
@@ -458,8 +501,7 @@ void NormalizeVec2D(double x, double y, double &xn, double &yn)
 Logger::Logger()
 {
 #ifndef SUPPRESS_LOG
-	file_.open(LOG_FILENAME);
-	if (file_.fail())
+	if (file_.Open(LOG_FILENAME, false) != 0)
 	{
 		throw std::iostream::failure(std::string("Cannot open file: ") + LOG_FILENAME);
 	}
@@ -467,24 +509,20 @@ Logger::Logger()
 	
 	static char message[1024];
 	snprintf(message, 1024, "esmini GIT REV: %s", esmini_git_rev());
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 	snprintf(message, 1024, "esmini GIT TAG: %s", esmini_git_tag());
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 	snprintf(message, 1024, "esmini GIT BRANCH: %s", esmini_git_branch());
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 	snprintf(message, 1024, "esmini BUILD VERSION: %s", esmini_build_version());
-	file_ << message << std::endl;
-	file_.flush();
+	file_.Write(std::string(message) + "\n");
 
 	callback_ = 0;
 }
 
 Logger::~Logger()
 {
-	if (file_.is_open())
-	{
-		file_.close();
-	}
+	file_.Close();
 
 	callback_ = 0;
 }
@@ -494,6 +532,8 @@ void Logger::Log(char const* file, char const* func, int line, char const* forma
 	static char complete_entry[2048];
 	static char message[1024];
 
+	mutex_.Lock();
+
 	va_list args;
 	va_start(args, format);
 	vsnprintf(message, 1024, format, args);
@@ -504,10 +544,9 @@ void Logger::Log(char const* file, char const* func, int line, char const* forma
 	strncpy(complete_entry, message, 1024);
 #endif
 
-	if (file_.is_open())
+	if (file_.IsOpen())
 	{
-		file_ << complete_entry << std::endl;
-		file_.flush();
+		file_.Write(std::string(complete_entry) + "\n");
 	}
 
 	if (callback_)
@@ -516,6 +555,8 @@ void Logger::Log(char const* file, char const* func, int line, char const* forma
 	}
 
 	va_end(args);
+
+	mutex_.Unlock();
 }
 
 void Logger::SetCallback(FuncPtr callback)
@@ -550,8 +591,7 @@ Logger& Logger::Inst()
 CSV_Logger::CSV_Logger(std::string scenario_filename, int numvehicles, std::string csv_filename)
 {
 
-	file_.open(csv_filename);
-	if (file_.fail())
+	if (file_.Open(csv_filename, false) != 0)
 	{
 		throw std::iostream::failure(std::string("Cannot open file: ") + csv_filename);
 	}
@@ -561,17 +601,17 @@ CSV_Logger::CSV_Logger(std::string scenario_filename, int numvehicles, std::stri
 	//Standard ESMINI log header, appended with Scenario file name and vehicle count
 	static char message[1024];
 	snprintf(message, 1024, "esmini GIT REV: %s", esmini_git_rev());
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 	snprintf(message, 1024, "esmini GIT TAG: %s", esmini_git_tag());
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 	snprintf(message, 1024, "esmini GIT BRANCH: %s", esmini_git_branch());
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 	snprintf(message, 1024, "esmini BUILD VERSION: %s", esmini_build_version());
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 	snprintf(message, 1024, "Scenario File Name: %s", scenario_filename.c_str());
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 	snprintf(message, 1024, "Number of Vehicles: %d", numvehicles);
-	file_ << message << std::endl;
+	file_.Write(std::string(message) + "\n");
 
 	//Ego vehicle is always present, at least one set of vehicle data values should be stored 
 	//Index and TimeStamp are included in this first set of columns 
@@ -583,7 +623,7 @@ CSV_Logger::CSV_Logger(std::string scenario_filename, int numvehicles, std::stri
 		"#1 Relative_Heading_Angle [rad] , #1 Relative_Heading_Angle_Drive_Direction [rad] , "
 		"#1 World_Pitch_Angle [rad] , #1 Road_Curvature [1/m] , ";
 	snprintf(message, 1024, egoHeader);
-	file_ << message;
+	file_.Write(message, strlen(message));
 
 	//Based on number of vehicels in the Entities vector, extend the header accordingly
 	const char* npcHeader = "#%d Entitity_Name [-] , #%d Entitity_ID [-] , "
@@ -596,21 +636,16 @@ CSV_Logger::CSV_Logger(std::string scenario_filename, int numvehicles, std::stri
 	for (int i = 2; i <= numvehicles; i++)
 	{
 		snprintf(message, 1024, npcHeader, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i);
-		file_ << message;
+		file_.Write(message, strlen(message));
 	}
-	file_ << std::endl;
-
-	file_.flush();
+	file_.Write("\n", 1);
 
 	callback_ = 0;
 }
 
 CSV_Logger::~CSV_Logger()
 {
-	if (file_.is_open())
-	{
-		file_.close();
-	}
+	file_.Close();
 
 	callback_ = 0;
 }
@@ -641,13 +676,12 @@ void CSV_Logger::LogVehicleData(bool isendline, double timestamp,
 	//Add lines horizontally until the endline is reached
 	if (isendline == false)
 	{
-		file_ << data_entry;
+		file_.Write(data_entry, strlen(data_entry));
 	}
-	else if (file_.is_open())
+	else if (file_.IsOpen())
 	{
 
-		file_ << data_entry << std::endl;
-		file_.flush();
+		file_.Write(std::string(data_entry) + "\n");
 		
 		data_index_++;
 	}
@@ -752,6 +786,677 @@ void SE_Mutex::Unlock()
 #endif
 }
 
+SE_Event::SE_Event()
+{
+#if (defined WINVER && WINVER == _WIN32_WINNT_WIN7)
+	event_ = (void*)CreateEvent(
+		NULL,              // default security attributes
+		FALSE,             // auto-reset
+		FALSE,             // initially not signaled
+		NULL);             // unnamed event
+
+	if (event_ == NULL)
+	{
+		LOG("CreateEvent error: %d\n", GetLastError());
+		event_ = 0;
+	}
+#else
+	signaled_ = false;
+#endif
+}
+
+SE_Event::~SE_Event()
+{
+#if (defined WINVER && WINVER == _WIN32_WINNT_WIN7)
+	if (event_)
+	{
+		CloseHandle((HANDLE)event_);
+	}
+#endif
+}
+
+void SE_Event::Signal()
+{
+#if (defined WINVER && WINVER == _WIN32_WINNT_WIN7)
+	SetEvent((HANDLE)event_);
+#else
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		signaled_ = true;
+	}
+	cond_.notify_one();
+#endif
+}
+
+bool SE_Event::Wait(int timeout_ms)
+{
+#if (defined WINVER && WINVER == _WIN32_WINNT_WIN7)
+	return WaitForSingleObject((HANDLE)event_, timeout_ms) == WAIT_OBJECT_0;
+#else
+	std::unique_lock<std::mutex> lock(mutex_);
+	bool signaled = cond_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return signaled_; });
+	signaled_ = false;
+	return signaled;
+#endif
+}
+
+SE_RingBuffer::SE_RingBuffer(size_t capacity) : head_(0), tail_(0)
+{
+	// Power of two size, so that positions can be wrapped by masking
+	for (capacity_ = 1; capacity_ < capacity; capacity_ <<= 1);
+	buf_ = new char[capacity_];
+}
+
+SE_RingBuffer::~SE_RingBuffer()
+{
+	delete[] buf_;
+}
+
+bool SE_RingBuffer::Write(const char *data, size_t size)
+{
+	size_t head = head_.load(std::memory_order_relaxed);
+	size_t tail = tail_.load(std::memory_order_acquire);
+
+	if (capacity_ - (head - tail) < size)
+	{
+		return false;
+	}
+
+	size_t pos = head & (capacity_ - 1);
+	size_t n = MIN(size, capacity_ - pos);
+	memcpy(buf_ + pos, data, n);
+	memcpy(buf_, data + n, size - n);  // wrapped part, if any
+
+	head_.store(head + size, std::memory_order_release);
+
+	return true;
+}
+
+size_t SE_RingBuffer::Peek(const char **data)
+{
+	size_t tail = tail_.load(std::memory_order_relaxed);
+	size_t head = head_.load(std::memory_order_acquire);
+	size_t pos = tail & (capacity_ - 1);
+
+	*data = buf_ + pos;
+
+	return MIN(head - tail, capacity_ - pos);
+}
+
+void SE_RingBuffer::Release(size_t size)
+{
+	tail_.store(tail_.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+// Background thread writing data of all open SE_AsyncWriter instances to file
+class SE_AsyncWriterThread
+{
+public:
+	static SE_AsyncWriterThread& Inst()
+	{
+		// Never deleted, since writers might be closed on destruction of other static objects
+		static SE_AsyncWriterThread *instance = new SE_AsyncWriterThread;
+		return *instance;
+	}
+
+	void Add(SE_AsyncWriter *writer)
+	{
+		bool start = false;
+
+		start_stop_mutex_.Lock();
+		mutex_.Lock();
+		writers_.push_back(writer);
+		if (!running_)
+		{
+			running_ = true;
+			start = true;
+		}
+		mutex_.Unlock();
+		if (start)
+		{
+			thread_.Start(Run, this);
+		}
+		start_stop_mutex_.Unlock();
+	}
+
+	// Wake up the thread if it's sleeping, called after data has been put into a buffer
+	void Signal()
+	{
+		// Pairs with the fence in Run(): Either the thread sees the new data before sleeping, or the flag is seen here
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false))
+		{
+			data_.Signal();
+		}
+	}
+
+	// Write buffered data of one writer right away, in the calling thread
+	void Drain(SE_AsyncWriter *writer)
+	{
+		mutex_.Lock();
+		writer->Drain();
+		mutex_.Unlock();
+	}
+
+	void Remove(SE_AsyncWriter *writer)
+	{
+		bool stop = false;
+
+		start_stop_mutex_.Lock();
+		mutex_.Lock();
+		for (size_t i = 0; i < writers_.size(); i++)
+		{
+			if (writers_[i] == writer)
+			{
+				writers_.erase(writers_.begin() + i);
+				break;
+			}
+		}
+		if (writers_.empty() && running_)
+		{
+			// No more files, stop thread until next one is opened
+			running_ = false;
+			stop = true;
+		}
+		mutex_.Unlock();
+		if (stop)
+		{
+			data_.Signal();
+			thread_.Wait();
+		}
+		start_stop_mutex_.Unlock();
+	}
+
+private:
+	SE_AsyncWriterThread() : running_(false), sleeping_(false) {}
+
+	static void Run(void *arg)
+	{
+		SE_AsyncWriterThread *self = (SE_AsyncWriterThread*)arg;
+
+		while (self->running_)
+		{
+			size_t n_bytes = 0;
+
+			self->mutex_.Lock();
+			for (size_t i = 0; i < self->writers_.size(); i++)
+			{
+				n_bytes += self->writers_[i]->Drain();
+			}
+			self->mutex_.Unlock();
+
+			if (n_bytes == 0)
+			{
+				// All written. Announce sleep, then check once more so that no data put just before is missed.
+				self->sleeping_.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				bool empty = true;
+				self->mutex_.Lock();
+				for (size_t i = 0; i < self->writers_.size() && empty; i++)
+				{
+					empty = self->writers_[i]->GetBufferedSize() == 0;
+				}
+				self->mutex_.Unlock();
+
+				if (empty)
+				{
+					self->data_.Wait(SE_ASYNC_WRITER_PERIOD);
+				}
+				self->sleeping_.store(false, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	std::vector<SE_AsyncWriter*> writers_;
+	SE_Event data_;  // signaled when data has been put into a buffer while sleeping, or when the thread should stop
+	SE_Mutex mutex_;  // protects writers_
+	SE_Mutex start_stop_mutex_;
+	SE_Thread thread_;
+	std::atomic<bool> running_;
+	std::atomic<bool> sleeping_;  // set by the thread before waiting for data_
+};
+
+int SE_AsyncWriter::Open(std::string filename, bool binary, double max_wait, size_t buffer_size)
+{
+	Close();
+
+	file_.open(filename, binary ? std::ofstream::binary : std::ofstream::out);
+	if (file_.fail())
+	{
+		return -1;
+	}
+
+	ring_ = new SE_RingBuffer(buffer_size);
+	max_wait_ = max_wait;
+	n_dropped_ = 0;
+	n_backpressured_ = 0;
+
+	SE_AsyncWriterThread::Inst().Add(this);
+
+	return 0;
+}
+
+void SE_AsyncWriter::Close()
+{
+	if (ring_ == 0)
+	{
+		return;
+	}
+
+	// Once removed the background thread will not touch this writer, write remaining data here
+	SE_AsyncWriterThread::Inst().Remove(this);
+	Drain();
+	file_.close();
+
+	delete ring_;
+	ring_ = 0;
+}
+
+int SE_AsyncWriter::Write(const char *data, size_t size)
+{
+	if (ring_ == 0)
+	{
+		return -1;
+	}
+
+	if (ring_->Write(data, size))
+	{
+		SE_AsyncWriterThread::Inst().Signal();
+		return 0;
+	}
+
+	n_backpressured_++;
+
+	if (size > ring_->GetCapacity())
+	{
+		// Will never fit, pass it in pieces. Once started it can't be dropped.
+		for (size_t pos = 0; pos < size;)
+		{
+			size_t n = MIN(size - pos, ring_->GetCapacity() / 2);
+			while (!ring_->Write(data + pos, n))
+			{
+				SE_AsyncWriterThread::Inst().Signal();
+				space_.Wait(SE_ASYNC_WRITER_PERIOD);
+			}
+			SE_AsyncWriterThread::Inst().Signal();
+			pos += n;
+		}
+		return 0;
+	}
+
+	// Buffer full, wait for the background thread to free up space
+	__int64 start_time = SE_getSystemTime();
+	while (!ring_->Write(data, size))
+	{
+		int timeout = SE_ASYNC_WRITER_PERIOD;
+		if (max_wait_ >= 0)
+		{
+			__int64 remaining = (__int64)(1000 * max_wait_) - (SE_getSystemTime() - start_time);
+			if (remaining <= 0)
+			{
+				n_dropped_++;
+				return -1;
+			}
+			timeout = (int)MIN(remaining, (__int64)SE_ASYNC_WRITER_PERIOD);
+		}
+		SE_AsyncWriterThread::Inst().Signal();
+		space_.Wait(timeout);
+	}
+	SE_AsyncWriterThread::Inst().Signal();
+
+	return 0;
+}
+
+void SE_AsyncWriter::Flush()
+{
+	if (ring_ == 0)
+	{
+		return;
+	}
+
+	SE_AsyncWriterThread::Inst().Drain(this);
+}
+
+size_t SE_AsyncWriter::Drain()
+{
+	const char *data;
+	size_t n_bytes = 0;
+
+	// Two chunks at most, when data wraps around the end of the buffer
+	for (int i = 0; i < 2; i++)
+	{
+		size_t n = ring_->Peek(&data);
+		if (n == 0)
+		{
+			break;
+		}
+		file_.write(data, n);
+		ring_->Release(n);
+		n_bytes += n;
+	}
+
+	if (n_bytes > 0)
+	{
+		file_.flush();
+		space_.Signal();
+	}
+
+	return n_bytes;
+}
+
+typedef struct
+{
+	SE_ProfileSection section;
+	__int64 start;
+	__int64 duration;
+} SE_ProfileEvent;
+
+// Measurements of one thread. The mutex is uncontended, except when data is read or reset.
+class SE_Profiler::ThreadData
+{
+public:
+	ThreadData(int id) : id_(id), n_skipped_(0)
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		for (int i = 0; i < SE_PROFILE_N_SECTIONS; i++)
+		{
+			SE_Profiler::ResetStats(stats_[i]);
+		}
+		events_.clear();
+		n_skipped_ = 0;
+	}
+
+	int id_;
+	SE_Mutex mutex_;
+	SE_ProfileStats stats_[SE_PROFILE_N_SECTIONS];
+	std::vector<SE_ProfileEvent> events_;
+	unsigned long long n_skipped_;
+};
+
+std::atomic<bool> SE_Profiler::enabled_(false);
+
+static const char *profile_section_name[SE_PROFILE_N_SECTIONS] =
+{
+	"frame",
+	"step",
+	"triggers",
+	"actions",
+	"step_objects",
+	"XYZH2TrackPos",
+	"MoveAlongS",
+	"gateway",
+	"osi",
+	"viewer"
+};
+
+SE_Profiler::SE_Profiler() : trace_(false)
+{
+	start_time_ = SE_getSystemTimeNs();
+}
+
+SE_Profiler::~SE_Profiler()
+{
+	enabled_ = false;
+	for (size_t i = 0; i < thread_data_.size(); i++)
+	{
+		delete thread_data_[i];
+	}
+}
+
+SE_Profiler& SE_Profiler::Inst()
+{
+	static SE_Profiler instance;
+	return instance;
+}
+
+SE_Profiler::ThreadData *SE_Profiler::GetThreadData()
+{
+	static thread_local ThreadData *thread_data = 0;
+
+	if (thread_data == 0)
+	{
+		mutex_.Lock();
+		thread_data = new ThreadData((int)thread_data_.size());
+		thread_data_.push_back(thread_data);
+		mutex_.Unlock();
+	}
+
+	return thread_data;
+}
+
+void SE_Profiler::Enable(bool enable, bool trace)
+{
+	trace_ = trace;
+	enabled_ = enable;
+}
+
+void SE_Profiler::Reset()
+{
+	mutex_.Lock();
+	for (size_t i = 0; i < thread_data_.size(); i++)
+	{
+		thread_data_[i]->mutex_.Lock();
+		thread_data_[i]->Reset();
+		thread_data_[i]->mutex_.Unlock();
+	}
+	start_time_ = SE_getSystemTimeNs();
+	mutex_.Unlock();
+}
+
+void SE_Profiler::Add(SE_ProfileSection section, __int64 start, __int64 duration)
+{
+	ThreadData *td = GetThreadData();
+
+	td->mutex_.Lock();
+
+	AddToStats(td->stats_[section], start, duration);
+
+	if (trace_.load(std::memory_order_relaxed))
+	{
+		if (td->events_.size() < SE_PROFILE_MAX_TRACE_EVENTS)
+		{
+			SE_ProfileEvent event = { section, start, duration };
+			td->events_.push_back(event);
+		}
+		else
+		{
+			td->n_skipped_++;
+		}
+	}
+
+	td->mutex_.Unlock();
+}
+
+void SE_Profiler::ResetStats(SE_ProfileStats &stats)
+{
+	memset(&stats, 0, sizeof(SE_ProfileStats));
+	stats.min = LLONG_MAX;
+}
+
+void SE_Profiler::AddToStats(SE_ProfileStats &stats, __int64 start, __int64 duration)
+{
+	// bin index is position of most significant bit
+	int bin = 0;
+	for (__int64 d = duration >> 1; d > 0 && bin < SE_PROFILE_N_BINS - 1; d >>= 1)
+	{
+		bin++;
+	}
+
+	stats.count++;
+	stats.total += duration;
+	stats.min = MIN(stats.min, duration);
+	stats.max = MAX(stats.max, duration);
+	stats.last = duration;
+	stats.last_end = start + duration;
+	stats.bins[bin]++;
+}
+
+SE_ProfileStats SE_Profiler::GetStats(SE_ProfileSection section)
+{
+	SE_ProfileStats result;
+
+	ResetStats(result);
+
+	mutex_.Lock();
+	for (size_t i = 0; i < thread_data_.size(); i++)
+	{
+		thread_data_[i]->mutex_.Lock();
+		SE_ProfileStats &stats = thread_data_[i]->stats_[section];
+		result.count += stats.count;
+		result.total += stats.total;
+		result.min = MIN(result.min, stats.min);
+		result.max = MAX(result.max, stats.max);
+		if (stats.count > 0 && stats.last_end > result.last_end)
+		{
+			result.last = stats.last;
+			result.last_end = stats.last_end;
+		}
+		for (int j = 0; j < SE_PROFILE_N_BINS; j++)
+		{
+			result.bins[j] += stats.bins[j];
+		}
+		thread_data_[i]->mutex_.Unlock();
+	}
+	mutex_.Unlock();
+
+	if (result.count == 0)
+	{
+		result.min = 0;
+	}
+
+	return result;
+}
+
+const char *SE_Profiler::GetSectionName(SE_ProfileSection section)
+{
+	if (section < 0 || section >= SE_PROFILE_N_SECTIONS)
+	{
+		return "unknown";
+	}
+
+	return profile_section_name[section];
+}
+
+double SE_Profiler::GetPercentile(SE_ProfileStats &stats, double p)
+{
+	if (stats.count == 0)
+	{
+		return 0.0;
+	}
+
+	double target = p / 100.0 * stats.count;
+	unsigned long long n = 0;
+
+	for (int i = 0; i < SE_PROFILE_N_BINS; i++)
+	{
+		if (stats.bins[i] > 0 && n + stats.bins[i] >= target)
+		{
+			// interpolate linearly within the bin, limited by observed range
+			double lower = i == 0 ? 0.0 : (double)(1LL << i);
+			double upper = (double)(1LL << (i + 1));
+			double value = lower + (upper - lower) * (target - n) / stats.bins[i];
+			value = MAX(value, (double)stats.min);
+			return MIN(value, (double)stats.max);
+		}
+		n += stats.bins[i];
+	}
+
+	return (double)stats.max;
+}
+
+int SE_Profiler::WriteJSON(std::string filename)
+{
+	FILE *file = fopen(filename.c_str(), "w");
+
+	if (file == 0)
+	{
+		LOG("Failed to open profile file %s", filename.c_str());
+		return -1;
+	}
+
+	fprintf(file, "{\n\t\"sections\": [");
+	for (int i = 0; i < SE_PROFILE_N_SECTIONS; i++)
+	{
+		SE_ProfileStats stats = GetStats((SE_ProfileSection)i);
+
+		fprintf(file, "%s\n\t\t{\n", i > 0 ? "," : "");
+		fprintf(file, "\t\t\t\"name\": \"%s\",\n", GetSectionName((SE_ProfileSection)i));
+		fprintf(file, "\t\t\t\"count\": %llu,\n", stats.count);
+		fprintf(file, "\t\t\t\"total_ms\": %.3f,\n", 1e-6 * stats.total);
+		fprintf(file, "\t\t\t\"mean_us\": %.3f,\n", stats.count > 0 ? 1e-3 * stats.total / stats.count : 0.0);
+		fprintf(file, "\t\t\t\"min_us\": %.3f,\n", 1e-3 * stats.min);
+		fprintf(file, "\t\t\t\"max_us\": %.3f,\n", 1e-3 * stats.max);
+		fprintf(file, "\t\t\t\"p50_us\": %.3f,\n", 1e-3 * GetPercentile(stats, 50));
+		fprintf(file, "\t\t\t\"p99_us\": %.3f,\n", 1e-3 * GetPercentile(stats, 99));
+
+		// non empty bins only, as [lower bound (ns), count]
+		fprintf(file, "\t\t\t\"histogram\": [");
+		bool first = true;
+		for (int j = 0; j < SE_PROFILE_N_BINS; j++)
+		{
+			if (stats.bins[j] > 0)
+			{
+				fprintf(file, "%s[%lld, %llu]", first ? "" : ", ", j == 0 ? 0LL : (1LL << j), stats.bins[j]);
+				first = false;
+			}
+		}
+		fprintf(file, "]\n\t\t}");
+	}
+	fprintf(file, "\n\t]\n}\n");
+	fclose(file);
+
+	return 0;
+}
+
+int SE_Profiler::WriteChromeTrace(std::string filename)
+{
+	FILE *file = fopen(filename.c_str(), "w");
+
+	if (file == 0)
+	{
+		LOG("Failed to open trace file %s", filename.c_str());
+		return -1;
+	}
+
+	unsigned long long n_skipped = 0;
+	bool first = true;
+
+	fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+	mutex_.Lock();
+	for (size_t i = 0; i < thread_data_.size(); i++)
+	{
+		ThreadData *td = thread_data_[i];
+
+		td->mutex_.Lock();
+		for (size_t j = 0; j < td->events_.size(); j++)
+		{
+			SE_ProfileEvent &event = td->events_[j];
+
+			// complete events, timestamps in microseconds
+			fprintf(file, "%s\n{\"name\": \"%s\", \"cat\": \"esmini\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+				first ? "" : ",", GetSectionName(event.section), 1e-3 * (event.start - start_time_), 1e-3 * event.duration, td->id_);
+			first = false;
+		}
+		n_skipped += td->n_skipped_;
+		td->mutex_.Unlock();
+	}
+	mutex_.Unlock();
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	if (n_skipped > 0)
+	{
+		LOG("Trace limited to %d events per thread, %llu skipped", SE_PROFILE_MAX_TRACE_EVENTS, n_skipped);
+	}
+
+	return 0;
+}
+
 
 void SE_Option::Usage()
 {
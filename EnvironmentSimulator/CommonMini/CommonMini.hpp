@@ -16,6 +16,7 @@
 #include <vector>
 #include <fstream>
 #include <string>
+#include <atomic>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
@@ -48,6 +49,8 @@
 
 // Time functions
 __int64 SE_getSystemTime();
+__int64 SE_getSystemTimeUs();  // Monotonic time in microseconds, for measuring durations
+__int64 SE_getSystemTimeNs();  // Monotonic time in nanoseconds, for measuring short durations
 void SE_sleep(unsigned int msec);
 double SE_getSimTimeStep(__int64 &time_stamp, double min_time_step, double max_time_step);
 
@@ -186,6 +189,7 @@ void SwapByteOrder(unsigned char *buf, int data_type_size, int buf_size);
 #else
 	#include <thread>
 	#include <mutex>
+	#include <condition_variable>
 #endif
 
 class SE_Thread
@@ -225,6 +229,294 @@ private:
 #endif
 };
 
+/*
+  Auto-reset event for waking up a waiting thread. A signal given while no thread is waiting is kept
+  until next wait, so it is not lost.
+*/
+class SE_Event
+{
+public:
+	SE_Event();
+	~SE_Event();
+
+	void Signal();
+
+	/**
+	Wait for a signal
+	@param timeout_ms Longest time to wait
+	@return true if signaled, false on timeout
+	*/
+	bool Wait(int timeout_ms);
+
+private:
+#if (defined WINVER && WINVER == _WIN32_WINNT_WIN7)
+	void *event_;
+#else
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	bool signaled_;
+#endif
+};
+
+/*
+  Lock-free ring buffer of bytes, for one producer and one consumer thread
+*/
+class SE_RingBuffer
+{
+public:
+	SE_RingBuffer(size_t capacity);
+	~SE_RingBuffer();
+
+	/**
+	Add data at the end of the buffer, called by producer only. All or nothing.
+	@return true if data was added, false if not enough free space
+	*/
+	bool Write(const char *data, size_t size);
+
+	/**
+	Get oldest contiguous chunk of data, called by consumer only. Data remains in buffer until released.
+	@param data Set to start of chunk
+	@return Size of chunk, 0 if buffer is empty
+	*/
+	size_t Peek(const char **data);
+
+	/**
+	Remove data from the start of the buffer, called by consumer only
+	*/
+	void Release(size_t size);
+
+	size_t GetCapacity() { return capacity_; }
+	size_t GetSize() { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+private:
+	char *buf_;
+	size_t capacity_;  // power of two
+	std::atomic<size_t> head_;  // total number of bytes written
+	std::atomic<size_t> tail_;  // total number of bytes released
+};
+
+/*
+  File writer offloading the actual file I/O to a background thread, shared by all writers.
+  Write() only copies data into a ring buffer. The background thread writes buffered data to file
+  in batches, and flushes. When all is written it sleeps until woken up by next Write(), or at most
+  SE_ASYNC_WRITER_PERIOD milliseconds. Only one thread at a time may call Write().
+*/
+#define SE_ASYNC_WRITER_PERIOD 100  // ms
+#define SE_ASYNC_WRITER_DEFAULT_BUFFER_SIZE (1 << 20)
+
+class SE_AsyncWriter
+{
+public:
+	SE_AsyncWriter() : ring_(0), max_wait_(-1), n_dropped_(0), n_backpressured_(0) {}
+	~SE_AsyncWriter() { Close(); }
+
+	/**
+	Open file and start buffered writing
+	@param filename Name of the file, overwritten if existing
+	@param binary Open in binary mode, else text mode
+	@param max_wait Longest time (s) to wait for space in a full buffer before the record is dropped, -1 means wait forever
+	@param buffer_size Size of the ring buffer in bytes
+	@return 0 on success, -1 if file could not be opened
+	*/
+	int Open(std::string filename, bool binary, double max_wait = -1, size_t buffer_size = SE_ASYNC_WRITER_DEFAULT_BUFFER_SIZE);
+
+	/**
+	Write all remaining data and close the file
+	*/
+	void Close();
+
+	bool IsOpen() { return ring_ != 0; }
+
+	/**
+	Queue a record for writing. A record is either written completely or dropped.
+	@return 0 if queued, -1 if dropped
+	*/
+	int Write(const char *data, size_t size);
+	int Write(const std::string &str) { return Write(str.c_str(), str.size()); }
+
+	/**
+	Write all data queued so far to file and flush, before returning. Called by the writing thread.
+	*/
+	void Flush();
+
+	/**
+	Write buffered data to file, called by the background thread
+	@return Number of bytes written
+	*/
+	size_t Drain();
+	size_t GetBufferedSize() { return ring_ ? ring_->GetSize() : 0; }
+
+	// Number of records dropped since the buffer stayed full for longer than max_wait
+	unsigned long long GetNumberOfDropped() { return n_dropped_; }
+	// Number of records which had to wait for the background thread to free up buffer space
+	unsigned long long GetNumberOfBackpressured() { return n_backpressured_; }
+
+private:
+	SE_RingBuffer *ring_;
+	std::ofstream file_;
+	SE_Event space_;  // signaled by the background thread when buffer space has been freed
+	double max_wait_;
+	std::atomic<unsigned long long> n_dropped_;
+	std::atomic<unsigned long long> n_backpressured_;
+};
+
+/*
+  Three copies of a value, for passing the latest version from one writer thread to one reader thread.
+  Neither side ever waits: The writer fills the back buffer and publishes it, the reader picks up
+  the most recently published one. Intermediate versions not picked up by the reader are skipped.
+*/
+template <class T> class SE_TripleBuffer
+{
+public:
+	SE_TripleBuffer() : back_(0), middle_(1), front_(2) {}
+
+	// Buffer to fill by the writer, content is whatever was published two versions ago
+	T& GetBack() { return buf_[back_]; }
+
+	// Make the back buffer available to the reader
+	void Publish()
+	{
+		back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Get most recently published buffer, called by the reader. Stays valid until next call.
+	T& GetFront()
+	{
+		if (middle_.load(std::memory_order_relaxed) & FRESH)
+		{
+			front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+		return buf_[front_];
+	}
+
+private:
+	enum { INDEX_MASK = 3, FRESH = 4 };
+	T buf_[3];
+	int back_;
+	std::atomic<int> middle_;  // index of buffer in between, FRESH set when not yet picked up by reader
+	int front_;
+};
+
+/*
+  Built-in profiler, measuring time spent in hot paths of the simulation
+  Scoped timers are always compiled in but do nothing unless profiling is enabled at runtime.
+  Measurements from all threads, e.g. parallel scenario instances, are aggregated per section.
+*/
+typedef enum
+{
+	SE_PROFILE_FRAME,           // ScenarioPlayer frame, i.e. all esmini work of a simulation step
+	SE_PROFILE_STEP,            // ScenarioEngine::step
+	SE_PROFILE_TRIGGERS,        // Trigger evaluation
+	SE_PROFILE_ACTIONS,         // Stepping of story actions
+	SE_PROFILE_STEP_OBJECTS,    // ScenarioEngine::stepObjects
+	SE_PROFILE_XYZH2TRACKPOS,   // Position::XYZH2TrackPos
+	SE_PROFILE_MOVE_ALONG_S,    // Position::MoveAlongS
+	SE_PROFILE_GATEWAY,         // Reporting object states to the gateway
+	SE_PROFILE_OSI,             // OSI update, serialization and file write
+	SE_PROFILE_VIEWER,          // Viewer frame update
+	SE_PROFILE_N_SECTIONS
+} SE_ProfileSection;
+
+#define SE_PROFILE_N_BINS 40  // histogram bin i holds durations in range [2^i, 2^(i+1)) ns, bin 0 also 0 ns
+#define SE_PROFILE_MAX_TRACE_EVENTS (1 << 20)  // per thread, further events are skipped
+
+typedef struct
+{
+	unsigned long long count;
+	__int64 total;      // ns
+	__int64 min;        // ns
+	__int64 max;        // ns
+	__int64 last;       // duration of most recent measurement, ns
+	__int64 last_end;   // end time of most recent measurement, ns
+	unsigned long long bins[SE_PROFILE_N_BINS];
+} SE_ProfileStats;
+
+class SE_Profiler
+{
+public:
+	static SE_Profiler& Inst();
+
+	static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+	/**
+	Switch profiling on or off. Collected data is kept, see Reset().
+	@param trace Also store each single measurement, for Chrome trace output
+	*/
+	void Enable(bool enable, bool trace = false);
+
+	// Clear all collected data
+	void Reset();
+
+	// Add a measurement, typically called by SE_ProfileScope
+	void Add(SE_ProfileSection section, __int64 start, __int64 duration);
+
+	// Get statistics of specified section, aggregated over all threads
+	SE_ProfileStats GetStats(SE_ProfileSection section);
+
+	static const char *GetSectionName(SE_ProfileSection section);
+
+	// Clear statistics, e.g. before collecting measurements of own interest with AddToStats()
+	static void ResetStats(SE_ProfileStats &stats);
+
+	/**
+	Add a measurement to statistics, updating count, min/max and histogram
+	@param start Start time of measurement, ns
+	@param duration Duration of measurement, ns
+	*/
+	static void AddToStats(SE_ProfileStats &stats, __int64 start, __int64 duration);
+
+	/**
+	Estimate percentile from histogram
+	@param p Percentile, 0..100
+	@return Duration in ns
+	*/
+	static double GetPercentile(SE_ProfileStats &stats, double p);
+
+	/**
+	Write statistics and histograms of all sections to file in JSON format
+	@return 0 on success, -1 if file could not be opened
+	*/
+	int WriteJSON(std::string filename);
+
+	/**
+	Write all traced measurements to file in Chrome trace event format, view in chrome://tracing or Perfetto
+	@return 0 on success, -1 if file could not be opened
+	*/
+	int WriteChromeTrace(std::string filename);
+
+private:
+	SE_Profiler();
+	~SE_Profiler();
+
+	class ThreadData;
+	ThreadData *GetThreadData();
+
+	static std::atomic<bool> enabled_;
+	std::atomic<bool> trace_;
+	__int64 start_time_;
+	SE_Mutex mutex_;
+	std::vector<ThreadData*> thread_data_;
+};
+
+class SE_ProfileScope
+{
+public:
+	SE_ProfileScope(SE_ProfileSection section) : section_(section), start_(SE_Profiler::IsEnabled() ? SE_getSystemTimeNs() : -1) {}
+	~SE_ProfileScope()
+	{
+		if (start_ >= 0)
+		{
+			SE_Profiler::Inst().Add(section_, start_, SE_getSystemTimeNs() - start_);
+		}
+	}
+
+private:
+	SE_ProfileSection section_;
+	__int64 start_;
+};
+
+#define SE_PROFILE_SCOPE(section) SE_ProfileScope se_profile_scope_(section)
+
 
 std::vector<std::string> SplitString(const std::string &s, char separator);
 std::string DirNameOf(const std::string& fname);
@@ -248,8 +540,9 @@ private:
 	Logger(bool use_logfile);
 	~Logger();
 	FuncPtr callback_;
+	SE_Mutex mutex_;  // Log might be called from worker threads, e.g. when creating OSI points
 
-	std::ofstream file_;
+	SE_AsyncWriter file_;
 };
 
 // Global Vehicle Data Logger
@@ -283,7 +576,7 @@ private:
 	int data_index_;
 
 	//File output stream
-	std::ofstream file_;
+	SE_AsyncWriter file_;
 
 	//Callback function pointer for error logging
 	FuncPtr callback_;
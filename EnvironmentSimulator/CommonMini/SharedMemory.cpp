@@ -0,0 +1,404 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include "SharedMemory.hpp"
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#define SHM_ALIGNMENT 64  // cache line, sections of the memory start at multiples of this
+#define SHM_POLL_INTERVAL 100  // us, time between polls when reader is not spinning
+
+static size_t AlignSize(size_t size)
+{
+	return (size + SHM_ALIGNMENT - 1) & ~(size_t)(SHM_ALIGNMENT - 1);
+}
+
+// Memory layout: header, then n_slots slots of slot header, object table and message
+static size_t SlotOffset(const SE_ShmHeader *header, unsigned long long frame_id)
+{
+	return AlignSize(sizeof(SE_ShmHeader)) + (size_t)(frame_id % header->n_slots) * header->slot_size;
+}
+
+static size_t ObjectsOffset()
+{
+	return AlignSize(sizeof(SE_ShmSlotHeader));
+}
+
+static size_t MessageOffset(const SE_ShmHeader *header)
+{
+	return ObjectsOffset() + AlignSize((size_t)header->max_objects * sizeof(SE_ShmObjectState));
+}
+
+int SE_SharedMemoryWriter::Open(std::string name, unsigned int max_msg_size, unsigned int max_objects, unsigned int n_slots)
+{
+	Close();
+
+	if (n_slots < 2)
+	{
+		n_slots = 2;  // otherwise the frame being written is the only one
+	}
+
+	size_t slot_size = AlignSize(ObjectsOffset() + AlignSize(max_objects * sizeof(SE_ShmObjectState)) + max_msg_size);
+	size_t size = AlignSize(sizeof(SE_ShmHeader)) + n_slots * slot_size;
+	void *data = 0;
+
+#ifdef _WIN32
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32),
+		(DWORD)(size & 0xffffffff), name.c_str());
+	if (mapping == NULL)
+	{
+		LOG("Failed to create shared memory %s", name.c_str());
+		return -1;
+	}
+
+	// The mapping might exist already, still used by a reader. Then it keeps its original size.
+	bool exists = GetLastError() == ERROR_ALREADY_EXISTS;
+
+	data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, exists ? 0 : size);
+	if (data == NULL)
+	{
+		LOG("Failed to map shared memory %s", name.c_str());
+		CloseHandle(mapping);
+		return -1;
+	}
+
+	MEMORY_BASIC_INFORMATION info;
+	if (exists && (VirtualQuery(data, &info, sizeof(info)) == 0 || info.RegionSize < size))
+	{
+		LOG("Shared memory %s exists with size smaller than %zu, close its readers first", name.c_str(), size);
+		UnmapViewOfFile(data);
+		CloseHandle(mapping);
+		return -1;
+	}
+	memset(data, 0, sizeof(SE_ShmHeader));
+	handle_ = mapping;
+#else
+	std::string shm_name = "/" + name;
+
+	// Start from scratch, readers still attached to a previous one keep their mapping of it
+	shm_unlink(shm_name.c_str());
+
+	int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+	if (fd < 0)
+	{
+		LOG("Failed to create shared memory %s", shm_name.c_str());
+		return -1;
+	}
+
+	// Pages are allocated first when used, so unused message space costs nothing
+	if (ftruncate(fd, (off_t)size) != 0 ||
+		(data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		LOG("Failed to allocate shared memory %s of size %zu", shm_name.c_str(), size);
+		close(fd);
+		shm_unlink(shm_name.c_str());
+		return -1;
+	}
+	close(fd);
+#endif
+
+	header_ = (SE_ShmHeader*)data;
+	size_ = size;
+	name_ = name;
+
+	header_->version = SE_SHM_VERSION;
+	header_->n_slots = n_slots;
+	header_->max_objects = max_objects;
+	header_->max_msg_size = max_msg_size;
+	header_->slot_size = (unsigned int)slot_size;
+	header_->frame_id.store(0, std::memory_order_relaxed);
+
+	// Readers accept the memory once the magic number is there
+	std::atomic_thread_fence(std::memory_order_release);
+	header_->magic = SE_SHM_MAGIC;
+
+	return 0;
+}
+
+void SE_SharedMemoryWriter::Close()
+{
+	if (header_ == 0)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(header_);
+	CloseHandle((HANDLE)handle_);
+	handle_ = 0;
+#else
+	munmap(header_, size_);
+	shm_unlink(("/" + name_).c_str());
+#endif
+
+	header_ = 0;
+	size_ = 0;
+}
+
+int SE_SharedMemoryWriter::Write(double sim_time, const SE_ShmObjectState *objects, unsigned int n_objects, const char *msg, unsigned int msg_size)
+{
+	if (header_ == 0)
+	{
+		return -1;
+	}
+
+	if (n_objects > header_->max_objects || msg_size > header_->max_msg_size)
+	{
+		if (n_failed_++ == 0)
+		{
+			LOG("Frame too large for shared memory: %u objects (max %u), message %u bytes (max %u). Frames dropped.",
+				n_objects, header_->max_objects, msg_size, header_->max_msg_size);
+		}
+		return -1;
+	}
+
+	unsigned long long frame_id = header_->frame_id.load(std::memory_order_relaxed) + 1;
+	char *slot_data = (char*)header_ + SlotOffset(header_, frame_id);
+	SE_ShmSlotHeader *slot = (SE_ShmSlotHeader*)slot_data;
+
+	// Mark slot as being written, before any of its content changes
+	slot->frame_id.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot->sim_time = sim_time;
+	slot->n_objects = n_objects;
+	slot->msg_size = msg_size;
+	if (n_objects > 0)
+	{
+		memcpy(slot_data + ObjectsOffset(), objects, n_objects * sizeof(SE_ShmObjectState));
+	}
+	if (msg_size > 0)
+	{
+		memcpy(slot_data + MessageOffset(header_), msg, msg_size);
+	}
+	slot->send_time = (unsigned long long)SE_getSystemTimeUs();
+
+	slot->frame_id.store(frame_id, std::memory_order_release);
+	header_->frame_id.store(frame_id, std::memory_order_release);
+
+	return 0;
+}
+
+int SE_SharedMemoryReader::Open(std::string name)
+{
+	Close();
+
+	void *data = 0;
+	size_t size = 0;
+
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+	if (mapping == NULL)
+	{
+		return -1;
+	}
+
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	MEMORY_BASIC_INFORMATION info;
+	if (data == NULL || VirtualQuery(data, &info, sizeof(info)) == 0)
+	{
+		if (data)
+		{
+			UnmapViewOfFile(data);
+		}
+		CloseHandle(mapping);
+		return -1;
+	}
+	size = info.RegionSize;
+	handle_ = mapping;
+#else
+	int fd = shm_open(("/" + name).c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	// Read only, a reader can't disturb the writer or other readers
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t)sizeof(SE_ShmHeader) ||
+		(data = mmap(0, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	size = file_stat.st_size;
+#endif
+
+	header_ = (const SE_ShmHeader*)data;
+	size_ = size;
+
+	bool ok = header_->magic == SE_SHM_MAGIC;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!ok || header_->version != SE_SHM_VERSION)
+	{
+		if (ok)
+		{
+			LOG("Shared memory %s version %u not supported (expected %u)", name.c_str(), header_->version, SE_SHM_VERSION);
+		}
+		Close();
+		return -1;
+	}
+
+	// Layout must fit in the mapped memory, so that no access goes beyond it
+	if (header_->n_slots == 0 || MessageOffset(header_) + header_->max_msg_size > header_->slot_size ||
+		AlignSize(sizeof(SE_ShmHeader)) + (size_t)header_->n_slots * header_->slot_size > size_)
+	{
+		LOG("Shared memory %s has inconsistent layout", name.c_str());
+		Close();
+		return -1;
+	}
+
+	// Only frames published from now on are of interest
+	frame_id_ = header_->frame_id.load(std::memory_order_acquire);
+	slot_ = 0;
+
+	return 0;
+}
+
+void SE_SharedMemoryReader::Close()
+{
+	if (header_ == 0)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(header_);
+	CloseHandle((HANDLE)handle_);
+	handle_ = 0;
+#else
+	munmap((void*)header_, size_);
+#endif
+
+	header_ = 0;
+	slot_ = 0;
+	size_ = 0;
+}
+
+int SE_SharedMemoryReader::Acquire(int timeout_ms)
+{
+	if (header_ == 0)
+	{
+		return -1;
+	}
+
+	__int64 start_time = SE_getSystemTimeUs();
+
+	for (;;)
+	{
+		unsigned long long latest = header_->frame_id.load(std::memory_order_acquire);
+
+		if (latest > frame_id_)
+		{
+			const SE_ShmSlotHeader *slot = (const SE_ShmSlotHeader*)((const char*)header_ + SlotOffset(header_, latest));
+
+			if (slot->frame_id.load(std::memory_order_acquire) == latest)
+			{
+				if (n_frames_ > 0 && latest > frame_id_ + 1)
+				{
+					n_dropped_ += latest - frame_id_ - 1;
+				}
+				frame_id_ = latest;
+				slot_ = slot;
+				n_frames_++;
+				latency_ = SE_getSystemTimeUs() - (__int64)slot->send_time;
+				return 1;
+			}
+			// else slot already being overwritten by next frame, which will be picked up instead
+		}
+
+		__int64 elapsed = SE_getSystemTimeUs() - start_time;
+		if (elapsed > (__int64)timeout_ms * 1000)
+		{
+			return 0;
+		}
+		else if (elapsed < spin_time_)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(SHM_POLL_INTERVAL));
+		}
+	}
+}
+
+bool SE_SharedMemoryReader::Validate()
+{
+	if (slot_ == 0)
+	{
+		return false;
+	}
+
+	// Any data read must have been read before the sequence number is checked again
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (slot_->frame_id.load(std::memory_order_relaxed) != frame_id_)
+	{
+		n_overwritten_++;
+		slot_ = 0;
+		return false;
+	}
+
+	return true;
+}
+
+unsigned int SE_SharedMemoryReader::GetNumberOfObjects()
+{
+	if (slot_ == 0)
+	{
+		return 0;
+	}
+
+	// guard against reading beyond slot while being overwritten, content checked by Validate()
+	return slot_->n_objects < header_->max_objects ? slot_->n_objects : header_->max_objects;
+}
+
+const SE_ShmObjectState *SE_SharedMemoryReader::GetObjects()
+{
+	if (slot_ == 0)
+	{
+		return 0;
+	}
+
+	return (const SE_ShmObjectState*)((const char*)slot_ + ObjectsOffset());
+}
+
+unsigned int SE_SharedMemoryReader::GetMessageSize()
+{
+	if (slot_ == 0)
+	{
+		return 0;
+	}
+
+	return slot_->msg_size < header_->max_msg_size ? slot_->msg_size : header_->max_msg_size;
+}
+
+const char *SE_SharedMemoryReader::GetMessageData()
+{
+	if (slot_ == 0)
+	{
+		return 0;
+	}
+
+	return (const char*)slot_ + MessageOffset(header_);
+}
@@ -0,0 +1,177 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+#pragma once
+
+#include <string>
+#include <atomic>
+#include "CommonMini.hpp"
+
+/*
+  Publishing of simulation frames to other processes on the same host via shared memory.
+  A frame consists of a compact object state table and a serialized message, e.g. OSI SensorView.
+  The writer puts each frame into the next slot of a ring buffer, never waiting for readers. Any number of
+  readers access the latest frame in place, without copying and without system calls as long as frames
+  keep coming. A sequence number per slot tells whether a slot was overwritten while being read.
+*/
+
+#define SE_SHM_DEFAULT_NAME "esmini"
+#define SE_SHM_MAGIC 0x4d485345  // "ESHM" in little endian
+#define SE_SHM_VERSION 1
+#define SE_SHM_N_SLOTS 4  // frames kept, a reader has n-1 frames of time to process one
+#define SE_SHM_MAX_MSG_SIZE (8 << 20)  // bytes per frame for the serialized message
+#define SE_SHM_MAX_OBJECTS 256
+#define SE_SHM_SPIN_TIME 2000  // us, default time for a reader to busy-wait for next frame before polling less often
+
+/**
+  Object state entry, plain fixed size types so that readers don't need esmini headers
+*/
+typedef struct
+{
+	int id;
+	int model_id;
+	int obj_type;  // 0=Vehicle, 1=Pedestrian, 2=MiscObj
+	int control;  // 0=undefined, 1=internal, 2=external, 3=hybrid_external, 4=hybrid_ghost
+	double x;
+	double y;
+	double z;
+	float h;
+	float p;
+	float r;
+	int road_id;
+	int lane_id;
+	float s;
+	float offset;
+	float speed;
+} SE_ShmObjectState;
+
+typedef struct
+{
+	unsigned int magic;  // SE_SHM_MAGIC, set when the memory is completely initialized
+	unsigned int version;  // SE_SHM_VERSION
+	unsigned int n_slots;
+	unsigned int max_objects;
+	unsigned int max_msg_size;
+	unsigned int slot_size;  // bytes per slot, including slot header
+	std::atomic<unsigned long long> frame_id;  // latest completely written frame, starts at 1, 0 means none yet
+} SE_ShmHeader;
+
+typedef struct
+{
+	std::atomic<unsigned long long> frame_id;  // frame in slot, 0 while being written
+	unsigned long long send_time;  // writer monotonic time (us) when frame was published
+	double sim_time;
+	unsigned int n_objects;
+	unsigned int msg_size;
+	// followed by SE_ShmObjectState[max_objects] and message data[max_msg_size]
+} SE_ShmSlotHeader;
+
+class SE_SharedMemoryWriter
+{
+public:
+	SE_SharedMemoryWriter() : header_(0), size_(0), handle_(0), n_failed_(0) {}
+	~SE_SharedMemoryWriter() { Close(); }
+
+	/**
+	Create shared memory, replacing any existing one with same name
+	@param name Name of shared memory, same for writer and readers
+	@return 0 on success, -1 on failure
+	*/
+	int Open(std::string name = SE_SHM_DEFAULT_NAME, unsigned int max_msg_size = SE_SHM_MAX_MSG_SIZE,
+		unsigned int max_objects = SE_SHM_MAX_OBJECTS, unsigned int n_slots = SE_SHM_N_SLOTS);
+
+	/**
+	Unmap and remove the shared memory. Readers already attached keep their mapping.
+	*/
+	void Close();
+	bool IsOpen() { return header_ != 0; }
+
+	/**
+	Publish a frame
+	@return 0 on success, -1 if data does not fit, see GetMaxObjects
+	*/
+	int Write(double sim_time, const SE_ShmObjectState *objects, unsigned int n_objects, const char *msg, unsigned int msg_size);
+
+	unsigned long long GetFrameId() { return header_ ? header_->frame_id.load(std::memory_order_relaxed) : 0; }
+	unsigned int GetMaxObjects() { return header_ ? header_->max_objects : 0; }
+	unsigned long long GetNumberOfFailed() { return n_failed_; }
+
+private:
+	SE_ShmHeader *header_;
+	size_t size_;
+	void *handle_;  // Windows file mapping handle
+	std::string name_;
+	unsigned long long n_failed_;
+};
+
+class SE_SharedMemoryReader
+{
+public:
+	SE_SharedMemoryReader() : header_(0), slot_(0), size_(0), handle_(0), spin_time_(SE_SHM_SPIN_TIME), frame_id_(0),
+		latency_(0), n_frames_(0), n_dropped_(0), n_overwritten_(0) {}
+	~SE_SharedMemoryReader() { Close(); }
+
+	/**
+	Attach to shared memory created by a writer
+	@return 0 on success, -1 if not available (yet)
+	*/
+	int Open(std::string name = SE_SHM_DEFAULT_NAME);
+	void Close();
+	bool IsOpen() { return header_ != 0; }
+
+	/**
+	Wait for a frame newer than the previous one, and make it current. Busy waits, yielding the CPU, for spin time
+	then sleeps shortly between polls. Returns immediately, without any system call, if a new frame is already there.
+	@param timeout_ms Longest time to wait
+	@return 1 if a new frame is available, 0 on timeout, -1 if not open
+	*/
+	int Acquire(int timeout_ms);
+
+	/**
+	Check that current frame was not overwritten by the writer. Call after reading the data, not before.
+	Frames found overwritten are counted, see GetNumberOfOverwritten.
+	*/
+	bool Validate();
+
+	/**
+	Set time to busy-wait in Acquire before sleeping between polls. Longer time means lower latency, but more CPU load.
+	@param spin_time_us Microseconds, e.g. a bit more than the frame interval to never sleep
+	*/
+	void SetSpinTime(int spin_time_us) { spin_time_ = spin_time_us; }
+
+	// Current frame, data is read in place and valid until validated
+	unsigned long long GetFrameId() { return frame_id_; }
+	double GetSimTime() { return slot_ ? slot_->sim_time : 0.0; }
+	unsigned int GetNumberOfObjects();
+	const SE_ShmObjectState *GetObjects();
+	unsigned int GetMessageSize();
+	const char *GetMessageData();
+
+	// Time (us) from frame published to acquired by this reader
+	__int64 GetLatency() { return latency_; }
+
+	unsigned long long GetNumberOfFrames() { return n_frames_; }
+	unsigned long long GetNumberOfDropped() { return n_dropped_; }  // frames skipped because reader was too slow
+	unsigned long long GetNumberOfOverwritten() { return n_overwritten_; }
+
+private:
+	const SE_ShmHeader *header_;
+	const SE_ShmSlotHeader *slot_;
+	size_t size_;
+	void *handle_;
+	int spin_time_;
+	unsigned long long frame_id_;
+	__int64 latency_;
+	unsigned long long n_frames_;
+	unsigned long long n_dropped_;
+	unsigned long long n_overwritten_;
+};
@@ -0,0 +1,484 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+#include <string.h>
+#include <random>
+#include "UDP.hpp"
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <Ws2tcpip.h>
+#else
+	 /* Assume that any non-Windows platform uses POSIX-style sockets instead. */
+	#include <sys/socket.h>
+	#include <sys/uio.h>
+	#include <arpa/inet.h>
+	#include <netdb.h>  /* Needed for getaddrinfo() and freeaddrinfo() */
+	#include <unistd.h> /* Needed for close() */
+	#include <errno.h>
+#endif
+
+#define UDP_RECEIVE_SLOT_SIZE 65536  // room for any UDP datagram over IPv4
+
+struct SE_UDPBatch
+{
+#ifdef __linux__
+	struct mmsghdr msg[SE_UDP_BATCH_SIZE];
+	struct iovec iov[SE_UDP_BATCH_SIZE][2];
+#endif
+	std::vector<char> buf;  // receive buffer, one slot per datagram
+	int len[SE_UDP_BATCH_SIZE];  // size of each received datagram
+	int n;  // number of datagrams in buffer
+	int pos;  // next datagram to process
+
+	SE_UDPBatch() : n(0), pos(0) {}
+};
+
+static void CloseSocket(int sock)
+{
+#ifdef _WIN32
+	if (closesocket(sock) == SOCKET_ERROR)
+#else
+	if (close(sock) < 0)
+#endif
+	{
+		LOG("Failed closing socket");
+	}
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+static int CreateSocket(int buffer_option)
+{
+#ifdef _WIN32
+	WSADATA wsa_data;
+	int iResult = WSAStartup(MAKEWORD(2, 2), &wsa_data);
+	if (iResult != NO_ERROR)
+	{
+		LOG("WSAStartup failed with error %d", iResult);
+		return -1;
+	}
+#endif
+
+	int sock = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0)
+	{
+		LOG("socket failed");
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return -1;
+	}
+
+	// Large buffer, so that all fragments of a big message fit. The system might limit the size.
+	int buffer_size = SE_UDP_SOCKET_BUFFER_SIZE;
+	setsockopt(sock, SOL_SOCKET, buffer_option, (const char*)&buffer_size, sizeof(buffer_size));
+
+	return sock;
+}
+
+int SE_UDPFragmentSender::Open(std::string ipaddr, int port, int max_datagram_size)
+{
+	Close();
+
+	if ((sock_ = CreateSocket(SO_SNDBUF)) < 0)
+	{
+		return -1;
+	}
+
+	addr_ = new struct sockaddr_in;
+	memset(addr_, 0, sizeof(*addr_));
+	addr_->sin_family = AF_INET;
+	addr_->sin_port = htons((unsigned short)port);
+	if (inet_pton(AF_INET, ipaddr.c_str(), &addr_->sin_addr) != 1)
+	{
+		LOG("Invalid IP address: %s", ipaddr.c_str());
+		Close();
+		return -1;
+	}
+
+	max_datagram_size_ = max_datagram_size;
+	if (max_datagram_size_ > SE_UDP_MAX_DATAGRAM_SIZE)
+	{
+		max_datagram_size_ = SE_UDP_MAX_DATAGRAM_SIZE;
+	}
+	else if (max_datagram_size_ < (int)sizeof(SE_UDPFragmentHeader) + 1)
+	{
+		max_datagram_size_ = (int)sizeof(SE_UDPFragmentHeader) + 1;
+	}
+
+	batch_ = new SE_UDPBatch;
+
+	// New session, frame ids start over. Time is mixed in since random_device might be deterministic on some platforms.
+	std::random_device rd;
+	do
+	{
+		session_id_ = rd() ^ (unsigned int)SE_getSystemTimeUs();
+	} while (session_id_ == 0);
+	frame_id_ = 0;
+
+	return 0;
+}
+
+void SE_UDPFragmentSender::Close()
+{
+	if (sock_ >= 0)
+	{
+		CloseSocket(sock_);
+		sock_ = -1;
+	}
+
+	delete addr_;
+	addr_ = 0;
+	delete batch_;
+	batch_ = 0;
+}
+
+int SE_UDPFragmentSender::Send(const char *data, unsigned int size)
+{
+	if (sock_ < 0)
+	{
+		return -1;
+	}
+
+	n_messages_++;
+
+	if (size <= (unsigned int)max_datagram_size_)
+	{
+		// Fits in one datagram, sent without header so that plain UDP consumers can parse it
+		if (sendto(sock_, data, size, 0, (struct sockaddr*)addr_, sizeof(*addr_)) != (int)size)
+		{
+			n_failed_++;
+			return -1;
+		}
+		return 0;
+	}
+
+	unsigned int payload_size = max_datagram_size_ - (unsigned int)sizeof(SE_UDPFragmentHeader);
+	unsigned int n_fragments = (size + payload_size - 1) / payload_size;
+	if (n_fragments > 0xffff)
+	{
+		LOG("Message of %u bytes too large for UDP transport", size);
+		n_failed_++;
+		return -1;
+	}
+
+	frame_id_++;
+	unsigned long long send_time = (unsigned long long)SE_getSystemTimeUs();
+
+	header_.resize(n_fragments);
+	for (unsigned int i = 0; i < n_fragments; i++)
+	{
+		header_[i].magic = SE_UDP_FRAGMENT_MAGIC;
+		header_[i].session_id = session_id_;
+		header_[i].frame_id = frame_id_;
+		header_[i].msg_size = size;
+		header_[i].n_fragments = (unsigned short)n_fragments;
+		header_[i].fragment_idx = (unsigned short)i;
+		header_[i].reserved = 0;
+		header_[i].send_time = send_time;
+	}
+
+	int result = 0;
+
+#ifdef __linux__
+	// Header and slice of the message are gathered into each datagram, no copy of payload
+	for (unsigned int i = 0; i < n_fragments && result == 0; i += SE_UDP_BATCH_SIZE)
+	{
+		unsigned int n = n_fragments - i < SE_UDP_BATCH_SIZE ? n_fragments - i : SE_UDP_BATCH_SIZE;
+
+		for (unsigned int j = 0; j < n; j++)
+		{
+			unsigned int offset = (i + j) * payload_size;
+			batch_->iov[j][0].iov_base = &header_[i + j];
+			batch_->iov[j][0].iov_len = sizeof(SE_UDPFragmentHeader);
+			batch_->iov[j][1].iov_base = (void*)(data + offset);
+			batch_->iov[j][1].iov_len = size - offset < payload_size ? size - offset : payload_size;
+
+			memset(&batch_->msg[j], 0, sizeof(batch_->msg[j]));
+			batch_->msg[j].msg_hdr.msg_name = addr_;
+			batch_->msg[j].msg_hdr.msg_namelen = sizeof(*addr_);
+			batch_->msg[j].msg_hdr.msg_iov = batch_->iov[j];
+			batch_->msg[j].msg_hdr.msg_iovlen = 2;
+		}
+
+		for (unsigned int sent = 0; sent < n;)
+		{
+			int ret = sendmmsg(sock_, &batch_->msg[sent], n - sent, 0);
+			if (ret < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (ret <= 0)
+			{
+				// Nothing sent, give up instead of retrying forever
+				result = -1;
+				break;
+			}
+			sent += ret;
+		}
+	}
+#else
+	datagram_.resize(max_datagram_size_);
+	for (unsigned int i = 0; i < n_fragments; i++)
+	{
+		unsigned int offset = i * payload_size;
+		unsigned int len = size - offset < payload_size ? size - offset : payload_size;
+
+		memcpy(&datagram_[0], &header_[i], sizeof(SE_UDPFragmentHeader));
+		memcpy(&datagram_[sizeof(SE_UDPFragmentHeader)], data + offset, len);
+
+		int datagram_size = (int)(sizeof(SE_UDPFragmentHeader) + len);
+		if (sendto(sock_, &datagram_[0], datagram_size, 0, (struct sockaddr*)addr_, sizeof(*addr_)) != datagram_size)
+		{
+			result = -1;
+			break;
+		}
+	}
+#endif
+
+	if (result != 0)
+	{
+		n_failed_++;
+	}
+
+	return result;
+}
+
+SE_UDPFragmentReceiver::SE_UDPFragmentReceiver() : sock_(-1), batch_(0), timeout_ms_(0), assembling_(false), session_id_(0), frame_id_(0),
+	n_fragments_received_(0), last_frame_id_(0), latency_(0), n_messages_(0), n_framed_(0), n_bytes_(0), n_dropped_(0), n_restarts_(0)
+{
+}
+
+int SE_UDPFragmentReceiver::Open(int port, int timeout_ms)
+{
+	Close();
+
+	if ((sock_ = CreateSocket(SO_RCVBUF)) < 0)
+	{
+		return -1;
+	}
+
+	timeout_ms_ = timeout_ms;
+#ifdef _WIN32
+	DWORD timeout = timeout_ms;
+	if (setsockopt(sock_, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout)) != 0)
+#else
+	struct timeval tv;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	if (setsockopt(sock_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0)
+#endif
+	{
+		LOG("socket SO_RCVTIMEO (receive timeout) not supported on this platform");
+	}
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((unsigned short)port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if (bind(sock_, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		LOG("Bind to port %d failed", port);
+		Close();
+		return -1;
+	}
+
+	batch_ = new SE_UDPBatch;
+	batch_->buf.resize((size_t)SE_UDP_BATCH_SIZE * UDP_RECEIVE_SLOT_SIZE);
+
+	return 0;
+}
+
+void SE_UDPFragmentReceiver::Close()
+{
+	if (sock_ >= 0)
+	{
+		CloseSocket(sock_);
+		sock_ = -1;
+	}
+
+	delete batch_;
+	batch_ = 0;
+	assembling_ = false;
+}
+
+int SE_UDPFragmentReceiver::Receive()
+{
+	if (sock_ < 0)
+	{
+		return -1;
+	}
+
+	__int64 start_time = SE_getSystemTimeUs();
+
+	for (;;)
+	{
+		// First process any datagrams remaining from previous call
+		while (batch_->pos < batch_->n)
+		{
+			int i = batch_->pos++;
+			if (AddDatagram(&batch_->buf[(size_t)i * UDP_RECEIVE_SLOT_SIZE], batch_->len[i]))
+			{
+				return (int)msg_.size();
+			}
+		}
+
+		if (SE_getSystemTimeUs() - start_time > (__int64)timeout_ms_ * 1000)
+		{
+			return 0;
+		}
+
+		batch_->n = 0;
+		batch_->pos = 0;
+
+#ifdef __linux__
+		for (int i = 0; i < SE_UDP_BATCH_SIZE; i++)
+		{
+			batch_->iov[i][0].iov_base = &batch_->buf[(size_t)i * UDP_RECEIVE_SLOT_SIZE];
+			batch_->iov[i][0].iov_len = UDP_RECEIVE_SLOT_SIZE;
+			memset(&batch_->msg[i], 0, sizeof(batch_->msg[i]));
+			batch_->msg[i].msg_hdr.msg_iov = batch_->iov[i];
+			batch_->msg[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		// Wait for the first datagram, then take whatever else is already there
+		int n = recvmmsg(sock_, batch_->msg, SE_UDP_BATCH_SIZE, MSG_WAITFORONE, 0);
+		for (int i = 0; i < n; i++)
+		{
+			batch_->len[i] = (int)batch_->msg[i].msg_len;
+		}
+#else
+		int n = recvfrom(sock_, &batch_->buf[0], UDP_RECEIVE_SLOT_SIZE, 0, 0, 0);
+		if (n > 0)
+		{
+			batch_->len[0] = n;
+			n = 1;
+		}
+#endif
+
+		if (n <= 0)
+		{
+			return 0;  // timeout
+		}
+		batch_->n = n;
+	}
+}
+
+bool SE_UDPFragmentReceiver::AddDatagram(const char *data, int size)
+{
+	SE_UDPFragmentHeader header;
+
+	header.magic = 0;
+	if (size >= (int)sizeof(header))
+	{
+		memcpy(&header, data, sizeof(header));
+	}
+
+	if (header.magic != SE_UDP_FRAGMENT_MAGIC || header.n_fragments < 2)
+	{
+		// Plain datagram, a complete message by itself
+		msg_.assign(data, data + size);
+		assembling_ = false;
+		latency_ = 0;
+		n_messages_++;
+		n_bytes_ += size;
+		return true;
+	}
+
+	if ((assembling_ || n_framed_ > 0) && header.session_id != session_id_)
+	{
+		// Sender restarted, frame ids of the new session are not comparable to the old ones
+		LOG("UDP sender restarted (session %u -> %u)", session_id_, header.session_id);
+		assembling_ = false;
+		n_framed_ = 0;
+		n_restarts_++;
+	}
+
+	if (assembling_ && header.frame_id != frame_id_)
+	{
+		if ((int)(header.frame_id - frame_id_) < 0)
+		{
+			return false;  // late fragment of an earlier message
+		}
+		// A later message has started, the current one will not be completed
+		assembling_ = false;
+	}
+
+	if (!assembling_)
+	{
+		if (n_framed_ > 0 && (int)(header.frame_id - last_frame_id_) <= 0)
+		{
+			return false;  // duplicate or late fragment of a message already completed or given up
+		}
+
+		if (header.msg_size > (unsigned long long)header.n_fragments * SE_UDP_MAX_DATAGRAM_SIZE)
+		{
+			return false;  // corrupt or foreign header, message could not have been sent in that many fragments
+		}
+
+		session_id_ = header.session_id;
+		frame_id_ = header.frame_id;
+		msg_.resize(header.msg_size);
+		fragment_received_.assign(header.n_fragments, 0);
+		n_fragments_received_ = 0;
+		assembling_ = true;
+	}
+
+	if (header.fragment_idx >= fragment_received_.size() || header.n_fragments != fragment_received_.size() ||
+		header.msg_size != msg_.size())
+	{
+		return false;  // inconsistent with other fragments of the message
+	}
+
+	// All fragments but the last one carry the same amount of payload
+	size_t payload_size = size - sizeof(header);
+	size_t offset = header.fragment_idx == header.n_fragments - 1 ?
+		msg_.size() - payload_size : header.fragment_idx * payload_size;
+
+	if (payload_size > msg_.size() || offset + payload_size > msg_.size())
+	{
+		return false;
+	}
+
+	if (!fragment_received_[header.fragment_idx])
+	{
+		if (payload_size > 0)
+		{
+			memcpy(&msg_[offset], data + sizeof(header), payload_size);
+		}
+		fragment_received_[header.fragment_idx] = 1;
+		n_fragments_received_++;
+	}
+
+	if (n_fragments_received_ < header.n_fragments)
+	{
+		return false;
+	}
+
+	assembling_ = false;
+	if (n_framed_ > 0)
+	{
+		n_dropped_ += frame_id_ - last_frame_id_ - 1;
+	}
+	last_frame_id_ = frame_id_;
+	n_framed_++;
+	n_messages_++;
+	n_bytes_ += msg_.size();
+	latency_ = SE_getSystemTimeUs() - (__int64)header.send_time;
+
+	return true;
+}
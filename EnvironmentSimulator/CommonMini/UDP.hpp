@@ -0,0 +1,158 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CommonMini.hpp"
+
+/*
+  Transport of messages of any size over UDP, e.g. serialized OSI SensorView.
+  A message that fits in one datagram is sent as is, so plain UDP consumers can parse it directly.
+  Larger messages are split into fragments, one per datagram, each prefixed by a header identifying
+  the message (frame id) and position of the fragment. The receiver puts the message together again
+  and keeps track of lost messages and latency, for fragmented messages only. Each sender instance
+  stamps its fragments with a random session id, so that the receiver can tell a restarted sender,
+  counting frames from the beginning again, from late fragments. On Linux datagrams are sent and
+  received in batches.
+*/
+
+#define SE_UDP_MAX_DATAGRAM_SIZE 65000  // bytes including fragment header, just below the limit of UDP over IPv4
+#define SE_UDP_FRAGMENT_MAGIC 0x46455345  // "ESEF" in little endian
+#define SE_UDP_BATCH_SIZE 32  // max number of datagrams per sendmmsg/recvmmsg call
+#define SE_UDP_SOCKET_BUFFER_SIZE (8 << 20)  // requested socket buffer size, to absorb bursts of fragments
+
+/**
+  Header of each datagram. Native byte order, i.e. sender and receiver are assumed to run on similar platforms.
+*/
+typedef struct
+{
+	unsigned int magic;            // SE_UDP_FRAGMENT_MAGIC
+	unsigned int session_id;       // Random number picked by the sender when opened, new value means sender restarted
+	unsigned int frame_id;         // Message counter, incremented for each fragmented message sent
+	unsigned int msg_size;         // Total size of the message, bytes
+	unsigned short n_fragments;    // Number of fragments (datagrams) of the message, at least 2
+	unsigned short fragment_idx;   // Index of this fragment, payload starts at fragment_idx * max payload size
+	unsigned int reserved;         // Zero, explicit padding for 8 byte alignment of send_time
+	unsigned long long send_time;  // Sender monotonic time (us) when message was sent, for latency measurement on same host
+} SE_UDPFragmentHeader;
+
+struct sockaddr_in;
+struct SE_UDPBatch;
+
+class SE_UDPFragmentSender
+{
+public:
+	SE_UDPFragmentSender() : sock_(-1), addr_(0), batch_(0), max_datagram_size_(SE_UDP_MAX_DATAGRAM_SIZE), session_id_(0), frame_id_(0),
+		n_messages_(0), n_failed_(0) {}
+	~SE_UDPFragmentSender() { Close(); }
+
+	/**
+	Create socket for sending to specified address
+	@param ipaddr IP address of receiver, e.g. "127.0.0.1"
+	@param port Port of receiver
+	@param max_datagram_size Largest datagram to send, including fragment header. Lower it to avoid IP fragmentation on real networks.
+	@return 0 on success, -1 on failure
+	*/
+	int Open(std::string ipaddr, int port, int max_datagram_size = SE_UDP_MAX_DATAGRAM_SIZE);
+	void Close();
+	bool IsOpen() { return sock_ >= 0; }
+	int GetSocket() { return sock_; }
+
+	/**
+	Send a message, as a single plain datagram if it fits, else split into as many fragments as needed
+	@return 0 on success, -1 if any datagram could not be sent
+	*/
+	int Send(const char *data, unsigned int size);
+
+	unsigned int GetSessionId() { return session_id_; }
+	unsigned int GetFrameId() { return frame_id_; }
+	unsigned long long GetNumberOfMessages() { return n_messages_; }
+	unsigned long long GetNumberOfFailed() { return n_failed_; }
+
+private:
+	int sock_;
+	struct sockaddr_in *addr_;
+	SE_UDPBatch *batch_;
+	int max_datagram_size_;
+	unsigned int session_id_;
+	unsigned int frame_id_;
+	unsigned long long n_messages_;
+	unsigned long long n_failed_;
+	std::vector<SE_UDPFragmentHeader> header_;
+	std::vector<char> datagram_;
+};
+
+class SE_UDPFragmentReceiver
+{
+public:
+	SE_UDPFragmentReceiver();
+	~SE_UDPFragmentReceiver() { Close(); }
+
+	/**
+	Create socket and bind to specified port
+	@param port Port to receive from
+	@param timeout_ms Longest time Receive() waits for a complete message
+	@return 0 on success, -1 on failure
+	*/
+	int Open(int port, int timeout_ms);
+	void Close();
+
+	/**
+	Wait for next complete message. Incomplete messages are dropped as soon as a fragment of a later message arrives.
+	Datagrams without fragment header are returned as complete messages, e.g. small messages sent unfragmented.
+	@return Size of the message, 0 if no complete message arrived within timeout, -1 on error
+	*/
+	int Receive();
+
+	/**
+	Process one datagram, as received by Receive(). Can also be used to feed datagrams received by other means.
+	@return true when a message was completed, then available by GetMessageData()
+	*/
+	bool AddDatagram(const char *data, int size);
+
+	// Last complete message, valid until next call to Receive()
+	const char *GetMessageData() { return msg_.data(); }
+	unsigned int GetFrameId() { return last_frame_id_; }
+	unsigned int GetSessionId() { return session_id_; }
+
+	// Time (us) from message sent to completely received, only valid for fragmented messages and when sender runs on same host
+	__int64 GetLatency() { return latency_; }
+
+	unsigned long long GetNumberOfMessages() { return n_messages_; }
+	unsigned long long GetNumberOfBytes() { return n_bytes_; }
+
+	// Number of fragmented messages missing, i.e. gaps in frame id sequence of complete messages
+	unsigned long long GetNumberOfDropped() { return n_dropped_; }
+
+	// Number of times a new sender session was detected after the first one, e.g. sender restarted
+	unsigned long long GetNumberOfRestarts() { return n_restarts_; }
+
+private:
+	int sock_;
+	SE_UDPBatch *batch_;
+	int timeout_ms_;
+	std::vector<char> msg_;
+	std::vector<char> fragment_received_;
+	bool assembling_;
+	unsigned int session_id_;  // of current sender, valid when n_framed_ > 0 or assembling_
+	unsigned int frame_id_;
+	unsigned int n_fragments_received_;
+	unsigned int last_frame_id_;
+	__int64 latency_;
+	unsigned long long n_messages_;
+	unsigned long long n_framed_;  // fragmented messages completed, for drop detection
+	unsigned long long n_bytes_;
+	unsigned long long n_dropped_;
+	unsigned long long n_restarts_;
+};
@@ -13,11 +13,13 @@
 #include <iostream>
 #include <string>
 #include <random>
+#include <algorithm>
 
 #include "ScenarioEngine.hpp"
 #include "RoadManager.hpp"
 #include "CommonMini.hpp"
 #include "Server.hpp"
+#include "Replay.hpp"
 #include "playerbase.hpp"
 #ifdef _SCENARIO_VIEWER
 	#include "viewer.hpp"
@@ -26,8 +28,8 @@
 using namespace scenarioengine;
 
 #define GHOST_HEADSTART 2.5
-
-static int osi_counter = 0; 
+#define FAST_MODE_DEFAULT_TIMESTEP 0.05
+#define FAST_MODE_VIEWER_INTERVAL 40  // ms between viewer frames in fast mode, i.e. 25 Hz
 
 void log_callback(const char *str)
 {
@@ -54,6 +56,14 @@ ScenarioPlayer::ScenarioPlayer(int &argc, char *argv[]) :
 	osi_receiver_addr = "";
 	osi_file = false; 
 	osi_freq_ = 1;
+	osi_counter_ = 0;
+	time_stamp_ = 0;
+	message_shown_ = false;
+	fast_ = false;
+	fast_start_time_ = 0;
+	viewer_time_stamp_ = 0;
+	fast_start_sim_time_ = 0.0;
+	fast_profiling_ = false;
 	CSV_Log = NULL;
 	osiReporter = NULL;
 	viewer_ = 0;
@@ -73,6 +83,31 @@ ScenarioPlayer::ScenarioPlayer(int &argc, char *argv[]) :
 
 ScenarioPlayer::~ScenarioPlayer()
 {
+	if (fast_)
+	{
+		PrintPerformanceReport();
+		if (fast_profiling_)
+		{
+			SE_Profiler::Inst().Enable(false);
+		}
+	}
+
+	if (!profile_filename_.empty())
+	{
+		if (SE_Profiler::Inst().WriteJSON(profile_filename_) == 0)
+		{
+			LOG("Profile written to %s", profile_filename_.c_str());
+		}
+	}
+
+	if (!profile_trace_filename_.empty())
+	{
+		if (SE_Profiler::Inst().WriteChromeTrace(profile_trace_filename_) == 0)
+		{
+			LOG("Profile trace written to %s", profile_trace_filename_.c_str());
+		}
+	}
+
 	if (launch_server && (scenarioEngine->entities.object_[0]->GetControl() == Object::Control::EXTERNAL ||
 		scenarioEngine->entities.object_[0]->GetControl() == Object::Control::HYBRID_EXTERNAL))
 	{
@@ -104,34 +139,47 @@ ScenarioPlayer::~ScenarioPlayer()
 
 void ScenarioPlayer::Frame(double timestep_s)
 {
-	static bool messageShown = false;
+	if (fast_ && fast_start_time_ == 0)
+	{
+		if (fast_profiling_)
+		{
+			// skip initialization, e.g. the initial step, in the performance report
+			SE_Profiler::Inst().Reset();
+		}
+		fast_start_time_ = SE_getSystemTimeNs();
+		fast_start_sim_time_ = scenarioEngine->getSimulationTime();
+	}
 
 	ScenarioFrame(timestep_s);
-	
+
 	if (!headless && viewer_)
 	{
 		if (!threads)
 		{
-			ViewerFrame();
+			// In fast mode, don't let the viewer (e.g. vsync) limit the simulation rate
+			if (!fast_ || SE_getSystemTime() - viewer_time_stamp_ >= FAST_MODE_VIEWER_INTERVAL)
+			{
+				ViewerFrame();
+				viewer_time_stamp_ = SE_getSystemTime();
+			}
 		}
 	}
 
-	if (scenarioEngine->getSimulationTime() > 3600 && !messageShown)
+	if (scenarioEngine->getSimulationTime() > 3600 && !message_shown_)
 	{
 		LOG("Info: Simulation time > 1 hour. Put a stopTrigger for automatic ending");
-		messageShown = true;
+		message_shown_ = true;
 	}
 
 }
 
 void ScenarioPlayer::Frame()
 {
-	static __int64 time_stamp = 0;
 	double dt;
 
 	if ((dt = GetFixedTimestep()) < 0.0)
 	{
-		Frame(SE_getSimTimeStep(time_stamp, minStepSize, maxStepSize));
+		Frame(SE_getSimTimeStep(time_stamp_, minStepSize, maxStepSize));
 	}
 	else
 	{
@@ -141,6 +189,8 @@ void ScenarioPlayer::Frame()
 
 void ScenarioPlayer::ScenarioFrame(double timestep_s)
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_FRAME);
+
 	mutex.Lock();
 	
 	scenarioEngine->step(timestep_s);
@@ -153,10 +203,10 @@ void ScenarioPlayer::ScenarioFrame(double timestep_s)
 	osiReporter->ReportSensors(sensor);
 
 	// Update OSI info
-	if (osi_file || osiReporter->GetSocket())
+	if (osi_file || osiReporter->GetSocket() || osiReporter->IsSharedMemoryOpen())
 	{
-		osi_counter++; 
-		if (osi_counter % osi_freq_ == 0 )
+		osi_counter_++; 
+		if (osi_counter_ % osi_freq_ == 0 )
 		{
 			osiReporter->UpdateOSISensorView(scenarioGateway->objectState_);
 			if (osi_file)
@@ -202,6 +252,12 @@ void ScenarioPlayer::ScenarioFrame(double timestep_s)
 	//    scenarioEngine->entities.object_[0]->pos_.GetHRoad(),
 	//    scenarioEngine->entities.object_[0]->pos_.GetHRelative());
 
+	if (threads && !headless)
+	{
+		// Hand over states to the viewer thread. Without one, e.g. headless, there is no reader.
+		scenarioGateway->PublishSnapshot();
+	}
+
 	mutex.Unlock();
 	
 	if (scenarioEngine->GetQuitFlag())
@@ -210,24 +266,98 @@ void ScenarioPlayer::ScenarioFrame(double timestep_s)
 	}
 }
 
+void ScenarioPlayer::SetFastMode(double timestep)
+{
+	if (timestep > 0.0)
+	{
+		SetFixedTimestep(timestep);
+	}
+	else if (GetFixedTimestep() <= 0.0)
+	{
+		SetFixedTimestep(FAST_MODE_DEFAULT_TIMESTEP);
+	}
+
+	fast_ = true;
+	if (!SE_Profiler::IsEnabled())
+	{
+		// the performance report is based on the profiler statistics
+		SE_Profiler::Inst().Enable(true);
+		fast_profiling_ = true;
+	}
+	LOG("Run as fast as possible, with fixed timestep: %.3f", GetFixedTimestep());
+}
+
+void ScenarioPlayer::PrintPerformanceReport()
+{
+	SE_ProfileStats frame = SE_Profiler::Inst().GetStats(SE_PROFILE_FRAME);
+
+	if (frame.count == 0)
+	{
+		LOG("Performance: No steps taken");
+		return;
+	}
+
+	double wall_time = 1e-9 * (SE_getSystemTimeNs() - fast_start_time_);
+	double sim_time = scenarioEngine->getSimulationTime() - fast_start_sim_time_;
+	double n = (double)frame.count;
+
+	LOG("Performance: %d steps, %.2f s simulated in %.2f s wall time => %.1f simulated seconds per wall second",
+		(int)frame.count, sim_time, wall_time, wall_time > SMALL_NUMBER ? sim_time / wall_time : 0.0);
+	LOG("  step time: mean %.1f us, p99 %.1f us, max %.1f us", 1e-3 * frame.total / n,
+		1e-3 * SE_Profiler::GetPercentile(frame, 99), 1e-3 * frame.max);
+
+	// Time per step spent in each profiled section, nested ones included in their parents (e.g. triggers in step)
+	for (int i = SE_PROFILE_FRAME + 1; i < SE_PROFILE_N_SECTIONS; i++)
+	{
+		SE_ProfileStats stats = SE_Profiler::Inst().GetStats((SE_ProfileSection)i);
+		if (stats.count > 0)
+		{
+			LOG("  %-14s mean %8.1f us %5.1f%%, p99 %8.1f us per call", SE_Profiler::GetSectionName((SE_ProfileSection)i),
+				1e-3 * stats.total / n, 100.0 * stats.total / MAX(frame.total, 1), 1e-3 * SE_Profiler::GetPercentile(stats, 99));
+		}
+	}
+}
+
 #ifdef _SCENARIO_VIEWER
 void ScenarioPlayer::ViewerFrame()
 {
-	static double last_dot_time = scenarioEngine->getSimulationTime();
+	SE_PROFILE_SCOPE(SE_PROFILE_VIEWER);
+
+	// Object states are read from the gateway snapshot, which is consistent and can be read without
+	// blocking the simulation. The mutex is needed only for data not in the snapshot.
+	if (!threads)
+	{
+		// Same thread as the simulation, publish current states on demand instead of every step
+		scenarioGateway->PublishSnapshot();
+	}
+	std::vector<ObjectStateStruct> &states = scenarioGateway->GetSnapshot();
+
+	// Externally reported states might carry other timestamps, use latest one
+	double simulation_time = 0.0;
+	bool hybrid = false;
+	for (size_t i = 0; i < states.size(); i++)
+	{
+		simulation_time = MAX(simulation_time, states[i].timeStamp);
+		hybrid = hybrid || states[i].control == Object::Control::HYBRID_EXTERNAL;
+	}
+
+	static double last_dot_time = simulation_time;
 
 	bool add_dot = false;
-	if (scenarioEngine->getSimulationTime() - last_dot_time > trail_dt)
+	if (simulation_time - last_dot_time > trail_dt)
 	{
 		add_dot = true;
-		last_dot_time = scenarioEngine->getSimulationTime();
+		last_dot_time = simulation_time;
 	}
 
-	mutex.Lock();
-
+	bool lock = states.size() != viewer_->cars_.size() || sensorFrustum.size() > 0 || hybrid;
+	if (lock)
+	{
+		mutex.Lock();
+	}
 
-	// Add or remove cars (for sumo)
-	
-	if (scenarioEngine->entities.object_.size() > viewer_->cars_.size())
+	// Add or remove cars (for sumo), only when entities are available (mutex locked)
+	if (lock && scenarioEngine->entities.object_.size() > viewer_->cars_.size())
 	{
 		// add cars missing
 		for (size_t i = 0; i < scenarioEngine->entities.object_.size(); i++)
@@ -249,7 +379,7 @@ void ScenarioPlayer::ViewerFrame()
 			}
 		}
 	} 
-	else if (scenarioEngine->entities.object_.size() < viewer_->cars_.size())
+	else if (lock && scenarioEngine->entities.object_.size() < viewer_->cars_.size())
 	{
 		// remove obsolete cars
 		for (size_t j = 0; j < viewer_->cars_.size(); j++)
@@ -270,41 +400,38 @@ void ScenarioPlayer::ViewerFrame()
 			}
 		}
 	}
-	// Visualize cars
-	for (size_t i = 0; i < scenarioEngine->entities.object_.size(); i++)
+	// Visualize cars, gateway holds objects in same order as the entities
+	for (size_t i = 0; i < states.size() && i < viewer_->cars_.size(); i++)
 	{
 		viewer::CarModel *car = viewer_->cars_[i];
-		Object *obj = scenarioEngine->entities.object_[i];
-		roadmanager::Position pos = obj->pos_;
+		ObjectStateStruct *state = &states[i];
+		roadmanager::Position *pos = &state->pos;
 
-		car->SetPosition(pos.GetX(), pos.GetY(), pos.GetZ());
-		car->SetRotation(pos.GetH(), pos.GetP(), pos.GetR());
-		car->UpdateWheels(obj->wheel_angle_, obj->wheel_rot_);
+		car->SetPosition(pos->GetX(), pos->GetY(), pos->GetZ());
+		car->SetRotation(pos->GetH(), pos->GetP(), pos->GetR());
+		car->UpdateWheels(state->wheel_angle, state->wheel_rot);
 
-		if (obj->GetControl() == Object::Control::EXTERNAL ||
-			obj->GetControl() == Object::Control::HYBRID_EXTERNAL)
+		if (state->control == Object::Control::HYBRID_EXTERNAL && i < scenarioEngine->entities.object_.size())
 		{
+			Object *obj = scenarioEngine->entities.object_[i];  // mutex locked
 
-			if (obj->GetControl() == Object::Control::HYBRID_EXTERNAL)
-			{
-				viewer_->SensorSetPivotPos(car->speed_sensor_, obj->pos_.GetX(), obj->pos_.GetY(), obj->pos_.GetZ());
-				viewer_->UpdateSensor(car->speed_sensor_);
-				viewer_->SensorSetPivotPos(car->steering_sensor_, obj->pos_.GetX(), obj->pos_.GetY(), obj->pos_.GetZ());
-				viewer_->UpdateSensor(car->steering_sensor_);
-
-				viewer_->SensorSetPivotPos(car->trail_sensor_, obj->trail_closest_pos_[0], obj->trail_closest_pos_[1], obj->trail_closest_pos_[2]);
-				viewer_->SensorSetTargetPos(car->trail_sensor_, pos.GetX(), pos.GetY(), pos.GetZ());
-				viewer_->UpdateSensor(car->trail_sensor_);
-			}
-			else if (odr_manager->GetNumOfRoads() > 0 && obj->GetControl() == Object::Control::EXTERNAL)
-			{
-				viewer_->UpdateRoadSensors(car->road_sensor_, car->lane_sensor_, &pos);
-			}
+			viewer_->SensorSetPivotPos(car->speed_sensor_, pos->GetX(), pos->GetY(), pos->GetZ());
+			viewer_->UpdateSensor(car->speed_sensor_);
+			viewer_->SensorSetPivotPos(car->steering_sensor_, pos->GetX(), pos->GetY(), pos->GetZ());
+			viewer_->UpdateSensor(car->steering_sensor_);
+
+			viewer_->SensorSetPivotPos(car->trail_sensor_, obj->trail_closest_pos_[0], obj->trail_closest_pos_[1], obj->trail_closest_pos_[2]);
+			viewer_->SensorSetTargetPos(car->trail_sensor_, pos->GetX(), pos->GetY(), pos->GetZ());
+			viewer_->UpdateSensor(car->trail_sensor_);
+		}
+		else if (odr_manager->GetNumOfRoads() > 0 && state->control == Object::Control::EXTERNAL)
+		{
+			viewer_->UpdateRoadSensors(car->road_sensor_, car->lane_sensor_, pos);
 		}
 
 		if (add_dot)
 		{
-			car->trail_->AddDot(scenarioEngine->getSimulationTime(), pos.GetX(), pos.GetY(), pos.GetZ(), pos.GetH());
+			car->trail_->AddDot(simulation_time, pos->GetX(), pos->GetY(), pos->GetZ(), pos->GetH());
 		}
 	}
 
@@ -313,13 +440,18 @@ void ScenarioPlayer::ViewerFrame()
 		sensorFrustum[i]->Update();
 	}
 
+	if (lock)
+	{
+		mutex.Unlock();
+	}
+
 	// Update info text 
 	static char str_buf[128];
-	snprintf(str_buf, sizeof(str_buf), "%.2fs %.2fkm/h", scenarioEngine->getSimulationTime(), 
-		3.6 * scenarioEngine->entities.object_[viewer_->currentCarInFocus_]->speed_);
-	viewer_->SetInfoText(str_buf);
-
-	mutex.Unlock();
+	if (viewer_->currentCarInFocus_ < (int)states.size())
+	{
+		snprintf(str_buf, sizeof(str_buf), "%.2fs %.2fkm/h", simulation_time, 3.6 * states[viewer_->currentCarInFocus_].speed);
+		viewer_->SetInfoText(str_buf);
+	}
 
 	viewer_->osgViewer_->frame();
 
@@ -508,6 +640,7 @@ int ScenarioPlayer::Init()
 	opt.AddOption("osc", "OpenSCENARIO filename", "filename");
 	opt.AddOption("control", "Ego control (\"osc\", \"internal\", \"external\", \"hybrid\"", "mode");
 	opt.AddOption("record", "Record position data into a file for later replay", "filename");
+	opt.AddOption("record_delta", "Delta encode recorded data, about 3 times smaller files (positions quantized to 0.1 mm, angles to 1e-5 rad)");
 	opt.AddOption("csv_logger", "Log data for each vehicle in ASCII csv format", "csv_filename");
 	opt.AddOption("info_text", "Show info text HUD (\"on\" (default), \"off\") (toggle during simulation by press 'i') ", "mode");
 	opt.AddOption("trails", "Show trails (\"on\" (default), \"off\") (toggle during simulation by press 'j') ", "mode");
@@ -520,10 +653,16 @@ int ScenarioPlayer::Init()
 	opt.AddOption("headless", "Run without viewer");
 	opt.AddOption("server", "Launch server to receive state of external Ego simulator");
 	opt.AddOption("fixed_timestep", "Run simulation decoupled from realtime, with specified timesteps", "timestep");
-	opt.AddOption("osi_receiver_ip", "IP address where to send OSI UDP packages", "IP address");
+	opt.AddOption("fast", "Run as fast as possible with fixed timestep (default 0.05 or --fixed_timestep), report step rate at end");
+	opt.AddOption("profile", "Measure time spent in hot paths, save statistics and histograms at end (JSON)", "filename");
+	opt.AddOption("profile_trace", "Measure time spent in hot paths, save each measurement at end (Chrome trace JSON)", "filename");
+	opt.AddOption("osi_receiver_ip", "IP address where to send OSI UDP packages (SensorView above 65000 bytes is split into fragments with esmini header, see osi_receiver)", "IP address");
+	opt.AddOption("osi_shm", "Publish OSI SensorView and object states in shared memory, for readers on same host (e.g. osi_shm_reader)", "name");
 	opt.AddOption("ghost_headstart", "Launch Ego ghost at specified headstart time", "time");
 	opt.AddOption("osi_file", "save osi messages in file (\"on\", \"off\" (default))", "mode");
 	opt.AddOption("osi_freq", "relative frequence for writing the .osi file e.g. --osi_freq=2 -> we write every two simulation steps", "frequence");
+	opt.AddOption("osi_radius", "Only include lanes and objects within given distance from host vehicle and sensors in OSI ground truth", "distance");
+	opt.AddOption("road_cache", "Cache precomputed road data in specified directory, speeding up subsequent loads of same road network", "directory");
 
 	if (argc_ < 3)
 	{
@@ -573,6 +712,20 @@ int ScenarioPlayer::Init()
 		LOG("Run simulation decoupled from realtime, with fixed timestep: %.2f", GetFixedTimestep());
 	}
 	
+	profile_filename_ = opt.GetOptionArg("profile");
+	profile_trace_filename_ = opt.GetOptionArg("profile_trace");
+	if (!profile_filename_.empty() || !profile_trace_filename_.empty())
+	{
+		SE_Profiler::Inst().Enable(true, !profile_trace_filename_.empty());
+		LOG("Profiling enabled");
+	}
+
+	if ((arg_str = opt.GetOptionArg("road_cache")) != "")
+	{
+		roadmanager::Position::GetOpenDrive()->SetCacheDir(arg_str);
+		LOG("Road cache directory: %s", arg_str.c_str());
+	}
+
 	double ghost_headstart = GHOST_HEADSTART;
 	if ((arg_str = opt.GetOptionArg("ghost_headstart")) != "")
 	{
@@ -610,6 +763,11 @@ int ScenarioPlayer::Init()
 	{
 		osiReporter->OpenSocket(opt.GetOptionArg("osi_receiver_ip"));
 	}
+
+	if (opt.GetOptionSet("osi_shm"))
+	{
+		osiReporter->OpenSharedMemory(opt.GetOptionArg("osi_shm"));
+	}
 	
 	if (opt.GetOptionArg("osi_file") ==  "on")
 	{
@@ -631,6 +789,12 @@ int ScenarioPlayer::Init()
 		LOG("Run simulation decoupled from realtime, with fixed timestep: %.2f", GetFixedTimestep());
 	}	
 
+	if ((arg_str = opt.GetOptionArg("osi_radius")) != "")
+	{
+		osiReporter->SetOSIRadius(atof(arg_str.c_str()));
+		LOG("OSI ground truth limited to %.1f m from host vehicle and sensors", osiReporter->GetOSIRadius());
+	}
+
 	// Initialize CSV logger for recording vehicle data
 	if (opt.GetOptionSet("csv_logger"))
 	{
@@ -643,14 +807,24 @@ int ScenarioPlayer::Init()
 	if ((arg_str = opt.GetOptionArg("record")) != "")
 	{
 		LOG("Recording data to file %s", arg_str.c_str());
-		scenarioGateway->RecordToFile(arg_str, scenarioEngine->getOdrFilename(), scenarioEngine->getSceneGraphFilename());
+		scenarioGateway->RecordToFile(arg_str, scenarioEngine->getOdrFilename(), scenarioEngine->getSceneGraphFilename(),
+			opt.GetOptionSet("record_delta") ? REPLAY_FLAG_DELTA : 0);
+	}
+
+	if (opt.GetOptionSet("fast"))
+	{
+		SetFastMode();
 	}
 
 	// Step scenario engine - zero time - just to reach and report init state of all vehicles
 	scenarioEngine->step(0.0, true);
+	if (threads && !headless)
+	{
+		scenarioGateway->PublishSnapshot();
+	}
 
 	// Update OSI info
-	if (osi_file || osiReporter->GetSocket())
+	if (osi_file || osiReporter->GetSocket() || osiReporter->IsSharedMemoryOpen())
 	{
 		osiReporter->UpdateOSISensorView(scenarioGateway->objectState_);
 		if (osi_file)
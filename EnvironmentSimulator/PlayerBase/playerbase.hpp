@@ -58,6 +58,15 @@ public:
 		double near, double far, double fovH, int maxObj);
 	void SetFixedTimestep(double timestep) { fixed_timestep_ = timestep; }
 	double GetFixedTimestep() { return fixed_timestep_; }
+
+	/**
+	Run as fast as possible with fixed timestep, i.e. no realtime sync. Viewer (if any) is updated at a limited rate.
+	Step time statistics are collected and reported when the player is deleted.
+	@param timestep Fixed timestep in seconds, if < 0 any already specified fixed timestep is used, else a default one
+	*/
+	void SetFastMode(double timestep = -1.0);
+	bool GetFastMode() { return fast_; }
+	void PrintPerformanceReport();
 	int GetOSIFreq() { return osi_freq_; }
 	
 	CSV_Logger *CSV_Log;
@@ -94,6 +103,16 @@ private:
 	double fixed_timestep_;
 	bool osi_file; 
 	int osi_freq_; 
+	int osi_counter_;
+	__int64 time_stamp_;
+	bool message_shown_;
+	bool fast_;
+	__int64 fast_start_time_;
+	__int64 viewer_time_stamp_;
+	double fast_start_sim_time_;
+	bool fast_profiling_;  // profiler enabled by fast mode, for the performance report
+	std::string profile_filename_;
+	std::string profile_trace_filename_;
 	std::string osi_receiver_addr;
 	int& argc_;
 	char** argv_;
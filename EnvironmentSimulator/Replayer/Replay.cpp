@@ -10,68 +10,498 @@
  * https://sites.google.com/view/simulationscenarios
  */
 
+#include <map>
+#include <cstring>
+#include <algorithm>
 #include "Replay.hpp"
 #include "ScenarioGateway.hpp"
 #include "CommonMini.hpp"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace scenarioengine;
 
 
-Replay::Replay(std::string filename) : time_(0.0), index_(0)
+Replay::Replay(std::string filename) : data_(0), size_(0), header_size_(0), legacy_(false), n_frames_(0), start_time_(0.0),
+	stop_time_(0.0), time_(0.0), frame_time_(0.0), frame_key_idx_(-1), next_offset_(0)
 {
-	file_.open(filename, std::ofstream::binary);
-	if (file_.fail())
+	if (MapFile(filename) != 0)
 	{
 		LOG("Cannot open file: %s", filename.c_str());
 		throw std::invalid_argument(std::string("Cannot open file: ") + filename);
 	}
 
-	file_.read((char*)&header_, sizeof(header_));
-	LOG("Recording %s opened. odr: %s model: %s", filename.c_str(), header_.odr_filename, header_.model_filename);
+	memset(&header_, 0, sizeof(header_));
+	if (size_ >= sizeof(header_) && strncmp(data_, REPLAY_MAGIC, sizeof(header_.magic)) == 0)
+	{
+		memcpy(&header_, data_, sizeof(header_));
+		header_size_ = sizeof(header_);
+		if (header_.version != REPLAY_VERSION)
+		{
+			UnmapFile();
+			LOG("Unsupported recording version %d (expected %d): %s", header_.version, REPLAY_VERSION, filename.c_str());
+			throw std::invalid_argument(std::string("Unsupported recording version: ") + filename);
+		}
+	}
+	else if (size_ >= 2 * REPLAY_FILENAME_SIZE)
+	{
+		// No magic, assume legacy format: filenames followed by raw ObjectStateStruct entries
+		memcpy(header_.odr_filename, data_, REPLAY_FILENAME_SIZE);
+		memcpy(header_.model_filename, data_ + REPLAY_FILENAME_SIZE, REPLAY_FILENAME_SIZE);
+		header_size_ = 2 * REPLAY_FILENAME_SIZE;
+		legacy_ = true;
+	}
+	else
+	{
+		UnmapFile();
+		LOG("Corrupt recording: %s", filename.c_str());
+		throw std::invalid_argument(std::string("Corrupt recording: ") + filename);
+	}
+
+	BuildIndex();
+	GoToTime(start_time_);
+
+	LOG("Recording %s opened. odr: %s model: %s, %d frames, time %.2f to %.2f", filename.c_str(), header_.odr_filename,
+		header_.model_filename, n_frames_, start_time_, stop_time_);
+}
+
+Replay::~Replay()
+{
+	UnmapFile();
+}
+
+int Replay::MapFile(std::string filename)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return -1;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return -1;
+	}
+
+	// The view keeps the mapping and file open until unmapped
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+	{
+		return -1;
+	}
+	data_ = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data_ == 0)
+	{
+		return -1;
+	}
+	size_ = (size_t)size.QuadPart;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	// The mapping keeps the file open until unmapped
+	void *data = mmap(0, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return -1;
+	}
+	data_ = (const char*)data;
+	size_ = (size_t)file_stat.st_size;
+#endif
+
+	return 0;
+}
+
+void Replay::UnmapFile()
+{
+	if (data_)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data_);
+#else
+		munmap((void*)data_, size_);
+#endif
+		data_ = 0;
+		size_ = 0;
+	}
+}
+
+void Replay::BuildIndex()
+{
+	// Decode the whole recording once, storing decoder state at regular intervals
+	next_offset_ = header_size_;
+	objects_.clear();
+	fields_.clear();
+	key_frames_.clear();
+	n_frames_ = 0;
 
-	while (!file_.eof())
+	for (double time; PeekTime(next_offset_, time) == 0; n_frames_++)
 	{
-		ObjectStateStruct data;
+		if (n_frames_ % REPLAY_KEY_FRAME_INTERVAL == 0)
+		{
+			ReplayKeyFrame key_frame;
+			key_frame.time = time;
+			key_frame.offset = next_offset_;
+			key_frame.objects = objects_;
+			key_frame.fields = fields_;
+			key_frames_.push_back(key_frame);
+		}
 
-		file_.read((char*)&data, sizeof(data));
+		if (ReadFrame() != 0)
+		{
+			break;
+		}
 
-		if (!file_.eof())
+		if (n_frames_ == 0)
 		{
-			data_.push_back(data);
+			start_time_ = frame_time_;
 		}
+		stop_time_ = frame_time_;
+	}
+
+	if (next_offset_ < size_)
+	{
+		LOG("Ignoring %d bytes of corrupt or incomplete data at end of recording", (int)(size_ - next_offset_));
 	}
+
+	frame_key_idx_ = -1;
 }
 
-Replay::~Replay()
+int Replay::ReadVarint(size_t &offset, long long &value)
 {
-	data_.clear();
+	unsigned long long zigzag = 0;
+
+	for (int shift = 0; shift < 64 && offset < size_; shift += 7)
+	{
+		unsigned char byte = (unsigned char)data_[offset++];
+		zigzag |= (unsigned long long)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+		{
+			value = (long long)(zigzag >> 1) ^ -(long long)(zigzag & 1);
+			return 0;
+		}
+	}
+
+	return -1;
 }
 
-void Replay::Step(double dt)
+int Replay::PeekTime(size_t offset, double &time)
 {
-	ObjectStateStruct data;
+	if (legacy_)
+	{
+		ObjectStateStruct state;
+		if (offset + sizeof(state) > size_)
+		{
+			return -1;
+		}
+		memcpy((void*)&state, data_ + offset, sizeof(state));
+		time = state.timeStamp;
+		return 0;
+	}
 
-	time_ += dt;
+	// Skip any object records, then look at timestamp of the state without decoding it
+	while (offset < size_ && data_[offset] == REPLAY_RECORD_OBJECT)
+	{
+		offset += 1 + sizeof(ReplayObjectRecord);
+	}
 
-	// Find entry according to time 
-	while ((index_ < data_.size() - 1 && time_ > data_[index_ + 1].timeStamp) || data_[index_].id != 0)
+	if (offset + 1 > size_)
+	{
+		return -1;
+	}
+	else if (data_[offset] == REPLAY_RECORD_STATE)
 	{
-		index_++;
-		if (index_ >= data_.size() - 1)
+		ReplayStateRecord state;
+		if (offset + 1 + sizeof(state) > size_)
 		{
-			index_ = 0;
-			time_ = 0;
+			return -1;
 		}
+		memcpy(&state, data_ + offset + 1, sizeof(state));
+		time = state.timestamp;
+		return 0;
 	}
+	else if (data_[offset] == REPLAY_RECORD_STATE_DELTA)
+	{
+		long long id;
+		long long delta;
+		offset++;
+		if (ReadVarint(offset, id) != 0 || ReadVarint(offset, delta) != 0)
+		{
+			return -1;
+		}
+		std::map<int, std::vector<long long> >::iterator fields = fields_.find((int)id);
+		long long timestamp = (fields == fields_.end() ? 0 : fields->second[0]) + delta;
+
+		// Same conversion as ReplayFieldsToState()
+		time = (float)(timestamp * replay_state_delta_unit[0]);
+		return 0;
+	}
+
+	return -1;
 }
 
-ObjectStateStruct* Replay::GetState(int id)
+int Replay::ReadRecord(size_t &offset, ObjectStateStruct *state)
 {
-	// Read all vehicles at current timestamp
-	if (index_ + id > data_.size() - 1 || data_[index_ + id].id != id)
+	if (legacy_)
+	{
+		if (offset + sizeof(ObjectStateStruct) > size_)
+		{
+			return -1;
+		}
+		memcpy((void*)state, data_ + offset, sizeof(ObjectStateStruct));
+		offset += sizeof(ObjectStateStruct);
+		return 1;
+	}
+
+	if (offset + 1 > size_)
 	{
+		return -1;
+	}
+
+	ReplayStateRecord record;
+	char record_type = data_[offset];
+	if (record_type == REPLAY_RECORD_OBJECT)
+	{
+		ReplayObjectRecord object;
+		if (offset + 1 + sizeof(object) > size_)
+		{
+			return -1;
+		}
+		memcpy(&object, data_ + offset + 1, sizeof(object));
+		objects_[object.id] = object;
+		offset += 1 + sizeof(object);
 		return 0;
 	}
+	else if (record_type == REPLAY_RECORD_STATE)
+	{
+		if (offset + 1 + sizeof(record) > size_)
+		{
+			return -1;
+		}
+		memcpy(&record, data_ + offset + 1, sizeof(record));
+		offset += 1 + sizeof(record);
+	}
+	else if (record_type == REPLAY_RECORD_STATE_DELTA)
+	{
+		size_t pos = offset + 1;
+		long long id;
+		long long delta[REPLAY_STATE_DELTA_N_FIELDS];
+		if (ReadVarint(pos, id) != 0)
+		{
+			return -1;
+		}
+		for (int i = 0; i < REPLAY_STATE_DELTA_N_FIELDS; i++)
+		{
+			if (ReadVarint(pos, delta[i]) != 0)
+			{
+				return -1;
+			}
+		}
+
+		std::vector<long long> &fields = fields_[(int)id];
+		fields.resize(REPLAY_STATE_DELTA_N_FIELDS, 0);
+		for (int i = 0; i < REPLAY_STATE_DELTA_N_FIELDS; i++)
+		{
+			fields[i] += delta[i];
+		}
+		record.id = (int)id;
+		ReplayFieldsToState(fields.data(), record);
+		offset = pos;
+	}
+	else
+	{
+		LOG("Unknown record type %d at file position %d", record_type, (int)offset);
+		return -1;
+	}
+
+	std::map<int, ReplayObjectRecord>::iterator object = objects_.find(record.id);
+	if (object == objects_.end())
+	{
+		LOG("State of undefined object %d at file position %d", record.id, (int)offset);
+		return -1;
+	}
+
+	state->id = record.id;
+	state->model_id = object->second.model_id;
+	state->obj_type = object->second.obj_type;
+	state->obj_category = object->second.obj_category;
+	state->control = object->second.control;
+	state->timeStamp = record.timestamp;
+	strncpy(state->name, object->second.name, NAME_LEN);
+	state->pos.SetX(record.x);
+	state->pos.SetY(record.y);
+	state->pos.SetZ(record.z);
+	state->pos.SetH(record.h);
+	state->pos.SetP(record.p);
+	state->pos.SetR(record.r);
+	state->pos.SetTrackId(record.road_id);
+	state->pos.SetLaneId(record.lane_id);
+	state->pos.SetS(record.s);
+	state->pos.SetOffset(record.offset);
+	state->speed = record.speed;
+	state->wheel_angle = record.wheel_angle;
+	state->wheel_rot = record.wheel_rot;
+	state->boundingbox.center_.x_ = object->second.bb_center[0];
+	state->boundingbox.center_.y_ = object->second.bb_center[1];
+	state->boundingbox.center_.z_ = object->second.bb_center[2];
+	state->boundingbox.dimensions_.width_ = object->second.bb_dimensions[0];
+	state->boundingbox.dimensions_.length_ = object->second.bb_dimensions[1];
+	state->boundingbox.dimensions_.height_ = object->second.bb_dimensions[2];
+
+	return 1;
+}
+
+int Replay::ReadFrame()
+{
+	size_t offset = next_offset_;
+	double time;
+
+	if (PeekTime(offset, time) != 0)
+	{
+		return -1;
+	}
+
+	// Keep track of latest passed key frame
+	if (frame_key_idx_ + 1 < (int)key_frames_.size() && key_frames_[frame_key_idx_ + 1].offset == offset)
+	{
+		frame_key_idx_++;
+	}
+
+	frame_.clear();
+	frame_time_ = time;
+
+	// Frame consists of all consecutive states with same timestamp
+	while (PeekTime(offset, time) == 0 && time == frame_time_)
+	{
+		ObjectStateStruct state;
+		int ret;
+		while ((ret = ReadRecord(offset, &state)) == 0);  // object records only update decoder state
+		if (ret < 0)
+		{
+			break;
+		}
+		frame_.push_back(state);
+	}
+	next_offset_ = offset;
+
+	return 0;
+}
+
+int Replay::GoToKeyFrame(int idx)
+{
+	ReplayKeyFrame &key_frame = key_frames_[idx];
+
+	objects_ = key_frame.objects;
+	fields_ = key_frame.fields;
+	next_offset_ = key_frame.offset;
+	frame_key_idx_ = idx - 1;  // updated when frame is read
+
+	return ReadFrame();
+}
+
+int Replay::GoToTime(double time)
+{
+	if (key_frames_.empty())
+	{
+		return -1;
+	}
+
+	time_ = time;
+
+	// Find key frame at or before time, binary search
+	std::vector<ReplayKeyFrame>::iterator it = std::upper_bound(key_frames_.begin(), key_frames_.end(), time,
+		[](double time, ReplayKeyFrame &key_frame) { return time < key_frame.time; });
+	int key_idx = MAX((int)(it - key_frames_.begin()) - 1, 0);
+
+	if (key_idx != frame_key_idx_ || time < frame_time_)
+	{
+		// Not just a bit forward from current frame, start from the key frame
+		if (GoToKeyFrame(key_idx) != 0)
+		{
+			return -1;
+		}
+	}
+
+	// Then step forward to requested time
+	double next_time;
+	while (PeekTime(next_offset_, next_time) == 0 && next_time <= time)
+	{
+		ReadFrame();
+	}
+
+	return 0;
+}
+
+int Replay::GoToNextFrame()
+{
+	if (ReadFrame() != 0)
+	{
+		return -1;
+	}
+	time_ = frame_time_;
+
+	return 0;
+}
+
+void Replay::Step(double dt)
+{
+	time_ += dt;
+
+	// Wrap around at the ends
+	if (time_ > stop_time_)
+	{
+		time_ = start_time_;
+	}
+	else if (time_ < start_time_)
+	{
+		time_ = stop_time_;
+	}
+
+	GoToTime(time_);
+}
+
+ObjectStateStruct* Replay::GetStateByIdx(int idx)
+{
+	if (idx < 0 || idx >= (int)frame_.size())
+	{
+		return 0;
+	}
+
+	return &frame_[idx];
+}
+
+ObjectStateStruct* Replay::GetState(int id)
+{
+	for (size_t i = 0; i < frame_.size(); i++)
+	{
+		if (frame_[i].id == id)
+		{
+			return &frame_[i];
+		}
+	}
 
-	return &data_[index_ + id];
+	return 0;
 }
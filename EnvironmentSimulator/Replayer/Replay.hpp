@@ -14,6 +14,9 @@
 
 #include <string>
 #include <fstream>
+#include <vector>
+#include <map>
+#include <cmath>
 #include "CommonMini.hpp"
 #include "ScenarioGateway.hpp"
 
@@ -21,28 +24,227 @@ namespace scenarioengine
 {
 
 #define REPLAY_FILENAME_SIZE 128
+#define REPLAY_SCHEMA_SIZE 256
+#define REPLAY_VERSION 2
+#define REPLAY_MAGIC "ESMREC"
+#define REPLAY_KEY_FRAME_INTERVAL 100  // number of frames between key frames
+
+	/*
+	Recording file format, version 2
+
+	A ReplayHeader followed by records, each one starting with a ReplayRecordType byte:
+	 - REPLAY_RECORD_OBJECT: ReplayObjectRecord. Static object info, written before first state of the object and whenever it changes.
+	 - REPLAY_RECORD_STATE: ReplayStateRecord. Dynamic object info, one per object and frame.
+	 - REPLAY_RECORD_STATE_DELTA: Same content as ReplayStateRecord, used instead if REPLAY_FLAG_DELTA is set.
+	   Starts with object id as varint. Then each field of ReplayStateRecord, in order, quantized according to
+	   replay_state_delta_unit and encoded as zigzag varint of the difference to previous state of the same object.
+	All values little endian. Legacy recordings (raw ObjectStateStruct, no magic) can still be read.
+	*/
+
+	enum ReplayFlags
+	{
+		REPLAY_FLAG_DELTA = (1 << 0),  // Delta and varint encoded states, lossy according to replay_state_delta_unit
+	};
+
+	enum ReplayRecordType
+	{
+		REPLAY_RECORD_OBJECT = 1,
+		REPLAY_RECORD_STATE = 2,
+		REPLAY_RECORD_STATE_DELTA = 3,
+	};
 
 	typedef struct
 	{
+		char magic[8];  // REPLAY_MAGIC
+		int version;
+		int flags;  // ReplayFlags
 		char odr_filename[REPLAY_FILENAME_SIZE];
 		char model_filename[REPLAY_FILENAME_SIZE];
+		char schema[REPLAY_SCHEMA_SIZE];  // description of state record fields, for information only
 	} ReplayHeader;
 
+	typedef struct
+	{
+		int id;
+		int model_id;
+		int obj_type;
+		int obj_category;
+		int control;
+		char name[NAME_LEN];
+		float bb_center[3];  // x, y, z
+		float bb_dimensions[3];  // width, length, height
+	} ReplayObjectRecord;
 
+	typedef struct
+	{
+		int id;
+		float timestamp;
+		double x;
+		double y;
+		double z;
+		float h;
+		float p;
+		float r;
+		int road_id;
+		int lane_id;
+		float s;
+		float offset;
+		float speed;
+		float wheel_angle;
+		float wheel_rot;
+	} ReplayStateRecord;
+
+#define REPLAY_STATE_SCHEMA "id:i32 timestamp:f32 x:f64 y:f64 z:f64 h:f32 p:f32 r:f32 road_id:i32 lane_id:i32 s:f32 offset:f32 speed:f32 wheel_angle:f32 wheel_rot:f32"
+#define REPLAY_STATE_DELTA_N_FIELDS 14  // all fields except id
+
+	// Quantization of delta encoded state fields, same order as in ReplayStateRecord (excluding id)
+	static const double replay_state_delta_unit[REPLAY_STATE_DELTA_N_FIELDS] =
+		{ 1e-4, 1e-4, 1e-4, 1e-4, 1e-5, 1e-5, 1e-5, 1.0, 1.0, 1e-4, 1e-4, 1e-4, 1e-5, 1e-4 };
+
+	// Convert state to quantized field values, excluding id. Shared by writer (ScenarioGateway) and reader (Replay).
+	inline void ReplayStateToFields(ReplayStateRecord &state, long long fields[REPLAY_STATE_DELTA_N_FIELDS])
+	{
+		double values[REPLAY_STATE_DELTA_N_FIELDS] = { state.timestamp, state.x, state.y, state.z, state.h, state.p, state.r,
+			(double)state.road_id, (double)state.lane_id, state.s, state.offset, state.speed, state.wheel_angle, state.wheel_rot };
+
+		for (int i = 0; i < REPLAY_STATE_DELTA_N_FIELDS; i++)
+		{
+			fields[i] = llround(values[i] / replay_state_delta_unit[i]);
+		}
+	}
+
+	inline void ReplayFieldsToState(long long fields[REPLAY_STATE_DELTA_N_FIELDS], ReplayStateRecord &state)
+	{
+		double values[REPLAY_STATE_DELTA_N_FIELDS];
 
+		for (int i = 0; i < REPLAY_STATE_DELTA_N_FIELDS; i++)
+		{
+			values[i] = fields[i] * replay_state_delta_unit[i];
+		}
+		state.timestamp = (float)values[0];
+		state.x = values[1];
+		state.y = values[2];
+		state.z = values[3];
+		state.h = (float)values[4];
+		state.p = (float)values[5];
+		state.r = (float)values[6];
+		state.road_id = (int)fields[7];
+		state.lane_id = (int)fields[8];
+		state.s = (float)values[9];
+		state.offset = (float)values[10];
+		state.speed = (float)values[11];
+		state.wheel_angle = (float)values[12];
+		state.wheel_rot = (float)values[13];
+	}
+
+	// Encode value as zigzag varint into buffer, returns number of bytes (max 10)
+	inline int ReplayEncodeVarint(long long value, unsigned char *buf)
+	{
+		unsigned long long zigzag = ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+		int n = 0;
+
+		while (zigzag >= 0x80)
+		{
+			buf[n++] = (unsigned char)(zigzag | 0x80);
+			zigzag >>= 7;
+		}
+		buf[n++] = (unsigned char)zigzag;
+
+		return n;
+	}
+
+	// Decoder state needed to start reading at a frame
+	typedef struct
+	{
+		double time;
+		size_t offset;
+		std::map<int, ReplayObjectRecord> objects;
+		std::map<int, std::vector<long long> > fields;
+	} ReplayKeyFrame;
+
+	/*
+	Reads recordings frame by frame from a memory mapped file, without loading all of it into memory.
+	A frame is the states of all objects at one timestamp. A sparse index of key frames, created when
+	the file is opened, is used for jumping to any time.
+	*/
 	class Replay
 	{
 	public:
 		Replay(std::string filename);
 		~Replay();
+
+		/**
+		Move playback time and update current frame, wrapping around at the end and at the start of the recording
+		@param dt Time step, negative for playing backwards
+		*/
 		void Step(double dt);
-		ObjectStateStruct * GetState(int id);
+
+		/**
+		Jump to the last frame at or before given time, O(log n)
+		@param time Playback time
+		@return 0 on success, -1 if recording is empty
+		*/
+		int GoToTime(double time);
+
+		/**
+		Move to next frame, regardless of time
+		@return 0 on success, -1 if already at last frame
+		*/
+		int GoToNextFrame();
+
+		double GetTime() { return time_; }
+		double GetStartTime() { return start_time_; }
+		double GetStopTime() { return stop_time_; }
+		int GetNumberOfFrames() { return n_frames_; }
+
+		/**
+		Number of objects in current frame
+		*/
+		int GetNumberOfObjects() { return (int)frame_.size(); }
+
+		/**
+		Get state of an object in current frame
+		@param idx Index of the object in current frame, 0 ... GetNumberOfObjects() - 1
+		@return Pointer to the state, 0 if not available
+		*/
+		ObjectStateStruct* GetStateByIdx(int idx);
+
+		/**
+		Get state of an object in current frame
+		@param id Object id
+		@return Pointer to the state, 0 if object is not present in current frame
+		*/
+		ObjectStateStruct* GetState(int id);
 
 		ReplayHeader header_;
-		std::vector<ObjectStateStruct> data_;
-		std::ifstream file_;
+
+	private:
+		const char *data_;  // memory mapped file content
+		size_t size_;
+		size_t header_size_;
+		bool legacy_;
+		std::vector<ReplayKeyFrame> key_frames_;
+		int n_frames_;
+		double start_time_;
+		double stop_time_;
 		double time_;
-		unsigned int index_;
+
+		// Current frame and decoder state, valid after reading it
+		std::vector<ObjectStateStruct> frame_;
+		double frame_time_;
+		int frame_key_idx_;  // key frame at or before current frame
+		size_t next_offset_;  // start of next frame
+		std::map<int, ReplayObjectRecord> objects_;
+		std::map<int, std::vector<long long> > fields_;
+
+		int MapFile(std::string filename);
+		void UnmapFile();
+		void BuildIndex();
+		int GoToKeyFrame(int idx);
+		int ReadFrame();
+		int PeekTime(size_t offset, double &time);
+		int ReadRecord(size_t &offset, ObjectStateStruct *state);
+		int ReadVarint(size_t &offset, long long &value);
 	};
 
 }
\ No newline at end of file
@@ -81,7 +81,7 @@ int main(int argc, char** argv)
 	SE_Options opt;
 	opt.AddOption("file", "Simulation recording data file", "filename");
 	opt.AddOption("res_path", "Path to resources root folder - relative or absolut", "path");
-	opt.AddOption("time_scale", "Playback speed scale factor (1.0 == normal)", "factor");
+	opt.AddOption("time_scale", "Playback speed scale factor (1.0 == normal, negative plays backwards)", "factor");
 
 	if (argc < 2)
 	{
@@ -153,10 +153,9 @@ int main(int argc, char** argv)
 			player->Step(deltaSimTime * time_scale);
 
 			// Fetch states of scenario objects
-			int index = 0;
-			ObjectStateStruct *state = player->GetState(index);
-			while (state != 0)
+			for (int index = 0; index < player->GetNumberOfObjects(); index++)
 			{
+				ObjectStateStruct *state = player->GetStateByIdx(index);
 				ScenarioCar *sc = getScenarioCarById(state->id);
 
 				// If not available, create it
@@ -179,9 +178,6 @@ int main(int argc, char** argv)
 				}
 
 				sc->pos = state->pos;
-
-				index++;
-				state = player->GetState(index);
 			}
 
 			// Visualize scenario cars
@@ -19,46 +19,14 @@
 #include "osi_sensorview.pb.h"
 #include "osi_version.pb.h"
 #include <signal.h>
-
-
-#ifndef _WINDOWS
-    #include <unistd.h>
-    #define Sleep(x) usleep((x)*1000)
-#endif
-
-static bool quit;
-
-#ifdef _WIN32
-	#include <winsock2.h>
-	#include <Ws2tcpip.h>
-#else
-	 /* Assume that any non-Windows platform uses POSIX-style sockets instead. */
-	#include <sys/socket.h>
-	#include <arpa/inet.h>
-	#include <netdb.h>  /* Needed for getaddrinfo() and freeaddrinfo() */
-	#include <unistd.h> /* Needed for close() */
-#endif
+#include "CommonMini.hpp"
+#include "UDP.hpp"
 
 #define OSI_OUT_PORT 48198
-#define ES_SERV_TIMEOUT 500
-#define MAX_MSG_SIZE 102400
-
+#define ES_SERV_TIMEOUT 500  // ms
+#define STATS_INTERVAL 1000000  // us, how often to print receive statistics
 
-void CloseGracefully(int socket)
-{
-#ifdef _WIN32
-	if (closesocket(socket) == SOCKET_ERROR)
-#else
-	if (close(socket) < 0)
-#endif
-	{
-		printf("Failed closing socket");
-	}
-
-#ifdef _WIN32
-	WSACleanup();
-#endif
-}
+static bool quit;
 
 static void signal_handler(int s) 
 {
@@ -69,100 +37,111 @@ static void signal_handler(int s)
 
 int main(int argc, char* argv[])
 {
-	static int sock;
-	struct sockaddr_in server_addr;
-	struct sockaddr_in sender_addr;
-	static int iPortIn = OSI_OUT_PORT;   // Port for incoming packages
-	char buf[MAX_MSG_SIZE];
-	socklen_t sender_addr_size = sizeof(sender_addr);
-	struct timeval tv;
-	
-	quit = false;
-
-	// Setup signal handler to catch Ctrl-C
-	signal(SIGINT, signal_handler);
+	SE_UDPFragmentReceiver receiver;
+	bool quiet = false;
 
-#ifdef _WIN32
-	WSADATA wsa_data;
-	int iResult = WSAStartup(MAKEWORD(2, 2), &wsa_data);
-	if (iResult != NO_ERROR)
+	for (int i = 1; i < argc; i++)
 	{
-		wprintf(L"WSAStartup failed with error %d\n", iResult);
-		return -1;
-	}
-#endif
-
-	sock = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-	if (sock < 0)
-	{
-		printf("socket failed\n");
-		return -1;
+		if (!strcmp(argv[i], "--quiet"))
+		{
+			quiet = true;  // print only statistics
+		}
+		else
+		{
+			printf("Usage: %s [--quiet]\n", argv[0]);
+			return -1;
+		}
 	}
 
-	//set timer for receive operations
-	tv.tv_sec = 0;
-	tv.tv_usec = ES_SERV_TIMEOUT;
-#ifdef _WIN32
-	int timeout_msec = 1000 * tv.tv_sec + tv.tv_usec;
-	if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout_msec, sizeof(timeout_msec)) < 0)
-#else
-	if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (struct timeval*)&tv, sizeof(tv)) == 0)
-#endif
-	{
-		printf("socket SO_RCVTIMEO (receive timeout) not supported on this platform\n");
-	}
+	quit = false;
 
-	server_addr.sin_family = AF_INET;
-	server_addr.sin_port = htons(iPortIn);
-	server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	// Setup signal handler to catch Ctrl-C
+	signal(SIGINT, signal_handler);
 
-	if (bind(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) != 0)
+	if (receiver.Open(OSI_OUT_PORT, ES_SERV_TIMEOUT) != 0)
 	{
-		printf("Bind failed");
-		CloseGracefully(sock);
+		printf("Failed to open socket\n");
 		return -1;
 	}
 
 	printf("Socket open. Waiting for OSI messages on port %d. Press Ctrl-C to quit.\n", OSI_OUT_PORT);
 
 	osi3::SensorView sv;
+	__int64 stats_time = SE_getSystemTimeUs();
+	unsigned long long stats_messages = 0;
+	unsigned long long stats_bytes = 0;
+	__int64 latency_sum = 0;
+	__int64 latency_max = 0;
 
 	while (!quit)
 	{
-		// Fetch and parse OSI message
-		int ret = recvfrom(sock, (char*)&buf, sizeof(buf), 0, (struct sockaddr *)&sender_addr, &sender_addr_size);
+		// Fetch and parse OSI message, put together from one or more datagrams
+		int ret = receiver.Receive();
 
 		if (ret > 0)
 		{
-			sv.ParseFromArray(buf, ret);
-
-			// Print timestamp
-			printf("timestamp: %.2f\n", sv.mutable_global_ground_truth()->mutable_timestamp()->seconds() +
-				1E-9 * sv.mutable_global_ground_truth()->mutable_timestamp()->nanos());
+			latency_sum += receiver.GetLatency();
+			if (receiver.GetLatency() > latency_max)
+			{
+				latency_max = receiver.GetLatency();
+			}
 
-			// Print object id, position, orientation and velocity
-			for (int i = 0; i < sv.mutable_global_ground_truth()->mutable_moving_object()->size(); i++)
+			if (!sv.ParseFromArray(receiver.GetMessageData(), ret))
 			{
-				printf(" obj id %d pos (%.2f, %.2f, %.2f) orientation (%.2f, %.2f, %.2f) velocity (%.2f, %.2f, %.2f) \n",
-					(int)sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_id()->value(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_position()->x(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_position()->y(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_position()->z(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_orientation()->yaw(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_orientation()->pitch(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_orientation()->roll(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_velocity()->x(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_velocity()->y(),
-					sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_velocity()->z()
-				);
+				printf("Failed to parse OSI message %llu of size %d\n", receiver.GetNumberOfMessages(), ret);
+			}
+			else if (!quiet)
+			{
+				// Print timestamp
+				printf("timestamp: %.2f\n", sv.mutable_global_ground_truth()->mutable_timestamp()->seconds() +
+					1E-9 * sv.mutable_global_ground_truth()->mutable_timestamp()->nanos());
+
+				// Print object id, position, orientation and velocity
+				for (int i = 0; i < sv.mutable_global_ground_truth()->mutable_moving_object()->size(); i++)
+				{
+					printf(" obj id %d pos (%.2f, %.2f, %.2f) orientation (%.2f, %.2f, %.2f) velocity (%.2f, %.2f, %.2f) \n",
+						(int)sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_id()->value(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_position()->x(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_position()->y(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_position()->z(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_orientation()->yaw(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_orientation()->pitch(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_orientation()->roll(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_velocity()->x(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_velocity()->y(),
+						sv.mutable_global_ground_truth()->mutable_moving_object(i)->mutable_base()->mutable_velocity()->z()
+					);
+				}
 			}
 		}
-		else
+		else if (ret < 0)
 		{
-			// No incoming messages, wait for a little while before polling again
-			Sleep(10);
+			break;
+		}
+
+		__int64 now = SE_getSystemTimeUs();
+		if (now - stats_time >= STATS_INTERVAL)
+		{
+			unsigned long long n = receiver.GetNumberOfMessages() - stats_messages;
+			double dt = 1e-6 * (now - stats_time);
+
+			if (n > 0)
+			{
+				printf("%.1f msg/s %.2f MB/s dropped %llu latency mean %.2f max %.2f ms\n",
+					n / dt, 1e-6 * (receiver.GetNumberOfBytes() - stats_bytes) / dt, receiver.GetNumberOfDropped(),
+					1e-3 * latency_sum / n, 1e-3 * latency_max);
+			}
+
+			stats_time = now;
+			stats_messages = receiver.GetNumberOfMessages();
+			stats_bytes = receiver.GetNumberOfBytes();
+			latency_sum = 0;
+			latency_max = 0;
 		}
 	}
 
+	printf("Received %llu messages, %llu bytes, %llu dropped\n",
+		receiver.GetNumberOfMessages(), receiver.GetNumberOfBytes(), receiver.GetNumberOfDropped());
+
 	return 0;
 }
@@ -0,0 +1,177 @@
+/*
+ * esmini - Environment Simulator Minimalistic
+ * https://github.com/esmini/esmini
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (c) partners of Simulation Scenarios
+ * https://sites.google.com/view/simulationscenarios
+ */
+
+/*
+ * Reference reader of OSI SensorView and object states published in shared memory by esmini (--osi_shm <name>)
+ * Several readers may run at the same time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osi_common.pb.h"
+#include "osi_object.pb.h"
+#include "osi_sensorview.pb.h"
+#include "osi_version.pb.h"
+#include <signal.h>
+#include "CommonMini.hpp"
+#include "SharedMemory.hpp"
+
+#define SHM_TIMEOUT 500  // ms
+#define STATS_INTERVAL 1000000  // us, how often to print receive statistics
+
+static bool quit;
+
+static void signal_handler(int s)
+{
+	printf("Caught signal %d - quit\n", s);
+
+	quit = true;
+}
+
+int main(int argc, char* argv[])
+{
+	SE_SharedMemoryReader reader;
+	std::string name = SE_SHM_DEFAULT_NAME;
+	bool quiet = false;
+	bool attached = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--quiet"))
+		{
+			quiet = true;  // print only statistics
+		}
+		else if (!strcmp(argv[i], "--spin") && i + 1 < argc)
+		{
+			reader.SetSpinTime(atoi(argv[++i]));
+		}
+		else if (argv[i][0] != '-')
+		{
+			name = argv[i];
+		}
+		else
+		{
+			printf("Usage: %s [name] [--quiet] [--spin <us>]\n", argv[0]);
+			printf("  name     Name of shared memory, as given to esmini --osi_shm (default \"%s\")\n", SE_SHM_DEFAULT_NAME);
+			printf("  --quiet  Print only statistics\n");
+			printf("  --spin   Time to busy-wait for next frame, longer means lower latency but more CPU load (default %d)\n", SE_SHM_SPIN_TIME);
+			return -1;
+		}
+	}
+
+	quit = false;
+
+	// Setup signal handler to catch Ctrl-C
+	signal(SIGINT, signal_handler);
+
+	printf("Waiting for shared memory %s. Press Ctrl-C to quit.\n", name.c_str());
+
+	osi3::SensorView sv;
+	__int64 stats_time = SE_getSystemTimeUs();
+	unsigned long long stats_frames = 0;  // complete frames, i.e. not overwritten while being read
+	unsigned long long stats_bytes = 0;
+	__int64 latency_sum = 0;
+	__int64 latency_max = 0;
+
+	while (!quit)
+	{
+		if (!reader.IsOpen())
+		{
+			// Writer not started yet, or restarted
+			if (reader.Open(name) != 0)
+			{
+				SE_sleep(SHM_TIMEOUT);
+				continue;
+			}
+			if (!attached)
+			{
+				printf("Shared memory %s open\n", name.c_str());
+				attached = true;
+			}
+		}
+
+		int ret = reader.Acquire(SHM_TIMEOUT);
+
+		if (ret > 0)
+		{
+			// Parse directly from shared memory, then make sure the writer did not overwrite it meanwhile
+			bool ok = sv.ParseFromArray(reader.GetMessageData(), reader.GetMessageSize());
+			unsigned int n_objects = reader.GetNumberOfObjects();
+			double sim_time = reader.GetSimTime();
+
+			if (!reader.Validate())
+			{
+				continue;  // too slow, frame already overwritten
+			}
+
+			stats_frames++;
+			latency_sum += reader.GetLatency();
+			if (reader.GetLatency() > latency_max)
+			{
+				latency_max = reader.GetLatency();
+			}
+			stats_bytes += reader.GetMessageSize();
+
+			if (!ok)
+			{
+				printf("Failed to parse OSI message of frame %llu\n", reader.GetFrameId());
+			}
+			else if (!quiet)
+			{
+				printf("time: %.2f objects: %u lanes: %d\n", sim_time, n_objects, sv.global_ground_truth().lane_size());
+
+				// Object states are plain structs, read in place
+				const SE_ShmObjectState *obj = reader.GetObjects();
+				for (unsigned int i = 0; i < n_objects; i++)
+				{
+					printf(" obj id %d pos (%.2f, %.2f, %.2f) heading %.2f road %d lane %d s %.2f speed %.2f\n",
+						obj[i].id, obj[i].x, obj[i].y, obj[i].z, obj[i].h, obj[i].road_id, obj[i].lane_id, obj[i].s, obj[i].speed);
+				}
+			}
+		}
+		else if (ret == 0)
+		{
+			// Nothing new, writer might have been restarted with a new shared memory
+			reader.Close();
+		}
+		else
+		{
+			break;
+		}
+
+		__int64 now = SE_getSystemTimeUs();
+		if (now - stats_time >= STATS_INTERVAL)
+		{
+			double dt = 1e-6 * (now - stats_time);
+
+			if (stats_frames > 0)
+			{
+				printf("%.1f frames/s %.2f MB/s dropped %llu overwritten %llu latency mean %.3f max %.3f ms\n",
+					stats_frames / dt, 1e-6 * stats_bytes / dt, reader.GetNumberOfDropped(), reader.GetNumberOfOverwritten(),
+					1e-3 * latency_sum / stats_frames, 1e-3 * latency_max);
+			}
+
+			stats_time = now;
+			stats_frames = 0;
+			stats_bytes = 0;
+			latency_sum = 0;
+			latency_max = 0;
+		}
+	}
+
+	printf("Read %llu frames, %llu dropped, %llu overwritten\n",
+		reader.GetNumberOfFrames(), reader.GetNumberOfDropped(), reader.GetNumberOfOverwritten());
+
+	return 0;
+}
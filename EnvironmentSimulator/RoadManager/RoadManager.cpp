@@ -45,18 +45,22 @@
   */
 
 #include <iostream>
+#include <fstream>
+#include <iterator>
 #include <cstring>
 #include <random>
 #include <time.h>
 #include <limits>
 #include <algorithm>
+#include <queue>
+#include <set>
 
 #include "RoadManager.hpp"
 #include "odrSpiral.h"
 #include "pugixml.hpp"
 #include "CommonMini.hpp"
 
-static std::mt19937 mt_rand;
+static thread_local std::mt19937 mt_rand;
 static unsigned int global_lane_counter;
  
 
@@ -64,6 +68,20 @@ static unsigned int global_lane_counter;
 using namespace std;
 using namespace roadmanager;
 
+// Road network being loaded on the calling thread. Positions used while calculating OSI points and the road grid
+// must refer to it, rather than to the default network or to the network of the active context.
+static thread_local OpenDrive *loading_odr = 0;
+
+class LoadingOpenDriveScope
+{
+public:
+	LoadingOpenDriveScope(OpenDrive *odr) : previous_(loading_odr) { loading_odr = odr; }
+	~LoadingOpenDriveScope() { loading_odr = previous_; }
+
+private:
+	OpenDrive *previous_;
+};
+
 #define CURV_ZERO 0.00001
 #define MAX(x, y) (y > x ? y : x)
 #define MIN(x, y) (y < x ? y : x)
@@ -72,10 +90,42 @@ using namespace roadmanager;
 #define OSI_LANE_CALC_REQUIREMENT 0.05 // [m]
 #define OSI_POINT_CALC_STEPSIZE 1 // [m]
 #define OSI_TANGENT_LINE_TOLERANCE 0.01 // [m]
+#define ROAD_GRID_CELL_SIZE 25.0 // [m]
+#define ROAD_GRID_MAX_CELLS 4000000
+#define GEOMETRY_LUT_INITIAL_STEP 10.0 // [m]
+#define GEOMETRY_LUT_MAX_SAMPLES 65537
+#define GEOMETRY_LUT_DEFAULT_TOLERANCE 1E-4 // [m] and [rad]
+#define ROAD_CACHE_VERSION 1  // increase whenever the cache format or the OSI point calculation changes
 
 int g_Lane_id;
 int g_Laneb_id;
 
+// Find index of the element covering s, in a list of elements sorted by start s, i.e. the last one starting at or before s.
+// First the element at given cursor index and the following one are checked, since s typically changes in small steps.
+// Otherwise binary search. Returns 0 if s is before first element and -1 if list is empty.
+template <class T>
+static int GetIdxByS(std::vector<T*> &elements, double s, int idx = -1, double (T::*get_s)() = &T::GetS)
+{
+	int n = (int)elements.size();
+
+	if (idx >= 0 && idx < n && !(s < (elements[idx]->*get_s)()))
+	{
+		if (idx + 1 == n || s < (elements[idx + 1]->*get_s)())
+		{
+			return idx;
+		}
+		if (idx + 2 == n || s < (elements[idx + 2]->*get_s)())
+		{
+			return idx + 1;
+		}
+	}
+
+	typename std::vector<T*>::iterator it = std::upper_bound(elements.begin(), elements.end(), s,
+		[get_s](double s, T *element) { return s < (element->*get_s)(); });
+
+	return n == 0 ? -1 : MAX((int)(it - elements.begin()) - 1, 0);
+}
+
 
 double Polynomial::Evaluate(double s)
 {
@@ -181,6 +231,157 @@ int OSIPoints::GetNumOfOSIPoints()
 	}
 }
 
+bool Geometry::use_lookup_table_ = false;
+double Geometry::lookup_table_tolerance_ = GEOMETRY_LUT_DEFAULT_TOLERANCE;
+
+static double UnwrapAngle(double angle, double reference)
+{
+	// Shift angle by whole turns to be as close as possible to reference, to keep sampled heading continuous
+	while (angle - reference > M_PI)
+	{
+		angle -= 2 * M_PI;
+	}
+	while (angle - reference < -M_PI)
+	{
+		angle += 2 * M_PI;
+	}
+	return angle;
+}
+
+void GeometryLookupTable::Clear()
+{
+	sample_.clear();
+	length_ = 0.0;
+	step_ = 0.0;
+	inv_step_ = 0.0;
+	tolerance_ = 0.0;
+	max_error_ = 0.0;
+}
+
+int GeometryLookupTable::Build(double length, double tolerance, EvaluateFunc evaluate)
+{
+	Clear();
+	length_ = length;
+	tolerance_ = tolerance;
+
+	sample_.resize(1);
+	evaluate(0.0, sample_[0]);
+	if (length < SMALL_NUMBER)
+	{
+		return 0;
+	}
+
+	int n_intervals = MAX(1, (int)ceil(length / GEOMETRY_LUT_INITIAL_STEP));
+	for (int i = 1; i <= n_intervals; i++)
+	{
+		Sample sample;
+		evaluate(i * length / n_intervals, sample);
+		sample.h = UnwrapAngle(sample.h, sample_.back().h);
+		sample_.push_back(sample);
+	}
+
+	std::vector<Sample> mid(n_intervals);
+	while (true)
+	{
+		step_ = length / n_intervals;
+		inv_step_ = 1.0 / step_;
+
+		// Compare interpolated and exact values at the midpoint of each interval, where the interpolation error peaks
+		max_error_ = 0.0;
+		mid.resize(n_intervals);
+		for (int i = 0; i < n_intervals; i++)
+		{
+			double ds = (i + 0.5) * step_;
+			double x, y, h;
+			evaluate(ds, mid[i]);
+			mid[i].h = UnwrapAngle(mid[i].h, sample_[i].h);
+			Evaluate(ds, &x, &y, &h);
+			double error = MAX(sqrt((x - mid[i].x) * (x - mid[i].x) + (y - mid[i].y) * (y - mid[i].y)), fabs(h - mid[i].h));
+			max_error_ = MAX(max_error_, error);
+		}
+
+		if (max_error_ < tolerance)
+		{
+			return 0;
+		}
+
+		if (2 * n_intervals + 1 > GEOMETRY_LUT_MAX_SAMPLES)
+		{
+			LOG("Lookup table of length %.2f reached max %d samples with error %.2e > tolerance %.2e", 
+				length, GetNumberOfSamples(), max_error_, tolerance);
+			return -1;
+		}
+
+		// Halve step length, reusing the midpoints already evaluated
+		std::vector<Sample> refined(2 * n_intervals + 1);
+		for (int i = 0; i < n_intervals; i++)
+		{
+			refined[2 * i] = sample_[i];
+			refined[2 * i + 1] = mid[i];
+		}
+		refined.back() = sample_.back();
+		sample_.swap(refined);
+		n_intervals *= 2;
+	}
+}
+
+void GeometryLookupTable::Evaluate(double ds, double *x, double *y, double *h)
+{
+	if (sample_.size() < 2)
+	{
+		if (sample_.size() == 1)
+		{
+			*x = sample_[0].x;
+			*y = sample_[0].y;
+			*h = sample_[0].h;
+		}
+		return;
+	}
+
+	double p = CLAMP(ds, 0.0, length_) * inv_step_;
+	int i = MIN((int)p, (int)sample_.size() - 2);
+	double t = p - i;
+	double t2 = t * t;
+	double t3 = t2 * t;
+
+	// Cubic Hermite basis functions, tangent terms scaled by interval length
+	double h00 = 2 * t3 - 3 * t2 + 1;
+	double h10 = (t3 - 2 * t2 + t) * step_;
+	double h01 = -2 * t3 + 3 * t2;
+	double h11 = (t3 - t2) * step_;
+
+	Sample &s0 = sample_[i];
+	Sample &s1 = sample_[i + 1];
+
+	*x = h00 * s0.x + h10 * s0.dx + h01 * s1.x + h11 * s1.dx;
+	*y = h00 * s0.y + h10 * s0.dy + h01 * s1.y + h11 * s1.dy;
+	*h = h00 * s0.h + h10 * s0.dh + h01 * s1.h + h11 * s1.dh;
+}
+
+double GeometryLookupTable::EvaluateCurvature(double ds)
+{
+	if (sample_.size() < 2)
+	{
+		return sample_.size() == 1 ? sample_[0].dh : 0.0;
+	}
+
+	double p = CLAMP(ds, 0.0, length_) * inv_step_;
+	int i = MIN((int)p, (int)sample_.size() - 2);
+	double t = p - i;
+	double t2 = t * t;
+
+	// Derivatives of the cubic Hermite basis functions, with respect to ds
+	double d00 = (6 * t2 - 6 * t) * inv_step_;
+	double d10 = 3 * t2 - 4 * t + 1;
+	double d01 = -d00;
+	double d11 = 3 * t2 - 2 * t;
+
+	Sample &s0 = sample_[i];
+	Sample &s1 = sample_[i + 1];
+
+	return d00 * s0.h + d10 * s0.dh + d01 * s1.h + d11 * s1.dh;
+}
+
 void Geometry::Print()
 {
 	LOG("Geometry virtual Print\n");
@@ -281,7 +482,34 @@ void Spiral::Print()
 		arc_ != 0 ? " - actually an Arc" : line_ != 0 ? "- actually a Line" : "");
 }
 
+void Spiral::UpdateLookupTable()
+{
+	if (use_lookup_table_ && line_ == 0 && arc_ == 0 && 
+		(lut_.IsEmpty() || lut_.GetTolerance() != lookup_table_tolerance_))
+	{
+		lut_.Build(GetLength(), lookup_table_tolerance_, [this](double s, GeometryLookupTable::Sample &sample)
+		{
+			EvaluateDSExact(s, &sample.x, &sample.y, &sample.h);
+			sample.dx = cos(sample.h);
+			sample.dy = sin(sample.h);
+			sample.dh = EvaluateCurvatureDSExact(s);
+		});
+	}
+}
+
 void Spiral::EvaluateDS(double ds, double* x, double* y, double* h)
+{
+	if (use_lookup_table_ && !lut_.IsEmpty() && lut_.GetTolerance() == lookup_table_tolerance_)
+	{
+		lut_.Evaluate(ds, x, y, h);
+	}
+	else
+	{
+		EvaluateDSExact(ds, x, y, h);
+	}
+}
+
+void Spiral::EvaluateDSExact(double ds, double* x, double* y, double* h)
 {
 	double xTmp, yTmp, t;
 
@@ -314,6 +542,18 @@ void Spiral::EvaluateDS(double ds, double* x, double* y, double* h)
 }
 
 double Spiral::EvaluateCurvatureDS(double ds)
+{
+	if (use_lookup_table_ && !lut_.IsEmpty() && lut_.GetTolerance() == lookup_table_tolerance_)
+	{
+		return lut_.EvaluateCurvature(ds);
+	}
+	else
+	{
+		return EvaluateCurvatureDSExact(ds);
+	}
+}
+
+double Spiral::EvaluateCurvatureDSExact(double ds)
 {
 	if (line_ != 0)
 	{
@@ -342,6 +582,7 @@ void Spiral::SetX(double x)
 	else
 	{
 		x_ = x;
+		lut_.Clear();
 	}
 }
 
@@ -358,6 +599,7 @@ void Spiral::SetY(double y)
 	else
 	{
 		y_ = y;
+		lut_.Clear();
 	}
 }
 
@@ -374,6 +616,7 @@ void Spiral::SetHdg(double h)
 	else
 	{
 		hdg_ = h;
+		lut_.Clear();
 	}
 }
 
@@ -409,7 +652,42 @@ void ParamPoly3::Print()
 	);
 }
 
+void ParamPoly3::UpdateLookupTable()
+{
+	if (use_lookup_table_ && (lut_.IsEmpty() || lut_.GetTolerance() != lookup_table_tolerance_))
+	{
+		lut_.Build(GetLength(), lookup_table_tolerance_, [this](double s, GeometryLookupTable::Sample &sample)
+		{
+			EvaluateDSExact(s, &sample.x, &sample.y, &sample.h);
+
+			// Derivatives with respect to s, polynomial derivatives are with respect to the scaled parameter
+			double du = poly3U_.EvaluatePrim(s);
+			double dv = poly3V_.EvaluatePrim(s);
+			double ddu = poly3U_.EvaluatePrimPrim(s);
+			double ddv = poly3V_.EvaluatePrimPrim(s);
+			double scale = poly3U_.GetPscale();
+			double len2 = du * du + dv * dv;
+
+			sample.dx = scale * (du * cos(GetHdg()) - dv * sin(GetHdg()));
+			sample.dy = scale * (du * sin(GetHdg()) + dv * cos(GetHdg()));
+			sample.dh = len2 > SMALL_NUMBER ? scale * (du * ddv - dv * ddu) / len2 : 0.0;
+		});
+	}
+}
+
 void ParamPoly3::EvaluateDS(double ds, double *x, double *y, double *h)
+{
+	if (use_lookup_table_ && !lut_.IsEmpty() && lut_.GetTolerance() == lookup_table_tolerance_)
+	{
+		lut_.Evaluate(ds, x, y, h);
+	}
+	else
+	{
+		EvaluateDSExact(ds, x, y, h);
+	}
+}
+
+void ParamPoly3::EvaluateDSExact(double ds, double *x, double *y, double *h)
 {
 	double u_local = poly3U_.Evaluate(ds);
 	double v_local = poly3V_.Evaluate(ds);
@@ -475,14 +753,7 @@ LaneWidth *Lane::GetWidthByS(double s)
 	{
 		return 0;  // No lanewidth defined
 	}
-	for (int i=0; i+1<(int)lane_width_.size(); i++)
-	{
-		if (s < lane_width_[i + 1]->GetSOffset())
-		{
-			return lane_width_[i];
-		}
-	}
-	return lane_width_.back();
+	return lane_width_[GetIdxByS(lane_width_, s, -1, &LaneWidth::GetSOffset)];
 }
 
 LaneLink *Lane::GetLink(LinkType type)
@@ -574,7 +845,6 @@ void LaneRoadMarkType::AddLine(LaneRoadMarkTypeLine *lane_roadMarkTypeLine)
 
 void Lane::SetLaneBoundary(LaneBoundaryOSI *lane_boundary) 
 {	
-	lane_boundary->SetGlobalId();
 	lane_boundary_ = lane_boundary; 
 } 
 
@@ -643,40 +913,17 @@ LaneSection* Road::GetLaneSectionByIdx(int idx)
 
 int Road::GetLaneSectionIdxByS(double s, int start_at)
 {
-	if (start_at < 0 || start_at > lane_section_.size() - 1)
+	if (start_at < 0 || start_at > (int)lane_section_.size() - 1)
 	{
 		return -1;
 	}
 
-	LaneSection *lane_section = lane_section_[start_at];
-	size_t i = start_at;
-
-	if (s < lane_section->GetS() && start_at > 0)  
-	{
-		// Look backwards
-		for (i = start_at - 1; i > 0; i--)  // No need to check the first one
-		{
-			lane_section = GetLaneSectionByIdx((int)i);
-			if (s > lane_section->GetS())
-			{
-				break;
-			}
-		}
-	}
-	else  
-	{
-		// look forward
-		for (i = start_at; i < GetNumberOfLaneSections()-1; i++) // No need to check the last one 
-		{
-			lane_section = GetLaneSectionByIdx((int)i);
-			if (s < lane_section->GetS() + lane_section->GetLength())
-			{
-				break;
-			}
-		}
-	}
+	return GetIdxByS(lane_section_, s, start_at);
+}
 
-	return (int)i;
+int Road::GetGeometryIdxByS(double s, int start_at)
+{
+	return GetIdxByS(geometry_, s, start_at);
 }
 
 LaneInfo Road::GetLaneInfoByS(double s, int start_lane_section_idx, int start_lane_id)
@@ -756,10 +1003,11 @@ double Road::GetSpeedByS(double s)
 {
 	if (type_.size() > 0)
 	{
-		size_t i;
-		for (i = 0; i < type_.size() - 1 && s > type_[i + 1]->s_; i++);
+		// Last entry starting before s
+		std::vector<RoadTypeEntry*>::iterator it = std::lower_bound(type_.begin() + 1, type_.end(), s,
+			[](RoadTypeEntry *type, double s) { return type->s_ < s; });
 
-		return type_[i]->speed_;
+		return (*(it - 1))->speed_;
 	}
 
 	// No type entries, fall back to a speed based on nr of lanes
@@ -798,6 +1046,12 @@ Lane* LaneSection::GetLaneByIdx(int idx)
 
 Lane* LaneSection::GetLaneById(int id)
 {
+	if (!lane_idx_by_slot_.empty())
+	{
+		int slot = GetLaneSlot(id);
+		return slot < 0 ? 0 : lane_[lane_idx_by_slot_[slot]];
+	}
+
 	for (size_t i=0; i<lane_.size(); i++)
 	{
 		if (lane_[i]->GetId() == id)
@@ -843,6 +1097,12 @@ int LaneSection::GetLaneIdByIdx(int idx)
 
 int LaneSection::GetLaneIdxById(int id)
 {
+	if (!lane_idx_by_slot_.empty())
+	{
+		int slot = GetLaneSlot(id);
+		return slot < 0 ? -1 : lane_idx_by_slot_[slot];
+	}
+
 	for (int i = 0; i<(int)lane_.size(); i++)
 	{
 		if (lane_[i]->GetId() == id)
@@ -929,6 +1189,22 @@ double LaneSection::GetWidth(double s, int lane_id)
 		return 0.0;  // reference lane has no width
 	}
 
+	int slot = GetLaneSlot(lane_id);
+	if (slot >= 0)
+	{
+		int idx = width_idx_by_slot_[slot];
+		int idx_end = width_idx_by_slot_[slot + 1];
+		if (idx == idx_end) // No lane width registered
+		{
+			return 0.0;
+		}
+
+		// Pick width segment same way as Lane::GetWidthByS()
+		idx = (int)(std::upper_bound(width_s_offset_.begin() + idx + 1, width_s_offset_.begin() + idx_end, s - s_) - width_s_offset_.begin()) - 1;
+
+		return width_poly_[idx].Evaluate(s - (s_ + width_s_offset_[idx]));
+	}
+
 	Lane *lane = GetLaneById(lane_id);
 	if (lane == 0)
 	{
@@ -951,17 +1227,22 @@ double LaneSection::GetWidth(double s, int lane_id)
 
 double LaneSection::GetOuterOffset(double s, int lane_id)
 {
-	double width = GetWidth(s, lane_id);
-
-	if (abs(lane_id) == 1)
+	if (lane_id == 0)
 	{
-		// this is the last lane, next to reference lane of width = 0. Stop here.
-		return width;
+		// reference lane has no width, continue into innermost right lane
+		lane_id = -1;
 	}
-	else
+
+	// Add lane widths starting from lane next to the reference lane and outwards
+	int step = lane_id < 0 ? -1 : +1;
+	double offset = 0.0;
+	for (int id = step; ; id += step)
 	{
-		int step = lane_id < 0 ? +1 : -1;
-		return (width + GetOuterOffset(s, lane_id + step));
+		offset = GetWidth(s, id) + offset;
+		if (id == lane_id)
+		{
+			return offset;
+		}
 	}
 }
 
@@ -1038,6 +1319,69 @@ void LaneSection::AddLane(Lane *lane)
 	lane->SetGlobalId();
 	global_lane_counter++;
 	lane_.push_back(lane);
+
+	// Lane table is outdated
+	lane_idx_by_slot_.clear();
+}
+
+void LaneSection::BuildLaneTable()
+{
+	lane_idx_by_slot_.clear();
+	width_idx_by_slot_.clear();
+	width_s_offset_.clear();
+	width_poly_.clear();
+
+	if (lane_.empty())
+	{
+		return;
+	}
+
+	int lane_id_max = lane_id_min_ = lane_[0]->GetId();
+	for (size_t i = 1; i < lane_.size(); i++)
+	{
+		lane_id_min_ = MIN(lane_id_min_, lane_[i]->GetId());
+		lane_id_max = MAX(lane_id_max, lane_[i]->GetId());
+	}
+
+	if (lane_id_max - lane_id_min_ > 4 * (int)lane_.size() + 16)
+	{
+		// Very sparse lane ids, not worth a table. Stick to the lane list.
+		return;
+	}
+
+	lane_idx_by_slot_.resize(lane_id_max - lane_id_min_ + 1, -1);
+	for (int i = (int)lane_.size() - 1; i >= 0; i--)
+	{
+		// In case of duplicate ids, first one rules just like in the lane list
+		lane_idx_by_slot_[lane_[i]->GetId() - lane_id_min_] = i;
+	}
+
+	for (size_t i = 0; i < lane_idx_by_slot_.size(); i++)
+	{
+		width_idx_by_slot_.push_back((int)width_s_offset_.size());
+		if (lane_idx_by_slot_[i] >= 0)
+		{
+			Lane *lane = lane_[lane_idx_by_slot_[i]];
+			for (int j = 0; j < lane->GetNumberOfLaneWidths(); j++)
+			{
+				width_s_offset_.push_back(lane->GetWidthByIndex(j)->GetSOffset());
+				width_poly_.push_back(lane->GetWidthByIndex(j)->poly3_);
+			}
+		}
+	}
+	width_idx_by_slot_.push_back((int)width_s_offset_.size());
+}
+
+int LaneSection::GetLaneSlot(int lane_id)
+{
+	int slot = lane_id - lane_id_min_;
+
+	if (slot < 0 || slot >= (int)lane_idx_by_slot_.size() || lane_idx_by_slot_[slot] < 0)
+	{
+		return -1;
+	}
+
+	return slot;
 }
 
 int LaneSection::GetConnectingLaneId(int incoming_lane_id, LinkType link_type)
@@ -1378,40 +1722,22 @@ Signal* Road::GetSignal(int idx)
 
 double Road::GetLaneOffset(double s)
 {
-	int i = 0;
-
 	if (lane_offset_.size() == 0)
 	{
 		return 0;
 	}
 
-	for (; i + 1 < (int)lane_offset_.size(); i++)
-	{
-		if (s < lane_offset_[i + 1]->GetS())
-		{
-			break;
-		}
-	}
-	return (lane_offset_[i]->GetLaneOffset(s));
+	return (lane_offset_[GetIdxByS(lane_offset_, s)]->GetLaneOffset(s));
 }
 
 double Road::GetLaneOffsetPrim(double s)
 {
-	int i = 0;
-
 	if (lane_offset_.size() == 0)
 	{
 		return 0;
 	}
 
-	for (; i + 1 < (int)lane_offset_.size(); i++)
-	{
-		if (s < lane_offset_[i + 1]->GetS())
-		{
-			break;
-		}
-	}
-	return (lane_offset_[i]->GetLaneOffsetPrim(s));
+	return (lane_offset_[GetIdxByS(lane_offset_, s)]->GetLaneOffsetPrim(s));
 }
 
 int Road::GetNumberOfLanes(double s)
@@ -1569,10 +1895,7 @@ bool Road::GetZAndPitchByS(double s, double *z, double *pitch, int *index)
 {
 	if (GetNumberOfElevations() > 0)
 	{
-		if (*index < 0 || *index >= GetNumberOfElevations())
-		{
-			*index = 0;
-		}
+		*index = GetIdxByS(elevation_profile_, s, *index);
 		Elevation *elevation = GetElevation(*index);
 		if (elevation == NULL)
 		{
@@ -1580,23 +1903,6 @@ bool Road::GetZAndPitchByS(double s, double *z, double *pitch, int *index)
 			return false;
 		}
 
-		if (elevation && s > elevation->GetS() + elevation->GetLength())
-		{
-			while (s > elevation->GetS() + elevation->GetLength() && *index < GetNumberOfElevations() - 1)
-			{
-				// Move to next elevation section
-				elevation = GetElevation(++*index);
-			}
-		}
-		else if (elevation && s < elevation->GetS())
-		{
-			while (s < elevation->GetS() && *index > 0)
-			{
-				// Move to previous elevation section
-				elevation = GetElevation(--*index);
-			}
-		}
-
 		if (elevation)
 		{
 			double p = s - elevation->GetS();
@@ -1612,12 +1918,10 @@ bool Road::GetZAndPitchByS(double s, double *z, double *pitch, int *index)
 
 Road* OpenDrive::GetRoadById(int id)
 {
-	for (size_t i=0; i<road_.size(); i++)
+	std::unordered_map<int, int>::iterator it = road_idx_by_id_.find(id);
+	if (it != road_idx_by_id_.end())
 	{
-		if (road_[i]->GetId() == id)
-		{
-			return road_[i];
-		}
+		return road_[it->second];
 	}
 	return 0;
 }
@@ -1648,12 +1952,10 @@ Geometry *OpenDrive::GetGeometryByIdx(int road_idx, int geom_idx)
 
 Junction* OpenDrive::GetJunctionById(int id)
 {
-	for (size_t i=0; i<junction_.size(); i++)
+	std::unordered_map<int, int>::iterator it = junction_idx_by_id_.find(id);
+	if (it != junction_idx_by_id_.end())
 	{
-		if (junction_[i]->GetId() == id)
-		{
-			return junction_[i];
-		}
+		return junction_[it->second];
 	}
 	return 0;
 }
@@ -1671,49 +1973,349 @@ Junction *OpenDrive::GetJunctionByIdx(int idx)
 	}
 }
 
-OpenDrive::OpenDrive(const char *filename)
+// Stamp per road of the road grid query in progress, to avoid duplicates in the result. Kept per thread, since a
+// road network, including its grid, may be shared by several threads, see OpenDriveContext.
+// Stamps increase for every query on the thread, so entries left from queries of other grids never match.
+static thread_local std::vector<int> grid_visited;
+static thread_local int grid_stamp = 0;
+
+static void StartRoadGridQuery(int n_roads)
 {
-	if (!LoadOpenDriveFile(filename))
+	if (grid_visited.size() < (size_t)n_roads)
 	{
-		LOG("Error loading OpenDrive %s\n", filename);
-		throw std::invalid_argument("Failed to load OpenDrive file");
+		grid_visited.resize(n_roads, 0);
+	}
+
+	if (++grid_stamp == std::numeric_limits<int>::max())
+	{
+		std::fill(grid_visited.begin(), grid_visited.end(), 0);
+		grid_stamp = 1;
 	}
 }
 
-bool OpenDrive::LoadOpenDriveFile(const char *filename, bool replace)
+void RoadGrid::Clear()
 {
-	mt_rand.seed((unsigned int)time(0));
+	cell_.clear();
+	x_min_ = 0;
+	y_min_ = 0;
+	cell_size_ = 0;
+	n_cols_ = 0;
+	n_rows_ = 0;
+	n_roads_ = 0;
+}
 
-	if (replace)
-	{
-		g_Lane_id = 0; 
-		g_Laneb_id = 0;
+void RoadGrid::AddRoadToCells(int road_idx, double x, double y, double radius)
+{
+	int col0 = CLAMP((int)floor((x - radius - x_min_) / cell_size_), 0, n_cols_ - 1);
+	int col1 = CLAMP((int)floor((x + radius - x_min_) / cell_size_), 0, n_cols_ - 1);
+	int row0 = CLAMP((int)floor((y - radius - y_min_) / cell_size_), 0, n_rows_ - 1);
+	int row1 = CLAMP((int)floor((y + radius - y_min_) / cell_size_), 0, n_rows_ - 1);
 
-		for (size_t i=0; i<road_.size(); i++)
+	for (int row = row0; row <= row1; row++)
+	{
+		for (int col = col0; col <= col1; col++)
 		{
-			delete road_[i];
-		}
-		road_.clear();
+			std::vector<int> &cell = cell_[row * n_cols_ + col];
 
-		for (size_t i=0; i<junction_.size(); i++)
-		{
-			delete junction_[i];
+			// Roads are added one by one, so it's enough to check last entry to avoid duplicates
+			if (cell.size() == 0 || cell.back() != road_idx)
+			{
+				cell.push_back(road_idx);
+			}
 		}
-		junction_.clear();
 	}
+}
 
-	odr_filename_ = filename;
-
-	if (odr_filename_ == "")
-	{
-		return false;
-	}
+void RoadGrid::Build(std::vector<Road*> &roads)
+{
+	double x_max = 0;
+	double y_max = 0;
+	double max_radius = 0;
+	bool first = true;
 
-	pugi::xml_document doc;
+	Clear();
 
-	// First assume absolute path
-	pugi::xml_parse_result result = doc.load_file(filename);
-	if (!result)
+	// First find extent of the road network
+	for (size_t i = 0; i < roads.size(); i++)
+	{
+		for (int j = 0; j < roads[i]->GetNumberOfLaneSections(); j++)
+		{
+			OSIPoints *osiPoints = roads[i]->GetLaneSectionByIdx(j)->GetLaneById(0)->GetOSIPoints();
+			for (int k = 0; k < osiPoints->GetNumOfOSIPoints(); k++)
+			{
+				double x = osiPoints->GetX()[k];
+				double y = osiPoints->GetY()[k];
+				if (first)
+				{
+					x_min_ = x_max = x;
+					y_min_ = y_max = y;
+					first = false;
+				}
+				else
+				{
+					x_min_ = MIN(x_min_, x);
+					x_max = MAX(x_max, x);
+					y_min_ = MIN(y_min_, y);
+					y_max = MAX(y_max, y);
+				}
+				double s = osiPoints->GetS()[k];
+				max_radius = MAX(max_radius, MAX(roads[i]->GetDrivableWidth(s, -1), roads[i]->GetDrivableWidth(s, 1)));
+			}
+		}
+	}
+
+	if (first)
+	{
+		return;  // no OSI points
+	}
+
+	x_min_ -= max_radius;
+	y_min_ -= max_radius;
+	x_max += max_radius;
+	y_max += max_radius;
+
+	// Increase cell size for huge networks, to limit memory footprint
+	cell_size_ = MAX(ROAD_GRID_CELL_SIZE, sqrt((x_max - x_min_) * (y_max - y_min_) / ROAD_GRID_MAX_CELLS));
+	n_cols_ = (int)((x_max - x_min_) / cell_size_) + 1;
+	n_rows_ = (int)((y_max - y_min_) / cell_size_) + 1;
+	cell_.resize((size_t)n_cols_ * n_rows_);
+	n_roads_ = (int)roads.size();
+
+	// Register each road in all cells touched by its center line segments, expanded by drivable width.
+	// Long segments are sampled with a step size of half a cell.
+	for (size_t i = 0; i < roads.size(); i++)
+	{
+		for (int j = 0; j < roads[i]->GetNumberOfLaneSections(); j++)
+		{
+			OSIPoints *osiPoints = roads[i]->GetLaneSectionByIdx(j)->GetLaneById(0)->GetOSIPoints();
+			double x0 = 0, y0 = 0, r0 = 0;
+
+			for (int k = 0; k < osiPoints->GetNumOfOSIPoints(); k++)
+			{
+				double x1 = osiPoints->GetX()[k];
+				double y1 = osiPoints->GetY()[k];
+				double s = osiPoints->GetS()[k];
+				double r1 = MAX(roads[i]->GetDrivableWidth(s, -1), roads[i]->GetDrivableWidth(s, 1));
+
+				if (k == 0)
+				{
+					AddRoadToCells((int)i, x1, y1, r1);
+				}
+				else
+				{
+					int n_steps = (int)ceil(PointDistance2D(x0, y0, x1, y1) / (0.5 * cell_size_));
+					for (int step = 1; step <= n_steps; step++)
+					{
+						double f = (double)step / n_steps;
+						AddRoadToCells((int)i, x0 + f * (x1 - x0), y0 + f * (y1 - y0), r0 + f * (r1 - r0));
+					}
+				}
+				x0 = x1;
+				y0 = y1;
+				r0 = r1;
+			}
+		}
+	}
+}
+
+int RoadGrid::AddCellRoads(int col, int row, std::vector<int> &road_idx)
+{
+	if (col < 0 || col >= n_cols_ || row < 0 || row >= n_rows_)
+	{
+		return 0;
+	}
+
+	int counter = 0;
+	std::vector<int> &cell = cell_[row * n_cols_ + col];
+	for (size_t i = 0; i < cell.size(); i++)
+	{
+		if (grid_visited[cell[i]] != grid_stamp)
+		{
+			grid_visited[cell[i]] = grid_stamp;
+			road_idx.push_back(cell[i]);
+			counter++;
+		}
+	}
+
+	return counter;
+}
+
+int RoadGrid::GetRoadsNearPoint(double x, double y, double margin, std::vector<int> &road_idx)
+{
+	road_idx.clear();
+
+	if (cell_.size() == 0)
+	{
+		return 0;
+	}
+
+	StartRoadGridQuery(n_roads_);
+
+	int col = (int)floor((x - x_min_) / cell_size_);
+	int row = (int)floor((y - y_min_) / cell_size_);
+
+	// Skip rings not overlapping the grid, in case the point is outside
+	int r_start = MAX(0, MAX(MAX(-col, col - (n_cols_ - 1)), MAX(-row, row - (n_rows_ - 1))));
+	int r_max = r_start + MAX(n_cols_, n_rows_);
+	int r_stop = r_max;
+
+	for (int r = r_start; r <= r_stop; r++)
+	{
+		if (r == 0)
+		{
+			AddCellRoads(col, row, road_idx);
+		}
+		else
+		{
+			for (int c = col - r; c <= col + r; c++)
+			{
+				AddCellRoads(c, row - r, road_idx);
+				AddCellRoads(c, row + r, road_idx);
+			}
+			for (int rr = row - r + 1; rr < row + r; rr++)
+			{
+				AddCellRoads(col - r, rr, road_idx);
+				AddCellRoads(col + r, rr, road_idx);
+			}
+		}
+
+		if (road_idx.size() > 0 && r_stop == r_max)
+		{
+			// First candidate found, at a distance of at most (r + 1) * sqrt(2) cells
+			// Any road not found within that distance plus margin can be ignored
+			// Add one cell to compensate for the sampling and the square expansion by road width
+			r_stop = MIN(r_max, (int)ceil((r + 1) * M_SQRT2 + 1 + margin / cell_size_));
+		}
+	}
+
+	return (int)road_idx.size();
+}
+
+int RoadGrid::GetRoadsInRadius(double x, double y, double radius, std::vector<int> &road_idx)
+{
+	road_idx.clear();
+
+	if (cell_.size() == 0)
+	{
+		return 0;
+	}
+
+	StartRoadGridQuery(n_roads_);
+
+	int col0 = (int)floor((x - radius - x_min_) / cell_size_);
+	int col1 = (int)floor((x + radius - x_min_) / cell_size_);
+	int row0 = (int)floor((y - radius - y_min_) / cell_size_);
+	int row1 = (int)floor((y + radius - y_min_) / cell_size_);
+
+	if (col1 < 0 || col0 >= n_cols_ || row1 < 0 || row0 >= n_rows_)
+	{
+		return 0;  // circle completely outside the grid
+	}
+
+	col0 = MAX(col0, 0);
+	col1 = MIN(col1, n_cols_ - 1);
+	row0 = MAX(row0, 0);
+	row1 = MIN(row1, n_rows_ - 1);
+
+	for (int row = row0; row <= row1; row++)
+	{
+		for (int col = col0; col <= col1; col++)
+		{
+			AddCellRoads(col, row, road_idx);
+		}
+	}
+
+	return (int)road_idx.size();
+}
+
+static unsigned long long HashBytes(const void *data, size_t size, unsigned long long hash = 14695981039346656037ULL)
+{
+	// FNV-1a, 64 bit
+	const unsigned char *p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ p[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+OpenDrive::OpenDrive(const char *filename) : use_road_grid_(true), osi_points_mode_(OSI_POINTS_EAGER), osi_points_threads_(0)
+{
+	if (!LoadOpenDriveFile(filename))
+	{
+		LOG("Error loading OpenDrive %s\n", filename);
+		throw std::invalid_argument("Failed to load OpenDrive file");
+	}
+}
+
+bool OpenDrive::LoadOpenDriveFile(const char *filename, bool replace)
+{
+	LoadingOpenDriveScope loading(this);
+
+	mt_rand.seed((unsigned int)time(0));
+
+	if (replace)
+	{
+		g_Lane_id = 0; 
+		g_Laneb_id = 0;
+
+		for (size_t i=0; i<road_.size(); i++)
+		{
+			delete road_[i];
+		}
+		road_.clear();
+		road_idx_by_id_.clear();
+
+		for (size_t i=0; i<junction_.size(); i++)
+		{
+			delete junction_[i];
+		}
+		junction_.clear();
+		junction_idx_by_id_.clear();
+
+		road_grid_.Clear();
+		connectivity_.clear();
+	}
+
+	// Any new road or link might affect previously calculated paths
+	road_path_cache_.Clear();
+
+	odr_filename_ = filename;
+	cache_filename_ = "";
+	cache_used_ = false;
+
+	if (odr_filename_ == "")
+	{
+		return false;
+	}
+
+	pugi::xml_document doc;
+	pugi::xml_parse_result result;
+	int first_road_idx = (int)road_.size();
+	unsigned long long hash = 0;
+
+	if (cache_dir_.empty())
+	{
+		// First assume absolute path
+		result = doc.load_file(filename);
+	}
+	else
+	{
+		// Read file into memory to find hash of content for cache lookup
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		std::vector<char> buf((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		hash = HashBytes(buf.data(), buf.size());
+		result = doc.load_buffer(buf.data(), buf.size());
+
+		// Settings affecting the OSI points are part of the key as well
+		double lut_tolerance = Geometry::GetUseLookupTable() ? Geometry::GetLookupTableTolerance() : 0.0;
+		hash = HashBytes(&lut_tolerance, sizeof(lut_tolerance), hash);
+	}
+	if (!result)
 	{
 		return false;
 	}
@@ -2490,7 +3092,17 @@ bool OpenDrive::LoadOpenDriveFile(const char *filename, bool replace)
 			lane_section->AddLane(new Lane(0, Lane::LANE_TYPE_NONE));
 			r->AddLaneSection(lane_section);
 		}
-			
+
+		for (int i = 0; i < r->GetNumberOfLaneSections(); i++)
+		{
+			r->GetLaneSectionByIdx(i)->BuildLaneTable();
+		}
+
+		// Register road for lookup by id. In case of duplicates, e.g. when merging networks, first one rules.
+		if (!road_idx_by_id_.emplace(r->GetId(), (int)road_.size()).second)
+		{
+			LOG("Warning: Road id %d already defined, ignoring it for lookup by id\n", r->GetId());
+		}
 		road_.push_back(r);
 	}
 
@@ -2537,16 +3149,40 @@ bool OpenDrive::LoadOpenDriveFile(const char *filename, bool replace)
 				j->AddConnection(connection);
 			}
 		}
+		if (!junction_idx_by_id_.emplace(j->GetId(), (int)junction_.size()).second)
+		{
+			LOG("Warning: Junction id %d already defined, ignoring it for lookup by id\n", j->GetId());
+		}
 		junction_.push_back(j);
 	}
 
 	// CheckConnections();
 
+	// Before any evaluation of the geometries, e.g. for OSI points
+	UpdateLookupTables();
+
+	if (!cache_dir_.empty())
+	{
+		cache_filename_ = CreateCacheFilename(hash);
+		cache_used_ = ReadCache(cache_filename_, hash, first_road_idx) == 0;
+	}
+
 	if (!SetRoadOSI())
 	{
 		LOG("Failed to create OSI points for OpenDrive road!");
 	}
 
+	if (!cache_dir_.empty() && !cache_used_)
+	{
+		WriteCache(cache_filename_, hash, first_road_idx);
+	}
+
+	// Index all roads, including any previously loaded ones, for fast world to road coordinate lookup
+	road_grid_.Build(road_);
+
+	// Precompute connectivity of all roads, since links might refer to previously loaded roads
+	BuildConnectivity();
+
 	return true;
 }
 
@@ -2720,142 +3356,312 @@ void Junction::Print()
 	}
 }
 
-bool RoadPath::CheckRoad(Road *checkRoad, RoadPath::PathNode *srcNode, Road *fromRoad)
+bool RoadPathCache::Get(Key key, Entry &entry)
 {
-	Road* targetRoad = targetPos_->GetOpenDrive()->GetRoadById(targetPos_->GetTrackId());
-	
-	RoadLink* nextLink = 0;
+	mutex_.Lock();
 
-	if (srcNode->link->GetElementType() == RoadLink::RoadLink::ELEMENT_TYPE_ROAD)
+	std::map<Key, std::list<std::pair<Key, Entry>>::iterator>::iterator it = map_.find(key);
+
+	if (it == map_.end())
 	{
-		if (srcNode->link->GetContactPointType() == ContactPointType::CONTACT_POINT_END)
-		{
-			nextLink = checkRoad->GetLink(LinkType::PREDECESSOR);
-		}
-		else
-		{
-			nextLink = checkRoad->GetLink(LinkType::SUCCESSOR);
-		}
+		misses_++;
+		mutex_.Unlock();
+		return false;
 	}
-	else if (srcNode->link->GetElementType() == RoadLink::ElementType::ELEMENT_TYPE_JUNCTION)
+
+	// Move to front, as most recently used
+	list_.splice(list_.begin(), list_, it->second);
+	hits_++;
+	entry = it->second->second;
+
+	mutex_.Unlock();
+
+	return true;
+}
+
+void RoadPathCache::Add(Key key, Entry &entry)
+{
+	mutex_.Lock();
+
+	std::map<Key, std::list<std::pair<Key, Entry>>::iterator>::iterator it = map_.find(key);
+
+	if (it != map_.end())
 	{
-		if (checkRoad->GetLink(LinkType::SUCCESSOR) && 
-			checkRoad->GetLink(LinkType::SUCCESSOR)->GetElementId() == fromRoad->GetId())
-		{
-			nextLink = checkRoad->GetLink(LinkType::PREDECESSOR);
-		}
-		else if (checkRoad->GetLink(LinkType::PREDECESSOR) &&
-			checkRoad->GetLink(LinkType::PREDECESSOR)->GetElementId() == fromRoad->GetId())
-		{
-			nextLink = checkRoad->GetLink(LinkType::SUCCESSOR);
-		}
+		// Already cached, just update
+		it->second->second = entry;
+		list_.splice(list_.begin(), list_, it->second);
+		mutex_.Unlock();
+		return;
 	}
 
-	if (nextLink == 0)
+	list_.push_front(std::make_pair(key, entry));
+	map_[key] = list_.begin();
+
+	// Drop least recently used entries, if cache is full
+	while (list_.size() > capacity_ && list_.size() > 1)
 	{
-		// end of road
-		return false;
+		map_.erase(list_.back().first);
+		list_.pop_back();
 	}
 
-	// Check if next node is already visited
-	for (size_t i = 0; i < visited_.size(); i++)
+	mutex_.Unlock();
+}
+
+void RoadPathCache::Clear()
+{
+	mutex_.Lock();
+	list_.clear();
+	map_.clear();
+	hits_ = 0;
+	misses_ = 0;
+	mutex_.Unlock();
+}
+
+void RoadPathCache::SetCapacity(size_t capacity)
+{
+	mutex_.Lock();
+	capacity_ = capacity;
+
+	while (list_.size() > capacity_)
 	{
-		if (visited_[i]->link == nextLink)
-		{
-			// Already visited, ignore and return
-			return false;
-		}
+		map_.erase(list_.back().first);
+		list_.pop_back();
 	}
+	mutex_.Unlock();
+}
 
-	// Check if next node is already among unvisited
-	size_t i;
-	for (i = 0; i < unvisited_.size(); i++)
+// Order nodes in a priority queue by cost, least first
+struct PathNodeCostCompare
+{
+	bool operator()(const RoadPath::PathNode *a, const RoadPath::PathNode *b) const
 	{
-		if (unvisited_[i]->link == nextLink)
-		{
-			// Consider it, i.e. calc distance and potentially store it (if less than old) 
-			if (srcNode->dist + checkRoad->GetLength() < unvisited_[i]->dist)
-			{
-				unvisited_[i]->dist = srcNode->dist + checkRoad->GetLength();
-			}
-		}
+		return a->cost > b->cost;
+	}
+};
+
+typedef std::priority_queue<RoadPath::PathNode*, std::vector<RoadPath::PathNode*>, PathNodeCostCompare> PathNodeQueue;
+
+// Position of the reference line at one end of a road, taken from the OSI points
+static bool GetRoadEndPoint(Road *road, LinkType end, double &x, double &y)
+{
+	if (road->GetNumberOfLaneSections() < 1)
+	{
+		return false;
 	}
 
-	if (i == unvisited_.size())
+	LaneSection *lane_section = road->GetLaneSectionByIdx(end == LinkType::SUCCESSOR ? road->GetNumberOfLaneSections() - 1 : 0);
+	Lane *lane = lane_section->GetLaneById(0);
+	if (lane == 0 || lane->GetOSIPoints()->GetNumOfOSIPoints() < 1)
 	{
-		// link not visited before, add it
-		PathNode *pNode = new PathNode;
-		pNode->dist = srcNode->dist + checkRoad->GetLength();
-		pNode->link = nextLink;
-		pNode->fromRoad = checkRoad;
-		pNode->previous = srcNode;
-		unvisited_.push_back(pNode);
+		return false;
 	}
 
+	OSIPoints *osi_points = lane->GetOSIPoints();
+	int idx = (end == LinkType::SUCCESSOR ? osi_points->GetNumOfOSIPoints() - 1 : 0);
+	x = osi_points->GetX()[idx];
+	y = osi_points->GetY()[idx];
+
 	return true;
 }
 
-int RoadPath::Calculate(double &dist)
+// Follow a lane through the lane sections of a road, return lane id in the last section or 0 if lane ends
+static int FollowLaneThroughRoad(Road *road, int lane_id, int from_lane_section_idx, int to_lane_section_idx)
 {
-	OpenDrive* odr = startPos_->GetOpenDrive();
-	RoadLink *link = 0;
-	Junction *junction = 0;
-	Road* startRoad = odr->GetRoadById(startPos_->GetTrackId());
-	Road* targetRoad = odr->GetRoadById(targetPos_->GetTrackId());
-	Road* pivotRoad = startRoad;
-	Road* nextRoad = startRoad;
-	bool found = false;
-	double tmpDist = 0;
-	size_t i;
-	
-	// This method will find and measure the length of the shortest path 
-	// between a start position and a target position
-	// The implementation is based on Dijkstra's algorithm
-	// https://en.wikipedia.org/wiki/Dijkstra%27s_algorithm
+	int step = (to_lane_section_idx > from_lane_section_idx ? 1 : -1);
 
-	if (pivotRoad == 0)
+	for (int i = from_lane_section_idx; i != to_lane_section_idx && lane_id != 0; i += step)
 	{
-		LOG("Invalid startpos road ID: %d", startPos_->GetTrackId());
-		return -1;
+		lane_id = road->GetLaneSectionByIdx(i)->GetConnectingLaneId(lane_id, step > 0 ? LinkType::SUCCESSOR : LinkType::PREDECESSOR);
 	}
 
-	// Look both forward and backwards from start position
-	for (i = 0; i < 2; i++)
+	LaneSection *lane_section = road->GetLaneSectionByIdx(to_lane_section_idx);
+	if (lane_id == 0 || lane_section == 0 || lane_section->GetLaneById(lane_id) == 0)
 	{
-		if (i == 0)
-		{
-			tmpDist = startPos_->GetS();  // distance to first road link is distance to start of road
-			link = pivotRoad->GetLink(LinkType::PREDECESSOR);  // Find link to previous road or junction
-		}
-		else
-		{
-			tmpDist = pivotRoad->GetLength() - startPos_->GetS();  // distance to end of road
-			link = pivotRoad->GetLink(LinkType::SUCCESSOR);  // Find link to previous road or junction
-		}
+		return 0;
+	}
+
+	return lane_id;
+}
 
-		// If only forward direction would be of interest, add something like:
-		// if (abs(startPos_->GetHRelative()) > M_PI_2 && abs(startPos_->GetHRelative()) < 3 * M_PI / 2)
-		// then choose predecessor, else successor 
+RoadPath::PathNode *RoadPath::NewNode(Road *road, int entry_lane_id, int lane_id, LinkType exit, ContactPointType entry, double dist, PathNode *previous)
+{
+	PathNode node;
 
-		if (link)
-		{
-			PathNode* pNode = new PathNode;
-			pNode->dist = tmpDist;
-			pNode->link = link;
-			pNode->fromRoad = pivotRoad;
-			pNode->previous = 0;
-			unvisited_.push_back(pNode);
-		}
-	}
+	node.road = road;
+	node.entry_lane_id = entry_lane_id;
+	node.lane_id = lane_id;
+	node.exit = exit;
+	node.entry = entry;
+	node.dist = dist;
+	node.cost = dist;
+	node.previous = previous;
+	node_pool_.push_back(node);
 
-	if (startRoad == targetRoad)
+	return &node_pool_.back();
+}
+
+double RoadPath::EstimateDistance(Road *road, LinkType end, Road *targetRoad)
+{
+	double x, y, x0, y0, x1, y1;
+
+	// Straight line distance to closest end of target road. Never longer than distance along roads, as required by A*.
+	if (!GetRoadEndPoint(road, end, x, y) ||
+		!GetRoadEndPoint(targetRoad, LinkType::PREDECESSOR, x0, y0) ||
+		!GetRoadEndPoint(targetRoad, LinkType::SUCCESSOR, x1, y1))
 	{
-		int direction = 0;
+		return 0;
+	}
 
-		dist = targetPos_->GetS() - startPos_->GetS();
+	return MIN(PointDistance2D(x, y, x0, y0), PointDistance2D(x, y, x1, y1));
+}
 
-		// Special case: On same road, distance is equal to delta s
-		if (startPos_->GetLaneId() < 0)
+int RoadPath::SearchRoadToRoad(Road *startRoad, LinkType startEnd, Road *targetRoad, RoadPathCache::Entry &result)
+{
+	OpenDrive* odr = startPos_->GetOpenDrive();
+	PathNodeQueue queue;
+	std::set<RoadLink*> visited;
+	int n_settled = 0;
+
+	for (int i = 0; i < 2; i++)
+	{
+		result.dist[i] = LARGE_NUMBER;
+		result.path[i].clear();
+	}
+
+	queue.push(NewNode(startRoad, 0, 0, startEnd, CONTACT_POINT_UNKNOWN, 0, 0));
+
+	// A* search over road ends, until target road has been reached from both ends or no more roads to visit
+	while (!queue.empty() && n_settled < 2)
+	{
+		PathNode *node = queue.top();
+		queue.pop();
+
+		if (n_settled > 0 && node->cost > MIN(result.dist[0], result.dist[1]) + targetRoad->GetLength())
+		{
+			// Entering target road from the other end can not result in a shorter path, wherever the target position is
+			break;
+		}
+
+		if (node->exit == LinkType::NONE)
+		{
+			// Reached target road
+			int idx = (node->entry == CONTACT_POINT_START ? 0 : 1);
+			if (result.dist[idx] < LARGE_NUMBER)
+			{
+				continue;  // already found a shorter way in at this end
+			}
+			result.dist[idx] = node->dist;
+			for (PathNode *n = node; n && n->previous; n = n->previous)
+			{
+				result.path[idx].insert(result.path[idx].begin(), n->road->GetId());
+			}
+			n_settled++;
+			continue;
+		}
+
+		RoadLink *link = node->road->GetLink(node->exit);
+		if (link == 0 || visited.find(link) != visited.end())
+		{
+			continue;
+		}
+		visited.insert(link);
+
+		// Collect roads, and which end of them, directly reachable from this road end
+		std::vector<std::pair<Road*, ContactPointType>> next;
+		if (link->GetElementType() == RoadLink::ElementType::ELEMENT_TYPE_ROAD)
+		{
+			Road *nextRoad = odr->GetRoadById(link->GetElementId());
+			if (nextRoad)
+			{
+				next.push_back(std::make_pair(nextRoad, link->GetContactPointType() == CONTACT_POINT_END ? CONTACT_POINT_END : CONTACT_POINT_START));
+			}
+		}
+		else if (link->GetElementType() == RoadLink::ElementType::ELEMENT_TYPE_JUNCTION)
+		{
+			// check all outgoing edges (connecting roads) from the link (junction)
+			Junction *junction = odr->GetJunctionById(link->GetElementId());
+			for (int j = 0; junction && j < junction->GetNoConnectionsFromRoadId(node->road->GetId()); j++)
+			{
+				Road *nextRoad = odr->GetRoadById(junction->GetConnectingRoadIdFromIncomingRoadId(node->road->GetId(), j));
+				if (nextRoad == 0)
+				{
+					continue;
+				}
+
+				RoadLink *pred_link = nextRoad->GetLink(LinkType::PREDECESSOR);
+				RoadLink *succ_link = nextRoad->GetLink(LinkType::SUCCESSOR);
+				if (pred_link && pred_link->GetElementId() == node->road->GetId())
+				{
+					next.push_back(std::make_pair(nextRoad, CONTACT_POINT_START));
+				}
+				else if (succ_link && succ_link->GetElementId() == node->road->GetId())
+				{
+					next.push_back(std::make_pair(nextRoad, CONTACT_POINT_END));
+				}
+			}
+		}
+
+		for (size_t j = 0; j < next.size(); j++)
+		{
+			Road *nextRoad = next[j].first;
+			ContactPointType entry = next[j].second;
+
+			if (nextRoad == targetRoad)
+			{
+				queue.push(NewNode(nextRoad, 0, 0, LinkType::NONE, entry, node->dist, node));
+			}
+			else
+			{
+				LinkType exit = (entry == CONTACT_POINT_START ? LinkType::SUCCESSOR : LinkType::PREDECESSOR);
+				RoadLink *nextLink = nextRoad->GetLink(exit);
+				if (nextLink == 0 || visited.find(nextLink) != visited.end())
+				{
+					continue;  // end of road or already visited
+				}
+				PathNode *nextNode = NewNode(nextRoad, 0, 0, exit, entry, node->dist + nextRoad->GetLength(), node);
+				nextNode->cost = nextNode->dist + EstimateDistance(nextRoad, exit, targetRoad);
+				queue.push(nextNode);
+			}
+		}
+	}
+
+	return n_settled > 0 ? 0 : -1;
+}
+
+int RoadPath::Calculate(double &dist)
+{
+	OpenDrive* odr = startPos_->GetOpenDrive();
+	Road* startRoad = odr->GetRoadById(startPos_->GetTrackId());
+	Road* targetRoad = odr->GetRoadById(targetPos_->GetTrackId());
+	LinkType link_type[2] = { LinkType::PREDECESSOR, LinkType::SUCCESSOR };
+	LinkType bestEnd = LinkType::NONE;
+	double minDist = LARGE_NUMBER;
+	
+	// This method will find and measure the length of the shortest path 
+	// between a start position and a target position
+	// The implementation is based on the A* algorithm, with straight line distance as heuristic
+	// Paths between roads are cached, since the same distance is typically measured over and over
+
+	if (startRoad == 0)
+	{
+		LOG("Invalid startpos road ID: %d", startPos_->GetTrackId());
+		return -1;
+	}
+
+	if (targetRoad == 0)
+	{
+		LOG("Invalid targetpos road ID: %d", targetPos_->GetTrackId());
+		return -1;
+	}
+
+	path_.clear();
+
+	if (startRoad == targetRoad)
+	{
+		dist = targetPos_->GetS() - startPos_->GetS();
+
+		// Special case: On same road, distance is equal to delta s
+		if (startPos_->GetLaneId() < 0)
 		{
 			if (startPos_->GetHRelative() > M_PI_2 && startPos_->GetHRelative() < 3 * M_PI_2)
 			{
@@ -2874,150 +3680,221 @@ int RoadPath::Calculate(double &dist)
 				dist *= -1;
 			}
 		}
+		path_.push_back(startRoad->GetId());
 
 		return 0;
 	}
 
-	if (unvisited_.size() == 0)
+	// Look both backwards and forward from start position
+	for (int i = 0; i < 2; i++)
+	{
+		if (startRoad->GetLink(link_type[i]) == 0)
+		{
+			continue;
+		}
+
+		RoadPathCache::Key key(startRoad->GetId(), targetRoad->GetId(), link_type[i] == LinkType::SUCCESSOR ? 1 : -1);
+		RoadPathCache::Entry entry;
+
+		if (!odr->GetRoadPathCache()->Get(key, entry))
+		{
+			SearchRoadToRoad(startRoad, link_type[i], targetRoad, entry);
+			odr->GetRoadPathCache()->Add(key, entry);
+		}
+
+		// distance from start position to the road end, i.e. to start of road (predecessor) or end of road (successor)
+		double startDist = (link_type[i] == LinkType::PREDECESSOR ? startPos_->GetS() : startRoad->GetLength() - startPos_->GetS());
+
+		for (int j = 0; j < 2; j++)
+		{
+			if (entry.dist[j] < LARGE_NUMBER)
+			{
+				// distance on target road, depending on whether entering at start or end of it
+				double targetDist = (j == 0 ? targetPos_->GetS() : targetRoad->GetLength() - targetPos_->GetS());
+				if (startDist + entry.dist[j] + targetDist < minDist)
+				{
+					minDist = startDist + entry.dist[j] + targetDist;
+					bestEnd = link_type[i];
+					path_.clear();
+					path_.push_back(startRoad->GetId());
+					path_.insert(path_.end(), entry.path[j].begin(), entry.path[j].end());
+				}
+			}
+		}
+	}
+
+	if (bestEnd == LinkType::NONE)
 	{
-		// No links
+		// No path found
 		dist = 0;
 		return -1;
 	}
 
-	for (i = 0; i < 100 && !found && unvisited_.size() > 0; i++)
+	// Find out whether the path goes forward or backwards from starting position
+	double h_relative = startPos_->GetHRelative();
+	if ((bestEnd == LinkType::PREDECESSOR && h_relative > M_PI_2 && h_relative < 3 * M_PI_2) ||
+		(bestEnd == LinkType::SUCCESSOR && (h_relative < M_PI_2 || h_relative > 3 * M_PI_2)))
 	{
-		found = false;
-		
-		// Find unvisited PathNode with shortest distance
-		double minDist = LARGE_NUMBER;
-		int minIndex = 0;
-		for (size_t j = 0; j < unvisited_.size(); j++)
+		direction_ = 1;
+	}
+	else
+	{
+		direction_ = -1;
+	}
+
+	dist = direction_ * minDist;
+
+	return 0;
+}
+
+int RoadPath::CalculateLanePath(double &dist)
+{
+	OpenDrive* odr = startPos_->GetOpenDrive();
+	Road* startRoad = odr->GetRoadById(startPos_->GetTrackId());
+	Road* targetRoad = odr->GetRoadById(targetPos_->GetTrackId());
+	int startLaneId = startPos_->GetLaneId();
+	int targetLaneId = targetPos_->GetLaneId();
+	PathNodeQueue queue;
+	std::set<std::pair<RoadLink*, int>> visited;
+	PathNode *goal = 0;
+
+	lane_path_.clear();
+
+	if (startRoad == 0 || targetRoad == 0 || startLaneId == 0 || targetLaneId == 0)
+	{
+		LOG("Invalid start (road %d lane %d) or target (road %d lane %d)",
+			startPos_->GetTrackId(), startLaneId, targetPos_->GetTrackId(), targetLaneId);
+		return -1;
+	}
+
+	int startLaneSectionIdx = startRoad->GetLaneSectionIdxByS(startPos_->GetS());
+	int targetLaneSectionIdx = targetRoad->GetLaneSectionIdxByS(targetPos_->GetS());
+
+	// Right lanes (negative id) are driven along the road direction, left lanes in the opposite direction
+	LinkType startExit = (startLaneId < 0 ? LinkType::SUCCESSOR : LinkType::PREDECESSOR);
+	int startExitLaneSectionIdx = (startExit == LinkType::SUCCESSOR ? startRoad->GetNumberOfLaneSections() - 1 : 0);
+
+	if (startRoad == targetRoad)
+	{
+		// Special case: Target ahead in same lane
+		double ds = (targetPos_->GetS() - startPos_->GetS()) * (startLaneId < 0 ? 1 : -1);
+		if (ds >= 0 && FollowLaneThroughRoad(startRoad, startLaneId, startLaneSectionIdx, targetLaneSectionIdx) == targetLaneId)
 		{
-			if (unvisited_[j]->dist < minDist)
-			{
-				minIndex = (int)j;
-				minDist = unvisited_[j]->dist;
-			}
+			LanePathNode lane_node = { startRoad->GetId(), startLaneId };
+			lane_path_.push_back(lane_node);
+			direction_ = 1;
+			dist = ds;
+			return 0;
 		}
+	}
 
-		link = unvisited_[minIndex]->link;
-		tmpDist = unvisited_[minIndex]->dist;
-		pivotRoad = unvisited_[minIndex]->fromRoad;
+	int startExitLaneId = FollowLaneThroughRoad(startRoad, startLaneId, startLaneSectionIdx, startExitLaneSectionIdx);
+	if (startExitLaneId == 0)
+	{
+		return -1;
+	}
 
-		// - Inspect all unvisited neighbor nodes (links), measure edge (road) distance to that link
-		// - Note the total distance 
-		// - If not already in invisited list, put it there. 
-		// - Update distance to this link if shorter than previously registered value
-		if (link->GetElementType() == RoadLink::ElementType::ELEMENT_TYPE_ROAD)
+	double startDist = (startExit == LinkType::SUCCESSOR ? startRoad->GetLength() - startPos_->GetS() : startPos_->GetS());
+	queue.push(NewNode(startRoad, startLaneId, startExitLaneId, startExit, CONTACT_POINT_UNKNOWN, startDist, 0));
+
+	while (!queue.empty())
+	{
+		PathNode *node = queue.top();
+		queue.pop();
+
+		if (node->exit == LinkType::NONE)
 		{
-			// only one edge (road)
-			nextRoad = odr->GetRoadById(link->GetElementId());
+			goal = node;
+			break;
+		}
 
-			if (nextRoad == targetRoad)
-			{
-				// Special case: On same road, distance is equal to delta s, direction considered
-				if (link->GetContactPointType() == ContactPointType::CONTACT_POINT_START)
-				{
-					tmpDist += targetPos_->GetS();
-				}
-				else
-				{
-					tmpDist += nextRoad->GetLength() - targetPos_->GetS();
-				}
-				
-				found = true;
-			}
-			else
+		RoadLink *link = node->road->GetLink(node->exit);
+		if (link == 0 || visited.find(std::make_pair(link, node->lane_id)) != visited.end())
+		{
+			continue;
+		}
+		visited.insert(std::make_pair(link, node->lane_id));
+
+		// Collect lanes, and which end of their road, directly connected to the lane at this road end
+		std::vector<std::tuple<Road*, int, ContactPointType>> next;
+		if (link->GetElementType() == RoadLink::ElementType::ELEMENT_TYPE_ROAD)
+		{
+			Road *nextRoad = odr->GetRoadById(link->GetElementId());
+			LaneSection *lane_section = node->road->GetLaneSectionByIdx(node->exit == LinkType::SUCCESSOR ? node->road->GetNumberOfLaneSections() - 1 : 0);
+			if (nextRoad && lane_section)
 			{
-				CheckRoad(nextRoad, unvisited_[minIndex], pivotRoad);
+				int nextLaneId = lane_section->GetConnectingLaneId(node->lane_id, node->exit);
+				next.push_back(std::make_tuple(nextRoad, nextLaneId, link->GetContactPointType() == CONTACT_POINT_END ? CONTACT_POINT_END : CONTACT_POINT_START));
 			}
 		}
 		else if (link->GetElementType() == RoadLink::ElementType::ELEMENT_TYPE_JUNCTION)
 		{
-			// check all outgoing edges (connecting roads) from the link (junction)
-			junction = odr->GetJunctionById(link->GetElementId());
-			for (size_t j = 0; j < junction->GetNoConnectionsFromRoadId(pivotRoad->GetId()); j++)
+			Junction *junction = odr->GetJunctionById(link->GetElementId());
+			for (int j = 0; junction && j < junction->GetNumberOfConnections(); j++)
 			{
-				Road * nextRoad = odr->GetRoadById(junction->GetConnectingRoadIdFromIncomingRoadId(pivotRoad->GetId(), (int)j));
-				if (nextRoad == 0)
-				{
-					return 0;
-				}
-
-				if (nextRoad == targetRoad)
+				Connection *connection = junction->GetConnectionByIdx(j);
+				if (connection->GetIncomingRoad() == node->road && connection->GetConnectingRoad())
 				{
-					// Special case: On same road, distance is equal to delta s, direction considered
-					if (nextRoad->GetLink(LinkType::PREDECESSOR)->GetElementId() == pivotRoad->GetId())
-					{
-						tmpDist += targetPos_->GetS();
-					}
-					else
-					{
-						tmpDist += nextRoad->GetLength() - targetPos_->GetS();
-					}
-					found = true;
-				}
-				else
-				{ 
-					CheckRoad(nextRoad, unvisited_[minIndex], pivotRoad);
+					next.push_back(std::make_tuple(connection->GetConnectingRoad(), connection->GetConnectingLaneId(node->lane_id), connection->GetContactPoint()));
 				}
 			}
 		}
-		
-		// Mark pivot link as visited (move it from unvisited to visited)
-		visited_.push_back(unvisited_[minIndex]);
-		unvisited_.erase(unvisited_.begin() + minIndex);
-	}
 
-	if (found)
-	{
-		// Find out whether the path goes forward or backwards from starting position
-		if (visited_.size() > 0)
+		for (size_t j = 0; j < next.size(); j++)
 		{
-			RoadPath::PathNode* node = visited_.back();
+			Road *nextRoad = std::get<0>(next[j]);
+			int nextLaneId = std::get<1>(next[j]);
+			ContactPointType entry = std::get<2>(next[j]);
 
-			while (node)
+			// Entering at start of road requires a lane driven along road direction, and vice versa
+			if (nextLaneId == 0 || (entry == CONTACT_POINT_START) != (nextLaneId < 0))
 			{
-				if (node->previous == 0)
-				{
-					// This is the first node - inspect whether it is in front or behind start position
-					if ((node->link == startRoad->GetLink(LinkType::PREDECESSOR) && 
-						abs(startPos_->GetHRelative()) > M_PI_2 && abs(startPos_->GetHRelative()) < 3 * M_PI / 2) ||
-						((node->link == startRoad->GetLink(LinkType::SUCCESSOR) &&
-						abs(startPos_->GetHRelative()) < M_PI_2 || abs(startPos_->GetHRelative()) > 3 * M_PI / 2)))
-					{
-						direction_ = 1;
-					}
-					else
-					{
-						direction_ = -1;
-					}
-				}
-				node = node->previous;
+				continue;
 			}
-		}
-	}
 
-	dist = direction_ * tmpDist;
+			int entryLaneSectionIdx = (entry == CONTACT_POINT_START ? 0 : nextRoad->GetNumberOfLaneSections() - 1);
+			LaneSection *lane_section = nextRoad->GetLaneSectionByIdx(entryLaneSectionIdx);
+			if (lane_section == 0 || lane_section->GetLaneById(nextLaneId) == 0)
+			{
+				continue;
+			}
 
-	return found ? 0 : -1;
-}
+			if (nextRoad == targetRoad &&
+				FollowLaneThroughRoad(nextRoad, nextLaneId, entryLaneSectionIdx, targetLaneSectionIdx) == targetLaneId)
+			{
+				double targetDist = (entry == CONTACT_POINT_START ? targetPos_->GetS() : targetRoad->GetLength() - targetPos_->GetS());
+				queue.push(NewNode(nextRoad, nextLaneId, targetLaneId, LinkType::NONE, entry, node->dist + targetDist, node));
+			}
 
+			// Also continue through the road, since the target might be reached from another direction or lane
+			LinkType exit = (entry == CONTACT_POINT_START ? LinkType::SUCCESSOR : LinkType::PREDECESSOR);
+			int exitLaneId = FollowLaneThroughRoad(nextRoad, nextLaneId, entryLaneSectionIdx,
+				exit == LinkType::SUCCESSOR ? nextRoad->GetNumberOfLaneSections() - 1 : 0);
+			if (exitLaneId != 0 && nextRoad->GetLink(exit))
+			{
+				PathNode *nextNode = NewNode(nextRoad, nextLaneId, exitLaneId, exit, entry, node->dist + nextRoad->GetLength(), node);
+				nextNode->cost = nextNode->dist + EstimateDistance(nextRoad, exit, targetRoad);
+				queue.push(nextNode);
+			}
+		}
+	}
 
-RoadPath::~RoadPath()
-{
-	for (size_t i = 0; i < visited_.size(); i++)
+	if (goal == 0)
 	{
-		delete(visited_[i]);
+		dist = 0;
+		return -1;
 	}
-	visited_.clear();
 
-	for (size_t i = 0; i < unvisited_.size(); i++)
+	for (PathNode *node = goal; node; node = node->previous)
 	{
-		delete(unvisited_[i]);
+		LanePathNode lane_node = { node->road->GetId(), node->entry_lane_id };
+		lane_path_.insert(lane_path_.begin(), lane_node);
 	}
-	unvisited_.clear();
+
+	direction_ = 1;
+	dist = goal->dist;
+
+	return 0;
 }
 
 OpenDrive::~OpenDrive()
@@ -3034,12 +3911,10 @@ OpenDrive::~OpenDrive()
 
 int OpenDrive::GetTrackIdxById(int id)
 {
-	for (int i = 0; i<(int)road_.size(); i++)
+	std::unordered_map<int, int>::iterator it = road_idx_by_id_.find(id);
+	if (it != road_idx_by_id_.end())
 	{
-		if (road_[i]->GetId() == id)
-		{
-			return i;
-		}
+		return it->second;
 	}
 	LOG("OpenDrive::GetTrackIdxById Error: Road id %d not found\n", id);
 	return -1;
@@ -3055,138 +3930,339 @@ int OpenDrive::GetTrackIdByIdx(int idx)
 	return 0;
 }
 
-int OpenDrive::IsDirectlyConnected(int road1_id, int road2_id, double &angle)
+void OpenDrive::AddDirectConnection(RoadConnectivity &connectivity, int road_id, int direction, double angle)
 {
-	Road *road1 = GetRoadById(road1_id);
-	Road *road2 = GetRoadById(road2_id);
-	RoadLink *link;
+	// Only first connection to a road counts, successor end is checked before predecessor end
+	for (size_t i = 0; i < connectivity.direct.size(); i++)
+	{
+		if (connectivity.direct[i].road_id == road_id)
+		{
+			return;
+		}
+	}
 
-	// Look from road 1, both ends, for road 2 
-		
-	for (int i = 0; i < 2; i++)
+	DirectRoadConnection connection = { road_id, direction, angle };
+	connectivity.direct.push_back(connection);
+}
+
+void OpenDrive::BuildConnectivity()
+{
+	LinkType link_type[2] = { SUCCESSOR, PREDECESSOR };
+
+	connectivity_.clear();
+	connectivity_.resize(road_.size());
+
+	for (size_t r = 0; r < road_.size(); r++)
 	{
-		if ((link = road1->GetLink(i == 0 ? LinkType::SUCCESSOR : LinkType::PREDECESSOR)))
+		Road *road1 = road_[r];
+		RoadConnectivity &connectivity = connectivity_[r];
+
+		// Look from road 1, both ends, for connected roads
+		for (int i = 0; i < 2; i++)
 		{
+			int direction = (i == 0 ? 1 : -1);
+			RoadLink *link = road1->GetLink(link_type[i]);
+
+			if (link == 0)
+			{
+				continue;
+			}
+
 			if (link->GetElementType() == RoadLink::ElementType::ELEMENT_TYPE_ROAD)
 			{
-				if (link->GetElementId() == road2->GetId())
-				{
-					angle = 0;
-					return i == 0 ? 1 : -1;
-				}
+				AddDirectConnection(connectivity, link->GetElementId(), direction, 0);
 			}
 			else if (link->GetElementType() == RoadLink::ElementType::ELEMENT_TYPE_JUNCTION)
 			{
 				Junction *junction = GetJunctionById(link->GetElementId());
 
+				if (junction == 0)
+				{
+					LOG("Error: junction %d not existing\n", link->GetElementId());
+					continue;
+				}
+
 				for (int j = 0; j < junction->GetNumberOfConnections(); j++)
 				{
 					Connection *connection = junction->GetConnectionByIdx(j);
+					Road *connecting_road = connection->GetConnectingRoad();
+					ContactPointType contact_point = connection->GetContactPoint();
+
+					if (connection->GetIncomingRoad() == 0 || connecting_road == 0)
+					{
+						continue;
+					}
+
+					// The angle is the heading difference between start and end of the connecting road
+					// Same in both directions, so no need to care about which end the connection is made
 					Position test_pos1;
 					Position test_pos2;
-
-					double heading1, heading2;
+					test_pos1.SetLanePos(connecting_road->GetId(), 0, 0, 0);
+					test_pos2.SetLanePos(connecting_road->GetId(), 0, connecting_road->GetLength(), 0);
+					double angle = GetAbsAngleDifference(test_pos2.GetH(), test_pos1.GetH());
 
 					// check case where road1 is incoming road
-					if (connection->GetIncomingRoad()->GetId() == road1_id && connection->GetConnectingRoad()->GetId() == road2_id)
+					if (connection->GetIncomingRoad() == road1)
 					{
-						test_pos1.SetLanePos(road2_id, 0, 0, 0);
-						test_pos2.SetLanePos(road2_id, 0, road2->GetLength(), 0);
+						RoadLink *exit_link = 0;
 
-						if (connection->GetContactPoint() == CONTACT_POINT_END)
+						if (contact_point == CONTACT_POINT_START || contact_point == CONTACT_POINT_END)
 						{
-							heading1 = test_pos2.GetH() + M_PI;
-							heading2 = test_pos1.GetH() + M_PI;
+							AddDirectConnection(connectivity, connecting_road->GetId(), direction, angle);
 						}
-						else if(connection->GetContactPoint() == CONTACT_POINT_START)
+						else
 						{
-							heading1 = test_pos1.GetH();
-							heading2 = test_pos2.GetH();
+							LOG("Unexpected contact point %d", contact_point);
+							AddDirectConnection(connectivity, connecting_road->GetId(), 0, 0);
+						}
+
+						// Register path through the junction, including lane connections
+						if (contact_point == ContactPointType::CONTACT_POINT_START)
+						{
+							exit_link = connecting_road->GetLink(SUCCESSOR);
 						}
 						else
 						{
-							LOG("Unexpected contact point %d", connection->GetContactPoint());
-							return 0;
+							exit_link = connecting_road->GetLink(PREDECESSOR);
 						}
 
-						angle = GetAbsAngleDifference(heading1, heading2);
+						if (exit_link == 0)
+						{
+							continue;
+						}
 
-						return i == 0 ? 1 : -1;
-					}
-					// then check other case where road1 is outgoing from connecting road (connecting road is a road within junction)
-					else if (connection->GetConnectingRoad()->GetId() == road2_id && 
-						((connection->GetContactPoint() == ContactPointType::CONTACT_POINT_START && connection->GetConnectingRoad()->GetLink(LinkType::SUCCESSOR)->GetElementId() == road1_id) ||
-						 (connection->GetContactPoint() == ContactPointType::CONTACT_POINT_END && connection->GetConnectingRoad()->GetLink(LinkType::PREDECESSOR)->GetElementId() == road1_id)) )
+						JunctionRoadPassage passage;
+						passage.connecting_road_id = connecting_road->GetId();
+						passage.exit_road_id = exit_link->GetElementId();
 
-					{
-						if (connection->GetContactPoint() == CONTACT_POINT_START) // connecting road ends up connecting to road_1
+						// Assume connecting road has only one lane section
+						LaneSection *lane_section = connecting_road->GetLaneSectionByIdx(0);
+						if (lane_section == 0)
 						{
-							test_pos1.SetLanePos(road2_id, 0, road2->GetLength(), 0);
-							test_pos2.SetLanePos(road2_id, 0, 0, 0);
-
-							if (connection->GetConnectingRoad()->GetLink(LinkType::SUCCESSOR)->GetContactPointType() == CONTACT_POINT_START)  // connecting to start of road_1
-							{
-								heading1 = test_pos2.GetH();
-								heading2 = test_pos1.GetH();
-							}
-							else if (connection->GetConnectingRoad()->GetLink(LinkType::SUCCESSOR)->GetContactPointType() == CONTACT_POINT_END)  // connecting to end of road_1
-							{
-								heading1 = test_pos2.GetH() + M_PI;
-								heading2 = test_pos1.GetH() + M_PI;
-							}
-							else
+							LOG("Error lane section == 0\n");
+						}
+						else if (contact_point == CONTACT_POINT_START || contact_point == CONTACT_POINT_END)
+						{
+							for (int k = 0; k < lane_section->GetNumberOfLanes(); k++)
 							{
-								LOG("Unexpected contact point %d", connection->GetConnectingRoad()->GetLink(LinkType::PREDECESSOR)->GetContactPointType());
-								return 0;
+								Lane *lane = lane_section->GetLaneByIdx(k);
+								LaneLink *lane_link_predecessor = lane->GetLink(PREDECESSOR);
+								LaneLink *lane_link_successor = lane->GetLink(SUCCESSOR);
+								if (lane_link_predecessor == 0 || lane_link_successor == 0)
+								{
+									continue;
+								}
+
+								JunctionLanePassage lane_passage;
+								lane_passage.connecting_lane_id = lane->GetId();
+								if (contact_point == CONTACT_POINT_START)
+								{
+									lane_passage.from_lane_id = lane_link_predecessor->GetId();
+									lane_passage.to_lane_id = lane_link_successor->GetId();
+								}
+								else
+								{
+									lane_passage.from_lane_id = lane_link_successor->GetId();
+									lane_passage.to_lane_id = lane_link_predecessor->GetId();
+								}
+								passage.lane_passage.push_back(lane_passage);
 							}
 						}
-						else if (connection->GetContactPoint() == CONTACT_POINT_END) // connecting road start point connecting to road_1 
+						connectivity.junction_passage[i].push_back(passage);
+					}
+					// then check other case where road1 is outgoing from connecting road (connecting road is a road within junction)
+					else
+					{
+						// Find the link from the connecting road out of the junction
+						RoadLink *exit_link = 0;
+						if (contact_point == CONTACT_POINT_START)
+						{
+							exit_link = connecting_road->GetLink(LinkType::SUCCESSOR);
+						}
+						else if (contact_point == CONTACT_POINT_END)
 						{
-							test_pos1.SetLanePos(road2_id, 0, 0, 0);
-							test_pos2.SetLanePos(road2_id, 0, road2->GetLength(), 0);
+							exit_link = connecting_road->GetLink(LinkType::PREDECESSOR);
+						}
 
-							if (connection->GetConnectingRoad()->GetLink(LinkType::PREDECESSOR)->GetContactPointType() == CONTACT_POINT_START)  // connecting to start of road_1
-							{
-								heading1 = test_pos2.GetH() + M_PI;
-								heading2 = test_pos1.GetH() + M_PI;
-							}
-							else if (connection->GetConnectingRoad()->GetLink(LinkType::PREDECESSOR)->GetContactPointType() == CONTACT_POINT_END)  // connecting to end of road_1
-							{
-								heading1 = test_pos2.GetH();
-								heading2 = test_pos1.GetH();
-							}
-							else
-							{
-								LOG("Unexpected contact point %d", connection->GetConnectingRoad()->GetLink(LinkType::PREDECESSOR)->GetContactPointType());
-								return 0;
-							}
+						if (exit_link == 0 || exit_link->GetElementId() != road1->GetId())
+						{
+							continue;
+						}
+
+						if (exit_link->GetContactPointType() == CONTACT_POINT_START || exit_link->GetContactPointType() == CONTACT_POINT_END)
+						{
+							AddDirectConnection(connectivity, connecting_road->GetId(), direction, angle);
 						}
 						else
 						{
-							LOG("Unexpected contact point %d", connection->GetContactPoint());
-							return 0;
+							LOG("Unexpected contact point %d", exit_link->GetContactPointType());
+							AddDirectConnection(connectivity, connecting_road->GetId(), 0, 0);
 						}
+					}
+				}
+			}
+		}
+	}
+}
 
-						angle = GetAbsAngleDifference(heading1, heading2);
+int OpenDrive::EvaluateLanePositions(const LanePositionQuery *in, LanePositionResult *out, int n)
+{
+	int retval = 0;
 
-						return i == 0 ? 1 : -1;
-					}
+	// Sort queries by road and s, keeping the road index to avoid repeated lookups
+	std::vector<std::pair<int, int>> order(n);  // road index, query index
+	for (int i = 0; i < n; i++)
+	{
+		order[i] = std::make_pair(GetTrackIdxById(in[i].road_id), i);
+	}
+	std::sort(order.begin(), order.end(), [in](const std::pair<int, int> &a, const std::pair<int, int> &b)
+	{
+		return a.first < b.first || (a.first == b.first && in[a.second].s < in[b.second].s);
+	});
+
+	std::vector<double> ds;
+	std::vector<double> s_clamped;
+	size_t i = 0;
+	while (i < order.size())
+	{
+		int road_idx = order[i].first;
+		if (road_idx < 0)
+		{
+			out[order[i].second].status = -1;
+			retval = -1;
+			i++;
+			continue;
+		}
+
+		Road *road = road_[road_idx];
+		int geom_idx = 0;
+		int lane_section_idx = 0;
+		int elevation_idx = 0;
+
+		for (; i < order.size() && order[i].first == road_idx;)
+		{
+			// Collect all queries on current geometry
+			double s = CLAMP(in[order[i].second].s, 0.0, road->GetLength());
+			Geometry *geom = road->GetGeometry(geom_idx);
+			while (s > geom->GetS() + geom->GetLength() && geom_idx < road->GetNumberOfGeometries() - 1)
+			{
+				geom = road->GetGeometry(++geom_idx);
+			}
+
+			size_t first = i;
+			ds.clear();
+			s_clamped.clear();
+			for (; i < order.size() && order[i].first == road_idx; i++)
+			{
+				s = CLAMP(in[order[i].second].s, 0.0, road->GetLength());
+				if (s > geom->GetS() + geom->GetLength() && geom_idx < road->GetNumberOfGeometries() - 1)
+				{
+					break;
+				}
+				s_clamped.push_back(s);
+				ds.push_back(s - geom->GetS());
+			}
+
+			// Evaluate reference line, for lines the heading is constant so skip the virtual call
+			if (geom->GetType() == Geometry::GEOMETRY_TYPE_LINE)
+			{
+				double h = geom->GetHdg();
+				double cos_h = cos(h);
+				double sin_h = sin(h);
+				for (size_t j = 0; j < ds.size(); j++)
+				{
+					LanePositionResult &r = out[order[first + j].second];
+					r.x = geom->GetX() + ds[j] * cos_h;
+					r.y = geom->GetY() + ds[j] * sin_h;
+					r.h = h;
+				}
+			}
+			else
+			{
+				for (size_t j = 0; j < ds.size(); j++)
+				{
+					LanePositionResult &r = out[order[first + j].second];
+					geom->EvaluateDS(ds[j], &r.x, &r.y, &r.h);
+				}
+			}
+
+			// Then lateral offset and elevation
+			for (size_t j = 0; j < ds.size(); j++)
+			{
+				const LanePositionQuery &q = in[order[first + j].second];
+				LanePositionResult &r = out[order[first + j].second];
+				s = s_clamped[j];
+
+				LaneSection *lane_section = 0;
+				if (road->GetNumberOfLaneSections() > 0)
+				{
+					lane_section_idx = road->GetLaneSectionIdxByS(s, lane_section_idx);
+					lane_section = road->GetLaneSectionByIdx(lane_section_idx);
 				}
+				if (lane_section == 0 || lane_section->GetLaneIdxById(q.lane_id) == -1)
+				{
+					r.status = -1;
+					retval = -1;
+					continue;
+				}
+
+				double t = q.offset + lane_section->GetCenterOffset(s, q.lane_id) * (q.lane_id < 0 ? -1 : 1);
+				double h_offset = lane_section->GetCenterOffsetHeading(s, q.lane_id) * (q.lane_id < 0 ? -1 : 1);
+				double lane_offset = road->GetLaneOffset(s);
+
+				r.x += (t + lane_offset) * cos(r.h + M_PI_2);
+				r.y += (t + lane_offset) * sin(r.h + M_PI_2);
+				r.h = GetAngleInInterval2PI(r.h + atan(road->GetLaneOffsetPrim(s)) + h_offset);
+				r.p = 0.0;
+				road->GetZAndPitchByS(s, &r.z, &r.p, &elevation_idx);
+				r.status = 0;
 			}
 		}
 	}
 
+	return retval;
+}
+
+int OpenDrive::IsDirectlyConnected(int road1_id, int road2_id, double &angle)
+{
+	int road1_idx = GetTrackIdxById(road1_id);
+
+	if (road1_idx < 0 || road1_idx >= (int)connectivity_.size())
+	{
+		return 0;
+	}
+
+	std::vector<DirectRoadConnection> &direct = connectivity_[road1_idx].direct;
+	for (size_t i = 0; i < direct.size(); i++)
+	{
+		if (direct[i].road_id == road2_id)
+		{
+			if (direct[i].direction != 0)
+			{
+				angle = direct[i].angle;
+			}
+			return direct[i].direction;
+		}
+	}
+
 	return 0;
 }
 
 bool OpenDrive::IsIndirectlyConnected(int road1_id, int road2_id, int* &connecting_road_id, int* &connecting_lane_id, int lane1_id, int lane2_id)
 {
-	Road *road1 = GetRoadById(road1_id);
-	Road *road2 = GetRoadById(road2_id);
+	int road1_idx = GetTrackIdxById(road1_id);
 	RoadLink *link = 0;
 
 	LinkType link_type[2] = { SUCCESSOR , PREDECESSOR };
 
+	if (road1_idx < 0 || road1_idx >= (int)connectivity_.size())
+	{
+		return false;
+	}
+
+	Road *road1 = road_[road1_idx];
+	RoadConnectivity &connectivity = connectivity_[road1_idx];
+
 	// Try both ends
 	for (int k = 0; k < 2; k++)
 	{
@@ -3196,40 +4272,31 @@ bool OpenDrive::IsIndirectlyConnected(int road1_id, int road2_id, int* &connecti
 			continue;
 		}
 
-		LaneSection *lane_section = 0;
-
 		if (link->GetElementType() == RoadLink::ELEMENT_TYPE_ROAD)
 		{
-			if (link->GetElementId() == road2->GetId())
+			if (link->GetElementId() == road2_id)
 			{
 				if (lane1_id != 0 && lane2_id != 0)
 				{
 					// Check lane connected
+					LaneSection *lane_section = 0;
 					if (link_type[k] == SUCCESSOR)
 					{
 						lane_section = road1->GetLaneSectionByIdx(road1->GetNumberOfLaneSections() - 1);
 					}
-					else if (link_type[k] == PREDECESSOR)
-					{
-						lane_section = road1->GetLaneSectionByIdx(0);
-					}
 					else
 					{
-						LOG("Error LinkType %d not suppoered\n", link_type[k]);
-						return false;
+						lane_section = road1->GetLaneSectionByIdx(0);
 					}
 					if (lane_section == 0)
 					{
 						LOG("Error lane section == 0\n");
 						return false;
 					}
-					Lane *lane = lane_section->GetLaneById(lane1_id);
-					(void)lane;
 					if (!(lane_section->GetConnectingLaneId(lane1_id, link_type[k]) == lane2_id))
 					{
 						return false;
 					}
-					// Now, check other end lane connectivitiy
 				}
 				return true;
 			}
@@ -3237,66 +4304,30 @@ bool OpenDrive::IsIndirectlyConnected(int road1_id, int road2_id, int* &connecti
 		// check whether the roads are connected via a junction connecting road and specified lane
 		else if (link->GetElementType() == RoadLink::ELEMENT_TYPE_JUNCTION)
 		{
-			Junction *junction = GetJunctionById(link->GetElementId());
+			std::vector<JunctionRoadPassage> &passage = connectivity.junction_passage[k];
 
-			for (int i = 0; i < junction->GetNumberOfConnections(); i++)
+			for (size_t i = 0; i < passage.size(); i++)
 			{
-				Connection *connection = junction->GetConnectionByIdx(i);
-
-				if (connection->GetIncomingRoad()->GetId() == road1_id)
+				if (passage[i].exit_road_id != road2_id)
 				{
-					// Found a connecting road - now check if it connects to second road
-					Road *connecting_road = connection->GetConnectingRoad();
-					RoadLink *exit_link = 0;
-
-					if (connection->GetContactPoint() == ContactPointType::CONTACT_POINT_START)
-					{
-						exit_link = connecting_road->GetLink(SUCCESSOR);
-					}
-					else
-					{
-						exit_link = connecting_road->GetLink(PREDECESSOR);
-					}
+					continue;
+				}
 
-					if (exit_link->GetElementId() == road2_id)
+				for (size_t j = 0; j < passage[i].lane_passage.size(); j++)
+				{
+					JunctionLanePassage &lane_passage = passage[i].lane_passage[j];
+					if (lane_passage.from_lane_id == lane1_id && lane_passage.to_lane_id == lane2_id)
 					{
-						// Finally check that lanes are connected through the junction
-						// Look at lane section and locate lane connecting both roads
-						// Assume connecting road has only one lane section 
-						lane_section = connecting_road->GetLaneSectionByIdx(0);
-						if (lane_section == 0)
+						// Found link
+						if (connecting_road_id != 0)
 						{
-							LOG("Error lane section == 0\n");
-							return false;
+							*connecting_road_id = passage[i].connecting_road_id;
 						}
-						for (int j = 0; j < lane_section->GetNumberOfLanes(); j++)
+						if (connecting_lane_id != 0)
 						{
-							Lane *lane = lane_section->GetLaneByIdx(j);
-							LaneLink *lane_link_predecessor = lane->GetLink(PREDECESSOR);
-							LaneLink *lane_link_successor = lane->GetLink(SUCCESSOR);
-							if (lane_link_predecessor == 0 || lane_link_successor == 0)
-							{
-								continue;
-							}
-							if ((connection->GetContactPoint() == ContactPointType::CONTACT_POINT_START &&
-								 lane_link_predecessor->GetId() == lane1_id && 
-								 lane_link_successor->GetId() == lane2_id) ||
-								(connection->GetContactPoint() == ContactPointType::CONTACT_POINT_END &&
-								 lane_link_predecessor->GetId() == lane2_id &&
-								 lane_link_successor->GetId() == lane1_id))
-							{
-								// Found link
-								if (connecting_road_id != 0)
-								{
-									*connecting_road_id = connection->GetConnectingRoad()->GetId();
-								}
-								if (connecting_lane_id != 0)
-								{
-									*connecting_lane_id = lane->GetId();
-								}
-								return true;
-							}
+							*connecting_lane_id = lane_passage.connecting_lane_id;
 						}
+						return true;
 					}
 				}
 			}
@@ -3520,49 +4551,176 @@ void Position::Init()
 	trajectory_ = 0;
 }
 
-Position::Position()
+Position::Position()
+{
+	Init();
+}
+
+Position::Position(int track_id, double s, double t)
+{
+	Init();
+	SetTrackPos(track_id, s, t);
+}
+
+Position::Position(int track_id, int lane_id, double s, double offset)
+{
+	Init();
+	SetLanePos(track_id, lane_id, s, offset);
+}
+
+Position::Position(double x, double y, double z, double h, double p, double r)
+{
+	Init();
+	SetInertiaPos(x, y, z, h, p, r);
+}
+
+Position::Position(double x, double y, double z, double h, double p, double r, bool calculateTrackPosition)
+{
+	Init();
+	SetInertiaPos(x, y, z, h, p, r, calculateTrackPosition);
+}
+
+Position::~Position()
+{
+	
+}
+
+bool Position::LoadOpenDrive(const char *filename)
+{
+	if (OpenDriveContext::GetActive())
+	{
+		return OpenDriveContext::GetActive()->LoadOpenDrive(filename);
+	}
+
+	return(GetOpenDrive()->LoadOpenDriveFile(filename));
+}
+
+OpenDrive* Position::GetOpenDrive()
+{
+	static OpenDrive od;
+
+	if (loading_odr)
+	{
+		return loading_odr;
+	}
+
+	if (OpenDriveContext::GetActive())
+	{
+		return OpenDriveContext::GetActive()->GetOpenDrive();
+	}
+
+	return &od; 
+}
+
+// Road networks loaded via contexts, shared by filename. Loading is serialized since it uses global counters.
+typedef struct
 {
-	Init();
-}
+	OpenDrive *odr;
+	int n_users;
+} SharedOpenDrive;
 
-Position::Position(int track_id, double s, double t)
+static std::map<std::string, SharedOpenDrive> shared_odr;
+static SE_Mutex shared_odr_mutex;
+static thread_local OpenDriveContext *active_context = 0;
+
+OpenDriveContext::~OpenDriveContext()
 {
-	Init();
-	SetTrackPos(track_id, s, t);
+	Release();
+
+	if (active_context == this)
+	{
+		active_context = 0;
+	}
 }
 
-Position::Position(int track_id, int lane_id, double s, double offset)
+OpenDriveContext *OpenDriveContext::Activate()
 {
-	Init();
-	SetLanePos(track_id, lane_id, s, offset);
+	OpenDriveContext *previous = active_context;
+	active_context = this;
+
+	return previous;
 }
 
-Position::Position(double x, double y, double z, double h, double p, double r)
+void OpenDriveContext::Restore(OpenDriveContext *context)
 {
-	Init();
-	SetInertiaPos(x, y, z, h, p, r);
+	active_context = context;
 }
 
-Position::Position(double x, double y, double z, double h, double p, double r, bool calculateTrackPosition)
+OpenDriveContext *OpenDriveContext::GetActive()
 {
-	Init();
-	SetInertiaPos(x, y, z, h, p, r, calculateTrackPosition);
+	return active_context;
 }
 
-Position::~Position()
+bool OpenDriveContext::LoadOpenDrive(const char *filename)
 {
-	
+	std::string name = filename;
+
+	if (odr_ && name == filename_)
+	{
+		return true;
+	}
+
+	shared_odr_mutex.Lock();
+
+	std::map<std::string, SharedOpenDrive>::iterator it = shared_odr.find(name);
+	if (it == shared_odr.end())
+	{
+		SharedOpenDrive shared;
+		shared.odr = new OpenDrive;
+		shared.n_users = 0;
+
+		// apply any settings made before loading, see GetOpenDrive()
+		shared.odr->SetCacheDir(GetOpenDrive()->GetCacheDir());
+		shared.odr->SetOSIPointsThreads(GetOpenDrive()->GetOSIPointsThreads());
+
+		if (!shared.odr->LoadOpenDriveFile(filename))
+		{
+			delete shared.odr;
+			shared_odr_mutex.Unlock();
+			return false;
+		}
+		it = shared_odr.insert(std::make_pair(name, shared)).first;
+	}
+	it->second.n_users++;
+
+	shared_odr_mutex.Unlock();
+
+	Release();
+	odr_ = it->second.odr;
+	filename_ = name;
+
+	return true;
 }
 
-bool Position::LoadOpenDrive(const char *filename)
+void OpenDriveContext::Release()
 {
-	return(GetOpenDrive()->LoadOpenDriveFile(filename));
+	if (odr_ == 0)
+	{
+		return;
+	}
+
+	shared_odr_mutex.Lock();
+
+	std::map<std::string, SharedOpenDrive>::iterator it = shared_odr.find(filename_);
+	if (it != shared_odr.end() && --it->second.n_users == 0)
+	{
+		delete it->second.odr;
+		shared_odr.erase(it);
+	}
+
+	shared_odr_mutex.Unlock();
+
+	odr_ = 0;
+	filename_.clear();
 }
 
-OpenDrive* Position::GetOpenDrive()
+int OpenDriveContext::GetNumberOfSharedOpenDrives()
 {
-	static OpenDrive od;
-	return &od; 
+	shared_odr_mutex.Lock();
+	int n = (int)shared_odr.size();
+	shared_odr_mutex.Unlock();
+
+	return n;
 }
 
 bool OpenDrive::CheckLaneOSIRequirement(std::vector<double> x0, std::vector<double> y0, std::vector<double> x1, std::vector<double> y1)
@@ -3618,10 +4776,17 @@ bool OpenDrive::CheckLaneOSIRequirement(std::vector<double> x0, std::vector<doub
 }
 
 void OpenDrive::SetLaneOSIPoints()
+{
+	for (size_t i = 0; i < road_.size(); i++)
+	{
+		SetLaneOSIPoints(road_[i]);
+	}
+}
+
+void OpenDrive::SetLaneOSIPoints(Road *road, bool reference_lane_only)
 {
 	// Initialization
-	Position* pos = new roadmanager::Position();
-	Road *road;
+	Position pos;
 	LaneSection *lsec;
 	Lane *lane;
 	int number_of_lane_sections, number_of_lanes, counter;
@@ -3630,82 +4795,320 @@ void OpenDrive::SetLaneOSIPoints()
 	double s0, s1, s1_prev;
 	bool osi_requirement;
 
-	// Looping through each road 
-	for (int i=0; i<road_.size(); i++)
+	// Looping through each lane section
+	number_of_lane_sections = road->GetNumberOfLaneSections();
+	for (int j=0; j<number_of_lane_sections; j++)
 	{
-		road = road_[i];
+		// Get the ending position of the current lane section
+		lsec = road->GetLaneSectionByIdx(j);
+		if (j == number_of_lane_sections-1)
+		{
+			lsec_end = road->GetLength();	
+		}
+		else
+		{
+			lsec_end = road->GetLaneSectionByIdx(j+1)->GetS();
+		}
+		
+		// Starting points of the each lane section for OSI calculations
+		s0 = lsec->GetS();
+		s1 = s0+OSI_POINT_CALC_STEPSIZE;
+		s1_prev = s0;
 
-		// Looping through each lane section
-		number_of_lane_sections = road_[i]->GetNumberOfLaneSections();
-		for (int j=0; j<number_of_lane_sections; j++)
+		// Looping through each lane
+		number_of_lanes = lsec->GetNumberOfLanes();
+		for (int k=0; k<number_of_lanes; k++)
 		{
-			// Get the ending position of the current lane section
-			lsec = road->GetLaneSectionByIdx(j);
-			if (j == number_of_lane_sections-1)
+			lane = lsec->GetLaneByIdx(k);
+			if ((reference_lane_only && lane->GetId() != 0) || lane->GetOSIPoints()->GetNumOfOSIPoints() > 0)
 			{
-				lsec_end = road->GetLength();	
+				continue;
 			}
-			else
+			// Start from a fresh position object, so that the result does not depend on which lanes were processed before
+			pos = Position();
+			counter = 0;
+			x0.clear();  // remove any points left from the last iteration of previous lane
+			y0.clear();
+			x1.clear();
+			y1.clear();
+
+			// Looping through sequential points along the track determined by "OSI_POINT_CALC_STEPSIZE"
+			while(true)
 			{
-				lsec_end = road->GetLaneSectionByIdx(j+1)->GetS();
+				counter++;
+
+				// [XO, YO] = closest position with given (-) tolerance
+				pos.SetLanePos(road->GetId(), lane->GetId(), s0-OSI_TANGENT_LINE_TOLERANCE, 0, j);
+				x0.push_back(pos.GetX());
+				y0.push_back(pos.GetY());
+
+				// [XO, YO] = Real position with no tolerance
+				pos.SetLanePos(road->GetId(), lane->GetId(), s0, 0, j);
+				x0.push_back(pos.GetX());
+				y0.push_back(pos.GetY());
+
+				// Add the starting point of each lane as osi point
+				if (counter == 1)
+				{
+					osi_s.push_back(s0);
+					osi_x.push_back(pos.GetX());
+					osi_y.push_back(pos.GetY());
+					osi_z.push_back(pos.GetZ());
+					osi_h.push_back(pos.GetHRoad());
+				}
+
+				// [XO, YO] = closest position with given (+) tolerance
+				pos.SetLanePos(road->GetId(), lane->GetId(), s0+OSI_TANGENT_LINE_TOLERANCE, 0, j);
+				x0.push_back(pos.GetX());
+				y0.push_back(pos.GetY());
+
+				// [X1, Y1] = closest position with given (-) tolerance																																																																																																												
+				pos.SetLanePos(road->GetId(), lane->GetId(), s1-OSI_TANGENT_LINE_TOLERANCE, 0, j);
+				x1.push_back(pos.GetX());																																	
+				y1.push_back(pos.GetY());
+
+				// [X1, Y1] = Real position with no tolerance																																																								
+				pos.SetLanePos(road->GetId(), lane->GetId(), s1, 0, j);
+				x1.push_back(pos.GetX());
+				y1.push_back(pos.GetY());
+
+				// [X1, Y1] = closest position with given (+) tolerance
+				pos.SetLanePos(road->GetId(), lane->GetId(), s1+OSI_TANGENT_LINE_TOLERANCE, 0, j);
+				x1.push_back(pos.GetX());
+				y1.push_back(pos.GetY());
+
+				// Check OSI Requirement between current given points
+				if (x1[1]-x0[1] != 0 && y1[1]-y0[1] != 0)
+				{
+					osi_requirement = CheckLaneOSIRequirement(x0, y0, x1, y1);
+				}
+				else
+				{
+					osi_requirement = true;
+				}
+				
+				// If requirement is satisfied -> look further points
+				// If requirement is not satisfied:
+					// Assign last unique satisfied point as OSI point
+					// Continue searching from the last satisfied point
+				if (osi_requirement)
+				{
+					s1_prev = s1;
+					s1 = s1 + OSI_POINT_CALC_STEPSIZE;
+
+				}
+				else 
+				{
+					if (s1 - s0 < OSI_POINT_CALC_STEPSIZE + SMALL_NUMBER)
+					{
+						// Back to last point and try smaller step forward
+						s1_prev = s1;
+						s1 = s0 + (s1 - s0) * 0.5;
+					}
+					else
+					{
+						s0 = s1_prev;
+						s1_prev = s1;
+						s1 = s0 + OSI_POINT_CALC_STEPSIZE;
+
+						if (counter != 1)
+						{
+							pos.SetLanePos(road->GetId(), lane->GetId(), s0, 0, j);
+							osi_s.push_back(s0);
+							osi_x.push_back(pos.GetX());
+							osi_y.push_back(pos.GetY());
+							osi_z.push_back(pos.GetZ());
+							osi_h.push_back(pos.GetHRoad());
+						}
+					}
+				}
+
+				// If the end of the lane reached, assign end of the lane as final OSI point for current lane
+				if (s1 + OSI_TANGENT_LINE_TOLERANCE >= lsec_end)
+				{
+					pos.SetLanePos(road->GetId(), lane->GetId(), lsec_end, 0, j);
+					osi_s.push_back(lsec_end);
+					osi_x.push_back(pos.GetX());
+					osi_y.push_back(pos.GetY());
+					osi_z.push_back(pos.GetZ());
+					osi_h.push_back(pos.GetHRoad());
+					break;
+				}
+
+				// Clear x-y collectors for next iteration
+				x0.clear();
+				y0.clear();
+				x1.clear();
+				y1.clear();
 			}
-			
-			// Starting points of the each lane section for OSI calculations
+
+			// Set all collected osi points for the current lane
+			lane->osi_points_.Set(osi_s, osi_x, osi_y, osi_z, osi_h);
+
+			// Clear osi collectors for next iteration
+			osi_s.clear();
+			osi_x.clear();
+			osi_y.clear();
+			osi_z.clear();
+			osi_h.clear();
+
+			// Re-assign the starting point of the next lane as the start point of the current lane section for OSI calculations
 			s0 = lsec->GetS();
 			s1 = s0+OSI_POINT_CALC_STEPSIZE;
 			s1_prev = s0;
+		}
+	}
+}
+
+void OpenDrive::SetLaneBoundaryPoints()
+{
+	for (size_t i = 0; i < road_.size(); i++)
+	{
+		CreateLaneBoundaries(road_[i]);
+		SetLaneBoundaryPoints(road_[i]);
+	}
+}
+
+void OpenDrive::SetLaneBoundaryIdBases()
+{
+	// Prefix sum of number of lane boundaries, in road order
+	for (size_t i = 0; i < road_.size(); i++)
+	{
+		if (road_[i]->GetLaneBoundaryIdBase() >= 0)
+		{
+			continue;
+		}
+
+		road_[i]->SetLaneBoundaryIdBase(g_Laneb_id);
+		for (int j = 0; j < road_[i]->GetNumberOfLaneSections(); j++)
+		{
+			LaneSection *lsec = road_[i]->GetLaneSectionByIdx(j);
+			for (int k = 0; k < lsec->GetNumberOfLanes(); k++)
+			{
+				if (lsec->GetLaneByIdx(k)->GetNumberOfRoadMarks() == 0)
+				{
+					g_Laneb_id++;
+				}
+			}
+		}
+	}
+}
+
+void OpenDrive::CreateLaneBoundaries(Road *road)
+{
+	if (road->GetLaneBoundaryIdBase() < 0)
+	{
+		SetLaneBoundaryIdBases();
+	}
 
-			// Looping through each lane
-			number_of_lanes = lsec->GetNumberOfLanes();
-			for (int k=0; k<number_of_lanes; k++)
+	int global_id = road->GetLaneBoundaryIdBase();
+	for (int j = 0; j < road->GetNumberOfLaneSections(); j++)
+	{
+		LaneSection *lsec = road->GetLaneSectionByIdx(j);
+		for (int k = 0; k < lsec->GetNumberOfLanes(); k++)
+		{
+			Lane *lane = lsec->GetLaneByIdx(k);
+			if (lane->GetNumberOfRoadMarks() == 0)
 			{
-				lane = lsec->GetLaneByIdx(k);
-				counter = 0;
+				if (lane->GetLaneBoundary() == 0)
+				{
+					lane->SetLaneBoundary(new LaneBoundaryOSI(global_id));
+				}
+				global_id++;
+			}
+		}
+	}
+}
+
+void OpenDrive::SetLaneBoundaryPoints(Road *road)
+{
+	// Initialization
+	Position pos;
+	LaneSection *lsec;
+	Lane *lane;
+	int number_of_lane_sections, number_of_lanes, counter;
+	double lsec_end;
+	std::vector<double> x0, y0, x1, y1, osi_s, osi_x, osi_y, osi_z, osi_h;
+	double s0, s1, s1_prev;
+	bool osi_requirement; 
 
+	// Looping through each lane section
+	number_of_lane_sections = road->GetNumberOfLaneSections();
+	for (int j=0; j<number_of_lane_sections; j++)
+	{
+		// Get the ending position of the current lane section
+		lsec = road->GetLaneSectionByIdx(j);
+		if (j == number_of_lane_sections-1)
+		{
+			lsec_end = road->GetLength();	
+		}
+		else
+		{
+			lsec_end = road->GetLaneSectionByIdx(j+1)->GetS();
+		}
+		
+		// Starting points of the each lane section for OSI calculations
+		s0 = lsec->GetS();
+		s1 = s0+OSI_POINT_CALC_STEPSIZE;
+		s1_prev = s0;
+
+		// Looping through each lane
+		number_of_lanes = lsec->GetNumberOfLanes();
+		for (int k=0; k<number_of_lanes; k++)
+		{
+			lane = lsec->GetLaneByIdx(k);
+			counter = 0;
+			x0.clear();  // remove any points left from the last iteration of previous lane
+			y0.clear();
+			x1.clear();
+			y1.clear();
+
+			if (lane->GetLaneBoundary() != 0 && lane->GetLaneBoundary()->osi_points_.GetNumOfOSIPoints() == 0)
+			{
 				// Looping through sequential points along the track determined by "OSI_POINT_CALC_STEPSIZE"
 				while(true)
 				{
 					counter++;
 
 					// [XO, YO] = closest position with given (-) tolerance
-					pos->SetLanePos(road->GetId(), lane->GetId(), s0-OSI_TANGENT_LINE_TOLERANCE, 0, j);
-					x0.push_back(pos->GetX());
-					y0.push_back(pos->GetY());
+					pos.SetLaneBoundaryPos(road->GetId(), lane->GetId(), s0-OSI_TANGENT_LINE_TOLERANCE, 0, j);
+					x0.push_back(pos.GetX());
+					y0.push_back(pos.GetY());
 
 					// [XO, YO] = Real position with no tolerance
-					pos->SetLanePos(road->GetId(), lane->GetId(), s0, 0, j);
-					x0.push_back(pos->GetX());
-					y0.push_back(pos->GetY());
+					pos.SetLaneBoundaryPos(road->GetId(), lane->GetId(), s0, 0, j);
+					x0.push_back(pos.GetX());
+					y0.push_back(pos.GetY());
 
 					// Add the starting point of each lane as osi point
 					if (counter == 1)
 					{
 						osi_s.push_back(s0);
-						osi_x.push_back(pos->GetX());
-						osi_y.push_back(pos->GetY());
-						osi_z.push_back(pos->GetZ());
-						osi_h.push_back(pos->GetHRoad());
+						osi_x.push_back(pos.GetX());
+						osi_y.push_back(pos.GetY());
+						osi_z.push_back(pos.GetZ());
+						osi_h.push_back(pos.GetH());
 					}
 
 					// [XO, YO] = closest position with given (+) tolerance
-					pos->SetLanePos(road->GetId(), lane->GetId(), s0+OSI_TANGENT_LINE_TOLERANCE, 0, j);
-					x0.push_back(pos->GetX());
-					y0.push_back(pos->GetY());
+					pos.SetLaneBoundaryPos(road->GetId(), lane->GetId(), s0+OSI_TANGENT_LINE_TOLERANCE, 0, j);
+					x0.push_back(pos.GetX());
+					y0.push_back(pos.GetY());
 
 					// [X1, Y1] = closest position with given (-) tolerance																																																																																																												
-					pos->SetLanePos(road->GetId(), lane->GetId(), s1-OSI_TANGENT_LINE_TOLERANCE, 0, j);
-					x1.push_back(pos->GetX());																																	
-					y1.push_back(pos->GetY());
+					pos.SetLaneBoundaryPos(road->GetId(), lane->GetId(), s1-OSI_TANGENT_LINE_TOLERANCE, 0, j);
+					x1.push_back(pos.GetX());																																	
+					y1.push_back(pos.GetY());
 
 					// [X1, Y1] = Real position with no tolerance																																																								
-					pos->SetLanePos(road->GetId(), lane->GetId(), s1, 0, j);
-					x1.push_back(pos->GetX());
-					y1.push_back(pos->GetY());
+					pos.SetLaneBoundaryPos(road->GetId(), lane->GetId(), s1, 0, j);
+					x1.push_back(pos.GetX());
+					y1.push_back(pos.GetY());
 
 					// [X1, Y1] = closest position with given (+) tolerance
-					pos->SetLanePos(road->GetId(), lane->GetId(), s1+OSI_TANGENT_LINE_TOLERANCE, 0, j);
-					x1.push_back(pos->GetX());
-					y1.push_back(pos->GetY());
+					pos.SetLaneBoundaryPos(road->GetId(), lane->GetId(), s1+OSI_TANGENT_LINE_TOLERANCE, 0, j);
+					x1.push_back(pos.GetX());
+					y1.push_back(pos.GetY());
 
 					// Check OSI Requirement between current given points
 					if (x1[1]-x0[1] != 0 && y1[1]-y0[1] != 0)
@@ -3719,7 +5122,7 @@ void OpenDrive::SetLaneOSIPoints()
 					
 					// If requirement is satisfied -> look further points
 					// If requirement is not satisfied:
-						// Assign last unique satisfied point as OSI point
+						// Assign last satisfied point as OSI point
 						// Continue searching from the last satisfied point
 					if (osi_requirement)
 					{
@@ -3727,41 +5130,32 @@ void OpenDrive::SetLaneOSIPoints()
 						s1 = s1 + OSI_POINT_CALC_STEPSIZE;
 
 					}
-					else 
+					else
 					{
-						if (s1 - s0 < OSI_POINT_CALC_STEPSIZE + SMALL_NUMBER)
-						{
-							// Back to last point and try smaller step forward
-							s1_prev = s1;
-							s1 = s0 + (s1 - s0) * 0.5;
-						}
-						else
-						{
-							s0 = s1_prev;
-							s1_prev = s1;
-							s1 = s0 + OSI_POINT_CALC_STEPSIZE;
+						s0 = s1_prev;
+						s1_prev = s1;
+						s1 = s0 + OSI_POINT_CALC_STEPSIZE;
 
-							if (counter != 1)
-							{
-								pos->SetLanePos(road->GetId(), lane->GetId(), s0, 0, j);
-								osi_s.push_back(s0);
-								osi_x.push_back(pos->GetX());
-								osi_y.push_back(pos->GetY());
-								osi_z.push_back(pos->GetZ());
-								osi_h.push_back(pos->GetHRoad());
-							}
+						if (counter != 1)
+						{
+							pos.SetLaneBoundaryPos(road->GetId(), lane->GetId(), s0, 0, j);
+							osi_s.push_back(s0);
+							osi_x.push_back(pos.GetX());
+							osi_y.push_back(pos.GetY());
+							osi_z.push_back(pos.GetZ());
+							osi_h.push_back(pos.GetH());
 						}
 					}
 
 					// If the end of the lane reached, assign end of the lane as final OSI point for current lane
 					if (s1 + OSI_TANGENT_LINE_TOLERANCE >= lsec_end)
 					{
-						pos->SetLanePos(road->GetId(), lane->GetId(), lsec_end, 0, j);
+						pos.SetLaneBoundaryPos(road->GetId(), lane->GetId(), lsec_end, 0, j);
 						osi_s.push_back(lsec_end);
-						osi_x.push_back(pos->GetX());
-						osi_y.push_back(pos->GetY());
-						osi_z.push_back(pos->GetZ());
-						osi_h.push_back(pos->GetHRoad());
+						osi_x.push_back(pos.GetX());
+						osi_y.push_back(pos.GetY());
+						osi_z.push_back(pos.GetZ());
+						osi_h.push_back(pos.GetH());
 						break;
 					}
 
@@ -3771,10 +5165,8 @@ void OpenDrive::SetLaneOSIPoints()
 					x1.clear();
 					y1.clear();
 				}
-
-				// Set all collected osi points for the current lane
-				lane->osi_points_.Set(osi_s, osi_x, osi_y, osi_z, osi_h);
-
+				//Fills up the osi points in the lane boundary class, created by CreateLaneBoundaries
+				lane->GetLaneBoundary()->osi_points_.Set(osi_s, osi_x, osi_y, osi_z, osi_h);
 				// Clear osi collectors for next iteration
 				osi_s.clear();
 				osi_x.clear();
@@ -3791,182 +5183,18 @@ void OpenDrive::SetLaneOSIPoints()
 	}
 }
 
-void OpenDrive::SetLaneBoundaryPoints()
+void OpenDrive::SetRoadMarkOSIPoints()
 {
-	// Initialization
-	Position* pos = new roadmanager::Position();
-	Road *road;
-	LaneSection *lsec;
-	Lane *lane;
-	int number_of_lane_sections, number_of_lanes, counter;
-	double lsec_end;
-	std::vector<double> x0, y0, x1, y1, osi_s, osi_x, osi_y, osi_z, osi_h;
-	double s0, s1, s1_prev;
-	bool osi_requirement; 
-
-	// Looping through each road 
-	for (int i=0; i<road_.size(); i++)
+	for (size_t i = 0; i < road_.size(); i++)
 	{
-		road = road_[i];
-
-		// Looping through each lane section
-		number_of_lane_sections = road_[i]->GetNumberOfLaneSections();
-		for (int j=0; j<number_of_lane_sections; j++)
-		{
-			// Get the ending position of the current lane section
-			lsec = road->GetLaneSectionByIdx(j);
-			if (j == number_of_lane_sections-1)
-			{
-				lsec_end = road->GetLength();	
-			}
-			else
-			{
-				lsec_end = road->GetLaneSectionByIdx(j+1)->GetS();
-			}
-			
-			// Starting points of the each lane section for OSI calculations
-			s0 = lsec->GetS();
-			s1 = s0+OSI_POINT_CALC_STEPSIZE;
-			s1_prev = s0;
-
-			// Looping through each lane
-			number_of_lanes = lsec->GetNumberOfLanes();
-			for (int k=0; k<number_of_lanes; k++)
-			{
-				lane = lsec->GetLaneByIdx(k);
-				counter = 0;
-
-				int n_roadmarks = lane->GetNumberOfRoadMarks(); 
-				if (n_roadmarks == 0)
-				{
-					// Looping through sequential points along the track determined by "OSI_POINT_CALC_STEPSIZE"
-					while(true)
-					{
-						counter++;
-
-						// [XO, YO] = closest position with given (-) tolerance
-						pos->SetLaneBoundaryPos(road->GetId(), lane->GetId(), s0-OSI_TANGENT_LINE_TOLERANCE, 0, j);
-						x0.push_back(pos->GetX());
-						y0.push_back(pos->GetY());
-
-						// [XO, YO] = Real position with no tolerance
-						pos->SetLaneBoundaryPos(road->GetId(), lane->GetId(), s0, 0, j);
-						x0.push_back(pos->GetX());
-						y0.push_back(pos->GetY());
-
-						// Add the starting point of each lane as osi point
-						if (counter == 1)
-						{
-							osi_s.push_back(s0);
-							osi_x.push_back(pos->GetX());
-							osi_y.push_back(pos->GetY());
-							osi_z.push_back(pos->GetZ());
-							osi_h.push_back(pos->GetH());
-						}
-
-						// [XO, YO] = closest position with given (+) tolerance
-						pos->SetLaneBoundaryPos(road->GetId(), lane->GetId(), s0+OSI_TANGENT_LINE_TOLERANCE, 0, j);
-						x0.push_back(pos->GetX());
-						y0.push_back(pos->GetY());
-
-						// [X1, Y1] = closest position with given (-) tolerance																																																																																																												
-						pos->SetLaneBoundaryPos(road->GetId(), lane->GetId(), s1-OSI_TANGENT_LINE_TOLERANCE, 0, j);
-						x1.push_back(pos->GetX());																																	
-						y1.push_back(pos->GetY());
-
-						// [X1, Y1] = Real position with no tolerance																																																								
-						pos->SetLaneBoundaryPos(road->GetId(), lane->GetId(), s1, 0, j);
-						x1.push_back(pos->GetX());
-						y1.push_back(pos->GetY());
-
-						// [X1, Y1] = closest position with given (+) tolerance
-						pos->SetLaneBoundaryPos(road->GetId(), lane->GetId(), s1+OSI_TANGENT_LINE_TOLERANCE, 0, j);
-						x1.push_back(pos->GetX());
-						y1.push_back(pos->GetY());
-
-						// Check OSI Requirement between current given points
-						if (x1[1]-x0[1] != 0 && y1[1]-y0[1] != 0)
-						{
-							osi_requirement = CheckLaneOSIRequirement(x0, y0, x1, y1);
-						}
-						else
-						{
-							osi_requirement = true;
-						}
-						
-						// If requirement is satisfied -> look further points
-						// If requirement is not satisfied:
-							// Assign last satisfied point as OSI point
-							// Continue searching from the last satisfied point
-						if (osi_requirement)
-						{
-							s1_prev = s1;
-							s1 = s1 + OSI_POINT_CALC_STEPSIZE;
-
-						}
-						else
-						{
-							s0 = s1_prev;
-							s1_prev = s1;
-							s1 = s0 + OSI_POINT_CALC_STEPSIZE;
-
-							if (counter != 1)
-							{
-								pos->SetLaneBoundaryPos(road->GetId(), lane->GetId(), s0, 0, j);
-								osi_s.push_back(s0);
-								osi_x.push_back(pos->GetX());
-								osi_y.push_back(pos->GetY());
-								osi_z.push_back(pos->GetZ());
-								osi_h.push_back(pos->GetH());
-							}
-						}
-
-						// If the end of the lane reached, assign end of the lane as final OSI point for current lane
-						if (s1 + OSI_TANGENT_LINE_TOLERANCE >= lsec_end)
-						{
-							pos->SetLaneBoundaryPos(road->GetId(), lane->GetId(), lsec_end, 0, j);
-							osi_s.push_back(lsec_end);
-							osi_x.push_back(pos->GetX());
-							osi_y.push_back(pos->GetY());
-							osi_z.push_back(pos->GetZ());
-							osi_h.push_back(pos->GetH());
-							break;
-						}
-
-						// Clear x-y collectors for next iteration
-						x0.clear();
-						y0.clear();
-						x1.clear();
-						y1.clear();
-					}
-					// Initialization of LaneBoundary class
-					LaneBoundaryOSI * lb = new LaneBoundaryOSI((int)0); 
-					// add the lane boundary class to the lane class and generating the global id 
-					lane->SetLaneBoundary(lb); 
-					//Fills up the osi points in the lane boundary class 
-					lb->osi_points_.Set(osi_s, osi_x, osi_y, osi_z, osi_h);
-					// Clear osi collectors for next iteration
-					osi_s.clear();
-					osi_x.clear();
-					osi_y.clear();
-					osi_z.clear();
-					osi_h.clear();
-
-					// Re-assign the starting point of the next lane as the start point of the current lane section for OSI calculations
-					s0 = lsec->GetS();
-					s1 = s0+OSI_POINT_CALC_STEPSIZE;
-					s1_prev = s0;
-				}
-			}
-		}
-	} 
+		SetRoadMarkOSIPoints(road_[i]);
+	}
 }
 
-void OpenDrive::SetRoadMarkOSIPoints()
+void OpenDrive::SetRoadMarkOSIPoints(Road *road)
 {
-	// Initialization
-	Position* pos = new roadmanager::Position();
-	Road *road;
+	// Initialization
+	Position pos;
 	LaneSection *lsec;
 	Lane *lane;
 	LaneRoadMark *lane_roadMark;
@@ -3977,234 +5205,393 @@ void OpenDrive::SetRoadMarkOSIPoints()
 	std::vector<double> x0, x1, y0, y1, osi_s_rm, osi_x_rm, osi_y_rm, osi_z_rm, osi_h_rm;
 	bool osi_requirement;
 
-	// Looping through each road 
-	for (int i=0; i<road_.size(); i++)
+	// Looping through each lane section
+	number_of_lane_sections = road->GetNumberOfLaneSections();
+	for (int j=0; j<number_of_lane_sections; j++)
 	{
-		road = road_[i];
+		// Get the ending position of the current lane section
+		lsec = road->GetLaneSectionByIdx(j);
+		if (j == number_of_lane_sections-1)
+		{
+			lsec_end = road->GetLength();	
+		}
+		else
+		{
+			lsec_end = road->GetLaneSectionByIdx(j+1)->GetS();
+		}
 
-		// Looping through each lane section
-		number_of_lane_sections = road_[i]->GetNumberOfLaneSections();
-		for (int j=0; j<number_of_lane_sections; j++)
+		// Looping through each lane
+		number_of_lanes = lsec->GetNumberOfLanes();
+		for (int k=0; k<number_of_lanes; k++)
 		{
-			// Get the ending position of the current lane section
-			lsec = road->GetLaneSectionByIdx(j);
-			if (j == number_of_lane_sections-1)
-			{
-				lsec_end = road->GetLength();	
-			}
-			else
-			{
-				lsec_end = road->GetLaneSectionByIdx(j+1)->GetS();
-			}
+			lane = lsec->GetLaneByIdx(k);
 
-			// Looping through each lane
-			number_of_lanes = lsec->GetNumberOfLanes();
-			for (int k=0; k<number_of_lanes; k++)
+			// Looping through each roadMark within the lane
+			number_of_roadmarks = lane->GetNumberOfRoadMarks();
+			if (number_of_roadmarks != 0)
 			{
-				lane = lsec->GetLaneByIdx(k);
-
-				// Looping through each roadMark within the lane
-				number_of_roadmarks = lane->GetNumberOfRoadMarks();
-				if (number_of_roadmarks != 0)
+				
+				for (int m=0; m<number_of_roadmarks; m++)
 				{
+					lane_roadMark = lane->GetLaneRoadMarkByIdx(m);
+					s_roadmark = lsec->GetS() + lane_roadMark->GetSOffset();
+					if (m == number_of_roadmarks-1)
+					{
+						s_end_roadmark = lsec_end;
+					}
+					else
+					{
+						s_end_roadmark = lane->GetLaneRoadMarkByIdx(m+1)->GetSOffset();
+					}
 					
-					for (int m=0; m<number_of_roadmarks; m++)
+					// Check the existence of "type" keyword under roadmark
+					number_of_roadmarktypes = lane_roadMark->GetNumberOfRoadMarkTypes();
+					if (number_of_roadmarktypes != 0)
 					{
-						lane_roadMark = lane->GetLaneRoadMarkByIdx(m);
-						s_roadmark = lsec->GetS() + lane_roadMark->GetSOffset();
-						if (m == number_of_roadmarks-1)
-						{
-							s_end_roadmark = lsec_end;
-						}
-						else
-						{
-							s_end_roadmark = lane->GetLaneRoadMarkByIdx(m+1)->GetSOffset();
-						}
-						
-						// Check the existence of "type" keyword under roadmark
-						number_of_roadmarktypes = lane_roadMark->GetNumberOfRoadMarkTypes();
-						if (number_of_roadmarktypes != 0)
-						{
-							lane_roadMarkType = lane_roadMark->GetLaneRoadMarkTypeByIdx(0);
-							number_of_roadmarklines = lane_roadMarkType->GetNumberOfRoadMarkTypeLines();
+						lane_roadMarkType = lane_roadMark->GetLaneRoadMarkTypeByIdx(0);
+						number_of_roadmarklines = lane_roadMarkType->GetNumberOfRoadMarkTypeLines();
 
-							// Looping through each roadmarkline under roadmark
-							for (int n=0; n<number_of_roadmarklines; n++)
+						// Looping through each roadmarkline under roadmark
+						for (int n=0; n<number_of_roadmarklines; n++)
+						{
+							lane_roadMarkTypeLine = lane_roadMarkType->GetLaneRoadMarkTypeLineByIdx(n);
+							s_roadmarkline = s_roadmark + lane_roadMarkTypeLine->GetSOffset();
+							if (lane_roadMarkTypeLine != 0)
 							{
-								lane_roadMarkTypeLine = lane_roadMarkType->GetLaneRoadMarkTypeLineByIdx(n);
-								s_roadmarkline = s_roadmark + lane_roadMarkTypeLine->GetSOffset();
-								if (lane_roadMarkTypeLine != 0)
+								if (n == number_of_roadmarklines-1)
 								{
-									if (n == number_of_roadmarklines-1)
-									{
-										s_end_roadmarkline = s_end_roadmark;
-									}
-									else
-									{
-										s_end_roadmarkline = lane_roadMarkType->GetLaneRoadMarkTypeLineByIdx(n+1)->GetSOffset();
-									}
+									s_end_roadmarkline = s_end_roadmark;
+								}
+								else
+								{
+									s_end_roadmarkline = lane_roadMarkType->GetLaneRoadMarkTypeLineByIdx(n+1)->GetSOffset();
+								}
 
-									if (lane_roadMark->GetType() == LaneRoadMark::RoadMarkType::BROKEN)
-									{
+								if (lane_roadMark->GetType() == LaneRoadMark::RoadMarkType::BROKEN)
+								{
 
-										// Setting OSI points for each roadmarkline
-										while(true)
+									// Setting OSI points for each roadmarkline
+									while(true)
+									{
+										pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s_roadmarkline, 0, j);
+										osi_s_rm.push_back(s_roadmarkline);
+										osi_x_rm.push_back(pos.GetX());
+										osi_y_rm.push_back(pos.GetY());
+										osi_z_rm.push_back(pos.GetZ());
+										osi_h_rm.push_back(pos.GetH());
+
+										pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s_roadmarkline+lane_roadMarkTypeLine->GetLength(), 0, j);
+										osi_s_rm.push_back(s_roadmarkline+lane_roadMarkTypeLine->GetLength());
+										osi_x_rm.push_back(pos.GetX());
+										osi_y_rm.push_back(pos.GetY());
+										osi_z_rm.push_back(pos.GetZ());
+										osi_h_rm.push_back(pos.GetH());
+
+										s_roadmarkline += lane_roadMarkTypeLine->GetLength() + lane_roadMarkTypeLine->GetSpace();
+										if (s_roadmarkline < SMALL_NUMBER || s_roadmarkline >= s_end_roadmarkline)
 										{
-											pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s_roadmarkline, 0, j);
-											osi_s_rm.push_back(s_roadmarkline);
-											osi_x_rm.push_back(pos->GetX());
-											osi_y_rm.push_back(pos->GetY());
-											osi_z_rm.push_back(pos->GetZ());
-											osi_h_rm.push_back(pos->GetH());
-
-											pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s_roadmarkline+lane_roadMarkTypeLine->GetLength(), 0, j);
-											osi_s_rm.push_back(s_roadmarkline+lane_roadMarkTypeLine->GetLength());
-											osi_x_rm.push_back(pos->GetX());
-											osi_y_rm.push_back(pos->GetY());
-											osi_z_rm.push_back(pos->GetZ());
-											osi_h_rm.push_back(pos->GetH());
-
-											s_roadmarkline += lane_roadMarkTypeLine->GetLength() + lane_roadMarkTypeLine->GetSpace();
-											if (s_roadmarkline < SMALL_NUMBER || s_roadmarkline >= s_end_roadmarkline)
+											if (s_roadmarkline < SMALL_NUMBER)
 											{
-												if (s_roadmarkline < SMALL_NUMBER)
-												{
-													LOG("Roadmark length + space = 0 - ignoring");
-												}
-												break;
+												LOG("Roadmark length + space = 0 - ignoring");
 											}
+											break;
 										}
 									}
-									else if (lane_roadMark->GetType() == LaneRoadMark::RoadMarkType::SOLID)
+								}
+								else if (lane_roadMark->GetType() == LaneRoadMark::RoadMarkType::SOLID)
+								{
+									s0 = s_roadmarkline;
+									s1 = s0+OSI_POINT_CALC_STEPSIZE;
+									s1_prev = s0;
+									counter = 0;
+									x0.clear();  // remove any points left from the last iteration of previous lane
+									y0.clear();
+									x1.clear();
+									y1.clear();
+									
+									while(true)
 									{
-										s0 = s_roadmarkline;
-										s1 = s0+OSI_POINT_CALC_STEPSIZE;
-										s1_prev = s0;
-										counter = 0;
-										
-										while(true)
-										{
-											counter++;
+										counter++;
 
-											// [XO, YO] = closest position with given (-) tolerance
-											pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s0-OSI_TANGENT_LINE_TOLERANCE, 0, j);
-											x0.push_back(pos->GetX());
-											y0.push_back(pos->GetY());
+										// [XO, YO] = closest position with given (-) tolerance
+										pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s0-OSI_TANGENT_LINE_TOLERANCE, 0, j);
+										x0.push_back(pos.GetX());
+										y0.push_back(pos.GetY());
 
-											// [XO, YO] = Real position with no tolerance
-											pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s0, 0, j);
-											x0.push_back(pos->GetX());
-											y0.push_back(pos->GetY());
+										// [XO, YO] = Real position with no tolerance
+										pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s0, 0, j);
+										x0.push_back(pos.GetX());
+										y0.push_back(pos.GetY());
 
-											// Add the starting point of each lane as osi point
-											if (counter == 1)
-											{
-												osi_s_rm.push_back(s0);
-												osi_x_rm.push_back(pos->GetX());
-												osi_y_rm.push_back(pos->GetY());
-												osi_z_rm.push_back(pos->GetZ());
-												osi_h_rm.push_back(pos->GetH());
-											}
+										// Add the starting point of each lane as osi point
+										if (counter == 1)
+										{
+											osi_s_rm.push_back(s0);
+											osi_x_rm.push_back(pos.GetX());
+											osi_y_rm.push_back(pos.GetY());
+											osi_z_rm.push_back(pos.GetZ());
+											osi_h_rm.push_back(pos.GetH());
+										}
 
-											// [XO, YO] = closest position with given (+) tolerance
-											pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s0+OSI_TANGENT_LINE_TOLERANCE, 0, j);
-											x0.push_back(pos->GetX());
-											y0.push_back(pos->GetY());
-
-											// [X1, Y1] = closest position with given (-) tolerance																																																																																																												
-											pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s1-OSI_TANGENT_LINE_TOLERANCE, 0, j);
-											x1.push_back(pos->GetX());																																	
-											y1.push_back(pos->GetY());
-
-											// [X1, Y1] = Real position with no tolerance																																																								
-											pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s1, 0, j);
-											x1.push_back(pos->GetX());
-											y1.push_back(pos->GetY());
-
-											// [X1, Y1] = closest position with given (+) tolerance
-											pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s1+OSI_TANGENT_LINE_TOLERANCE, 0, j);
-											x1.push_back(pos->GetX());
-											y1.push_back(pos->GetY());
-
-											// Check OSI Requirement between current given points
-											osi_requirement = CheckLaneOSIRequirement(x0, y0, x1, y1);
-
-											// If requirement is satisfied -> look further points
-											// If requirement is not satisfied:
-												// Assign last satisfied point as OSI point
-												// Continue searching from the last satisfied point
-											if (osi_requirement)
-											{
-												s1_prev = s1;
-												s1 = s1 + OSI_POINT_CALC_STEPSIZE;
+										// [XO, YO] = closest position with given (+) tolerance
+										pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s0+OSI_TANGENT_LINE_TOLERANCE, 0, j);
+										x0.push_back(pos.GetX());
+										y0.push_back(pos.GetY());
+
+										// [X1, Y1] = closest position with given (-) tolerance																																																																																																												
+										pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s1-OSI_TANGENT_LINE_TOLERANCE, 0, j);
+										x1.push_back(pos.GetX());																																	
+										y1.push_back(pos.GetY());
+
+										// [X1, Y1] = Real position with no tolerance																																																								
+										pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s1, 0, j);
+										x1.push_back(pos.GetX());
+										y1.push_back(pos.GetY());
+
+										// [X1, Y1] = closest position with given (+) tolerance
+										pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s1+OSI_TANGENT_LINE_TOLERANCE, 0, j);
+										x1.push_back(pos.GetX());
+										y1.push_back(pos.GetY());
+
+										// Check OSI Requirement between current given points
+										osi_requirement = CheckLaneOSIRequirement(x0, y0, x1, y1);
+
+										// If requirement is satisfied -> look further points
+										// If requirement is not satisfied:
+											// Assign last satisfied point as OSI point
+											// Continue searching from the last satisfied point
+										if (osi_requirement)
+										{
+											s1_prev = s1;
+											s1 = s1 + OSI_POINT_CALC_STEPSIZE;
 
-											}
-											else
-											{
-												s0 = s1_prev;
-												s1_prev = s1;
-												s1 = s0 + OSI_POINT_CALC_STEPSIZE;
-
-												if (counter != 1)
-												{
-													pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s0, 0, j);
-													osi_s_rm.push_back(s0);
-													osi_x_rm.push_back(pos->GetX());
-													osi_y_rm.push_back(pos->GetY());
-													osi_z_rm.push_back(pos->GetZ());
-													osi_h_rm.push_back(pos->GetH());
-												}
-											}
+										}
+										else
+										{
+											s0 = s1_prev;
+											s1_prev = s1;
+											s1 = s0 + OSI_POINT_CALC_STEPSIZE;
 
-											// If the end of the road mark line reached, assign end of the road mark line as final OSI point for current road mark line
-											if (s1 >= s_end_roadmarkline)
+											if (counter != 1)
 											{
-												pos->SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s_end_roadmarkline, 0, j);
-												osi_s_rm.push_back(s_end_roadmarkline);
-												osi_x_rm.push_back(pos->GetX());
-												osi_y_rm.push_back(pos->GetY());
-												osi_z_rm.push_back(pos->GetZ());
-												osi_h_rm.push_back(pos->GetH());
-												break;
+												pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s0, 0, j);
+												osi_s_rm.push_back(s0);
+												osi_x_rm.push_back(pos.GetX());
+												osi_y_rm.push_back(pos.GetY());
+												osi_z_rm.push_back(pos.GetZ());
+												osi_h_rm.push_back(pos.GetH());
 											}
+										}
 
-											// Clear x-y collectors for next iteration
-											x0.clear();
-											y0.clear();
-											x1.clear();
-											y1.clear();
-
+										// If the end of the road mark line reached, assign end of the road mark line as final OSI point for current road mark line
+										if (s1 >= s_end_roadmarkline)
+										{
+											pos.SetRoadMarkPos(road->GetId(), lane->GetId(), m, 0, n, s_end_roadmarkline, 0, j);
+											osi_s_rm.push_back(s_end_roadmarkline);
+											osi_x_rm.push_back(pos.GetX());
+											osi_y_rm.push_back(pos.GetY());
+											osi_z_rm.push_back(pos.GetZ());
+											osi_h_rm.push_back(pos.GetH());
+											break;
 										}
+
+										// Clear x-y collectors for next iteration
+										x0.clear();
+										y0.clear();
+										x1.clear();
+										y1.clear();
+
 									}
+								}
 
 
-									// Set all collected osi points for the current lane rpadmarkline
-									lane_roadMarkTypeLine->osi_points_.Set(osi_s_rm, osi_x_rm, osi_y_rm, osi_z_rm, osi_h_rm);
+								// Set all collected osi points for the current lane rpadmarkline
+								lane_roadMarkTypeLine->osi_points_.Set(osi_s_rm, osi_x_rm, osi_y_rm, osi_z_rm, osi_h_rm);
 
-									// Clear osi collectors for roadmarks for next iteration
-									osi_s_rm.clear();
-									osi_x_rm.clear();
-									osi_y_rm.clear();
-									osi_z_rm.clear();
-									osi_h_rm.clear();
-								}
-								else
-								{
-									LOG("LaneRoadMarkTypeLine %d for LaneRoadMarkType for LaneRoadMark %d for lane %d is not defined", n, m, lane->GetId());
-								}
+								// Clear osi collectors for roadmarks for next iteration
+								osi_s_rm.clear();
+								osi_x_rm.clear();
+								osi_y_rm.clear();
+								osi_z_rm.clear();
+								osi_h_rm.clear();
+							}
+							else
+							{
+								LOG("LaneRoadMarkTypeLine %d for LaneRoadMarkType for LaneRoadMark %d for lane %d is not defined", n, m, lane->GetId());
 							}
 						}
-						else
-						{
-							LOG("LaneRoadMarkType for LaneRoadMark %d for lane %d is not defined", m, lane->GetId());
-						}	
 					}
+					else
+					{
+						LOG("LaneRoadMarkType for LaneRoadMark %d for lane %d is not defined", m, lane->GetId());
+					}	
 				}
-				else
+			}
+			else
+			{
+				if (lane->IsDriving())
+				{
+					LOG("LaneRoadMarks for driving lane %d on road %d is not defined", lane->GetId(), road->GetId());
+				}
+			}
+		}
+	}
+}
+
+typedef struct
+{
+	OpenDrive *odr;
+	std::vector<Road*> *roads;
+	size_t next_road;
+	bool reference_lane_only;
+	SE_Mutex mutex;
+} OSIPointsJob;
+
+static void OSIPointsWorker(void *arg)
+{
+	OSIPointsJob *job = (OSIPointsJob*)arg;
+	LoadingOpenDriveScope loading(job->odr);
+
+	while (true)
+	{
+		// Pick next road to process
+		job->mutex.Lock();
+		size_t i = job->next_road++;
+		job->mutex.Unlock();
+
+		if (i >= job->roads->size())
+		{
+			break;
+		}
+
+		Road *road = (*job->roads)[i];
+		job->odr->CreateLaneBoundaries(road);
+		if (job->reference_lane_only)
+		{
+			job->odr->SetLaneOSIPoints(road, true);
+		}
+		else
+		{
+			job->odr->SetLaneOSIPoints(road);
+			job->odr->SetRoadMarkOSIPoints(road);
+			job->odr->SetLaneBoundaryPoints(road);
+			road->SetOSIPointsDone(true);
+		}
+	}
+}
+
+void OpenDrive::UpdateLookupTables()
+{
+	if (!Geometry::GetUseLookupTable())
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < road_.size(); i++)
+	{
+		for (int j = 0; j < road_[i]->GetNumberOfGeometries(); j++)
+		{
+			road_[i]->GetGeometry(j)->UpdateLookupTable();
+		}
+	}
+}
+
+bool OpenDrive::SetRoadOSI()
+{
+	OSIPointsJob job;
+	std::vector<Road*> roads;
+
+	// Lane boundary ids are assigned per road up front, then the boundaries can be created in parallel
+	SetLaneBoundaryIdBases();
+
+	// Only roads not processed already, e.g. when adding roads to an existing network
+	for (size_t i = 0; i < road_.size(); i++)
+	{
+		if (!road_[i]->GetOSIPointsDone())
+		{
+			roads.push_back(road_[i]);
+		}
+	}
+
+	job.odr = this;
+	job.roads = &roads;
+	job.next_road = 0;
+	job.reference_lane_only = osi_points_mode_ == OSI_POINTS_LAZY;
+
+	// Roads are independent of each other, so they can be processed in parallel
+	int n_threads = osi_points_threads_;
+#if (defined WINVER && WINVER == _WIN32_WINNT_WIN7)
+	n_threads = 1;
+#else
+	if (n_threads < 1)
+	{
+		n_threads = (int)std::thread::hardware_concurrency();
+	}
+#endif
+	n_threads = MIN(n_threads, (int)roads.size());
+
+	if (n_threads > 1)
+	{
+		std::vector<SE_Thread> thread(n_threads);
+		for (int i = 0; i < n_threads; i++)
+		{
+			thread[i].Start(OSIPointsWorker, &job);
+		}
+		for (int i = 0; i < n_threads; i++)
+		{
+			thread[i].Wait();
+		}
+	}
+	else
+	{
+		OSIPointsWorker(&job);
+	}
+
+	return true;
+}
+
+typedef struct
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int n_roads;
+	unsigned long long hash;  // of road network file content and settings affecting OSI points
+	unsigned long long n_polylines;
+	unsigned long long n_points;
+} RoadCacheHeader;
+
+// Cache file layout, no pointers so it can be read (or mapped) in one go:
+//   RoadCacheHeader
+//   unsigned long long n_points[n_polylines]
+//   double s, x, y, z, h arrays of each polyline, in order
+static const char road_cache_magic[8] = { 'E', 'S', 'M', 'R', 'O', 'A', 'D', 'C' };
+
+void OpenDrive::GetOSIPolylines(int first_road_idx, std::vector<OSIPoints*> &polylines)
+{
+	for (size_t i = first_road_idx; i < road_.size(); i++)
+	{
+		Road *road = road_[i];
+		for (int j = 0; j < road->GetNumberOfLaneSections(); j++)
+		{
+			LaneSection *lsec = road->GetLaneSectionByIdx(j);
+			for (int k = 0; k < lsec->GetNumberOfLanes(); k++)
+			{
+				Lane *lane = lsec->GetLaneByIdx(k);
+				polylines.push_back(lane->GetOSIPoints());
+				if (lane->GetLaneBoundary())
+				{
+					polylines.push_back(&lane->GetLaneBoundary()->osi_points_);
+				}
+				for (int m = 0; m < lane->GetNumberOfRoadMarks(); m++)
 				{
-					if (lane->IsDriving())
+					LaneRoadMark *roadmark = lane->GetLaneRoadMarkByIdx(m);
+					for (int n = 0; n < roadmark->GetNumberOfRoadMarkTypes(); n++)
 					{
-						LOG("LaneRoadMarks for driving lane %d on road %d is not defined", lane->GetId(), road->GetId());
+						LaneRoadMarkType *type = roadmark->GetLaneRoadMarkTypeByIdx(n);
+						for (int o = 0; o < type->GetNumberOfRoadMarkTypeLines(); o++)
+						{
+							polylines.push_back(&type->GetLaneRoadMarkTypeLineByIdx(o)->osi_points_);
+						}
 					}
 				}
 			}
@@ -4212,11 +5599,180 @@ void OpenDrive::SetRoadMarkOSIPoints()
 	}
 }
 
-bool OpenDrive::SetRoadOSI()
+std::string OpenDrive::CreateCacheFilename(unsigned long long hash)
+{
+	char hash_str[32];
+	snprintf(hash_str, sizeof(hash_str), "%016llx", hash);
+
+	return cache_dir_ + "/" + FileNameOf(odr_filename_) + "_" + hash_str + ".rmcache";
+}
+
+int OpenDrive::ReadCache(std::string filename, unsigned long long hash, int first_road_idx)
+{
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file == 0)
+	{
+		return -1;
+	}
+
+	std::vector<char> buf;
+	fseek(file, 0, SEEK_END);
+	buf.resize(ftell(file));
+	fseek(file, 0, SEEK_SET);
+	size_t n_read = fread(buf.data(), 1, buf.size(), file);
+	fclose(file);
+
+	RoadCacheHeader *header = (RoadCacheHeader*)buf.data();
+	if (n_read != buf.size() || buf.size() < sizeof(RoadCacheHeader) ||
+		memcmp(header->magic, road_cache_magic, sizeof(road_cache_magic)) != 0 ||
+		header->version != ROAD_CACHE_VERSION ||
+		header->hash != hash ||
+		header->n_roads != road_.size() - first_road_idx ||
+		header->n_polylines > buf.size() / sizeof(unsigned long long) ||
+		header->n_points > buf.size() / (5 * sizeof(double)) ||
+		buf.size() != sizeof(RoadCacheHeader) + header->n_polylines * sizeof(unsigned long long) + 5 * header->n_points * sizeof(double))
+	{
+		LOG("Ignoring invalid road cache %s", filename.c_str());
+		return -1;
+	}
+
+	// Points per polyline must add up to the total, else polylines would be read beyond the data
+	unsigned long long *n_points = (unsigned long long*)(buf.data() + sizeof(RoadCacheHeader));
+	unsigned long long n_points_sum = 0;
+	bool n_points_ok = true;
+	for (size_t i = 0; i < header->n_polylines && n_points_ok; i++)
+	{
+		n_points_ok = n_points[i] <= header->n_points - n_points_sum;  // compared to what's left, no overflow
+		n_points_sum += n_points[i];
+	}
+	if (!n_points_ok || n_points_sum != header->n_points)
+	{
+		LOG("Ignoring invalid road cache %s, number of points mismatch", filename.c_str());
+		return -1;
+	}
+
+	// Cache holds lane boundaries, create them before looking up polylines
+	for (size_t i = first_road_idx; i < road_.size(); i++)
+	{
+		CreateLaneBoundaries(road_[i]);
+	}
+
+	std::vector<OSIPoints*> polylines;
+	GetOSIPolylines(first_road_idx, polylines);
+	if (polylines.size() != header->n_polylines)
+	{
+		LOG("Ignoring road cache %s, structure mismatch", filename.c_str());
+		return -1;
+	}
+
+	double *data = (double*)(n_points + header->n_polylines);
+	for (size_t i = 0; i < polylines.size(); i++)
+	{
+		size_t n = (size_t)n_points[i];
+		polylines[i]->Set(
+			std::vector<double>(data, data + n),
+			std::vector<double>(data + n, data + 2 * n),
+			std::vector<double>(data + 2 * n, data + 3 * n),
+			std::vector<double>(data + 3 * n, data + 4 * n),
+			std::vector<double>(data + 4 * n, data + 5 * n));
+		data += 5 * n;
+	}
+
+	for (size_t i = first_road_idx; i < road_.size(); i++)
+	{
+		road_[i]->SetOSIPointsDone(true);
+	}
+
+	return 0;
+}
+
+int OpenDrive::WriteCache(std::string filename, unsigned long long hash, int first_road_idx)
+{
+	for (size_t i = first_road_idx; i < road_.size(); i++)
+	{
+		if (!road_[i]->GetOSIPointsDone())
+		{
+			// e.g. lazy mode, nothing complete to cache
+			return -1;
+		}
+	}
+
+	std::vector<OSIPoints*> polylines;
+	GetOSIPolylines(first_road_idx, polylines);
+
+	RoadCacheHeader header;
+	memcpy(header.magic, road_cache_magic, sizeof(road_cache_magic));
+	header.version = ROAD_CACHE_VERSION;
+	header.n_roads = (unsigned int)(road_.size() - first_road_idx);
+	header.hash = hash;
+	header.n_polylines = polylines.size();
+	header.n_points = 0;
+
+	std::vector<unsigned long long> n_points(polylines.size());
+	for (size_t i = 0; i < polylines.size(); i++)
+	{
+		n_points[i] = polylines[i]->GetS().size();
+		header.n_points += n_points[i];
+	}
+
+	// Write to a temporary file first, then rename, so that other processes never see a partially written cache
+	std::string tmp_filename = filename + "." + std::to_string(std::random_device()()) + ".tmp";
+	FILE *file = fopen(tmp_filename.c_str(), "wb");
+	if (file == 0)
+	{
+		LOG("Failed to create road cache %s", filename.c_str());
+		return -1;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && (n_points.empty() || fwrite(n_points.data(), sizeof(unsigned long long), n_points.size(), file) == n_points.size());
+	for (size_t i = 0; i < polylines.size() && ok; i++)
+	{
+		std::vector<double> *arrays[5] = { &polylines[i]->GetS(), &polylines[i]->GetX(), &polylines[i]->GetY(), 
+			&polylines[i]->GetZ(), &polylines[i]->GetH() };
+		for (int j = 0; j < 5 && ok; j++)
+		{
+			ok = arrays[j]->size() == n_points[i] && 
+				(n_points[i] == 0 || fwrite(arrays[j]->data(), sizeof(double), n_points[i], file) == n_points[i]);
+		}
+	}
+	fclose(file);
+
+	if (ok && rename(tmp_filename.c_str(), filename.c_str()) != 0)
+	{
+		// Existing file is not replaced on all platforms
+		remove(filename.c_str());
+		ok = rename(tmp_filename.c_str(), filename.c_str()) == 0;
+	}
+
+	if (!ok)
+	{
+		LOG("Failed to write road cache %s", filename.c_str());
+		remove(tmp_filename.c_str());
+		return -1;
+	}
+
+	return 0;
+}
+
+bool OpenDrive::SetRoadOSI(Road *road)
 {
-	SetLaneOSIPoints();
-	SetRoadMarkOSIPoints();
-	SetLaneBoundaryPoints(); 
+	if (road == 0)
+	{
+		return false;
+	}
+
+	if (!road->GetOSIPointsDone())
+	{
+		LoadingOpenDriveScope loading(this);
+
+		CreateLaneBoundaries(road);
+		SetLaneOSIPoints(road);
+		SetRoadMarkOSIPoints(road);
+		SetLaneBoundaryPoints(road);
+		road->SetOSIPointsDone(true);
+	}
+
 	return true;
 }
 
@@ -4343,6 +5899,8 @@ void Position::Track2Lane()
 
 int Position::XYZH2TrackPos(double x3, double y3, double z3, double h3, bool alignZAndPitch)
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_XYZH2TRACKPOS);
+
 	// Overall method:
 	//   1. Iterate over all roads, looking at OSI points of each lane sections center line (lane 0)
 	//   2. Identify line segment (between two OSI points) closest to xyz point
@@ -4370,9 +5928,19 @@ int Position::XYZH2TrackPos(double x3, double y3, double z3, double h3, bool ali
 
 	current_road = GetOpenDrive()->GetRoadByIdx(track_idx_);
 
+	// Narrow down the search to roads in the vicinity, if spatial index is available
+	// Extend search with the maximum penalty applied to roads not connected to current one, see weights below
+	std::vector<int> candidates;
+	bool useGrid = GetOpenDrive()->GetUseRoadGrid();
+	int nRoads = GetOpenDrive()->GetNumOfRoads();
+	if (useGrid)
+	{
+		nRoads = GetOpenDrive()->GetRoadGrid()->GetRoadsNearPoint(x3, y3, 5.0, candidates);
+	}
+
 	// First step is to identify closest road and OSI line segment
 
-	for (int i = -1; !search_done && i < GetOpenDrive()->GetNumOfRoads(); i++)
+	for (int i = -1; !search_done && i < nRoads; i++)
 	{
 		if (i == -1)
 		{
@@ -4388,13 +5956,14 @@ int Position::XYZH2TrackPos(double x3, double y3, double z3, double h3, bool ali
 		}
 		else
 		{
-			if (current_road && i == track_idx_)
+			int roadIdx = useGrid ? candidates[i] : i;
+			if (current_road && roadIdx == track_idx_)
 			{
 				continue; // Skip, already checked this one
 			}
 			else
 			{
-				road = GetOpenDrive()->GetRoadByIdx(i);
+				road = GetOpenDrive()->GetRoadByIdx(roadIdx);
 			}
 		}
 
@@ -4726,11 +6295,6 @@ int Position::XYZH2TrackPos(double x3, double y3, double z3, double h3, bool ali
 	// Update lateral offsets
 	SetTrackPos(roadMin->GetId(), closestS, latOffset, UpdateTrackPosMode::UPDATE_NOT_XYZH);
 
-	static int rid = 0;
-	if (roadMin->GetId() != rid)
-	{
-		rid = roadMin->GetId();
-	}
 
 	// Set specified position and heading
 	SetX(x3);
@@ -4910,24 +6474,8 @@ int Position::SetLongitudinalTrackPos(int track_id, double s)
 	}
 
 
-	Geometry *geometry = road->GetGeometry(geometry_idx_);
-	// check if still on same geometry
-	if (s > geometry->GetS() + geometry->GetLength())
-	{
-		while (s > geometry->GetS() + geometry->GetLength() && geometry_idx_ < road->GetNumberOfGeometries() - 1)
-		{
-			// Move to next geometry
-			geometry = road->GetGeometry(++geometry_idx_);
-		}
-	}
-	else if (s < geometry->GetS())
-	{
-		while (s < geometry->GetS() && geometry_idx_ > 0)
-		{
-			// Move to previous geometry
-			geometry = road->GetGeometry(--geometry_idx_);
-		}
-	}
+	// check if still on same geometry, else look it up
+	geometry_idx_ = road->GetGeometryIdxByS(s, geometry_idx_);
 
 
 	if (s > road->GetLength())
@@ -5254,6 +6802,7 @@ int Position::MoveToConnectingRoad(RoadLink *road_link, ContactPointType &contac
 
 int Position::MoveAlongS(double ds, double dLaneOffset, Junction::JunctionStrategyType strategy)
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_MOVE_ALONG_S);
 	RoadLink *link;
 	double ds_signed = ds;
 	int max_links = 8;  // limit lookahead through junctions/links 
@@ -5876,19 +7425,10 @@ bool Position::Delta(Position pos_b, PositionDiff &diff)
 		diff.dt = pos_b.GetT() - GetT();
 
 #if 0   // Change to 1 to print some info on stdout - e.g. for debugging
-		printf("Dist %.2f Path (reversed): %d", dist, pos_b.GetTrackId());
-		if (path->visited_.size() > 0)
+		printf("Dist %.2f Path:", dist);
+		for (size_t i = 0; i < path->path_.size(); i++)
 		{
-			RoadPath::PathNode* node = path->visited_.back();
-
-			while (node)
-			{
-				if (node->fromRoad != 0)
-				{
-					printf(" <- %d", node->fromRoad->GetId());
-				}
-				node = node->previous;
-			}
+			printf(" %s%d", i > 0 ? "-> " : "", path->path_[i]);
 		}
 		printf("\n");
 #endif
@@ -6713,6 +8253,28 @@ int Route::AddWaypoint(Position *position)
 						(int)waypoint_.size() - 1, connecting_road_id, connecting_lane_id, 0.0);
 				}
 			}
+
+			if (!connected)
+			{
+				// Not connected directly or via a junction, look for the shortest lane connected path in between
+				RoadPath path(prev_pos, position);
+				double dist = 0;
+				if (path.CalculateLanePath(dist) == 0)
+				{
+					connected = true;
+
+					// Add waypoints for intermediate roads, at the point where the lane enters each road
+					for (size_t i = 1; i + 1 < path.lane_path_.size(); i++)
+					{
+						Road *road = position->GetOpenDrive()->GetRoadById(path.lane_path_[i].road_id);
+						double s = path.lane_path_[i].lane_id < 0 ? 0 : road->GetLength();
+						Position *path_pos = new Position(path.lane_path_[i].road_id, path.lane_path_[i].lane_id, s, 0);
+						waypoint_.push_back(path_pos);
+						LOG("Route::AddWaypoint Added path waypoint %d: %d, %d, %.2f\n",
+							(int)waypoint_.size() - 1, path.lane_path_[i].road_id, path.lane_path_[i].lane_id, s);
+					}
+				}
+			}
 		}
 
 		if (!connected)
@@ -17,6 +17,11 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <functional>
+#include <unordered_map>
 #include "pugixml.hpp"
 #include "CommonMini.hpp"
 
@@ -105,6 +110,29 @@ namespace roadmanager
 		virtual void Print();
 		virtual void EvaluateDS(double ds, double *x, double *y, double *h);
 
+		/**
+		Build lookup table, if enabled and not already built for current tolerance. Geometries that are cheap to
+		evaluate have no table. Evaluation never builds tables, since road networks may be shared between threads.
+		*/
+		virtual void UpdateLookupTable() {}
+
+		/**
+		Enable or disable lookup table evaluation of geometries that are expensive to evaluate (Spiral and ParamPoly3)
+		Tables are built when a road network is loaded, see also UpdateLookupTable and OpenDrive::UpdateLookupTables.
+		Default is disabled, i.e. exact evaluation.
+		@param use true = use lookup tables, false = evaluate exactly
+		*/
+		static void SetUseLookupTable(bool use) { use_lookup_table_ = use; }
+		static bool GetUseLookupTable() { return use_lookup_table_; }
+
+		/**
+		Set max allowed deviation of lookup table evaluation compared to exact evaluation
+		Geometries with tables of another tolerance are evaluated exactly until their tables are updated.
+		@param tolerance Max position error [m], also used as max heading error [rad]
+		*/
+		static void SetLookupTableTolerance(double tolerance) { lookup_table_tolerance_ = tolerance; }
+		static double GetLookupTableTolerance() { return lookup_table_tolerance_; }
+
 	protected:
 		double s_;
 		double x_;
@@ -112,6 +140,65 @@ namespace roadmanager
 		double hdg_;
 		double length_;
 		GeometryType type_;
+
+		static bool use_lookup_table_;
+		static double lookup_table_tolerance_;
+	};
+
+	/**
+	Uniformly sampled table of position, heading and their derivatives along a geometry, indexed by distance 
+	from the geometry start. Values in between samples are found by cubic Hermite interpolation, making it 
+	a cheap replacement for geometries that are costly to evaluate, e.g. Spiral (Fresnel integrals).
+	*/
+	class GeometryLookupTable
+	{
+	public:
+		typedef struct
+		{
+			double x;
+			double y;
+			double h;
+			double dx;  // derivative of x with respect to ds
+			double dy;  // derivative of y with respect to ds
+			double dh;  // derivative of h with respect to ds, i.e. curvature for arc length parameterized geometries
+		} Sample;
+
+		/**
+		Exact evaluation of a geometry at distance ds from its start, filling in all fields of the sample
+		*/
+		typedef std::function<void(double ds, Sample &sample)> EvaluateFunc;
+
+		GeometryLookupTable() : length_(0.0), step_(0.0), inv_step_(0.0), tolerance_(0.0), max_error_(0.0) {}
+
+		/**
+		Sample a geometry, halving the step length until interpolated values at interval midpoints
+		deviate less than tolerance from the exact evaluation, or the max number of samples is reached
+		@param length Length of the geometry
+		@param tolerance Max position error [m] and heading error [rad]
+		@param evaluate Exact evaluation function
+		@return 0 if tolerance was met, else -1 (table is still usable at the finest resolution tried)
+		*/
+		int Build(double length, double tolerance, EvaluateFunc evaluate);
+		void Clear();
+		bool IsEmpty() { return sample_.empty(); }
+		void Evaluate(double ds, double *x, double *y, double *h);
+
+		/**
+		Derivative of the interpolated heading with respect to ds, i.e. curvature for arc length parameterized geometries.
+		Exact for geometries with heading quadratic in ds, like Spiral.
+		*/
+		double EvaluateCurvature(double ds);
+		int GetNumberOfSamples() { return (int)sample_.size(); }
+		double GetTolerance() { return tolerance_; }
+		double GetMaxError() { return max_error_; }
+
+	private:
+		std::vector<Sample> sample_;
+		double length_;
+		double step_;
+		double inv_step_;
+		double tolerance_;
+		double max_error_;  // largest deviation found at interval midpoints during build
 	};
 
 
@@ -174,11 +261,24 @@ namespace roadmanager
 		void SetX(double x);
 		void SetY(double y);
 		void SetHdg(double h);
+		void UpdateLookupTable();
+		GeometryLookupTable &GetLookupTable() { return lut_; }
+
+		/**
+		Evaluate the spiral by Fresnel integrals, bypassing any lookup table
+		*/
+		void EvaluateDSExact(double ds, double *x, double *y, double *h);
+
+		/**
+		Curvature from start and end curvature, bypassing any lookup table
+		*/
+		double EvaluateCurvatureDSExact(double ds);
 
 		Arc* arc_;
 		Line* line_;
 
 	private:
+		GeometryLookupTable lut_;
 		double curv_start_;
 		double curv_end_;
 		double c_dot_;
@@ -240,9 +340,19 @@ namespace roadmanager
 		Polynomial GetPoly3V() {return poly3V_;}
 		void EvaluateDS(double ds, double *x, double *y, double *h);
 		double EvaluateCurvatureDS(double ds);
+		void UpdateLookupTable();
+		GeometryLookupTable &GetLookupTable() { return lut_; }
+
+		/**
+		Evaluate the polynomials, bypassing any lookup table
+		*/
+		void EvaluateDSExact(double ds, double *x, double *y, double *h);
 		
 		Polynomial poly3U_;
 		Polynomial poly3V_;
+
+	private:
+		GeometryLookupTable lut_;
 	};
 
 
@@ -528,8 +638,8 @@ namespace roadmanager
 		} LaneType;
 
 		// Construct & Destruct
-		Lane() : id_(0), type_(LaneType::LANE_TYPE_NONE), level_(0), offset_from_ref_(0.0), global_id_(0) {}
-		Lane(int id, Lane::LaneType type) : id_(id), type_(type), level_(1), offset_from_ref_(0), global_id_(0) {}
+		Lane() : id_(0), type_(LaneType::LANE_TYPE_NONE), level_(0), offset_from_ref_(0.0), global_id_(0), lane_boundary_(0) {}
+		Lane(int id, Lane::LaneType type) : id_(id), type_(type), level_(1), offset_from_ref_(0), global_id_(0), lane_boundary_(0) {}
 		~Lane() {}
 
 		// Base Get Functions
@@ -588,8 +698,14 @@ namespace roadmanager
 	class LaneSection
 	{
 	public:
-		LaneSection(double s) : s_(s), length_(0) {}
+		LaneSection(double s) : s_(s), length_(0), lane_id_min_(0) {}
 		void AddLane(Lane *lane);
+
+		/**
+		Copy lane widths into flat arrays indexed by lane id, for fast lookup of lanes and evaluation of lane widths and offsets.
+		Done when the road network is loaded. Call again if lanes or lane widths are added afterwards.
+		*/
+		void BuildLaneTable();
 		double GetS() { return s_; }
 		Lane* GetLaneByIdx(int idx);
 		Lane* GetLaneById(int id);
@@ -628,6 +744,16 @@ namespace roadmanager
 		double s_;
 		double length_;
 		std::vector<Lane*> lane_;
+
+		// Flat lane table, see BuildLaneTable(). Lanes are addressed by slot = lane id - lane_id_min_
+		// Empty until built, then lanes are looked up in lane_ instead
+		int lane_id_min_;
+		std::vector<int> lane_idx_by_slot_;  // index in lane_, -1 if lane id is missing
+		std::vector<int> width_idx_by_slot_;  // first width entry of each slot, one extra entry marking the end
+		std::vector<double> width_s_offset_;
+		std::vector<Polynomial> width_poly_;
+
+		int GetLaneSlot(int lane_id);
 	};
 
 	enum ContactPointType
@@ -765,7 +891,8 @@ namespace roadmanager
 	{
 	public:
 
-		Road(int id, std::string name) : id_(id), name_(name), length_(0), junction_(0) {}
+		Road(int id, std::string name) : id_(id), name_(name), length_(0), junction_(0), osi_points_done_(false),
+			lane_boundary_id_base_(-1) {}
 		~Road();
 
 		void Print();
@@ -789,9 +916,17 @@ namespace roadmanager
 		/**
 		Retrieve the lanesection index at specified s-value
 		@param s distance along the road segment
+		@param start_at index of lane section to check first, e.g. the previous one. Binary search if s is not within it or the next one.
 		*/
 		int GetLaneSectionIdxByS(double s, int start_at = 0);
 
+		/**
+		Retrieve the geometry index at specified s-value
+		@param s distance along the road segment
+		@param start_at index of geometry to check first, e.g. the previous one. Binary search if s is not within it or the next one.
+		*/
+		int GetGeometryIdxByS(double s, int start_at = -1);
+
 		/**
 		Retrieve the lanesection at specified s-value
 		@param s distance along the road segment
@@ -840,11 +975,27 @@ namespace roadmanager
 		int GetNumberOfDrivingLanesSide(double s, int side);  // side = -1 right, 1 left
 		double GetDrivableWidth(double s, int side=0);   // side: -1=right, 1=left, 0=both
 
+		/**
+		Whether OSI points of all lanes, lane boundaries and road marks of the road have been calculated
+		In lazy mode only the reference lane points are calculated at load, see OpenDrive::SetOSIPointsMode
+		*/
+		bool GetOSIPointsDone() { return osi_points_done_; }
+		void SetOSIPointsDone(bool done) { osi_points_done_ = done; }
+
+		/**
+		Global id of the first lane boundary of the road, the following ones numbered in lane order. -1 if not yet assigned.
+		See OpenDrive::CreateLaneBoundaries
+		*/
+		int GetLaneBoundaryIdBase() { return lane_boundary_id_base_; }
+		void SetLaneBoundaryIdBase(int id) { lane_boundary_id_base_ = id; }
+
 	protected:
 		int id_;
 		std::string name_;
 		double length_;
 		int junction_;
+		bool osi_points_done_;
+		int lane_boundary_id_base_;
 		std::vector<RoadTypeEntry*> type_;
 		std::vector<RoadLink*> link_;
 		std::vector<Geometry*> geometry_;
@@ -933,10 +1084,180 @@ namespace roadmanager
 		std::string name_;
 	};
 
+	/**
+	Uniform grid spatial index over the center line (lane 0) OSI polylines of all roads.
+	Each cell refers to the roads passing through, or within drivable width of, the cell.
+	Used to narrow down the set of roads to look into when mapping a world position to road coordinates.
+	*/
+	class RoadGrid
+	{
+	public:
+		RoadGrid() : x_min_(0), y_min_(0), cell_size_(0), n_cols_(0), n_rows_(0), n_roads_(0) {}
+
+		/**
+		Build the grid from current OSI points. Any previous content is discarded.
+		@param roads Roads to index. Cells will refer to index in this vector.
+		*/
+		void Build(std::vector<Road*> &roads);
+		void Clear();
+		bool IsEmpty() { return cell_.size() == 0; }
+		double GetCellSize() { return cell_size_; }
+
+		/**
+		Find roads that might be closest to given point. Search starts in the cell of the point and expands
+		ring by ring until any road is found. Then it continues far enough to guarantee no road closer
+		than the ones found, with given margin added, is missed.
+		Queries don't modify the grid, so they can be made from several threads at the same time.
+		@param x X coordinate of the point
+		@param y Y coordinate of the point
+		@param margin Additional distance to cover, e.g. to compensate for weighting of candidates
+		@param road_idx Resulting unique road indices, in order of cells visited
+		@return Number of candidate roads found
+		*/
+		int GetRoadsNearPoint(double x, double y, double margin, std::vector<int> &road_idx);
+
+		/**
+		Find roads that might be within given distance from a point, i.e. all roads of cells overlapping the circle.
+		@param x X coordinate of the point
+		@param y Y coordinate of the point
+		@param radius Distance from the point
+		@param road_idx Resulting unique road indices
+		@return Number of candidate roads found
+		*/
+		int GetRoadsInRadius(double x, double y, double radius, std::vector<int> &road_idx);
+
+	private:
+		double x_min_;
+		double y_min_;
+		double cell_size_;
+		int n_cols_;
+		int n_rows_;
+		std::vector<std::vector<int>> cell_;
+		int n_roads_;
+
+		void AddRoadToCells(int road_idx, double x, double y, double radius);
+		int AddCellRoads(int col, int row, std::vector<int> &road_idx);
+	};
+
+	/**
+	Road connected directly to another one, either by road link or as connecting road of a junction
+	*/
+	typedef struct
+	{
+		int road_id;     // Id of the connected road
+		int direction;   // +1 if connected at successor end of the first road, -1 if at predecessor end, 0 if invalid connection
+		double angle;    // Heading difference between start and end of the connected road, in driving direction
+	} DirectRoadConnection;
+
+	/**
+	Lane passing through a junction, from a lane of the incoming road via a connecting road lane to a lane of the exit road
+	*/
+	typedef struct
+	{
+		int from_lane_id;
+		int connecting_lane_id;
+		int to_lane_id;
+	} JunctionLanePassage;
+
+	/**
+	Path through a junction, from an incoming road via a connecting road to the exit road
+	*/
+	typedef struct
+	{
+		int connecting_road_id;
+		int exit_road_id;
+		std::vector<JunctionLanePassage> lane_passage;
+	} JunctionRoadPassage;
+
+	/**
+	Connectivity of one road, precomputed from road links and junction connections when loading the road network
+	*/
+	typedef struct
+	{
+		std::vector<DirectRoadConnection> direct;  // in order of precedence: successor end first, then predecessor end
+		std::vector<JunctionRoadPassage> junction_passage[2];  // per road end, 0: successor, 1: predecessor
+	} RoadConnectivity;
+
+	/**
+	Least recently used cache of road to road shortest path results, see RoadPath
+	Key is start road id, target road id and direction (which end of start road the path leaves from)
+	Thread safe, since a road network may be shared by scenarios running in parallel, see OpenDriveContext
+	*/
+	class RoadPathCache
+	{
+	public:
+		typedef std::tuple<int, int, int> Key;  // start road id, target road id, direction (1 = successor end, -1 = predecessor end)
+
+		typedef struct
+		{
+			double dist[2];             // distance from start road end to target road, entering at its start [0] or end [1]. LARGE_NUMBER if not reachable.
+			std::vector<int> path[2];   // ids of roads along the path, excluding the start road, including the target road
+		} Entry;
+
+		RoadPathCache(size_t capacity = 256) : capacity_(capacity), hits_(0), misses_(0) {}
+
+		/**
+		Look up a cached path. If found the entry is marked as most recently used.
+		@param entry Copy of the cached entry, if found
+		@return true if found, false if not cached
+		*/
+		bool Get(Key key, Entry &entry);
+
+		/**
+		Add path to the cache. The least recently used entry is dropped if cache is full.
+		*/
+		void Add(Key key, Entry &entry);
+
+		void Clear();
+		void SetCapacity(size_t capacity);
+		size_t GetCapacity() { return capacity_; }
+		size_t GetNumberOfEntries() { return list_.size(); }
+		int GetNumberOfHits() { return hits_; }
+		int GetNumberOfMisses() { return misses_; }
+
+	private:
+		size_t capacity_;
+		int hits_;
+		int misses_;
+		std::list<std::pair<Key, Entry>> list_;  // most recently used first
+		std::map<Key, std::list<std::pair<Key, Entry>>::iterator> map_;
+		SE_Mutex mutex_;
+	};
+
+	/**
+	Input to OpenDrive::EvaluateLanePositions, a lane position
+	*/
+	typedef struct
+	{
+		int road_id;
+		int lane_id;
+		double s;
+		double offset;  // lateral offset from lane center
+	} LanePositionQuery;
+
+	/**
+	Output of OpenDrive::EvaluateLanePositions, world position and orientation of the lane at the queried point
+	*/
+	typedef struct
+	{
+		double x;
+		double y;
+		double z;
+		double h;  // lane heading, along road reference line direction regardless of lane driving direction
+		double p;  // road pitch, along road reference line direction
+		int status;  // 0 if ok, -1 if road or lane not found. s out of range is clamped to the road.
+	} LanePositionResult;
+
 	class OpenDrive
 	{
 	public:
-		OpenDrive() {}; 
+		enum OSIPointsMode
+		{
+			OSI_POINTS_EAGER,  // calculate OSI points for all roads at load
+			OSI_POINTS_LAZY    // at load only for reference lanes, the rest when first requested by SetRoadOSI(road)
+		};
+
+		OpenDrive() : use_road_grid_(true), osi_points_mode_(OSI_POINTS_EAGER), osi_points_threads_(0), cache_used_(false) {};
 		OpenDrive(const char *filename);
 		~OpenDrive();
 
@@ -952,18 +1273,88 @@ namespace roadmanager
 		*/
 		std::string GetOpenDriveFilename() { return odr_filename_; }
 
+		/**
+		Build lookup tables of all geometries, according to current settings, see Geometry::SetUseLookupTable.
+		Done automatically when loading. Needed only if settings are changed after loading.
+		*/
+		void UpdateLookupTables();
+
 		/**
 		Setting information based on the OSI standards for OpenDrive elements
 		*/
 		bool SetRoadOSI();
+
+		/**
+		Calculate any missing OSI points of a road. Needed before accessing OSI points of lanes (other than the reference lane),
+		lane boundaries and road marks when OSI points mode is lazy. Returns immediately if already done.
+		@param road The road
+		*/
+		bool SetRoadOSI(Road *road);
+
+		/**
+		Select whether to calculate all OSI points at load or only when needed, see OSIPointsMode
+		Reference lane points are always calculated at load since they are used for world to road coordinate mapping
+		Set before loading the road network.
+		*/
+		void SetOSIPointsMode(OSIPointsMode mode) { osi_points_mode_ = mode; }
+		OSIPointsMode GetOSIPointsMode() { return osi_points_mode_; }
+
+		/**
+		Set number of worker threads used for calculating OSI points at load, roads being processed in parallel
+		@param n_threads Number of threads, 0 = number of hardware threads, 1 = no worker threads
+		*/
+		void SetOSIPointsThreads(int n_threads) { osi_points_threads_ = n_threads; }
+		int GetOSIPointsThreads() { return osi_points_threads_; }
+
+		/**
+		Enable caching of precomputed road data (OSI points) in binary files, one per road network file and content.
+		When loading a road network with a valid cache file, the OSI points are read from it instead of being calculated.
+		If no valid cache file is found, one is created after calculating the OSI points. Set before loading the road network.
+		@param dir Directory of the cache files, empty string disables caching (default)
+		*/
+		void SetCacheDir(std::string dir) { cache_dir_ = dir; }
+		std::string GetCacheDir() { return cache_dir_; }
+
+		/**
+		Whether the OSI points of the most recently loaded road network were read from a cache file
+		*/
+		bool GetCacheUsed() { return cache_used_; }
+
+		/**
+		Name of the cache file matching the most recently loaded road network, empty if caching is disabled
+		*/
+		std::string GetCacheFilename() { return cache_filename_; }
+
 		bool CheckLaneOSIRequirement(std::vector<double> x0, std::vector<double> y0, std::vector<double> x1, std::vector<double> y1);
 		void SetLaneOSIPoints();
+
+		/**
+		Calculate OSI points of lanes of one road. Lanes already having OSI points are skipped.
+		@param road The road
+		@param reference_lane_only If true only reference lane (id 0) points are calculated
+		*/
+		void SetLaneOSIPoints(Road *road, bool reference_lane_only = false);
 		void SetRoadMarkOSIPoints();
+		void SetRoadMarkOSIPoints(Road *road);
 		/**
 		Checks all lanes - if a lane has RoadMarks it does nothing. If a lane does not have roadmarks 
 		then it creates a LaneBoundary following the lane border (left border for left lanes, right border for right lanes)
 		*/
 		void SetLaneBoundaryPoints();
+
+		/**
+		Create lane boundary objects for lanes without road marks. Lanes already having one are skipped.
+		Global ids are given by the lane boundary id base of the road and lane order, so they do not depend on
+		in which order, or by which thread, roads are processed.
+		@param road The road
+		*/
+		void CreateLaneBoundaries(Road *road);
+
+		/**
+		Calculate OSI points of the lane boundaries of one road, created by CreateLaneBoundaries
+		@param road The road
+		*/
+		void SetLaneBoundaryPoints(Road *road);
 		
 		/**
 		Retrieve a road segment specified by road ID 
@@ -996,6 +1387,17 @@ namespace roadmanager
 		@return 0 if not connected, -1 if road 2 is the predecessor of road 1, +1 if road 2 is the successor of road 1
 		*/
 		int IsDirectlyConnected(int road1_id, int road2_id, double &angle);
+
+		/**
+		Check if two roads are connected, directly or via a junction. Optionally also check that specified lanes are connected.
+		@param road1_id Id of the first road
+		@param road2_id Id of the second road
+		@param connecting_road_id if connected via a junction, the id of the connecting road is returned here, unless null
+		@param connecting_lane_id if connected via a junction, the id of the connecting lane is returned here, unless null
+		@param lane1_id Lane id on first road, 0 means skip lane check when roads are directly connected
+		@param lane2_id Lane id on second road, 0 means skip lane check when roads are directly connected
+		@return true if connected, else false
+		*/
 		bool IsIndirectlyConnected(int road1_id, int road2_id, int* &connecting_road_id, int* &connecting_lane_id, int lane1_id = 0, int lane2_id = 0);
 
 		/**
@@ -1011,14 +1413,62 @@ namespace roadmanager
 		std::string ContactPointType2Str(ContactPointType type);
 		std::string ElementType2Str(RoadLink::ElementType type);
 
+		/**
+		Enable or disable use of the spatial road index when mapping world coordinates to road coordinates.
+		When disabled all roads are searched, which might be slow for large road networks.
+		*/
+		void SetUseRoadGrid(bool value) { use_road_grid_ = value; }
+		bool GetUseRoadGrid() { return use_road_grid_ && !road_grid_.IsEmpty(); }
+		RoadGrid *GetRoadGrid() { return &road_grid_; }
+
+		/**
+		Cache of shortest path calculations between roads. Cleared whenever a road network is loaded.
+		*/
+		RoadPathCache *GetRoadPathCache() { return &road_path_cache_; }
+
+		/**
+		Precompute road connectivity, used by IsDirectlyConnected and IsIndirectlyConnected.
+		Called when loading the road network. Needs to be called again if any road link or junction connection is changed.
+		*/
+		void BuildConnectivity();
+
+		/**
+		Convert many lane positions to world coordinates in one call, same result as Position::SetLanePos for each one
+		but without the overhead of a stateful Position object. Queries are processed in order of road and s, so that 
+		geometry, lane section and elevation lookup is done by stepping forward instead of searching from start, 
+		and positions on the same geometry are evaluated together.
+		@param in Array of lane positions
+		@param out Array of results, same size and order as in
+		@param n Number of positions
+		@return 0 if all positions were successfully evaluated, else -1 (see status of each result)
+		*/
+		int EvaluateLanePositions(const LanePositionQuery *in, LanePositionResult *out, int n);
 
 		void Print();
-	
+
 	private:
 		pugi::xml_node root_node_;
 		std::vector<Road*> road_;
 		std::vector<Junction*> junction_;
+		std::unordered_map<int, int> road_idx_by_id_;  // road id -> index in road_
+		std::unordered_map<int, int> junction_idx_by_id_;  // junction id -> index in junction_
 		std::string odr_filename_;
+		RoadGrid road_grid_;
+		bool use_road_grid_;
+		std::vector<RoadConnectivity> connectivity_;  // per road, same index as road_
+		RoadPathCache road_path_cache_;
+		OSIPointsMode osi_points_mode_;
+		int osi_points_threads_;
+		std::string cache_dir_;
+		std::string cache_filename_;
+		bool cache_used_;
+
+		void AddDirectConnection(RoadConnectivity &connectivity, int road_id, int direction, double angle);
+		void SetLaneBoundaryIdBases();
+		void GetOSIPolylines(int first_road_idx, std::vector<OSIPoints*> &polylines);
+		std::string CreateCacheFilename(unsigned long long hash);
+		int ReadCache(std::string filename, unsigned long long hash, int first_road_idx);
+		int WriteCache(std::string filename, unsigned long long hash, int first_road_idx);
 	};
 
 	typedef struct
@@ -1046,6 +1496,63 @@ namespace roadmanager
 		int dLaneId;			// delta laneId (increasing left and decreasing to the right)
 	} PositionDiff;
 
+	/**
+	Road network context, for running several scenarios in parallel within one process
+	While a context is active on a thread, Position objects used by that thread refer to the road network of the
+	context instead of the process wide default one. Road networks loaded via a context are shared, by filename,
+	between all contexts and must be treated as immutable once loaded. For that reason they are always loaded with
+	OSI points calculated eagerly, see OpenDrive::SetOSIPointsMode.
+	*/
+	class OpenDriveContext
+	{
+	public:
+		OpenDriveContext() : odr_(0) {}
+		~OpenDriveContext();
+
+		/**
+		Make this context active on the calling thread
+		@return The previously active context, 0 if none (i.e. process wide default network)
+		*/
+		OpenDriveContext *Activate();
+
+		/**
+		Make given context active on the calling thread, typically the one returned from Activate()
+		@param context The context to activate, 0 for the process wide default road network
+		*/
+		static void Restore(OpenDriveContext *context);
+
+		/**
+		Get the context active on the calling thread
+		@return The context, 0 if none (i.e. process wide default network)
+		*/
+		static OpenDriveContext *GetActive();
+
+		/**
+		Load road network into this context. If already loaded by any context the network is shared.
+		@param filename OpenDRIVE file
+		@return true if successful, else false
+		*/
+		bool LoadOpenDrive(const char *filename);
+
+		/**
+		Get road network of the context. Before loading an empty network is returned, on which settings like cache
+		directory can be made to be applied when loading.
+		*/
+		OpenDrive *GetOpenDrive() { return odr_ ? odr_ : &empty_; }
+
+		/**
+		Get number of shared road networks currently loaded by any context
+		*/
+		static int GetNumberOfSharedOpenDrives();
+
+	private:
+		OpenDrive *odr_;
+		std::string filename_;
+		OpenDrive empty_;
+
+		void Release();
+	};
+
 	// Forward declarations
 	class Route;
 	class Trajectory;
@@ -1517,7 +2024,8 @@ namespace roadmanager
 		explicit Route() {}
 
 		/**
-		Adds a waypoint to the route. One waypoint per road. At most one junction between waypoints.
+		Adds a waypoint to the route. One waypoint per road. If the waypoint is not connected to the previous one
+		directly or via a junction, waypoints are added for the roads along the shortest lane connected path in between.
 		@param position A regular position created with road, lane or world coordinates
 		@return Non zero return value indicates error of some kind
 		*/
@@ -1541,34 +2049,58 @@ namespace roadmanager
 
 		typedef struct PathNode
 		{
-			RoadLink *link;
-			double dist;
-			Road* fromRoad;
-			PathNode* previous;
+			Road *road;          // road travelled up to this node
+			int entry_lane_id;   // lane at the end of the road where it was entered (lane aware search only)
+			int lane_id;         // lane at the end of the road where it is left (lane aware search only)
+			LinkType exit;       // end of road where it is left, NONE for the final node on target road
+			ContactPointType entry;  // end of road where it was entered
+			double dist;         // distance along the path from start position
+			double cost;         // distance plus estimated remaining distance to target
+			PathNode *previous;
 		} PathNode;
 
-		std::vector<PathNode*> visited_;
-		std::vector<PathNode*> unvisited_;
+		typedef struct
+		{
+			int road_id;
+			int lane_id;  // lane id where the road is entered
+		} LanePathNode;
+
 		Position *startPos_;
 		Position *targetPos_;
-		int direction_;  // direction of path from starting pos. 0==not set, 1==forward, 2==backward
+		int direction_;  // direction of path from starting pos. 0==not set, 1==forward, -1==backward
+		std::vector<int> path_;  // ids of roads along the path, from start road to target road
+		std::vector<LanePathNode> lane_path_;  // lanes along the path, from start lane to target lane (lane aware search only)
 
-		RoadPath(Position* startPos, Position* targetPos) : startPos_(startPos), targetPos_(targetPos) {};
-		~RoadPath();
+		RoadPath(Position* startPos, Position* targetPos) : startPos_(startPos), targetPos_(targetPos), direction_(0) {};
+		~RoadPath() {};
 
 		/**
 		Calculate shortest path between starting position and target position, 
-		using Dijkstra's algorithm https://en.wikipedia.org/wiki/Dijkstra%27s_algorithm
+		using the A* algorithm https://en.wikipedia.org/wiki/A*_search_algorithm
 		it also calculates the length of the path, or distance between the positions
 		positive distance means that the shortest path was found in forward direction
 		negative distance means that the shortest path goes in opposite direction from the heading of the starting position
+		Road to road results are cached, see RoadPathCache
 		@param dist A reference parameter into which the calculated path distance is stored
 		@return 0 on success, -1 on failure e.g. path not found
 		*/
 		int Calculate(double &dist);
-	
+
+		/**
+		Calculate shortest lane connected path from the lane of starting position to the lane of target position
+		The path follows the driving direction of the lanes, and only lane links, no lane changes, are considered
+		The result is stored in lane_path_
+		@param dist A reference parameter into which the calculated path distance is stored
+		@return 0 on success, -1 on failure e.g. path not found
+		*/
+		int CalculateLanePath(double &dist);
+
 	private:
-		bool CheckRoad(Road* checkRoad, RoadPath::PathNode* srcNode, Road* fromRoad);
+		std::deque<PathNode> node_pool_;  // all nodes of a search, released when path object is deleted
+
+		PathNode *NewNode(Road *road, int entry_lane_id, int lane_id, LinkType exit, ContactPointType entry, double dist, PathNode *previous);
+		double EstimateDistance(Road *road, LinkType end, Road *targetRoad);
+		int SearchRoadToRoad(Road *startRoad, LinkType startEnd, Road *targetRoad, RoadPathCache::Entry &result);
 	};
 
 
@@ -162,6 +162,16 @@ namespace OpenDRIVE
         [DllImport(LIB_NAME, EntryPoint = "RM_SetLanePosition")]
         public static extern int SetLanePosition(int index, int roadId, int laneId, float laneOffset, float s, bool align);
 
+        /// <summary>
+        /// Convert many lane positions to world coordinates in one call, without involving any position objects
+        /// </summary>
+        /// <param name="data">Array of positions. Input: roadId, laneId, laneOffset and s. Output: x, y, z, h, p and r</param>
+        /// <param name="n">Number of positions in the array</param>
+        /// <param name="align">If true heading and pitch are given in the lane driving direction, else along the road reference line</param>
+        /// <returns>0 if all positions were successful, -1 if any failed</returns>
+        [DllImport(LIB_NAME, EntryPoint = "RM_SetLanePositionBatch")]
+        public static extern int SetLanePositionBatch([In, Out] OpenDrivePositionData[] data, int n, bool align);
+
         /// <summary>
         /// Set s (distance) part of a lane position, world coordinates being calculated
         /// </summary>
@@ -18,6 +18,8 @@ using namespace roadmanager;
 
 static roadmanager::OpenDrive *odrManager = 0;
 static std::vector<Position> position;
+static std::vector<LanePositionQuery> batch_query;
+static std::vector<LanePositionResult> batch_result;
 
 static int GetProbeInfo(int index, float lookahead_distance, RM_RoadProbeInfo *r_data, int lookAheadMode)
 {
@@ -261,6 +263,46 @@ extern "C"
 		return 0;
 	}
 
+	RM_DLL_API int RM_SetLanePositionBatch(RM_PositionData *data, int n, bool align)
+	{
+		if (odrManager == 0 || data == 0 || n < 0)
+		{
+			return -1;
+		}
+
+		batch_query.resize(n);
+		batch_result.resize(n);
+		for (int i = 0; i < n; i++)
+		{
+			batch_query[i].road_id = data[i].roadId;
+			batch_query[i].lane_id = data[i].laneId;
+			batch_query[i].s = data[i].s;
+			batch_query[i].offset = data[i].laneOffset;
+		}
+
+		int retval = odrManager->EvaluateLanePositions(batch_query.data(), batch_result.data(), n);
+
+		for (int i = 0; i < n; i++)
+		{
+			LanePositionResult &r = batch_result[i];
+			if (r.status != 0)
+			{
+				continue;
+			}
+
+			bool reverse = align && data[i].laneId > 0;
+			data[i].x = (float)r.x;
+			data[i].y = (float)r.y;
+			data[i].z = (float)r.z;
+			data[i].h = (float)(reverse ? GetAngleSum(r.h, M_PI) : r.h);
+			data[i].p = (float)(reverse ? -r.p : r.p);
+			data[i].r = 0.0f;
+			data[i].hRelative = 0.0f;
+		}
+
+		return retval;
+	}
+
 	RM_DLL_API int RM_SetWorldPosition(int handle, float x, float y, float z, float h, float p, float r)
 	{
 		if (odrManager == 0 || handle >= position.size())
@@ -135,6 +135,16 @@ extern "C"
 	*/
 	RM_DLL_API int RM_SetLanePosition(int handle, int roadId, int laneId, float laneOffset, float s, bool align);
 
+	/**
+	Convert many lane positions to world coordinates in one call, without involving any position objects.
+	Much faster than calling RM_SetLanePosition + RM_GetPositionData for each position.
+	@param data Array of positions. Input: roadId, laneId, laneOffset and s. Output: x, y, z, h, p and r (hRelative set to 0)
+	@param n Number of positions in the array
+	@param align If true heading and pitch are given in the lane driving direction, else along the road reference line
+	@return 0 if all positions were successful, -1 if any failed (e.g. road or lane not existing)
+	*/
+	RM_DLL_API int RM_SetLanePositionBatch(RM_PositionData *data, int n, bool align);
+
 	/**
 	Set s (distance) part of a lane position, world coordinates being calculated
 	@param handle Handle to the position object
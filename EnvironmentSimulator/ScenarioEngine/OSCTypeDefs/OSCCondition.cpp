@@ -184,6 +184,7 @@ bool ConditionGroup::Evaluate(StoryBoard *storyBoard, double sim_time)
 
 bool Trigger::Evaluate(StoryBoard *storyBoard, double sim_time)
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_TRIGGERS);
 	bool result = false;
 
 	for (size_t i = 0; i < conditionGroup_.size(); i++)
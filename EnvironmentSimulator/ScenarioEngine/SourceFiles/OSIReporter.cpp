@@ -18,61 +18,86 @@
 #include "osi_version.pb.h"
 #include <cmath>
 
-#ifdef _WIN32
-#include <winsock2.h>
-#include <Ws2tcpip.h>
-#else
- /* Assume that any non-Windows platform uses POSIX-style sockets instead. */
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#include <netdb.h>  /* Needed for getaddrinfo() and freeaddrinfo() */
-#include <unistd.h> /* Needed for close() */
-#endif
-
 #define OSI_OUT_PORT 48198
+#define OSI_FILE_MAX_WAIT 0.01  // s, rather drop a message than stall the simulation on slow file system
+#define OSI_WIRETYPE_LENGTH_DELIMITED 2
 
-static struct {
-	osi3::SensorView *sv;
-	std::vector<osi3::StationaryObject*> sobj;
-	std::vector<osi3::MovingObject*> mobj;
-	std::vector<osi3::Lane*> ln;
-	std::vector<osi3::LaneBoundary*> lnb;
-} obj_osi_internal;
+using namespace scenarioengine;
 
-typedef struct
+static void AppendVarint(std::string &dst, uint64_t value)
 {
-	std::string sensor_view;
-	unsigned int size;
-} OSISensorView;
+	while (value >= 0x80)
+	{
+		dst.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	dst.push_back((char)value);
+}
 
-typedef struct
+/*
+	Append a serialized sub message as field of an enclosing message, protobuf wire format.
+	Non repeated message fields occurring several times are merged by the parser, so this
+	allows to compose a message from separately serialized fragments.
+*/
+static void AppendMessageField(std::string &dst, int field_number, const std::string &msg)
 {
-	std::string osi_lane_info;
-	unsigned int size;
-} OSIRoadLane;
+	AppendVarint(dst, ((uint64_t)field_number << 3) | OSI_WIRETYPE_LENGTH_DELIMITED);
+	AppendVarint(dst, msg.size());
+	dst.append(msg);
+}
 
-typedef struct
+static bool PolylineWithinRadius(roadmanager::OSIPoints *points, double x, double y, double radius)
 {
-	std::string osi_lane_boundary_info;
-	unsigned int size;
-} OSIRoadLaneBoundary;
+	std::vector<double> &px = points->GetX();
+	std::vector<double> &py = points->GetY();
+	double radius_sq = radius * radius;
 
-using namespace scenarioengine;
+	if (px.size() == 1)
+	{
+		return PointSquareDistance2D(x, y, px[0], py[0]) < radius_sq;
+	}
 
-static OSISensorView osiSensorView;
-static OSIRoadLane osiRoadLane;
-static OSIRoadLaneBoundary osiRoadLaneBoundary;
-std::ofstream osi_file;
+	for (size_t i = 1; i < px.size(); i++)
+	{
+		// closest point on segment
+		double dx = px[i] - px[i - 1];
+		double dy = py[i] - py[i - 1];
+		double len_sq = dx * dx + dy * dy;
+		double f = len_sq > SMALL_NUMBER ? ((x - px[i - 1]) * dx + (y - py[i - 1]) * dy) / len_sq : 0.0;
+		if (f < 0.0)
+		{
+			f = 0.0;
+		}
+		else if (f > 1.0)
+		{
+			f = 1.0;
+		}
 
-static struct sockaddr_in recvAddr;
+		if (PointSquareDistance2D(x, y, px[i - 1] + f * dx, py[i - 1] + f * dy) < radius_sq)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
 
 // ScenarioGateway
 
 OSIReporter::OSIReporter()
 {
-	sendSocket = 0;
-
-	obj_osi_internal.sv = new osi3::SensorView();
+	osiSensorView.size = 0;
+	static_gt_ready = false;
+	static_gt_dirty = false;
+	static_gt_attached = false;
+	sv_serialized = false;
+	host_lane_idx = -1;
+	osi_radius = 0.0;
+	shm_objects_truncated = false;
+
+	// Lanes are owned by static_gt and lent to sv while attached, see AttachStaticGroundTruth()
+	obj_osi_internal.sv = new osi3::SensorView;
+	obj_osi_internal.static_gt = new osi3::GroundTruth;
 
 	obj_osi_internal.sv->mutable_version()->set_version_major(3);
 	obj_osi_internal.sv->mutable_version()->set_version_minor(0);
@@ -85,82 +110,81 @@ OSIReporter::OSIReporter()
 
 OSIReporter::~OSIReporter()
 {
-	if (obj_osi_internal.sv)
-	{
-		obj_osi_internal.sv->Clear();
-		delete obj_osi_internal.sv;
-	}
-
+	DetachStaticGroundTruth();
 	obj_osi_internal.mobj.clear();
+	obj_osi_internal.sobj.clear();
 	obj_osi_internal.ln.clear();
 	obj_osi_internal.lnb.clear();
 
 	osiSensorView.size = 0;
-	osiRoadLane.size=0;
 
 	CloseSocket();
-	if (osi_file.is_open())
+	CloseSharedMemory();
+	if (osi_file.GetNumberOfDropped() > 0)
 	{
-		osi_file.close();
+		LOG("OSI file: %llu messages dropped due to slow file writing", osi_file.GetNumberOfDropped());
 	}
-	
+	osi_file.Close();
+
+	// sv has given back the static lanes above, so each message is deleted once
+	delete obj_osi_internal.sv;
+	delete obj_osi_internal.static_gt;
 }
 
 int OSIReporter::OpenSocket(std::string ipaddr)
 {
-#ifdef _WIN32
-	WSADATA wsa_data;
-	int iResult = WSAStartup(MAKEWORD(2, 2), &wsa_data);
-	if (iResult != NO_ERROR)
+	// SensorView is sent as a plain datagram when it fits, else fragmented, so that any size can be sent
+	if (udp_sender.Open(ipaddr, OSI_OUT_PORT) != 0)
 	{
-		wprintf(L"WSAStartup failed with error %d\n", iResult);
-		return -1;
-	}
-#endif
-
-	// create socket for outgoing UDP packages
-	sendSocket = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-	if (sendSocket < 0) {
-		LOG("socket failed");
+		LOG("Failed to open UDP socket for OSI, receiver %s:%d", ipaddr.c_str(), OSI_OUT_PORT);
 		return -1;
 	}
 
-	// Setup receiver IP address
-	recvAddr.sin_family = AF_INET;
-	recvAddr.sin_port = htons(OSI_OUT_PORT);
-	inet_pton(AF_INET, ipaddr.c_str(), &recvAddr.sin_addr);
-
 	return 0;
 }
 
 int OSIReporter::CloseSocket()
 {
-	if (!sendSocket)
+	if (udp_sender.IsOpen() && udp_sender.GetNumberOfFailed() > 0)
 	{
-		return 0;
+		LOG("OSI UDP: %llu of %llu messages failed to send", udp_sender.GetNumberOfFailed(), udp_sender.GetNumberOfMessages());
 	}
+	udp_sender.Close();
 
-#ifdef _WIN32
-	if (closesocket(sendSocket) == SOCKET_ERROR)
-#else
-	if (close(sendSocket) < 0)
-#endif
+	return 0;
+}
+
+int OSIReporter::OpenSharedMemory(std::string name)
+{
+	if (shm_writer.Open(name) != 0)
 	{
-		printf("Failed closing socket");
+		LOG("Failed to open shared memory %s for OSI", name.c_str());
 		return -1;
 	}
-
-#ifdef _WIN32
-	WSACleanup();
-#endif
+	shm_objects_truncated = false;
 
 	return 0;
 }
 
+void OSIReporter::CloseSharedMemory()
+{
+	if (shm_writer.IsOpen() && shm_writer.GetNumberOfFailed() > 0)
+	{
+		LOG("OSI shared memory: %llu frames too large, not published", shm_writer.GetNumberOfFailed());
+	}
+	shm_writer.Close();
+}
+
 void OSIReporter::ReportSensors(std::vector<ObjectSensor*> sensor)
 {
 	const int max_detections = 10;
 
+	sensor_pos.clear();
+	for (size_t i = 0; i < sensor.size(); i++)
+	{
+		sensor_pos.push_back(std::make_pair(sensor[i]->pos_.x_global, sensor[i]->pos_.y_global));
+	}
+
 	if (sensor.size() == 0)
 	{
 		return;
@@ -180,10 +204,28 @@ void OSIReporter::ReportSensors(std::vector<ObjectSensor*> sensor)
 	}
 }
 
+void OSIReporter::SetOSIRadius(double radius)
+{
+	osi_radius = radius;
+	local_ln.clear();
+	static_gt_dirty = true;
+}
+
+bool OSIReporter::IsWithinOSIRadius(double x, double y)
+{
+	for (size_t i = 0; i < osi_center.size(); i++)
+	{
+		if (PointSquareDistance2D(x, y, osi_center[i].first, osi_center[i].second) < osi_radius * osi_radius)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 bool OSIReporter::OpenOSIFile()
 {
-	osi_file = std::ofstream("move_obj.osi", std::ios_base::binary);
-	if (!osi_file.good())
+	if (osi_file.Open("move_obj.osi", true, OSI_FILE_MAX_WAIT) != 0)
 	{
 		LOG("Failed open osi file");
 		return false; 
@@ -191,25 +233,54 @@ bool OSIReporter::OpenOSIFile()
 	return true; 
 }
 
-bool OSIReporter::WriteOSIFile()
+bool OSIReporter::WriteOSIFile(bool flush)
 {
-	// write to file, first size of message
-	osi_file.write((char*)&osiSensorView.size, sizeof(osiSensorView.size));
+	SE_PROFILE_SCOPE(SE_PROFILE_OSI);
+
+	SerializeOSISensorView();
 
-	// write to file, actual message - the sensorview object including timestamp and moving objects
-	osi_file.write(osiSensorView.sensor_view.c_str(), osiSensorView.size);
+	// write to file as one record, first size of message
+	osi_file_buf.assign((char*)&osiSensorView.size, sizeof(osiSensorView.size));
 
-	if (!osi_file.good())
+	// then actual message - the sensorview object including timestamp and moving objects
+	osi_file_buf.append(osiSensorView.sensor_view.c_str(), osiSensorView.size);
+
+	if (osi_file.Write(osi_file_buf) != 0)
 	{
-		LOG("Failed write osi file");
-		return false; 
+		// Dropped, reported on close
+		return false;
+	}
+
+	if (flush)
+	{
+		osi_file.Flush();
 	}
 	return true; 
 }
 
 int OSIReporter::UpdateOSISensorView(std::vector<ObjectState*> objectState)
 {
-	double time_stamp = objectState[0]->state_.timeStamp;
+	SE_PROFILE_SCOPE(SE_PROFILE_OSI);
+
+	// Shared lanes must not be part of the live SensorView while it's being modified
+	DetachStaticGroundTruth();
+	sv_serialized = false;
+
+	if (!static_gt_ready)
+	{
+		UpdateOSIStaticGroundTruth();
+	}
+
+	if (osi_radius > 0.0)
+	{
+		UpdateOSILocalLanes(objectState);
+	}
+
+	// Objects are reported from scratch each frame. Cleared elements are kept allocated for reuse.
+	obj_osi_internal.sv->mutable_global_ground_truth()->clear_moving_object();
+	obj_osi_internal.sv->mutable_global_ground_truth()->clear_stationary_object();
+	obj_osi_internal.mobj.clear();
+	obj_osi_internal.sobj.clear();
 
 	obj_osi_internal.sv->mutable_global_ground_truth()->mutable_timestamp()->set_seconds((int64_t)objectState[0]->state_.timeStamp);
 	obj_osi_internal.sv->mutable_global_ground_truth()->mutable_timestamp()->set_nanos((uint32_t)(
@@ -218,6 +289,11 @@ int OSIReporter::UpdateOSISensorView(std::vector<ObjectState*> objectState)
 
 	for (size_t i = 0; i < objectState.size(); i++)
 	{
+		if (osi_radius > 0.0 && !IsWithinOSIRadius(objectState[i]->state_.pos.GetX(), objectState[i]->state_.pos.GetY()))
+		{
+			continue;
+		}
+
 		if(objectState[i]->state_.obj_type==static_cast<int>(Object::Type::VEHICLE) || 
 		objectState[i]->state_.obj_type==static_cast<int>(Object::Type::PEDESTRIAN))
 		{
@@ -233,28 +309,70 @@ int OSIReporter::UpdateOSISensorView(std::vector<ObjectState*> objectState)
 		}
 	}
 	
-	//collect all information of lanes in the lane section where obj=0 is
-	UpdateOSIRoadLane(objectState);
-
-	UpdateOSILaneBoundary(objectState);
+	UpdateOSIHostLane(objectState);
 
-	obj_osi_internal.sv->SerializeToString(&osiSensorView.sensor_view);
-	osiSensorView.size = (unsigned int)obj_osi_internal.sv->ByteSizeLong();
+	if (static_gt_dirty)
+	{
+		ComposeStaticGroundTruth();
+	}
 
-	if (sendSocket)
+	// Serialization is postponed until needed, in-process consumers may use the live SensorView instead
+	if (udp_sender.IsOpen())
 	{
-		// send over udp - skip size (package size == message size)
-		int sendResult = sendto(sendSocket, (char*)osiSensorView.sensor_view.c_str(), osiSensorView.size, 0, (struct sockaddr*)&recvAddr, sizeof(recvAddr));
+		SerializeOSISensorView();
 
-		if (sendResult != osiSensorView.size)
+		// send over udp, split into fragments with header only if larger than one datagram
+		if (udp_sender.Send(osiSensorView.sensor_view.c_str(), osiSensorView.size) != 0)
 		{
 			LOG("Failed send osi package over UDP");
-#ifdef _WIN32
-			wprintf(L"send failed with error: %d\n", WSAGetLastError());
-#endif
 		}
 	}
 
+	if (shm_writer.IsOpen())
+	{
+		SerializeOSISensorView();
+
+		// Compact state of all objects, not limited by OSI radius. Table is truncated if there is no room for all,
+		// the SensorView is published anyway.
+		size_t n_objects = objectState.size();
+		if (n_objects > shm_writer.GetMaxObjects())
+		{
+			if (!shm_objects_truncated)
+			{
+				LOG("OSI shared memory: room for %u of %zu objects, rest left out of object table",
+					shm_writer.GetMaxObjects(), n_objects);
+				shm_objects_truncated = true;
+			}
+			n_objects = shm_writer.GetMaxObjects();
+		}
+
+		shm_objects.resize(n_objects);
+		for (size_t i = 0; i < n_objects; i++)
+		{
+			ObjectStateStruct &state = objectState[i]->state_;
+			SE_ShmObjectState &entry = shm_objects[i];
+
+			entry.id = state.id;
+			entry.model_id = state.model_id;
+			entry.obj_type = state.obj_type;
+			entry.control = state.control;
+			entry.x = state.pos.GetX();
+			entry.y = state.pos.GetY();
+			entry.z = state.pos.GetZ();
+			entry.h = (float)state.pos.GetH();
+			entry.p = (float)state.pos.GetP();
+			entry.r = (float)state.pos.GetR();
+			entry.road_id = state.pos.GetTrackId();
+			entry.lane_id = state.pos.GetLaneId();
+			entry.s = (float)state.pos.GetS();
+			entry.offset = (float)state.pos.GetOffset();
+			entry.speed = state.speed;
+		}
+
+		shm_writer.Write(objectState[0]->state_.timeStamp, shm_objects.data(), (unsigned int)shm_objects.size(),
+			osiSensorView.sensor_view.data(), osiSensorView.size);
+	}
+
 	return 0;
 }
 
@@ -262,7 +380,7 @@ int OSIReporter::UpdateOSIStationaryObject(ObjectState* objectState)
 {
 	// Create OSI Stationary object
 	osi3::StationaryObject* sobj = obj_osi_internal.sv->mutable_global_ground_truth()->add_stationary_object();
-	sobj->mutable_id()->set_value(obj_osi_internal.sobj.size());
+	sobj->mutable_id()->set_value(objectState->state_.id);  // stable also when objects are filtered by OSI radius
 	
 	// Set OSI Stationary Object Type and Classification
 	if(objectState->state_.obj_category == static_cast<int>(Object::Type::MISC_OBJECT))
@@ -340,7 +458,7 @@ int OSIReporter::UpdateOSIMovingObject(ObjectState* objectState)
 {
 	// Create OSI Moving object
 	osi3::MovingObject* mobj = obj_osi_internal.sv->mutable_global_ground_truth()->add_moving_object();
-	mobj->mutable_id()->set_value(obj_osi_internal.mobj.size());
+	mobj->mutable_id()->set_value(objectState->state_.id);  // stable also when objects are filtered by OSI radius
 	
 	// Set OSI Moving Object Type and Classification
 	if(objectState->state_.obj_type == static_cast<int>(Object::Type::VEHICLE))
@@ -425,10 +543,294 @@ int OSIReporter::UpdateOSIMovingObject(ObjectState* objectState)
 	return 0;
 }
 
-int OSIReporter::UpdateOSILaneBoundary(std::vector<ObjectState*> objectState)
+int OSIReporter::UpdateOSIStaticGroundTruth()
+{
+	obj_osi_internal.static_gt->Clear();
+	obj_osi_internal.ln.clear();
+	obj_osi_internal.lnb.clear();
+	ln_idx.clear();
+	lnb_idx.clear();
+	host_lane_idx = -1;
+
+	UpdateOSIRoadLane();
+	UpdateOSILaneBoundary();
+
+	ln_buf.resize(obj_osi_internal.ln.size());
+	for (size_t i = 0; i < obj_osi_internal.ln.size(); i++)
+	{
+		obj_osi_internal.ln[i]->SerializeToString(&ln_buf[i]);
+	}
+
+	lnb_buf.resize(obj_osi_internal.lnb.size());
+	for (size_t i = 0; i < obj_osi_internal.lnb.size(); i++)
+	{
+		obj_osi_internal.lnb[i]->SerializeToString(&lnb_buf[i]);
+	}
+
+	// Register boundaries of each lane, for lookup when composing a local ground truth
+	ln_lnb.resize(obj_osi_internal.ln.size());
+	for (size_t i = 0; i < obj_osi_internal.ln.size(); i++)
+	{
+		osi3::Lane_Classification *classification = obj_osi_internal.ln[i]->mutable_classification();
+		ln_lnb[i].clear();
+		for (int j = 0; j < classification->left_lane_boundary_id_size() + classification->right_lane_boundary_id_size(); j++)
+		{
+			int id = (int)(j < classification->left_lane_boundary_id_size() ? classification->left_lane_boundary_id(j).value() :
+				classification->right_lane_boundary_id(j - classification->left_lane_boundary_id_size()).value());
+			std::map<int, int>::iterator it = lnb_idx.find(id);
+			if (it != lnb_idx.end())
+			{
+				ln_lnb[i].push_back(it->second);
+			}
+		}
+	}
+	ln_flag.assign(obj_osi_internal.ln.size(), 0);
+	lnb_flag.assign(obj_osi_internal.lnb.size(), 0);
+	local_ln.clear();
+
+	static_gt_ready = true;
+	static_gt_dirty = true;
+
+	return 0;
+}
+
+void OSIReporter::ComposeStaticGroundTruth()
+{
+	std::string gt_buf;
+
+	static_ln.clear();
+	static_lnb.clear();
+
+	if (osi_radius > 0.0)
+	{
+		for (size_t i = 0; i < local_ln.size(); i++)
+		{
+			static_ln.push_back(local_ln[i]);
+
+			// Collect boundaries of the lane, each only once
+			for (size_t j = 0; j < ln_lnb[local_ln[i]].size(); j++)
+			{
+				int idx = ln_lnb[local_ln[i]][j];
+				if (!lnb_flag[idx])
+				{
+					lnb_flag[idx] = 1;
+					static_lnb.push_back(idx);
+				}
+			}
+		}
+
+		for (size_t i = 0; i < static_lnb.size(); i++)
+		{
+			lnb_flag[static_lnb[i]] = 0;
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < ln_buf.size(); i++)
+		{
+			static_ln.push_back((int)i);
+		}
+		for (size_t i = 0; i < lnb_buf.size(); i++)
+		{
+			static_lnb.push_back((int)i);
+		}
+	}
+
+	for (size_t i = 0; i < static_ln.size(); i++)
+	{
+		AppendMessageField(gt_buf, osi3::GroundTruth::kLaneFieldNumber, ln_buf[static_ln[i]]);
+	}
+	for (size_t i = 0; i < static_lnb.size(); i++)
+	{
+		AppendMessageField(gt_buf, osi3::GroundTruth::kLaneBoundaryFieldNumber, lnb_buf[static_lnb[i]]);
+	}
+
+	static_gt_buf.clear();
+	AppendMessageField(static_gt_buf, osi3::SensorView::kGlobalGroundTruthFieldNumber, gt_buf);
+	static_gt_dirty = false;
+}
+
+void OSIReporter::AttachStaticGroundTruth()
+{
+	if (static_gt_attached)
+	{
+		return;
+	}
+
+	// Heap allocated messages are moved by pointer, no copies. Detach before static_gt is cleared or deleted.
+	osi3::GroundTruth *gt = obj_osi_internal.sv->mutable_global_ground_truth();
+	for (size_t i = 0; i < static_ln.size(); i++)
+	{
+		gt->mutable_lane()->AddAllocated(obj_osi_internal.ln[static_ln[i]]);
+	}
+	for (size_t i = 0; i < static_lnb.size(); i++)
+	{
+		gt->mutable_lane_boundary()->AddAllocated(obj_osi_internal.lnb[static_lnb[i]]);
+	}
+
+	static_gt_attached = true;
+}
+
+void OSIReporter::DetachStaticGroundTruth()
+{
+	if (!static_gt_attached)
+	{
+		return;
+	}
+
+	osi3::GroundTruth *gt = obj_osi_internal.sv->mutable_global_ground_truth();
+	while (gt->lane_size() > 0)
+	{
+		gt->mutable_lane()->ReleaseLast();
+	}
+	while (gt->lane_boundary_size() > 0)
+	{
+		gt->mutable_lane_boundary()->ReleaseLast();
+	}
+
+	static_gt_attached = false;
+}
+
+void OSIReporter::SerializeOSISensorView()
+{
+	if (sv_serialized)
+	{
+		return;
+	}
+
+	// Serialize dynamic part, then append the static ground truth already serialized
+	bool attached = static_gt_attached;
+	DetachStaticGroundTruth();
+	obj_osi_internal.sv->SerializeToString(&osiSensorView.sensor_view);
+	osiSensorView.sensor_view.append(static_gt_buf);
+	osiSensorView.size = (unsigned int)osiSensorView.sensor_view.size();
+	if (attached)
+	{
+		AttachStaticGroundTruth();
+	}
+
+	sv_serialized = true;
+}
+
+int OSIReporter::UpdateOSILocalLanes(std::vector<ObjectState*> objectState)
+{
+	roadmanager::OpenDrive* opendrive = roadmanager::Position::GetOpenDrive();
+	roadmanager::RoadGrid* grid = opendrive->GetRoadGrid();
+
+	// Centers of interest: host object, or first object if no host, and sensors
+	osi_center.clear();
+	for (size_t i = 0; i < objectState.size(); i++)
+	{
+		if (objectState[i]->state_.control == static_cast<int>(Object::Control::HYBRID_EXTERNAL))
+		{
+			osi_center.push_back(std::make_pair(objectState[i]->state_.pos.GetX(), objectState[i]->state_.pos.GetY()));
+		}
+	}
+	if (osi_center.size() == 0 && objectState.size() > 0)
+	{
+		osi_center.push_back(std::make_pair(objectState[0]->state_.pos.GetX(), objectState[0]->state_.pos.GetY()));
+	}
+	osi_center.insert(osi_center.end(), sensor_pos.begin(), sensor_pos.end());
+
+	local_ln_new.clear();
+	for (size_t i = 0; i < osi_center.size(); i++)
+	{
+		double x = osi_center[i].first;
+		double y = osi_center[i].second;
+
+		if (grid->IsEmpty())
+		{
+			road_idx.resize(opendrive->GetNumOfRoads());
+			for (int j = 0; j < opendrive->GetNumOfRoads(); j++)
+			{
+				road_idx[j] = j;
+			}
+		}
+		else
+		{
+			grid->GetRoadsInRadius(x, y, osi_radius, road_idx);
+		}
+
+		for (size_t j = 0; j < road_idx.size(); j++)
+		{
+			roadmanager::Road* road = opendrive->GetRoadByIdx(road_idx[j]);
+			for (int k = 0; k < road->GetNumberOfLaneSections(); k++)
+			{
+				roadmanager::LaneSection* lane_section = road->GetLaneSectionByIdx(k);
+				for (int l = 0; l < lane_section->GetNumberOfLanes(); l++)
+				{
+					roadmanager::Lane* lane = lane_section->GetLaneByIdx(l);
+					std::map<int, int>::iterator it = ln_idx.find(lane->GetGlobalId());
+
+					if (it != ln_idx.end() && !ln_flag[it->second] && PolylineWithinRadius(lane->GetOSIPoints(), x, y, osi_radius))
+					{
+						ln_flag[it->second] = 1;
+						local_ln_new.push_back(it->second);
+					}
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < local_ln_new.size(); i++)
+	{
+		ln_flag[local_ln_new[i]] = 0;
+	}
+	std::sort(local_ln_new.begin(), local_ln_new.end());
+
+	if (local_ln_new != local_ln)
+	{
+		local_ln.swap(local_ln_new);
+		static_gt_dirty = true;
+	}
+
+	return 0;
+}
+
+int OSIReporter::UpdateOSIHostLane(std::vector<ObjectState*> objectState)
+{
+	int idx = -1;
+
+	for (size_t i = 0; i < objectState.size(); i++)
+	{
+		if (objectState[i]->state_.control == static_cast<int>(Object::Control::HYBRID_EXTERNAL))  // external hybrid is host
+		{
+			std::map<int, int>::iterator it = ln_idx.find(objectState[i]->state_.pos.GetLaneGlobalId());
+			if (it != ln_idx.end())
+			{
+				idx = it->second;
+			}
+		}
+	}
+
+	if (idx == host_lane_idx)
+	{
+		// No change, cached serialized lanes are still valid
+		return 0;
+	}
+
+	if (host_lane_idx > -1)
+	{
+		obj_osi_internal.ln[host_lane_idx]->mutable_classification()->set_is_host_vehicle_lane(false);
+		obj_osi_internal.ln[host_lane_idx]->SerializeToString(&ln_buf[host_lane_idx]);
+	}
+
+	if (idx > -1)
+	{
+		obj_osi_internal.ln[idx]->mutable_classification()->set_is_host_vehicle_lane(true);
+		obj_osi_internal.ln[idx]->SerializeToString(&ln_buf[idx]);
+	}
+
+	host_lane_idx = idx;
+	static_gt_dirty = true;
+
+	return 0;
+}
+
+int OSIReporter::UpdateOSILaneBoundary()
 {
 	//Retrieve opendrive class from RoadManager
-	static roadmanager::OpenDrive* opendrive = roadmanager::Position::GetOpenDrive();
+	roadmanager::OpenDrive* opendrive = roadmanager::Position::GetOpenDrive();
 
 	//Loop over all roads
 	for (int i = 0; i<opendrive->GetNumOfRoads(); i++)
@@ -436,6 +838,9 @@ int OSIReporter::UpdateOSILaneBoundary(std::vector<ObjectState*> objectState)
 
 		roadmanager::Road* road = opendrive->GetRoadByIdx(i);
 
+		// make sure OSI points are calculated, in case of lazy mode
+		opendrive->SetRoadOSI(road);
+
 		// loop over all lane sections
 		for (int j= 0; j<road->GetNumberOfLaneSections(); j++)
 		{
@@ -469,16 +874,9 @@ int OSIReporter::UpdateOSILaneBoundary(std::vector<ObjectState*> objectState)
 								int line_id = laneroadmarktypeline->GetGlobalId();
 
 								// Check if this line is already pushed to OSI
-								for (int h=0; h < obj_osi_internal.lnb.size(); h++)
+								if (lnb_idx.find(line_id) == lnb_idx.end())
 								{
-									if (obj_osi_internal.lnb[h]->mutable_id()->value() == line_id)
-									{
-										osi_laneboundary = obj_osi_internal.lnb[h];
-									}
-								}
-								if (!osi_laneboundary)
-								{
-									osi_laneboundary = obj_osi_internal.sv->mutable_global_ground_truth()->add_lane_boundary();
+									osi_laneboundary = obj_osi_internal.static_gt->add_lane_boundary();
 
 									// update id
 									osi_laneboundary->mutable_id()->set_value(line_id);
@@ -543,8 +941,8 @@ int OSIReporter::UpdateOSILaneBoundary(std::vector<ObjectState*> objectState)
 									// update limiting structure id only if the type of lane boundary is set to TYPE_STRUCTURE - for now it is not implemented
 									//osi_laneboundary->mutable_classification()->mutable_limiting_structure_id(0)->set_value(0);
 
+									lnb_idx[line_id] = (int)obj_osi_internal.lnb.size();
 									obj_osi_internal.lnb.push_back(osi_laneboundary);
-
 								}
 							}
 						}
@@ -556,16 +954,9 @@ int OSIReporter::UpdateOSILaneBoundary(std::vector<ObjectState*> objectState)
 					// Check if this line is already pushed to OSI
 					int boundary_id = laneboundary->GetGlobalId();
 					osi3::LaneBoundary* osi_laneboundary = 0;
-					for (int h=0; h < obj_osi_internal.lnb.size(); h++)
-					{
-						if (obj_osi_internal.lnb[h]->mutable_id()->value() == boundary_id)
-						{
-							osi_laneboundary = obj_osi_internal.lnb[h];
-						}
-					}
-					if (!osi_laneboundary)
+					if (lnb_idx.find(boundary_id) == lnb_idx.end())
 					{
-						osi_laneboundary = obj_osi_internal.sv->mutable_global_ground_truth()->add_lane_boundary();
+						osi_laneboundary = obj_osi_internal.static_gt->add_lane_boundary();
 
 						// update id
 						osi_laneboundary->mutable_id()->set_value(boundary_id);
@@ -587,6 +978,7 @@ int OSIReporter::UpdateOSILaneBoundary(std::vector<ObjectState*> objectState)
 						osi3::LaneBoundary_Classification_Color classific_col = osi3::LaneBoundary_Classification_Color::LaneBoundary_Classification_Color_COLOR_UNKNOWN;
 						osi_laneboundary->mutable_classification()->set_color(classific_col);
 
+						lnb_idx[boundary_id] = (int)obj_osi_internal.lnb.size();
 						obj_osi_internal.lnb.push_back(osi_laneboundary);
 					}
 				}
@@ -597,20 +989,10 @@ int OSIReporter::UpdateOSILaneBoundary(std::vector<ObjectState*> objectState)
 	return 0;
 }
 
-int OSIReporter::UpdateOSIRoadLane(std::vector<ObjectState*> objectState)
+int OSIReporter::UpdateOSIRoadLane()
 {
-	// Find ego vehicle 
-	roadmanager::Position pos;
-	for (size_t i = 0; i < objectState.size() ; i++)
-	{
-		if (objectState[i]->state_.control == 3) // external hybrid is host 
-		{
-			pos = objectState[i]->state_.pos;
-		}
-	}
-
 	//Retrieve opendrive class from RoadManager
-	static roadmanager::OpenDrive* opendrive = roadmanager::Position::GetOpenDrive();
+	roadmanager::OpenDrive* opendrive = roadmanager::Position::GetOpenDrive();
 
 	// Loop over all roads
 	for (int i = 0; i<opendrive->GetNumOfRoads(); i++)
@@ -618,6 +1000,9 @@ int OSIReporter::UpdateOSIRoadLane(std::vector<ObjectState*> objectState)
 
 		roadmanager::Road* road = opendrive->GetRoadByIdx(i);
 
+		// make sure OSI points are calculated, in case of lazy mode
+		opendrive->SetRoadOSI(road);
+
 		// loop over all lane sections
 		for (int j= 0; j<road->GetNumberOfLaneSections(); j++)
 		{
@@ -632,30 +1017,16 @@ int OSIReporter::UpdateOSIRoadLane(std::vector<ObjectState*> objectState)
 				int lane_id = lane->GetId();
 
 
-				// Check if this lane is already pushed to OSI - if yes just update
-				for (int jj=0; jj < obj_osi_internal.ln.size(); jj++)
-				{
-					if (obj_osi_internal.ln[jj]->mutable_id()->value() == lane_global_id)
-					{
-						osi_lane = obj_osi_internal.ln[jj];
-
-						// update classification is_host_vehicle_in_lane
-						bool is_ego_on_lane = false;
-						if (lane_id == pos.GetLaneId())
-						{
-							is_ego_on_lane = true;
-						}
-						osi_lane->mutable_classification()->set_is_host_vehicle_lane(is_ego_on_lane);
-						break;
-					}
-				}
 				// if the lane is not already in the osi message we add it all 
-				if (!osi_lane) 
+				if (ln_idx.find(lane_global_id) == ln_idx.end())
 				{
 					// LANE ID 
-					osi_lane = obj_osi_internal.sv->mutable_global_ground_truth()->add_lane();
+					osi_lane = obj_osi_internal.static_gt->add_lane();
 					osi_lane->mutable_id()->set_value(lane_global_id);
 
+					// updated by UpdateOSIHostLane()
+					osi_lane->mutable_classification()->set_is_host_vehicle_lane(false);
+
 					// CLASSIFICATION TYPE 
 					roadmanager::Lane::LaneType lanetype = lane->GetLaneType();
 					osi3::Lane_Classification_Type class_type;
@@ -890,6 +1261,7 @@ int OSIReporter::UpdateOSIRoadLane(std::vector<ObjectState*> objectState)
 					osi_lane->mutable_classification()->mutable_road_condition()->set_surface_roughness(temp);
 					osi_lane->mutable_classification()->mutable_road_condition()->set_surface_texture(temp);
 
+					ln_idx[lane_global_id] = (int)obj_osi_internal.ln.size();
 					obj_osi_internal.ln.push_back(osi_lane);
 				}
 			}
@@ -901,10 +1273,26 @@ int OSIReporter::UpdateOSIRoadLane(std::vector<ObjectState*> objectState)
 
 const char* OSIReporter::GetOSISensorView(int* size)
 {
+	if (static_gt_ready)
+	{
+		SerializeOSISensorView();
+	}
 	*size = osiSensorView.size;
 	return osiSensorView.sensor_view.data();
 }
 
+const osi3::SensorView* OSIReporter::GetOSISensorViewRaw()
+{
+	if (!static_gt_ready)
+	{
+		return 0;  // no update yet
+	}
+
+	AttachStaticGroundTruth();
+
+	return obj_osi_internal.sv;
+}
+
 const char* OSIReporter::GetOSIRoadLane(std::vector<ObjectState*> objectState, int* size, int object_id)
 {
 	// Check if object_id exists
@@ -916,62 +1304,43 @@ const char* OSIReporter::GetOSIRoadLane(std::vector<ObjectState*> objectState, i
 	}
 
 	// Find position of the object
-	roadmanager::Position pos; 
+	roadmanager::Position *pos = 0;
 	for (size_t i = 0; i < objectState.size() ; i++)
 	{
 		if (object_id == objectState[i]->state_.id)
 		{
-			pos = objectState[i]->state_.pos;
+			pos = &objectState[i]->state_.pos;
+			break;
 		}
 	}
 
 	// find the lane in the sensor view and save its index in the sensor view
-	int lane_id_of_vehicle = pos.GetLaneGlobalId();
-	int idx;
-	for (int i = 0; i<obj_osi_internal.ln.size(); i++)
+	int idx = pos ? GetLaneIdxfromIdOSI(pos->GetLaneGlobalId()) : -1;
+	if (idx == -1)
 	{
-		osi3::Identifier identifier = obj_osi_internal.ln[i]->id();
-		int found_id = (int)identifier.value();
-		if (found_id == lane_id_of_vehicle)
-		{
-			idx = i;
-			break; 
-		}
+		*size = 0;
+		return 0;
 	}
 
-	// serialize to string the single lane
-	obj_osi_internal.ln[idx]->SerializeToString(&osiRoadLane.osi_lane_info);
-	osiRoadLane.size = (unsigned int)obj_osi_internal.ln[idx]->ByteSizeLong();
-	*size = osiRoadLane.size;
-	return osiRoadLane.osi_lane_info.data();
+	// the lane is already serialized, kept up to date with host lane flag
+	*size = (int)ln_buf[idx].size();
+	return ln_buf[idx].data();
 }
 
 
 const char* OSIReporter::GetOSIRoadLaneBoundary(int* size, int global_id)
 {
 	// find the lane bounday in the sensor view and save its index
-	int idx = -1;
-	for (int i = 0; i<obj_osi_internal.lnb.size(); i++)
-	{
-		osi3::Identifier identifier = obj_osi_internal.lnb[i]->id();
-		int found_id = (int)identifier.value();
-		if (found_id == global_id)
-		{
-			idx = i;
-			break; 
-		}
-	}
-
-	if (idx == -1)
+	std::map<int, int>::iterator it = lnb_idx.find(global_id);
+	if (it == lnb_idx.end())
 	{
 		return 0; 
 	}
+	int idx = it->second;
 
-	// serialize to string the single lane
-	obj_osi_internal.lnb[idx]->SerializeToString(&osiRoadLaneBoundary.osi_lane_boundary_info);
-	osiRoadLaneBoundary.size = (unsigned int)obj_osi_internal.lnb[idx]->ByteSizeLong();
-	*size = osiRoadLaneBoundary.size;
-	return osiRoadLaneBoundary.osi_lane_boundary_info.data();
+	// the lane boundary is already serialized
+	*size = (int)lnb_buf[idx].size();
+	return lnb_buf[idx].data();
 }
 
 bool OSIReporter::IsCentralOSILane(int lane_idx)
@@ -995,18 +1364,12 @@ bool OSIReporter::IsCentralOSILane(int lane_idx)
 
 int OSIReporter::GetLaneIdxfromIdOSI(int lane_id)
 {
-	int idx = -1; 
-	for (int i = 0; i<obj_osi_internal.ln.size(); i++)
+	std::map<int, int>::iterator it = ln_idx.find(lane_id);
+	if (it == ln_idx.end())
 	{
-		osi3::Identifier identifier = obj_osi_internal.ln[i]->id();
-		int found_id = (int)identifier.value(); 
-		if (found_id == lane_id)
-		{
-			idx = i; 
-			break; 
-		}
+		return -1;
 	}
-	return idx; 
+	return it->second; 
 }
 
 void OSIReporter::GetOSILaneBoundaryIds(std::vector<ObjectState*> objectState, std::vector<int> &ids, int object_id)
@@ -1025,18 +1388,23 @@ void OSIReporter::GetOSILaneBoundaryIds(std::vector<ObjectState*> objectState, s
 	}	
 
 	// Find position of the object 
-	roadmanager::Position pos;
+	roadmanager::Position *pos = 0;
 	for (size_t i = 0; i < objectState.size(); i++)
 	{
 		if (object_id == objectState[i]->state_.id)
 		{
-			pos = objectState[i]->state_.pos;
-		}		
-	} 
+			pos = &objectState[i]->state_.pos;
+			break;
+		}
+	}
 
 	// find the lane in the sensor view and save its index
-	int lane_id_of_vehicle = pos.GetLaneGlobalId();
-	idx_central = GetLaneIdxfromIdOSI(lane_id_of_vehicle); 
+	idx_central = pos ? GetLaneIdxfromIdOSI(pos->GetLaneGlobalId()) : -1;
+	if (idx_central == -1)
+	{
+		ids = {-1, -1, -1, -1};
+		return;
+	}
 	
 	// find left and right lane boundary ids of central lane	
 	if (obj_osi_internal.ln[idx_central]->mutable_classification()->left_lane_boundary_id_size() == 0 )
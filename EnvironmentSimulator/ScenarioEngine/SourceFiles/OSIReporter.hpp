@@ -14,16 +14,38 @@
 
 #include "IdealSensor.hpp"
 #include "ScenarioGateway.hpp"
+#include "UDP.hpp"
+#include "SharedMemory.hpp"
 
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
+#include <map>
 #include <math.h>
 
 
 using namespace scenarioengine;
 
+namespace osi3
+{
+	class SensorView;
+	class GroundTruth;
+	class StationaryObject;
+	class MovingObject;
+	class Lane;
+	class LaneBoundary;
+}
+
+typedef struct
+{
+	std::string sensor_view;
+	unsigned int size;
+} OSISensorView;
+
+/**
+All OSI state is kept per reporter instance, so that several scenarios may run in parallel in one process
+*/
 class OSIReporter
 {
 public:
@@ -37,8 +59,9 @@ public:
 	bool OpenOSIFile();
 	/**
 	Writes SensorView in the OSI file
+	@param flush Wait until the message is in the file, else it's written in the background
 	*/
-	bool WriteOSIFile();
+	bool WriteOSIFile(bool flush = false);
 	/**
 	Fills up the osi message with SensorView
 	*/
@@ -52,15 +75,35 @@ public:
 	*/
 	int UpdateOSIMovingObject(ObjectState* objectState);
 	/**
-	Fills up the osi message with Lane Boundary
+	Builds the static part of the ground truth, i.e. lanes and lane boundaries, and caches it serialized.
+	Done once, on first update. The road network is not expected to change during a scenario.
 	*/
-	int UpdateOSILaneBoundary(std::vector<ObjectState*> objectState);
+	int UpdateOSIStaticGroundTruth();
 	/**
-	Fills up the osi message with Lanes
+	Fills up the static ground truth with Lane Boundary
 	*/
-	int UpdateOSIRoadLane(std::vector<ObjectState*> objectState);
+	int UpdateOSILaneBoundary();
+	/**
+	Fills up the static ground truth with Lanes
+	*/
+	int UpdateOSIRoadLane();
+	/**
+	Updates is_host_vehicle_lane flag of the lane where the host (hybrid external) vehicle is
+	Only lanes changing state are re-serialized.
+	*/
+	int UpdateOSIHostLane(std::vector<ObjectState*> objectState);
+	/**
+	Find lanes within OSI radius from host object and sensors, using the road grid spatial index
+	Only when lane selection changed the static ground truth is composed again.
+	*/
+	int UpdateOSILocalLanes(std::vector<ObjectState*> objectState);
 
 	const char* GetOSISensorView(int* size);
+	/**
+	Live SensorView, complete with static ground truth, as of last UpdateOSISensorView. No serialization or copy.
+	Read only, valid until next call to UpdateOSISensorView.
+	*/
+	const osi3::SensorView* GetOSISensorViewRaw();
 	const char* GetOSIRoadLane(std::vector<ObjectState*> objectState, int* size, int object_id);
 	const char* GetOSIRoadLaneBoundary(int* size, int global_id);
 	void GetOSILaneBoundaryIds(std::vector<ObjectState*> objectState, std::vector<int>& ids, int object_id);
@@ -68,11 +111,90 @@ public:
 	int GetLaneIdxfromIdOSI(int lane_id);
 	int OpenSocket(std::string ipaddr);
 	int CloseSocket();
-	int GetSocket() { return sendSocket; }
+	int GetSocket() { return udp_sender.IsOpen() ? udp_sender.GetSocket() : 0; }
+
+	/**
+	Publish SensorView and a table of all object states in shared memory on each update, for readers on the same host.
+	The table holds up to SE_SHM_MAX_OBJECTS objects, any further objects are left out.
+	@param name Name of the shared memory, readers open the same name
+	@return 0 on success, -1 on failure
+	*/
+	int OpenSharedMemory(std::string name);
+	void CloseSharedMemory();
+	bool IsSharedMemoryOpen() { return shm_writer.IsOpen(); }
 
 	void ReportSensors(std::vector<ObjectSensor*> sensor);
 
+	/**
+	Limit ground truth to lanes, lane boundaries and objects within given distance from the host (hybrid external)
+	object, or first object if there is no host, and from any sensor. Useful for huge road networks.
+	@param radius Distance in meters, 0 or less means entire road network and all objects (default)
+	*/
+	void SetOSIRadius(double radius);
+	double GetOSIRadius() { return osi_radius; }
+
 private:
-	int sendSocket;
+	SE_UDPFragmentSender udp_sender;
+	SE_SharedMemoryWriter shm_writer;
+	std::vector<SE_ShmObjectState> shm_objects;
+	bool shm_objects_truncated;  // object table did not fit, reported once
+
+	/**
+	Select lanes (all or within OSI radius) and their boundaries into static_ln and static_lnb, then concatenate
+	their cached serialized form into one global_ground_truth field of SensorView
+	*/
+	void ComposeStaticGroundTruth();
+
+	/**
+	Add the selected static lanes and lane boundaries to the live SensorView, sharing the messages with static_gt
+	*/
+	void AttachStaticGroundTruth();
+
+	/**
+	Remove the shared lanes and lane boundaries from the live SensorView again, without deleting them
+	*/
+	void DetachStaticGroundTruth();
+
+	/**
+	Serialize the dynamic part of SensorView and append the static ground truth, unless already done for this update
+	*/
+	void SerializeOSISensorView();
+
+	bool IsWithinOSIRadius(double x, double y);
+
+	struct {
+		osi3::SensorView *sv;  // dynamic content only: timestamp and objects, static part attached on raw access
+		osi3::GroundTruth *static_gt;  // lanes and lane boundaries
+		std::vector<osi3::StationaryObject*> sobj;
+		std::vector<osi3::MovingObject*> mobj;
+		std::vector<osi3::Lane*> ln;
+		std::vector<osi3::LaneBoundary*> lnb;
+	} obj_osi_internal;
+
+	std::map<int, int> ln_idx;  // lane global id -> index in obj_osi_internal.ln
+	std::map<int, int> lnb_idx;  // lane boundary global id -> index in obj_osi_internal.lnb
+	std::vector<std::string> ln_buf;  // serialized lanes, one per lane
+	std::vector<std::string> lnb_buf;  // serialized lane boundaries, one per boundary
+	std::vector<std::vector<int>> ln_lnb;  // per lane, index of its lane boundaries
+	std::string static_gt_buf;  // serialized static ground truth, tagged as SensorView field
+	std::vector<int> static_ln;  // lanes currently included in ground truth, index into obj_osi_internal.ln
+	std::vector<int> static_lnb;  // lane boundaries currently included in ground truth
+	bool static_gt_ready;
+	bool static_gt_dirty;
+	bool static_gt_attached;  // static_ln and static_lnb are added to obj_osi_internal.sv
+	bool sv_serialized;  // osiSensorView is up to date with obj_osi_internal.sv
+	int host_lane_idx;
+
+	double osi_radius;
+	std::vector<std::pair<double, double>> osi_center;  // x, y of host object and sensors
+	std::vector<std::pair<double, double>> sensor_pos;  // x, y of sensors, as of last ReportSensors()
+	std::vector<int> local_ln;  // lanes within radius, sorted index into obj_osi_internal.ln
+	std::vector<int> local_ln_new;
+	std::vector<int> road_idx;
+	std::vector<char> ln_flag;  // per lane, temporary marks
+	std::vector<char> lnb_flag;  // per lane boundary, temporary marks
 
+	OSISensorView osiSensorView;
+	SE_AsyncWriter osi_file;
+	std::string osi_file_buf;
 };
@@ -20,6 +20,12 @@ ScenarioEngine::ScenarioEngine(std::string oscFilename, double headstart_time, R
 	InitScenario(oscFilename, headstart_time, control_mode_first_vehicle);
 }
 
+ScenarioEngine::ScenarioEngine(std::string oscFilename, std::vector<ParameterStruct> &parameters, double headstart_time, RequestControlMode control_mode_first_vehicle)
+{
+	parameterOverrides_ = parameters;
+	InitScenario(oscFilename, headstart_time, control_mode_first_vehicle);
+}
+
 ScenarioEngine::ScenarioEngine(const pugi::xml_document &xml_doc, double headstart_time, RequestControlMode control_mode_first_vehicle)
 {
 	InitScenario(xml_doc, headstart_time, control_mode_first_vehicle);
@@ -58,6 +64,8 @@ ScenarioEngine::~ScenarioEngine()
 void ScenarioEngine::step(double deltaSimTime, bool initial)
 
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_STEP);
+
 	simulationTime += deltaSimTime;
 
 	if (entities.object_.size() == 0)
@@ -73,18 +81,18 @@ void ScenarioEngine::step(double deltaSimTime, bool initial)
 			if (entities.object_[i]->control_ == Object::Control::EXTERNAL ||
 				entities.object_[i]->control_ == Object::Control::HYBRID_EXTERNAL)
 			{
-				ObjectState o;
+				ObjectState *o = scenarioGateway.getObjectStatePtrById(entities.object_[i]->id_);
 
-				if (scenarioGateway.getObjectStateById(entities.object_[i]->id_, o) != 0)
+				if (o == 0)
 				{
 					LOG("Gateway did not provide state for external car %d", entities.object_[i]->id_);
 				}
 				else
 				{
-					entities.object_[i]->pos_ = o.state_.pos;
-					entities.object_[i]->speed_ = o.state_.speed;
-					entities.object_[i]->wheel_angle_ = o.state_.wheel_angle;
-					entities.object_[i]->wheel_rot_ = o.state_.wheel_rot;
+					entities.object_[i]->pos_ = o->state_.pos;
+					entities.object_[i]->speed_ = o->state_.speed;
+					entities.object_[i]->wheel_angle_ = o->state_.wheel_angle;
+					entities.object_[i]->wheel_rot_ = o->state_.wheel_rot;
 				}
 			}
 		}
@@ -109,6 +117,7 @@ void ScenarioEngine::step(double deltaSimTime, bool initial)
 		if (init.private_action_[i]->IsActive())
 		{
 			//LOG("Stepping action of type %d", init.private_action_[i]->action_[j]->type_)
+			SE_PROFILE_SCOPE(SE_PROFILE_ACTIONS);
 			init.private_action_[i]->Step(deltaSimTime, getSimulationTime());
 			init.private_action_[i]->UpdateState();
 		}
@@ -265,6 +274,7 @@ void ScenarioEngine::step(double deltaSimTime, bool initial)
 								{
 									if (event->action_[n]->IsActive())
 									{
+										SE_PROFILE_SCOPE(SE_PROFILE_ACTIONS);
 										event->action_[n]->Step(deltaSimTime, getSimulationTime());
 
 										active = active || (event->action_[n]->IsActive());
@@ -392,6 +402,14 @@ void ScenarioEngine::parseScenario(RequestControlMode control_mode_first_vehicle
 
 	scenarioReader->parseGlobalParameterDeclarations();
 
+	for (size_t i = 0; i < parameterOverrides_.size(); i++)
+	{
+		if (scenarioReader->setParameterValue(parameterOverrides_[i].name, parameterOverrides_[i].value) != 0)
+		{
+			throw std::invalid_argument(std::string("Can't set undeclared parameter ") + parameterOverrides_[i].name);
+		}
+	}
+
 	// Init road manager
 	scenarioReader->parseRoadNetwork(roadNetwork);
 
@@ -487,6 +505,8 @@ void ScenarioEngine::parseScenario(RequestControlMode control_mode_first_vehicle
 
 void ScenarioEngine::stepObjects(double dt)
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_STEP_OBJECTS);
+
 	for (size_t i = 0; i < entities.object_.size(); i++)
 	{
 		Object *obj = entities.object_[i];
@@ -49,6 +49,12 @@ namespace scenarioengine
 
 		ScenarioEngine(std::string oscFilename, double headstart_time = DEFAULT_HEADSTART_TIME, RequestControlMode control_mode_first_vehicle = CONTROL_BY_OSC);
 		ScenarioEngine(const pugi::xml_document &xml_doc, double headstart_time = DEFAULT_HEADSTART_TIME, RequestControlMode control_mode_first_vehicle = CONTROL_BY_OSC);
+
+		/**
+		Load scenario, overriding values of global parameter declarations
+		@param parameters Name and value of parameters to override
+		*/
+		ScenarioEngine(std::string oscFilename, std::vector<ParameterStruct> &parameters, double headstart_time = DEFAULT_HEADSTART_TIME, RequestControlMode control_mode_first_vehicle = CONTROL_BY_OSC);
 		~ScenarioEngine();
 
 		void InitScenario(std::string oscFilename, double headstart_time, RequestControlMode control_mode_first_vehicle = CONTROL_BY_OSC);
@@ -84,6 +90,7 @@ namespace scenarioengine
 		Vehicle sumotemplate;
 		ScenarioGateway scenarioGateway;
 		SumoController *sumocontroller;
+		std::vector<ParameterStruct> parameterOverrides_;
 
 		// execution control flags
 		bool quit_flag;
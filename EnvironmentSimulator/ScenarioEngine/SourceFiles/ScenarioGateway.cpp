@@ -124,7 +124,7 @@ void ObjectState::Print()
 
 // ScenarioGateway
 
-ScenarioGateway::ScenarioGateway()
+ScenarioGateway::ScenarioGateway() : record_flags_(0)
 {
 }
 
@@ -135,37 +135,60 @@ ScenarioGateway::~ScenarioGateway()
 		delete objectState_[i];
 	}
 	objectState_.clear();
+	objectIdx_.clear();
+	ClearRecorded();
 
-	data_file_.flush();
-	data_file_.close();
+	if (data_file_.GetNumberOfBackpressured() > 0)
+	{
+		LOG("Recording: %llu records had to wait for file writing", data_file_.GetNumberOfBackpressured());
+	}
+	data_file_.Close();
 }
 
 ObjectState* ScenarioGateway::getObjectStatePtrById(int id)
 {
-	for (size_t i = 0; i < objectState_.size(); i++)
+	std::unordered_map<int, int>::iterator it = objectIdx_.find(id);
+
+	if (it == objectIdx_.end())
 	{
-		if (objectState_[i]->state_.id == id)
-		{
-			return objectState_[i];
-		}
+		return 0;
 	}
 
-	return 0;
+	return objectState_[it->second];
 }
 
 int ScenarioGateway::getObjectStateById(int id, ObjectState& objectState)
 {
+	ObjectState* obj_state = getObjectStatePtrById(id);
+
+	if (obj_state == 0)
+	{
+		// Indicate not found by returning non zero
+		return -1;
+	}
+
+	objectState = *obj_state;
+
+	return 0;
+}
+
+void ScenarioGateway::PublishSnapshot()
+{
+	std::vector<ObjectStateStruct> &snapshot = snapshot_.GetBack();
+
+	snapshot.resize(objectState_.size());
 	for (size_t i = 0; i < objectState_.size(); i++)
 	{
-		if (objectState_[i]->state_.id == id)
-		{
-			objectState = *objectState_[i];
-			return 0;
-		}
+		snapshot[i] = objectState_[i]->state_;
 	}
 
-	// Indicate not found by returning non zero
-	return -1;
+	snapshot_.Publish();
+}
+
+void ScenarioGateway::addObjectState(ObjectState* obj_state)
+{
+	objectIdx_[obj_state->state_.id] = (int)objectState_.size();
+	objectState_.push_back(obj_state);
 }
 
 void ScenarioGateway::updateObjectInfo(ObjectState* obj_state, double timestamp, double speed, double wheel_angle, double wheel_rot)
@@ -181,9 +204,117 @@ void ScenarioGateway::updateObjectInfo(ObjectState* obj_state, double timestamp,
 	obj_state->state_.wheel_rot = (float)wheel_rot;
 
 	// Write status to file - for later replay
-	if (data_file_.is_open())
+	if (data_file_.IsOpen())
+	{
+		WriteStateToFile(obj_state);
+	}
+}
+
+static void StateToObjectRecord(ObjectStateStruct &state, ReplayObjectRecord &record)
+{
+	memset(&record, 0, sizeof(record));
+	record.id = state.id;
+	record.model_id = state.model_id;
+	record.obj_type = state.obj_type;
+	record.obj_category = state.obj_category;
+	record.control = state.control;
+	strncpy(record.name, state.name, NAME_LEN);
+	record.bb_center[0] = state.boundingbox.center_.x_;
+	record.bb_center[1] = state.boundingbox.center_.y_;
+	record.bb_center[2] = state.boundingbox.center_.z_;
+	record.bb_dimensions[0] = state.boundingbox.dimensions_.width_;
+	record.bb_dimensions[1] = state.boundingbox.dimensions_.length_;
+	record.bb_dimensions[2] = state.boundingbox.dimensions_.height_;
+}
+
+static void StateToStateRecord(ObjectStateStruct &state, ReplayStateRecord &record)
+{
+	record.id = state.id;
+	record.timestamp = state.timeStamp;
+	record.x = state.pos.GetX();
+	record.y = state.pos.GetY();
+	record.z = state.pos.GetZ();
+	record.h = (float)state.pos.GetH();
+	record.p = (float)state.pos.GetP();
+	record.r = (float)state.pos.GetR();
+	record.road_id = state.pos.GetTrackId();
+	record.lane_id = state.pos.GetLaneId();
+	record.s = (float)state.pos.GetS();
+	record.offset = (float)state.pos.GetOffset();
+	record.speed = state.speed;
+	record.wheel_angle = state.wheel_angle;
+	record.wheel_rot = state.wheel_rot;
+}
+
+namespace scenarioengine
+{
+	// Records as last written to file, i.e. quantized in case of delta encoding, so that the reader ends up with same values
+	struct RecordedObject
+	{
+		ReplayObjectRecord object;
+		long long fields[REPLAY_STATE_DELTA_N_FIELDS];
+	};
+}
+
+void ScenarioGateway::ClearRecorded()
+{
+	for (std::map<int, RecordedObject*>::iterator it = recorded_.begin(); it != recorded_.end(); ++it)
+	{
+		delete it->second;
+	}
+	recorded_.clear();
+}
+
+void ScenarioGateway::WriteStateToFile(ObjectState* obj_state)
+{
+	ObjectStateStruct &state = obj_state->state_;
+	RecordedObject *&prev = recorded_[state.id];
+	bool first = prev == 0;
+
+	if (first)
+	{
+		prev = new RecordedObject;
+		memset(prev, 0, sizeof(RecordedObject));
+	}
+
+	// Static info only when new or changed
+	ReplayObjectRecord object_record;
+	StateToObjectRecord(state, object_record);
+	if (first || memcmp(&object_record, &prev->object, sizeof(object_record)) != 0)
+	{
+		char buf[1 + sizeof(object_record)];
+		buf[0] = REPLAY_RECORD_OBJECT;
+		memcpy(&buf[1], &object_record, sizeof(object_record));
+		data_file_.Write(buf, sizeof(buf));
+		prev->object = object_record;
+	}
+
+	ReplayStateRecord state_record;
+	StateToStateRecord(state, state_record);
+
+	if (record_flags_ & REPLAY_FLAG_DELTA)
 	{
-		data_file_.write((char*)(&obj_state->state_), sizeof(obj_state->state_));
+		// Differences to previous record of the object, or to zero for first one
+		long long fields[REPLAY_STATE_DELTA_N_FIELDS];
+		ReplayStateToFields(state_record, fields);
+
+		unsigned char buf[1 + 10 * (REPLAY_STATE_DELTA_N_FIELDS + 1)];
+		int n = 0;
+		buf[n++] = REPLAY_RECORD_STATE_DELTA;
+		n += ReplayEncodeVarint(state.id, &buf[n]);
+		for (int i = 0; i < REPLAY_STATE_DELTA_N_FIELDS; i++)
+		{
+			n += ReplayEncodeVarint(fields[i] - prev->fields[i], &buf[n]);
+			prev->fields[i] = fields[i];
+		}
+		data_file_.Write((char*)buf, n);
+	}
+	else
+	{
+		char buf[1 + sizeof(state_record)];
+		buf[0] = REPLAY_RECORD_STATE;
+		memcpy(&buf[1], &state_record, sizeof(state_record));
+		data_file_.Write(buf, sizeof(buf));
 	}
 }
 
@@ -191,6 +322,7 @@ void ScenarioGateway::reportObject(int id, std::string name, int obj_type, int o
 	double timestamp, double speed, double wheel_angle, double wheel_rot,
 	roadmanager::Position* pos)
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_GATEWAY);
 	ObjectState* obj_state = getObjectStatePtrById(id);
 
 	if (obj_state == 0)
@@ -203,7 +335,7 @@ void ScenarioGateway::reportObject(int id, std::string name, int obj_type, int o
 		obj_state->state_.pos.SetSnapLaneTypes(roadmanager::Lane::LaneType::LANE_TYPE_ANY_DRIVING);
 
 		// Add object to collection
-		objectState_.push_back(obj_state);
+		addObjectState(obj_state);
 	}
 	else
 	{
@@ -217,6 +349,7 @@ void ScenarioGateway::reportObject(int id, std::string name, int obj_type, int o
 	double timestamp, double speed, double wheel_angle, double wheel_rot,
 	double x, double y, double z, double h, double p, double r)
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_GATEWAY);
 	ObjectState* obj_state = getObjectStatePtrById(id);
 
 	if (obj_state == 0)
@@ -226,7 +359,7 @@ void ScenarioGateway::reportObject(int id, std::string name, int obj_type, int o
 		obj_state = new ObjectState(id, name, obj_type, obj_category, model_id, control, boundingbox, timestamp, speed, wheel_angle, wheel_rot, x, y, z, h, p, r);
 
 		// Add object to collection
-		objectState_.push_back(obj_state);
+		addObjectState(obj_state);
 	}
 	else
 	{
@@ -240,6 +373,7 @@ void ScenarioGateway::reportObject(int id, std::string name, int obj_type, int o
 	double timestamp, double speed, double wheel_angle, double wheel_rot,
 	int roadId, int laneId, double laneOffset, double s)
 {
+	SE_PROFILE_SCOPE(SE_PROFILE_GATEWAY);
 	ObjectState* obj_state = getObjectStatePtrById(id);
 
 	if (obj_state == 0)
@@ -249,7 +383,7 @@ void ScenarioGateway::reportObject(int id, std::string name, int obj_type, int o
 		obj_state = new ObjectState(id, name, obj_type, obj_category, model_id, control, boundingbox,timestamp, speed, wheel_angle, wheel_rot, roadId, laneId, laneOffset, s);
 
 		// Add object to collection
-		objectState_.push_back(obj_state);
+		addObjectState(obj_state);
 	}
 	else
 	{
@@ -261,41 +395,60 @@ void ScenarioGateway::reportObject(int id, std::string name, int obj_type, int o
 
 void ScenarioGateway::removeObject(int id)
 {
-	for (size_t i = 0; i < objectState_.size(); i++) 
+	std::unordered_map<int, int>::iterator it = objectIdx_.find(id);
+
+	if (it == objectIdx_.end())
 	{
-		if (objectState_[i]->state_.id == id) 
-		{
-			objectState_.erase(objectState_.begin() + i);
-		}
+		return;
+	}
+
+	int idx = it->second;
+	delete objectState_[idx];
+	objectState_.erase(objectState_.begin() + idx);
+	objectIdx_.erase(it);
+
+	// Keep order of remaining objects, just update indices of the ones after
+	for (size_t i = idx; i < objectState_.size(); i++)
+	{
+		objectIdx_[objectState_[i]->state_.id] = (int)i;
 	}
 }
 
 void ScenarioGateway::removeObject(std::string name)
 {
-	for (size_t i = 0; i < objectState_.size(); i++) 
+	for (size_t i = 0; i < objectState_.size(); i++)
 	{
-		if (objectState_[i]->state_.name == name) 
+		if (objectState_[i]->state_.name == name)
 		{
-			objectState_.erase(objectState_.begin() + i);
+			removeObject(objectState_[i]->state_.id);
+			i--;
 		}
 	}
 }
 
-int ScenarioGateway::RecordToFile(std::string filename, std::string odr_filename, std::string  model_filename)
+int ScenarioGateway::RecordToFile(std::string filename, std::string odr_filename, std::string  model_filename, int flags)
 {
 	if (!filename.empty())
 	{
-		data_file_.open(filename, std::ofstream::binary);
-		if (data_file_.fail())
+		// Never drop records, since any gap would break decoding of delta records
+		if (data_file_.Open(filename, true) != 0)
 		{
 			LOG("Cannot open file: %s", filename.c_str());
 			return -1;
 		}
-		ReplayHeader header;
-		strncpy(header.odr_filename, FileNameOf(odr_filename).c_str(), REPLAY_FILENAME_SIZE);
-		strncpy(header.model_filename, FileNameOf(model_filename).c_str(), REPLAY_FILENAME_SIZE);
+		record_flags_ = flags;
+		ClearRecorded();
 
-		data_file_.write((char*)&header, sizeof(header));
+		ReplayHeader header;
+		memset(&header, 0, sizeof(header));
+		strncpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+		header.version = REPLAY_VERSION;
+		header.flags = flags;
+		strncpy(header.odr_filename, FileNameOf(odr_filename).c_str(), REPLAY_FILENAME_SIZE - 1);
+		strncpy(header.model_filename, FileNameOf(model_filename).c_str(), REPLAY_FILENAME_SIZE - 1);
+		strncpy(header.schema, REPLAY_STATE_SCHEMA, REPLAY_SCHEMA_SIZE - 1);
+
+		data_file_.Write((char*)&header, sizeof(header));
 	}
 
 	return 0;
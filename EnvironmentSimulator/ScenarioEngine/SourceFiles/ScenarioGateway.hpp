@@ -11,6 +11,8 @@
  */
 
 #pragma once
+#include <map>
+#include <unordered_map>
 #include "RoadManager.hpp"
 #include "OSCBoundingBox.hpp"
 #include "Entities.hpp"
@@ -56,6 +58,8 @@ namespace scenarioengine
 	};
 
 
+	struct RecordedObject;  // last records written of an object, defined along with the writer
+
 	class ScenarioGateway
 	{
 	public:
@@ -79,15 +83,54 @@ namespace scenarioengine
 		int getNumberOfObjects() { return (int)objectState_.size(); }
 		ObjectState getObjectStateByIdx(int idx) { return *objectState_[idx]; }
 		ObjectState *getObjectStatePtrByIdx(int idx) { return objectState_[idx]; }
+
+		/**
+		Find object state by id, constant time
+		@param id Object id
+		@return Pointer to the state, valid until object is removed. 0 if not found.
+		*/
 		ObjectState *getObjectStatePtrById(int id);
-		int getObjectStateById(int idx, ObjectState &objState);
-		int RecordToFile(std::string filename, std::string odr_filename, std::string model_filename);
+
+		/**
+		Get a copy of the object state. Prefer getObjectStatePtrById() to avoid the copy.
+		@return 0 on success, -1 if not found
+		*/
+		int getObjectStateById(int id, ObjectState &objState);
+
+		/**
+		Record object states into a file, for later replay
+		@param filename Recording filename
+		@param odr_filename OpenDRIVE filename, stored in file header
+		@param model_filename 3D model filename, stored in file header
+		@param flags Recording format options, see ReplayFlags in Replay.hpp
+		@return 0 on success, -1 on failure
+		*/
+		int RecordToFile(std::string filename, std::string odr_filename, std::string model_filename, int flags = 0);
+
+		/**
+		Copy current state of all objects into a snapshot for other threads, call once per step
+		*/
+		void PublishSnapshot();
+
+		/**
+		Get a consistent view of all object states, as of latest PublishSnapshot(). Never blocks.
+		Only one thread may read snapshots.
+		@return Object states, in same order as objectState_. Valid until next call.
+		*/
+		std::vector<ObjectStateStruct> &GetSnapshot() { return snapshot_.GetFront(); }
 
 		std::vector<ObjectState*> objectState_;
 
 	private:
 		void updateObjectInfo(ObjectState* obj_state, double timestamp, double speed, double wheel_angle, double wheel_rot);
-		std::ofstream data_file_;
+		void WriteStateToFile(ObjectState* obj_state);
+		void addObjectState(ObjectState* obj_state);
+		void ClearRecorded();
+		std::unordered_map<int, int> objectIdx_;  // object id -> index in objectState_
+		SE_TripleBuffer<std::vector<ObjectStateStruct> > snapshot_;
+		SE_AsyncWriter data_file_;
+		int record_flags_;
+		std::map<int, RecordedObject*> recorded_;  // baseline for static info and delta records, by object id
 	};
 
 	class SumoController
@@ -38,6 +38,23 @@ void ScenarioReader::parseGlobalParameterDeclarations()
 	paramDeclarationsSize_ = (int)parameterDeclarations_.Parameter.size();
 }
 
+int ScenarioReader::setParameterValue(std::string name, std::string value)
+{
+	for (size_t i = 0; i < parameterDeclarations_.Parameter.size(); i++)
+	{
+		if (parameterDeclarations_.Parameter[i].name == name)
+		{
+			LOG("setting %s = %s", name.c_str(), value.c_str());
+			parameterDeclarations_.Parameter[i].value = value;
+			return 0;
+		}
+	}
+
+	LOG("Parameter %s not declared, can't set value %s", name.c_str(), value.c_str());
+
+	return -1;
+}
+
 void ScenarioReader::RestoreParameterDeclarations()
 {
 	parameterDeclarations_.Parameter.erase(
@@ -47,6 +47,12 @@ namespace scenarioengine
 		// ParameterDeclarations
 		void parseGlobalParameterDeclarations();
 
+		/**
+		Override value of a declared global parameter, call after parseGlobalParameterDeclarations()
+		@return 0 if successful, -1 if parameter is not declared
+		*/
+		int setParameterValue(std::string name, std::string value);
+
 		// Catalogs
 		void parseCatalogs();
 		Catalog* LoadCatalog(std::string name);
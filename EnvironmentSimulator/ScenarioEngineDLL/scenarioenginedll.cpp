@@ -19,54 +19,106 @@ using namespace scenarioengine;
 
 #define EGO_ID 0	// need to match appearing order in the OpenSCENARIO file
 
-static ScenarioPlayer *player = 0;
+/*
+  A scenario instance, i.e. player with arguments and road network context
+  Instances created by SE_CreateInstance() have their own road network context, so they can run in parallel threads.
+  The default instance, used by the functions without instance argument, uses the process wide road network.
+*/
+class ScenarioInstance
+{
+public:
+	ScenarioInstance(bool own_road_network) : player(0), argv(0), argc(0), odr_context(0)
+	{
+		if (own_road_network)
+		{
+			odr_context = new roadmanager::OpenDriveContext;
+		}
+	}
 
-static char **argv = 0;
-static int argc = 0;
-static std::vector<std::string> args_v;
+	~ScenarioInstance()
+	{
+		Reset();
+		if (odr_context)
+		{
+			delete odr_context;
+		}
+	}
 
-static void resetScenario(void)
-{
-	if (player)
+	void Reset()
 	{
-		delete player;
-		player = 0;
+		if (player)
+		{
+			delete player;
+			player = 0;
+		}
+		args_v.clear();
+		if (argv)
+		{
+			for (int i = 0; i < argc; i++)
+			{
+				free(argv[i]);
+			}
+			free(argv);
+			argv = 0;
+			argc = 0;
+		}
 	}
-	args_v.clear();
-	if (argv)
+
+	void AddArgument(const char *str)
 	{
+		// split separate argument strings
+		std::vector<std::string> args = SplitString(std::string(str), ' ');
+
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			args_v.push_back(args[i]);
+		}
+	}
+
+	void ConvertArguments()
+	{
+		argc = (int)args_v.size();
+		argv = (char**)malloc(argc * sizeof(char*));
 		for (int i = 0; i < argc; i++)
 		{
-			free(argv[i]);
+			argv[i] = (char*)malloc((args_v[i].size() + 1) * sizeof(char));
+			strcpy(argv[i], args_v[i].c_str());
+			LOG("arg[%d]: %s", i, argv[i]);
 		}
-		free(argv);
-		argv = 0;
-		argc = 0;
 	}
-}
 
-static void AddArgument(const char *str)
-{
-	// split separate argument strings
-	std::vector<std::string> args = SplitString(std::string(str), ' ');
+	ScenarioPlayer *player;
+	char **argv;
+	int argc;
+	std::vector<std::string> args_v;
+	roadmanager::OpenDriveContext *odr_context;
+};
 
-	for (size_t i = 0; i < args.size(); i++)
+/*
+  Activates the road network of an instance on the calling thread, for the duration of an API call
+*/
+class InstanceScope
+{
+public:
+	InstanceScope(ScenarioInstance *instance) : previous_(roadmanager::OpenDriveContext::GetActive())
 	{
-		args_v.push_back(args[i]);
+		if (instance->odr_context)
+		{
+			instance->odr_context->Activate();
+		}
 	}
-}
 
-static void ConvertArguments()
-{
-	argc = (int)args_v.size();
-	argv = (char**)malloc(argc * sizeof(char*));
-	for (int i = 0; i < argc; i++)
+	~InstanceScope()
 	{
-		argv[i] = (char*)malloc((args_v[i].size() + 1) * sizeof(char));
-		strcpy(argv[i], args_v[i].c_str());
-		LOG("arg[%d]: %s", i, argv[i]);
+		roadmanager::OpenDriveContext::Restore(previous_);
 	}
-}
+
+private:
+	roadmanager::OpenDriveContext *previous_;
+};
+
+static ScenarioInstance default_instance(false);
+static ScenarioPlayer *&player = default_instance.player;
 
 static void copyStateFromScenarioGateway(SE_ScenarioObjectState *state, ObjectStateStruct *gw_state)
 {
@@ -203,104 +255,120 @@ static int GetRoadInfoAlongGhostTrail(int object_id, float lookahead_distance, S
 	return 0;
 }
 
-extern "C"
+static int StartInstance(ScenarioInstance *instance)
 {
-	SE_DLL_API int SE_Init(const char *oscFilename, int control, int use_viewer, int threads, int record, float headstart_time)
+	instance->ConvertArguments();
+
+	// Create scenario engine
+	try
 	{
-		resetScenario();
+		// Initialize the scenario engine and viewer
+		instance->player = new ScenarioPlayer(instance->argc, instance->argv);
+
+		// Fast forward to time == 0 - launching hybrid ghost vehicles
+		//while (player->scenarioEngine->getSimulationTime() < 0)
+		//{
+		//	player->Frame(0.05);
+		//}
+
+	}
+	catch (const std::exception& e)
+	{
+		LOG(e.what());
+		instance->Reset();
+		return -1;
+	}
+
+	return 0;
+}
+
+static int InitInstance(ScenarioInstance *instance, const char *oscFilename, int control, int use_viewer, int threads, int record, float headstart_time)
+{
+	instance->Reset();
 
 #ifndef _SCENARIO_VIEWER
-		if (use_viewer)
-		{
-			LOG("use_viewer flag set, but no viewer available (compiled without -D _SCENARIO_VIEWER");
-		}
+	if (use_viewer)
+	{
+		LOG("use_viewer flag set, but no viewer available (compiled without -D _SCENARIO_VIEWER");
+	}
 #endif
 
-		AddArgument("viewer");  // name of application
-		AddArgument("--osc");
-		AddArgument(oscFilename);
-		AddArgument("--control");
-		if (control == 0)
-		{
-			AddArgument("osc");
-		}
-		else if (control == 1)
-		{
-			AddArgument("internal");
-		}
-		else if (control == 2)
-		{
-			AddArgument("external");
-		}
-		else if (control == 3)
-		{
-			AddArgument("hybrid");
-		}
-		if (record)
-		{
-			AddArgument("--record scenario.dat");
-		}
-		if (use_viewer)
-		{
-			AddArgument("--window 50 50 800 400");
-		}
-		else
-		{
-			AddArgument("--headless");
-		}
-		if (threads)
-		{
-			AddArgument("--threads");
-			LOG("Threads arg created");
-		}
+	instance->AddArgument("viewer");  // name of application
+	instance->AddArgument("--osc");
+	instance->AddArgument(oscFilename);
+	instance->AddArgument("--control");
+	if (control == 0)
+	{
+		instance->AddArgument("osc");
+	}
+	else if (control == 1)
+	{
+		instance->AddArgument("internal");
+	}
+	else if (control == 2)
+	{
+		instance->AddArgument("external");
+	}
+	else if (control == 3)
+	{
+		instance->AddArgument("hybrid");
+	}
+	if (record)
+	{
+		instance->AddArgument("--record scenario.dat");
+	}
+	if (use_viewer)
+	{
+		instance->AddArgument("--window 50 50 800 400");
+	}
+	else
+	{
+		instance->AddArgument("--headless");
+	}
+	if (threads)
+	{
+		instance->AddArgument("--threads");
+		LOG("Threads arg created");
+	}
 
-		AddArgument(std::string("--ghost_headstart " + std::to_string((long double)headstart_time)).c_str());
+	instance->AddArgument(std::string("--ghost_headstart " + std::to_string((long double)headstart_time)).c_str());
 
-		ConvertArguments();
+	return StartInstance(instance);
+}
 
-		// Create scenario engine
-		try
-		{
-			// Initialize the scenario engine and viewer
-			player = new ScenarioPlayer(argc, argv);
+static int InitInstanceWithArgs(ScenarioInstance *instance, int argc, const char *argv[])
+{
+	instance->Reset();
 
-			// Fast forward to time == 0 - launching hybrid ghost vehicles
-			//while (player->scenarioEngine->getSimulationTime() < 0)
-			//{
-			//	player->Frame(0.05);
-			//}
+	// Arguments are passed as is, not split at spaces, to allow for e.g. filenames including spaces
+	for (int i = 0; i < argc; i++)
+	{
+		instance->args_v.push_back(argv[i]);
+	}
 
-		}
-		catch (const std::exception& e)
-		{
-			LOG(e.what());
-			resetScenario();
-			return -1;
-		}
+	return StartInstance(instance);
+}
 
-		return 0;
+extern "C"
+{
+	SE_DLL_API int SE_Init(const char *oscFilename, int control, int use_viewer, int threads, int record, float headstart_time)
+	{
+		return InitInstance(&default_instance, oscFilename, control, use_viewer, threads, record, headstart_time);
 	}
 
-	SE_DLL_API int SE_GetQuitFlag()
+	SE_DLL_API int SE_InitWithArgs(int argc, const char *argv[])
 	{
-		int quit_flag;
-		if(player)
-		{
-			if(player->IsQuitRequested())
-				quit_flag = 1;
-			else
-				quit_flag = 0;
-		}
-		else
-			quit_flag = 2;
+		return InitInstanceWithArgs(&default_instance, argc, argv);
+	}
 
-		return quit_flag; 
-		
+	SE_DLL_API int SE_GetQuitFlag()
+	{
+		return SE_InstanceGetQuitFlag(&default_instance);
 	}
 
 	SE_DLL_API void SE_Close()
 	{
-		resetScenario();
+		default_instance.Reset();
 	}
 
 	SE_DLL_API int SE_OpenOSISocket(char* ipaddr)
@@ -309,100 +377,59 @@ extern "C"
 		return 0;
 	}
 
-	SE_DLL_API int SE_Step()
+	SE_DLL_API int SE_OpenOSISharedMemory(const char *name)
 	{
 		if (player)
 		{
-			player->Frame();
-			return 0;
-		}
-		else
-		{
-			return -1;
+			return player->osiReporter->OpenSharedMemory(name);
 		}
+
+		return -1;
+	}
+
+	SE_DLL_API int SE_Step()
+	{
+		return SE_InstanceStep(&default_instance);
 	}
 
 	SE_DLL_API int SE_StepDT(float dt)
 	{
-		if (player)
-		{
-			player->Frame(dt);
-			return 0;
-		}
-		else
-		{
-			return -1;
-		}
+		return SE_InstanceStepDT(&default_instance, dt);
 	}
 
 	SE_DLL_API float SE_GetSimulationTime()
 	{
-		return (float)player->scenarioEngine->getSimulationTime();
+		return SE_InstanceGetSimulationTime(&default_instance);
 	}
 
 	SE_DLL_API int SE_ReportObjectPos(int id, float timestamp, float x, float y, float z, float h, float p, float r, float speed)
 	{
-		if (player)
-		{
-			if (id < player->scenarioEngine->entities.object_.size())
-			{
-				// reuse some values
-				Object *obj = player->scenarioEngine->entities.object_[id];
-				int control = obj->control_ == Object::Control::EXTERNAL || obj->control_ == Object::Control::HYBRID_EXTERNAL;
-				player->scenarioGateway->reportObject(id, obj->name_, obj->type_, obj->category_holder_, obj->model_id_, control, obj->boundingbox_, timestamp, speed, 0, 0, x, y, z, h, p, r);
-			}
-		}
-
-		return 0;
+		return SE_InstanceReportObjectPos(&default_instance, id, timestamp, x, y, z, h, p, r, speed);
 	}
 
 	SE_DLL_API int SE_ReportObjectRoadPos(int id, float timestamp, int roadId, int laneId, float laneOffset, float s, float speed)
 	{
-		if (player)
-		{
-			if (id < player->scenarioEngine->entities.object_.size())
-			{
-				// reuse some values
-				Object *obj = player->scenarioEngine->entities.object_[id];
-				int control = obj->control_ == Object::Control::EXTERNAL || obj->control_ == Object::Control::HYBRID_EXTERNAL;
-				player->scenarioGateway->reportObject(id, obj->name_, obj->type_, obj->category_holder_, obj->model_id_, control, obj->boundingbox_, timestamp, speed, 0, 0, roadId, laneId, laneOffset, s);
-			}
-		}
-
-		return 0;
+		return SE_InstanceReportObjectRoadPos(&default_instance, id, timestamp, roadId, laneId, laneOffset, s, speed);
 	}
 
 	SE_DLL_API int SE_GetNumberOfObjects()
 	{
-		if (player)
-		{
-			return player->scenarioGateway->getNumberOfObjects();
-		}
-		else
-		{
-			return 0;
-		}
+		return SE_InstanceGetNumberOfObjects(&default_instance);
 	}
 
 	SE_DLL_API int SE_GetObjectState(int index, SE_ScenarioObjectState *state)
 	{
-		if (player)
-		{
-			copyStateFromScenarioGateway(state, &player->scenarioGateway->getObjectStatePtrByIdx(index)->state_);
-		}
-
-		return 0;
+		return SE_InstanceGetObjectState(&default_instance, index, state);
 	}
 
 	SE_DLL_API const char* SE_GetOSISensorView(int* size)
 	{
-		if (player)
-		{
-			return player->osiReporter->GetOSISensorView(size);
-		}
+		return SE_InstanceGetOSISensorView(&default_instance, size);
+	}
 
-		*size = 0;
-		return 0;
+	SE_DLL_API const char* SE_GetOSISensorViewRaw()
+	{
+		return SE_InstanceGetOSISensorViewRaw(&default_instance);
 	}
 
 	SE_DLL_API const char* SE_GetOSIRoadLane(int* size, int object_id)
@@ -446,12 +473,12 @@ extern "C"
 	
 	SE_DLL_API int SE_UpdateOSISensorView()
 	{
-		if (player)
-		{
-			return player->osiReporter->UpdateOSISensorView(player->scenarioGateway->objectState_);
-		}
+		return SE_InstanceUpdateOSISensorView(&default_instance);
+	}
 
-		return 0;
+	SE_DLL_API int SE_SetOSIRadius(float radius)
+	{
+		return SE_InstanceSetOSIRadius(&default_instance, radius);
 	}
 
 	SE_DLL_API bool SE_OSIFileOpen()
@@ -468,7 +495,8 @@ extern "C"
 	{		
 		if (player)
 		{
-			return player->osiReporter->WriteOSIFile();
+			// Explicit call by the user, make sure the message is in the file when returning
+			return player->osiReporter->WriteOSIFile(true);
 		}
 
 		return false;
@@ -484,9 +512,11 @@ extern "C"
 				{
 					if (player->scenarioEngine->entities.object_[index]->ghost_)
 					{
-						scenarioengine::ObjectState obj_state;
-						player->scenarioGateway->getObjectStateById(player->scenarioEngine->entities.object_[index]->ghost_->id_, obj_state);
-						copyStateFromScenarioGateway(state, &obj_state.state_);
+						scenarioengine::ObjectState *obj_state = player->scenarioGateway->getObjectStatePtrById(player->scenarioEngine->entities.object_[index]->ghost_->id_);
+						if (obj_state)
+						{
+							copyStateFromScenarioGateway(state, &obj_state->state_);
+						}
 					}
 				}
 			}
@@ -519,21 +549,7 @@ extern "C"
 
 	SE_DLL_API int SE_GetObjectStates(int *nObjects, SE_ScenarioObjectState* state)
 	{
-		int i;
-
-		if (player)
-		{
-			for (i = 0; i < *nObjects && i < player->scenarioGateway->getNumberOfObjects(); i++)
-			{
-				copyStateFromScenarioGateway(&state[i], &player->scenarioGateway->getObjectStatePtrByIdx(i)->state_);
-			}
-			*nObjects = i;
-		}
-		else
-		{
-			*nObjects = 0;
-		}
-		return 0;
+		return SE_InstanceGetObjectStates(&default_instance, nObjects, state);
 	}
 
 	SE_DLL_API int SE_AddObjectSensor(int object_id, float x, float y, float z, float h, float rangeNear, float rangeFar, float fovH, int maxObj)
@@ -609,4 +625,269 @@ extern "C"
 		//LOG("id %d dist %.2f x %.2f y %.2f z %.2f", object_id, lookahead_distance, data->global_pos_x, data->global_pos_y, data->global_pos_z);
 		return 0;
 	}
+
+	SE_DLL_API SE_Instance SE_CreateInstance(const char *oscFilename, int control, float headstart_time)
+	{
+		ScenarioInstance *instance = new ScenarioInstance(true);
+		InstanceScope scope(instance);
+
+		if (InitInstance(instance, oscFilename, control, 0, 0, 0, headstart_time) != 0)
+		{
+			delete instance;
+			return 0;
+		}
+
+		return instance;
+	}
+
+	SE_DLL_API void SE_DestroyInstance(SE_Instance instance)
+	{
+		if (instance == 0)
+		{
+			return;
+		}
+
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+		InstanceScope scope(inst);
+		inst->Reset();
+		delete inst;
+	}
+
+	SE_DLL_API int SE_InstanceStep(SE_Instance instance)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			InstanceScope scope(inst);
+			inst->player->Frame();
+			return 0;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	SE_DLL_API int SE_InstanceStepDT(SE_Instance instance, float dt)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			InstanceScope scope(inst);
+			inst->player->Frame(dt);
+			return 0;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	SE_DLL_API int SE_InstanceGetQuitFlag(SE_Instance instance)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst == 0 || inst->player == 0)
+		{
+			return 2;
+		}
+
+		return inst->player->IsQuitRequested() ? 1 : 0;
+	}
+
+	SE_DLL_API float SE_InstanceGetSimulationTime(SE_Instance instance)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst == 0 || inst->player == 0)
+		{
+			return 0.0f;
+		}
+
+		return (float)inst->player->scenarioEngine->getSimulationTime();
+	}
+
+	SE_DLL_API int SE_InstanceReportObjectPos(SE_Instance instance, int id, float timestamp, float x, float y, float z, float h, float p, float r, float speed)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			if (id < inst->player->scenarioEngine->entities.object_.size())
+			{
+				InstanceScope scope(inst);
+
+				// reuse some values
+				Object *obj = inst->player->scenarioEngine->entities.object_[id];
+				int control = obj->control_ == Object::Control::EXTERNAL || obj->control_ == Object::Control::HYBRID_EXTERNAL;
+				inst->player->scenarioGateway->reportObject(id, obj->name_, obj->type_, obj->category_holder_, obj->model_id_, control, obj->boundingbox_, timestamp, speed, 0, 0, x, y, z, h, p, r);
+			}
+		}
+
+		return 0;
+	}
+
+	SE_DLL_API int SE_InstanceReportObjectRoadPos(SE_Instance instance, int id, float timestamp, int roadId, int laneId, float laneOffset, float s, float speed)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			if (id < inst->player->scenarioEngine->entities.object_.size())
+			{
+				InstanceScope scope(inst);
+
+				// reuse some values
+				Object *obj = inst->player->scenarioEngine->entities.object_[id];
+				int control = obj->control_ == Object::Control::EXTERNAL || obj->control_ == Object::Control::HYBRID_EXTERNAL;
+				inst->player->scenarioGateway->reportObject(id, obj->name_, obj->type_, obj->category_holder_, obj->model_id_, control, obj->boundingbox_, timestamp, speed, 0, 0, roadId, laneId, laneOffset, s);
+			}
+		}
+
+		return 0;
+	}
+
+	SE_DLL_API int SE_InstanceGetNumberOfObjects(SE_Instance instance)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			return inst->player->scenarioGateway->getNumberOfObjects();
+		}
+		else
+		{
+			return 0;
+		}
+	}
+
+	SE_DLL_API int SE_InstanceGetObjectState(SE_Instance instance, int index, SE_ScenarioObjectState *state)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			copyStateFromScenarioGateway(state, &inst->player->scenarioGateway->getObjectStatePtrByIdx(index)->state_);
+		}
+
+		return 0;
+	}
+
+	SE_DLL_API int SE_InstanceGetObjectStates(SE_Instance instance, int *nObjects, SE_ScenarioObjectState* state)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+		int i;
+
+		if (inst && inst->player)
+		{
+			for (i = 0; i < *nObjects && i < inst->player->scenarioGateway->getNumberOfObjects(); i++)
+			{
+				copyStateFromScenarioGateway(&state[i], &inst->player->scenarioGateway->getObjectStatePtrByIdx(i)->state_);
+			}
+			*nObjects = i;
+		}
+		else
+		{
+			*nObjects = 0;
+		}
+		return 0;
+	}
+
+	SE_DLL_API int SE_InstanceUpdateOSISensorView(SE_Instance instance)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			InstanceScope scope(inst);
+			return inst->player->osiReporter->UpdateOSISensorView(inst->player->scenarioGateway->objectState_);
+		}
+
+		return 0;
+	}
+
+	SE_DLL_API int SE_InstanceSetOSIRadius(SE_Instance instance, float radius)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			inst->player->osiReporter->SetOSIRadius(radius);
+			return 0;
+		}
+
+		return -1;
+	}
+
+	SE_DLL_API const char* SE_InstanceGetOSISensorView(SE_Instance instance, int* size)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			return inst->player->osiReporter->GetOSISensorView(size);
+		}
+
+		*size = 0;
+		return 0;
+	}
+
+	SE_DLL_API const char* SE_InstanceGetOSISensorViewRaw(SE_Instance instance)
+	{
+		ScenarioInstance *inst = (ScenarioInstance*)instance;
+
+		if (inst && inst->player)
+		{
+			return (const char*)inst->player->osiReporter->GetOSISensorViewRaw();
+		}
+
+		return 0;
+	}
+
+	SE_DLL_API void SE_EnableProfiler(int enable, int trace)
+	{
+		SE_Profiler::Inst().Enable(enable != 0, trace != 0);
+	}
+
+	SE_DLL_API void SE_ResetProfiler()
+	{
+		SE_Profiler::Inst().Reset();
+	}
+
+	SE_DLL_API int SE_GetNumberOfProfileSections()
+	{
+		return SE_PROFILE_N_SECTIONS;
+	}
+
+	SE_DLL_API int SE_GetProfileSection(int index, SE_ProfileData *data)
+	{
+		if (index < 0 || index >= SE_PROFILE_N_SECTIONS || data == 0)
+		{
+			return -1;
+		}
+
+		SE_ProfileStats stats = SE_Profiler::Inst().GetStats((SE_ProfileSection)index);
+
+		data->name = SE_Profiler::GetSectionName((SE_ProfileSection)index);
+		data->count = (int)stats.count;
+		data->total = 1e-6 * stats.total;
+		data->last = 1e-6 * stats.last;
+		data->mean = stats.count > 0 ? 1e-6 * stats.total / stats.count : 0.0;
+		data->max = 1e-6 * stats.max;
+		data->p99 = 1e-6 * SE_Profiler::GetPercentile(stats, 99);
+
+		return 0;
+	}
+
+	SE_DLL_API int SE_WriteProfile(const char *filename)
+	{
+		return SE_Profiler::Inst().WriteJSON(filename);
+	}
+
+	SE_DLL_API int SE_WriteProfileTrace(const char *filename)
+	{
+		return SE_Profiler::Inst().WriteChromeTrace(filename);
+	}
 }
@@ -65,6 +65,9 @@ typedef struct
 	float speed_limit;		// speed limit given by OpenDRIVE type entry
 } SE_RoadInfo;
 
+// Handle to a scenario instance, see SE_CreateInstance
+typedef void* SE_Instance;
+
 typedef struct 
 {
 	int far_left_lb_id;
@@ -73,6 +76,18 @@ typedef struct
 	int far_right_lb_id;
 } SE_LaneBoundaryId;
 
+// Profiler measurements of one code section, see SE_GetProfileSection
+typedef struct
+{
+	const char *name;	// section name, e.g. "step" or "osi"
+	int count;			// number of measurements
+	double total;		// total time (ms)
+	double last;		// most recent measurement (ms)
+	double mean;		// mean time (ms)
+	double max;			// max time (ms)
+	double p99;			// 99th percentile, estimated from histogram (ms)
+} SE_ProfileData;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -89,6 +104,16 @@ extern "C"
 	*/
 	SE_DLL_API int SE_Init(const char *oscFilename, int control, int use_viewer, int threads, int record, float headstart_time);
 
+	/**
+	Initialize the scenario engine with command line arguments, same as for the esmini application,
+	e.g. {"esmini", "--osc", "cut-in.xosc", "--headless", "--fast"}. First argument is application name (ignored).
+	Use --fast to run as fast as possible with fixed timestep, reporting step rate and step time statistics at SE_Close()
+	@param argc Number of arguments
+	@param argv Argument strings, one argument per string
+	@return 0 if successful, -1 if not
+	*/
+	SE_DLL_API int SE_InitWithArgs(int argc, const char *argv[]);
+
 	/**
 	Step the simulation forward with specified timestep
 	@param dt time step in seconds
@@ -117,6 +142,13 @@ extern "C"
 	*/
 	SE_DLL_API int SE_OpenOSISocket(char *ipaddr);
 
+	/**
+	Publish OSI SensorView and object states in shared memory on each SE_UpdateOSISensorView, for readers on same host
+	@param name Name of shared memory, e.g. "esmini"
+	@return 0 if successful, -1 if not
+	*/
+	SE_DLL_API int SE_OpenOSISharedMemory(const char *name);
+
 	/**
 	Get simulation time in seconds
 	*/
@@ -139,6 +171,14 @@ extern "C"
 	*/
 	SE_DLL_API const char* SE_GetOSISensorView(int* size);
 
+	/**
+	The SE_GetOSISensorViewRaw function returns a pointer to the live OSI SensorView, as of last call to SE_UpdateOSISensorView
+	No serialization or copy involved. For consumers in the same process, built with the same OSI and protobuf versions.
+	Read only, valid until next call to SE_UpdateOSISensorView.
+	@return Pointer to osi3::SensorView (cast from const char*), 0 if not available
+	*/
+	SE_DLL_API const char* SE_GetOSISensorViewRaw();
+
 	/**
 	The SE_GetOSIRoadLane function returns a char array containing the osi Lane information/message of the lane where the object with object_id is, serialized to a string
 	*/
@@ -154,13 +194,21 @@ extern "C"
 	*/
 	SE_DLL_API void SE_GetOSILaneBoundaryIds(int object_id, SE_LaneBoundaryId* ids);
 
+	/**
+	Limit OSI ground truth to lanes, lane boundaries and objects within given distance from the host vehicle
+	(hybrid external control, or first object if none) and from any sensor. Reduces message size on large road networks.
+	@param radius Distance in meters, 0 or less means entire road network and all objects (default)
+	@return 0 if successful, -1 if not
+	*/
+	SE_DLL_API int SE_SetOSIRadius(float radius);
+
 	/**
 	Create and open osi file 
 	*/
 	SE_DLL_API bool SE_OSIFileOpen();
 
 	/**
-	Create and open osi file 
+	Write current SensorView to the osi file, returns when it's in the file
 	*/
 	SE_DLL_API bool SE_OSIFileWrite();
 
@@ -207,6 +255,90 @@ extern "C"
 	*/
 	SE_DLL_API int SE_GetRoadInfoAlongGhostTrail(int object_id, float lookahead_distance, SE_RoadInfo *data, float *speed_ghost);
 
+	/**
+	Create a scenario instance. Several instances can run in parallel, e.g. one per thread, each one with its own 
+	scenario, entities and OSI state. Road networks are shared, read only, between instances loading the same OpenDRIVE
+	file. An instance may be called from any thread, but only from one thread at a time. Instances always run without
+	viewer and recording. The functions without instance argument operate on a separate default instance.
+	@param oscFilename Path to the OpenSCEANRIO file
+	@param control Ego control 0=by OSC 1=Internal 2=External 3=Hybrid
+	@param headstart_time For hybrid control mode launch ghost vehicle with this headstart time
+	@return Handle to the instance, 0 if not successful
+	*/
+	SE_DLL_API SE_Instance SE_CreateInstance(const char *oscFilename, int control, float headstart_time);
+
+	/**
+	Stop simulation of the instance and release all of its resources
+	@param instance Handle to the instance, see SE_CreateInstance
+	*/
+	SE_DLL_API void SE_DestroyInstance(SE_Instance instance);
+
+	/**
+	Step the simulation of the instance forward, see SE_StepDT
+	@param instance Handle to the instance, see SE_CreateInstance
+	@param dt time step in seconds
+	@return 0 if successful, -1 if not
+	*/
+	SE_DLL_API int SE_InstanceStepDT(SE_Instance instance, float dt);
+
+	/**
+	Step the simulation of the instance forward with elapsed system time, see SE_Step
+	@param instance Handle to the instance, see SE_CreateInstance
+	@return 0 if successful, -1 if not
+	*/
+	SE_DLL_API int SE_InstanceStep(SE_Instance instance);
+
+	/**
+	The following functions correspond to the ones without instance argument, but operate on given instance
+	@param instance Handle to the instance, see SE_CreateInstance
+	*/
+	SE_DLL_API int SE_InstanceGetQuitFlag(SE_Instance instance);
+	SE_DLL_API float SE_InstanceGetSimulationTime(SE_Instance instance);
+	SE_DLL_API int SE_InstanceReportObjectPos(SE_Instance instance, int id, float timestamp, float x, float y, float z, float h, float p, float r, float speed);
+	SE_DLL_API int SE_InstanceReportObjectRoadPos(SE_Instance instance, int id, float timestamp, int roadId, int laneId, float laneOffset, float s, float speed);
+	SE_DLL_API int SE_InstanceGetNumberOfObjects(SE_Instance instance);
+	SE_DLL_API int SE_InstanceGetObjectState(SE_Instance instance, int index, SE_ScenarioObjectState *state);
+	SE_DLL_API int SE_InstanceGetObjectStates(SE_Instance instance, int *nObjects, SE_ScenarioObjectState* state);
+	SE_DLL_API int SE_InstanceUpdateOSISensorView(SE_Instance instance);
+	SE_DLL_API int SE_InstanceSetOSIRadius(SE_Instance instance, float radius);
+	SE_DLL_API const char* SE_InstanceGetOSISensorView(SE_Instance instance, int* size);
+	SE_DLL_API const char* SE_InstanceGetOSISensorViewRaw(SE_Instance instance);
+
+	/**
+	Switch built-in profiler on or off. Measurements are process wide, i.e. aggregated over all instances.
+	The "frame" section covers all esmini work of a step, e.g. compare its last value to the duration of a co-simulation cycle.
+	@param enable 0=off, 1=on
+	@param trace 1=also keep each measurement, for SE_WriteProfileTrace
+	*/
+	SE_DLL_API void SE_EnableProfiler(int enable, int trace);
+
+	/**
+	Clear all profiler measurements
+	*/
+	SE_DLL_API void SE_ResetProfiler();
+
+	SE_DLL_API int SE_GetNumberOfProfileSections();
+
+	/**
+	Get profiler measurements of a code section
+	@param index Index of the section, 0 <= index < SE_GetNumberOfProfileSections()
+	@param data Pointer to struct to fill in
+	@return 0 if successful, -1 if not
+	*/
+	SE_DLL_API int SE_GetProfileSection(int index, SE_ProfileData *data);
+
+	/**
+	Save statistics and histograms of all sections to file in JSON format
+	@return 0 if successful, -1 if not
+	*/
+	SE_DLL_API int SE_WriteProfile(const char *filename);
+
+	/**
+	Save all traced measurements to file in Chrome trace event format, see SE_EnableProfiler
+	@return 0 if successful, -1 if not
+	*/
+	SE_DLL_API int SE_WriteProfileTrace(const char *filename);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,579 @@
+#include <iostream>
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include "CommonMini.hpp"
+#include "UDP.hpp"
+
+static std::string ReadFile(std::string filename)
+{
+    std::ifstream file(filename, std::ifstream::binary);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+//////////////////////////////////////////////////////////////////////
+////////// TESTS FOR CLASS -> SE_TripleBuffer //////////
+//////////////////////////////////////////////////////////////////////
+
+#define TRIPLE_BUFFER_N_VERSIONS 200000
+#define TRIPLE_BUFFER_SIZE 64
+
+// Fill all elements with version number, a torn read would show mixed versions
+static void FillVersion(std::vector<int> &buf, int version)
+{
+    buf.resize(TRIPLE_BUFFER_SIZE);
+    for (size_t i = 0; i < buf.size(); i++)
+    {
+        buf[i] = version;
+    }
+}
+
+TEST(TripleBufferTest, SingleThread)
+{
+    SE_TripleBuffer<std::vector<int> > tb;
+
+    // Nothing published yet, reader gets the initial empty buffer
+    EXPECT_EQ(tb.GetFront().size(), 0);
+
+    FillVersion(tb.GetBack(), 1);
+    tb.Publish();
+    EXPECT_EQ(tb.GetFront()[0], 1);
+
+    // Intermediate versions not picked up are skipped, reader gets the newest
+    FillVersion(tb.GetBack(), 2);
+    tb.Publish();
+    FillVersion(tb.GetBack(), 3);
+    tb.Publish();
+    EXPECT_EQ(tb.GetFront()[0], 3);
+
+    // No new version, reader keeps the same buffer
+    EXPECT_EQ(tb.GetFront()[0], 3);
+
+    // Writer never gets the buffer held by the reader
+    std::vector<int> *front = &tb.GetFront();
+    for (int i = 4; i < 10; i++)
+    {
+        EXPECT_NE(&tb.GetBack(), front);
+        FillVersion(tb.GetBack(), i);
+        tb.Publish();
+    }
+    EXPECT_EQ((*front)[0], 3);
+    EXPECT_EQ(tb.GetFront()[0], 9);
+}
+
+TEST(TripleBufferTest, ProducerConsumer)
+{
+    SE_TripleBuffer<std::vector<int> > tb;
+    std::atomic<int> published(0);
+    int n_torn = 0;
+    int n_older = 0;
+    int n_stale = 0;
+    int n_reads = 0;
+
+    std::thread producer([&]()
+    {
+        for (int v = 1; v <= TRIPLE_BUFFER_N_VERSIONS; v++)
+        {
+            FillVersion(tb.GetBack(), v);
+            tb.Publish();
+            published.store(v, std::memory_order_release);
+        }
+    });
+
+    std::thread consumer([&]()
+    {
+        int last = 0;
+        bool done = false;
+
+        while (!done)
+        {
+            // Versions published before the read must be visible, the read may be even newer
+            int min_version = published.load(std::memory_order_acquire);
+            done = min_version == TRIPLE_BUFFER_N_VERSIONS;
+
+            std::vector<int> &buf = tb.GetFront();
+            n_reads++;
+            if (buf.size() == 0)
+            {
+                if (min_version > 0)
+                {
+                    n_stale++;
+                }
+                continue;
+            }
+
+            int version = buf[0];
+            for (size_t i = 1; i < buf.size(); i++)
+            {
+                if (buf[i] != version)
+                {
+                    n_torn++;
+                    break;
+                }
+            }
+
+            if (version < last)
+            {
+                n_older++;
+            }
+            if (version < min_version)
+            {
+                n_stale++;
+            }
+            last = version;
+        }
+
+        EXPECT_EQ(last, TRIPLE_BUFFER_N_VERSIONS);
+    });
+
+    producer.join();
+    consumer.join();
+
+    EXPECT_GT(n_reads, 0);
+    EXPECT_EQ(n_torn, 0);
+    EXPECT_EQ(n_older, 0);
+    EXPECT_EQ(n_stale, 0);
+}
+
+//////////////////////////////////////////////////////////////////////
+////////// TESTS FOR CLASS -> SE_RingBuffer //////////
+//////////////////////////////////////////////////////////////////////
+
+TEST(RingBufferTest, SingleThread)
+{
+    SE_RingBuffer ring(100);
+    const char *data = 0;
+
+    // Capacity is rounded up to power of two
+    EXPECT_EQ(ring.GetCapacity(), 128);
+    EXPECT_EQ(ring.Peek(&data), 0);
+
+    std::string a(100, 'a');
+    std::string b(40, 'b');
+    EXPECT_TRUE(ring.Write(a.c_str(), a.size()));
+    EXPECT_EQ(ring.GetSize(), 100);
+
+    // All or nothing, when not enough free space
+    EXPECT_FALSE(ring.Write(b.c_str(), b.size()));
+    EXPECT_EQ(ring.GetSize(), 100);
+
+    ASSERT_EQ(ring.Peek(&data), 100);
+    EXPECT_EQ(std::string(data, 100), a);
+    ring.Release(90);
+    EXPECT_EQ(ring.GetSize(), 10);
+
+    // Wraps around the end of the buffer, read in two chunks
+    EXPECT_TRUE(ring.Write(b.c_str(), b.size()));
+    EXPECT_EQ(ring.GetSize(), 50);
+    ASSERT_EQ(ring.Peek(&data), 38);
+    EXPECT_EQ(std::string(data, 38), std::string(10, 'a') + std::string(28, 'b'));
+    ring.Release(38);
+    ASSERT_EQ(ring.Peek(&data), 12);
+    EXPECT_EQ(std::string(data, 12), std::string(12, 'b'));
+    ring.Release(12);
+    EXPECT_EQ(ring.GetSize(), 0);
+    EXPECT_EQ(ring.Peek(&data), 0);
+
+    // Completely full
+    std::string c(128, 'c');
+    EXPECT_TRUE(ring.Write(c.c_str(), c.size()));
+    EXPECT_FALSE(ring.Write(c.c_str(), 1));
+    EXPECT_EQ(ring.GetSize(), 128);
+}
+
+TEST(RingBufferTest, ProducerConsumer)
+{
+    SE_RingBuffer ring(1000);
+    const size_t total = 1000000;
+    size_t n_full = 0;
+    size_t n_received = 0;
+    size_t n_bad = 0;
+
+    // Byte sequence which does not repeat at buffer size, to detect misplaced data
+    std::thread producer([&]()
+    {
+        char record[300];
+        size_t pos = 0;
+        for (size_t size = 1; pos < total; size = size % 300 + 1)
+        {
+            size = MIN(size, total - pos);
+            for (size_t i = 0; i < size; i++)
+            {
+                record[i] = (char)((pos + i) % 251);
+            }
+            while (!ring.Write(record, size))
+            {
+                n_full++;
+                std::this_thread::yield();
+            }
+            pos += size;
+        }
+    });
+
+    std::thread consumer([&]()
+    {
+        const char *data;
+        while (n_received < total)
+        {
+            size_t n = ring.Peek(&data);
+            if (n == 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                if (data[i] != (char)((n_received + i) % 251))
+                {
+                    n_bad++;
+                }
+            }
+            ring.Release(n);
+            n_received += n;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    EXPECT_EQ(n_received, total);
+    EXPECT_EQ(n_bad, 0);
+    EXPECT_EQ(ring.GetSize(), 0);
+    std::cout << "Producer found buffer full " << n_full << " times" << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////////
+////////// TESTS FOR CLASS -> SE_AsyncWriter //////////
+//////////////////////////////////////////////////////////////////////
+
+TEST(AsyncWriterTest, WriteFlushClose)
+{
+    std::string filename = testing::TempDir() + "async_writer_test.txt";
+    SE_AsyncWriter writer;
+
+    EXPECT_EQ(writer.Write("a", 1), -1);  // not open
+    ASSERT_EQ(writer.Open(filename, true), 0);
+    EXPECT_TRUE(writer.IsOpen());
+
+    std::string expected;
+    for (int i = 0; i < 100; i++)
+    {
+        std::string record = "record " + std::to_string(i) + "\n";
+        EXPECT_EQ(writer.Write(record), 0);
+        expected += record;
+    }
+
+    // All data queued so far is in the file when Flush returns
+    writer.Flush();
+    EXPECT_EQ(ReadFile(filename), expected);
+
+    // Close writes remaining data, without any Flush
+    std::string last(5000, 'x');
+    EXPECT_EQ(writer.Write(last), 0);
+    expected += last;
+    writer.Close();
+    EXPECT_FALSE(writer.IsOpen());
+    EXPECT_EQ(ReadFile(filename), expected);
+
+    EXPECT_EQ(writer.Write("a", 1), -1);  // closed
+    EXPECT_EQ(writer.GetNumberOfDropped(), 0);
+}
+
+TEST(AsyncWriterTest, MultipleWriters)
+{
+    const int n_writers = 3;
+    const int n_records = 20000;
+    std::vector<std::thread> threads;
+    std::vector<std::string> expected(n_writers);
+    std::vector<unsigned long long> n_backpressured(n_writers);
+    std::vector<unsigned long long> n_dropped(n_writers);
+
+    // Each thread writes its own file through a small buffer, forcing the writers to wait for the shared
+    // background thread. Some records are larger than the buffer, then passed in pieces.
+    for (int w = 0; w < n_writers; w++)
+    {
+        threads.push_back(std::thread([&, w]()
+        {
+            SE_AsyncWriter writer;
+            ASSERT_EQ(writer.Open(testing::TempDir() + "async_writer_test_" + std::to_string(w) + ".txt", true, -1, 4096), 0);
+            for (int i = 0; i < n_records; i++)
+            {
+                std::string record = std::to_string(w) + " " + std::to_string(i) + "\n";
+                if (i % 5000 == 0)
+                {
+                    record += std::string(10000, (char)('a' + w)) + "\n";
+                }
+                EXPECT_EQ(writer.Write(record), 0);
+                expected[w] += record;
+            }
+            n_backpressured[w] = writer.GetNumberOfBackpressured();
+            n_dropped[w] = writer.GetNumberOfDropped();
+            writer.Close();
+        }));
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    for (int w = 0; w < n_writers; w++)
+    {
+        EXPECT_EQ(ReadFile(testing::TempDir() + "async_writer_test_" + std::to_string(w) + ".txt"), expected[w]);
+        EXPECT_GE(n_backpressured[w], 4);  // at least the records larger than the buffer
+        EXPECT_EQ(n_dropped[w], 0);  // waits forever by default
+    }
+}
+
+TEST(AsyncWriterTest, DropWhenFull)
+{
+    std::string filename = testing::TempDir() + "async_writer_test_drop.txt";
+    const int n_records = 100000;
+    SE_AsyncWriter writer;
+    std::vector<bool> written(n_records);
+    unsigned long long n_failed = 0;
+
+    // Don't wait for space at all, records not fitting in the buffer are dropped
+    ASSERT_EQ(writer.Open(filename, true, 0.0, 1024), 0);
+    for (int i = 0; i < n_records; i++)
+    {
+        char record[16];
+        snprintf(record, sizeof(record), "%09d\n", i);
+        written[i] = writer.Write(record, 10) == 0;
+        if (!written[i])
+        {
+            n_failed++;
+        }
+    }
+    unsigned long long n_dropped = writer.GetNumberOfDropped();
+    writer.Close();
+
+    EXPECT_EQ(n_dropped, n_failed);
+    std::cout << "Dropped " << n_dropped << " of " << n_records << " records" << std::endl;
+
+    // The file holds complete records only, all which were reported written and in order
+    std::string expected;
+    for (int i = 0; i < n_records; i++)
+    {
+        if (written[i])
+        {
+            char record[16];
+            snprintf(record, sizeof(record), "%09d\n", i);
+            expected += record;
+        }
+    }
+    EXPECT_EQ(ReadFile(filename), expected);
+}
+
+//////////////////////////////////////////////////////////////////////
+////////// TESTS FOR CLASS -> SE_UDPFragmentReceiver //////////
+//////////////////////////////////////////////////////////////////////
+
+#define UDP_TEST_PORT 48299
+
+// Message with content depending on frame id, to tell messages apart
+static std::string MakeMessage(unsigned int frame_id, size_t size)
+{
+    std::string msg(size, 0);
+    for (size_t i = 0; i < size; i++)
+    {
+        msg[i] = (char)((i * 7 + frame_id) % 256);
+    }
+    return msg;
+}
+
+// Split message into datagrams the way SE_UDPFragmentSender does
+static std::vector<std::string> MakeFragments(unsigned int session_id, unsigned int frame_id, const std::string &msg, size_t payload_size)
+{
+    std::vector<std::string> fragments;
+    unsigned short n_fragments = (unsigned short)((msg.size() + payload_size - 1) / payload_size);
+
+    for (unsigned short i = 0; i < n_fragments; i++)
+    {
+        SE_UDPFragmentHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = SE_UDP_FRAGMENT_MAGIC;
+        header.session_id = session_id;
+        header.frame_id = frame_id;
+        header.msg_size = (unsigned int)msg.size();
+        header.n_fragments = n_fragments;
+        header.fragment_idx = i;
+        header.send_time = (unsigned long long)SE_getSystemTimeUs();
+
+        std::string datagram((const char*)&header, sizeof(header));
+        datagram += msg.substr(i * payload_size, payload_size);
+        fragments.push_back(datagram);
+    }
+
+    return fragments;
+}
+
+static bool AddDatagram(SE_UDPFragmentReceiver &receiver, const std::string &datagram)
+{
+    return receiver.AddDatagram(datagram.c_str(), (int)datagram.size());
+}
+
+TEST(UDPFragmentTest, Reassembly)
+{
+    SE_UDPFragmentReceiver receiver;
+    std::string msg = MakeMessage(1, 2500);
+    std::vector<std::string> fragments = MakeFragments(10, 1, msg, 1000);
+    ASSERT_EQ(fragments.size(), 3);
+
+    EXPECT_FALSE(AddDatagram(receiver, fragments[0]));
+    EXPECT_FALSE(AddDatagram(receiver, fragments[1]));
+    ASSERT_TRUE(AddDatagram(receiver, fragments[2]));
+    EXPECT_EQ(std::string(receiver.GetMessageData(), msg.size()), msg);
+    EXPECT_EQ(receiver.GetFrameId(), 1);
+    EXPECT_EQ(receiver.GetSessionId(), 10);
+
+    // Duplicate of a fragment of a completed message is ignored
+    EXPECT_FALSE(AddDatagram(receiver, fragments[2]));
+
+    // Datagram without fragment header is a message by itself
+    std::string plain = "plain message";
+    ASSERT_TRUE(AddDatagram(receiver, plain));
+    EXPECT_EQ(std::string(receiver.GetMessageData(), plain.size()), plain);
+
+    EXPECT_EQ(receiver.GetNumberOfMessages(), 2);
+    EXPECT_EQ(receiver.GetNumberOfDropped(), 0);
+}
+
+TEST(UDPFragmentTest, OutOfOrder)
+{
+    SE_UDPFragmentReceiver receiver;
+    std::string msg = MakeMessage(1, 4321);
+    std::vector<std::string> fragments = MakeFragments(10, 1, msg, 1000);
+    ASSERT_EQ(fragments.size(), 5);
+
+    // Last fragment first, it is shorter than the others
+    int order[] = { 4, 2, 0, 3, 1 };
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_FALSE(AddDatagram(receiver, fragments[order[i]]));
+    }
+    // Duplicate while assembling changes nothing
+    EXPECT_FALSE(AddDatagram(receiver, fragments[0]));
+    ASSERT_TRUE(AddDatagram(receiver, fragments[order[4]]));
+    EXPECT_EQ(std::string(receiver.GetMessageData(), msg.size()), msg);
+}
+
+TEST(UDPFragmentTest, LostFragments)
+{
+    SE_UDPFragmentReceiver receiver;
+    std::vector<std::string> frame[4];
+    for (unsigned int i = 1; i < 4; i++)
+    {
+        frame[i] = MakeFragments(10, i, MakeMessage(i, 3000), 1000);
+    }
+
+    EXPECT_FALSE(AddDatagram(receiver, frame[1][0]));
+    EXPECT_FALSE(AddDatagram(receiver, frame[1][1]));
+    ASSERT_TRUE(AddDatagram(receiver, frame[1][2]));
+
+    // Frame 2 misses a fragment, given up when frame 3 starts
+    EXPECT_FALSE(AddDatagram(receiver, frame[2][0]));
+    EXPECT_FALSE(AddDatagram(receiver, frame[2][2]));
+    EXPECT_FALSE(AddDatagram(receiver, frame[3][0]));
+    EXPECT_FALSE(AddDatagram(receiver, frame[3][1]));
+
+    // Late fragment of frame 2 does not disturb frame 3
+    EXPECT_FALSE(AddDatagram(receiver, frame[2][1]));
+    ASSERT_TRUE(AddDatagram(receiver, frame[3][2]));
+    EXPECT_EQ(receiver.GetFrameId(), 3);
+    EXPECT_EQ(std::string(receiver.GetMessageData(), 3000), MakeMessage(3, 3000));
+    EXPECT_EQ(receiver.GetNumberOfDropped(), 1);
+
+    // Fragments of an already completed frame arriving late again are ignored
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_FALSE(AddDatagram(receiver, frame[1][i]));
+    }
+
+    // Frame 4 lost completely, detected when frame 5 completes
+    std::vector<std::string> frame5 = MakeFragments(10, 5, MakeMessage(5, 3000), 1000);
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(AddDatagram(receiver, frame5[i]), i == 2);
+    }
+    EXPECT_EQ(receiver.GetNumberOfMessages(), 3);
+    EXPECT_EQ(receiver.GetNumberOfDropped(), 2);
+}
+
+TEST(UDPFragmentTest, SenderRestart)
+{
+    SE_UDPFragmentReceiver receiver;
+
+    for (unsigned int i = 1; i <= 5; i++)
+    {
+        std::vector<std::string> fragments = MakeFragments(10, i, MakeMessage(i, 2000), 1000);
+        EXPECT_FALSE(AddDatagram(receiver, fragments[0]));
+        EXPECT_TRUE(AddDatagram(receiver, fragments[1]));
+    }
+
+    // New sender session starts counting frames from 1 again, its messages are not taken as late ones
+    for (unsigned int i = 1; i <= 5; i++)
+    {
+        std::vector<std::string> fragments = MakeFragments(20, i, MakeMessage(i + 100, 2000), 1000);
+        EXPECT_FALSE(AddDatagram(receiver, fragments[0]));
+        ASSERT_TRUE(AddDatagram(receiver, fragments[1]));
+        EXPECT_EQ(receiver.GetFrameId(), i);
+        EXPECT_EQ(receiver.GetSessionId(), 20);
+        EXPECT_EQ(std::string(receiver.GetMessageData(), 2000), MakeMessage(i + 100, 2000));
+    }
+
+    EXPECT_EQ(receiver.GetNumberOfMessages(), 10);
+    EXPECT_EQ(receiver.GetNumberOfDropped(), 0);
+    EXPECT_EQ(receiver.GetNumberOfRestarts(), 1);
+}
+
+TEST(UDPFragmentTest, SendReceive)
+{
+    SE_UDPFragmentReceiver receiver;
+    ASSERT_EQ(receiver.Open(UDP_TEST_PORT, 1000), 0);
+
+    // Second run of the sender, e.g. esmini restarted, must be delivered as well
+    for (int run = 0; run < 2; run++)
+    {
+        SE_UDPFragmentSender sender;
+        ASSERT_EQ(sender.Open("127.0.0.1", UDP_TEST_PORT, 1400), 0);
+
+        for (unsigned int i = 1; i <= 5; i++)
+        {
+            std::string msg = MakeMessage(i, 100000);
+            ASSERT_EQ(sender.Send(msg.c_str(), (unsigned int)msg.size()), 0);
+            ASSERT_EQ(receiver.Receive(), (int)msg.size());
+            EXPECT_EQ(receiver.GetFrameId(), i);
+            EXPECT_EQ(receiver.GetSessionId(), sender.GetSessionId());
+            EXPECT_EQ(std::string(receiver.GetMessageData(), msg.size()), msg);
+            EXPECT_GE(receiver.GetLatency(), 0);
+        }
+
+        // Small message is sent as plain datagram
+        std::string small = "small";
+        ASSERT_EQ(sender.Send(small.c_str(), (unsigned int)small.size()), 0);
+        ASSERT_EQ(receiver.Receive(), (int)small.size());
+        EXPECT_EQ(std::string(receiver.GetMessageData(), small.size()), small);
+    }
+
+    EXPECT_EQ(receiver.GetNumberOfMessages(), 12);
+    EXPECT_EQ(receiver.GetNumberOfDropped(), 0);
+    EXPECT_EQ(receiver.GetNumberOfRestarts(), 1);
+}
+
+//////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////
+
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,321 @@
+#include <iostream>
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include "CommonMini.hpp"
+#include "ScenarioGateway.hpp"
+#include "Replay.hpp"
+
+using namespace scenarioengine;
+
+//////////////////////////////////////////////////////////////////////
+////////// TESTS FOR RECORDING (ScenarioGateway) AND Replay //////////
+//////////////////////////////////////////////////////////////////////
+
+#define REPLAY_TEST_N_STEPS 350  // more than three key frame intervals
+#define REPLAY_TEST_DT 0.05
+
+typedef struct
+{
+    int id;
+    float time;
+    double x;
+    double y;
+    double h;
+    int road_id;
+    double s;
+    float speed;
+    float length;
+} ExpectedState;
+
+static long long FileSize(std::string filename)
+{
+    std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+    return (long long)file.tellg();
+}
+
+// Object 1 runs all the time, object 2 is added at step 120 and removed at step 260 and
+// object 3 changes bounding box (static info, not updated by reportObject) at step 200.
+static bool ObjectExists(int id, int step)
+{
+    return id != 2 || (step >= 120 && step < 260);
+}
+
+static ExpectedState MakeState(int id, int step)
+{
+    ExpectedState state;
+
+    state.id = id;
+    state.time = (float)(step * REPLAY_TEST_DT);
+    state.x = 100.0 * id + 1.2345678 * step;
+    state.y = -3.5 * id + 2.0 * sin(0.05 * step);
+    state.h = fmod(0.01 * step * id, 2 * M_PI);
+    state.road_id = id + step / 100;
+    state.s = 0.8765 * step;
+    state.speed = (float)(20.0 + 0.1 * id + 0.01 * step);
+    state.length = (id == 3 && step >= 200) ? 12.5f : 4.5f;
+
+    return state;
+}
+
+/*
+  Record given number of steps, return expected content of each recorded frame.
+  States are written from the second report of an object, the first one only creates it.
+*/
+static std::vector<std::vector<ExpectedState> > Record(std::string filename, int flags, int n_steps)
+{
+    std::vector<std::vector<ExpectedState> > frames;
+    ScenarioGateway *gateway = new ScenarioGateway();
+
+    EXPECT_EQ(gateway->RecordToFile(filename, "road.xodr", "models.osgb", flags), 0);
+
+    for (int step = 0; step < n_steps; step++)
+    {
+        std::vector<ExpectedState> frame;
+
+        for (int id = 1; id <= 3; id++)
+        {
+            bool existed = gateway->getObjectStatePtrById(id) != 0;
+            if (!ObjectExists(id, step))
+            {
+                if (existed)
+                {
+                    gateway->removeObject(id);
+                }
+                continue;
+            }
+
+            ExpectedState state = MakeState(id, step);
+            roadmanager::Position pos;
+            pos.SetInertiaPos(state.x, state.y, 0.0, state.h, 0.0, 0.0, false);
+            pos.SetTrackId(state.road_id);
+            pos.SetLaneId(-1);
+            pos.SetS(state.s);
+            OSCBoundingBox bb;
+            bb.dimensions_.width_ = 2.0f;
+            bb.dimensions_.length_ = state.length;
+            bb.dimensions_.height_ = 1.5f;
+
+            if (existed)
+            {
+                gateway->getObjectStatePtrById(id)->state_.boundingbox = bb;
+            }
+            gateway->reportObject(id, "obj" + std::to_string(id), 0, 0, id, 1, bb, state.time, state.speed, 0.0, 0.0, &pos);
+            if (existed)
+            {
+                frame.push_back(state);
+            }
+        }
+
+        if (!frame.empty())
+        {
+            frames.push_back(frame);
+        }
+    }
+
+    // Recording is flushed and closed along with the gateway
+    delete gateway;
+
+    return frames;
+}
+
+static void CompareFrame(Replay &replay, std::vector<ExpectedState> &frame, double tolerance)
+{
+    ASSERT_EQ(replay.GetNumberOfObjects(), (int)frame.size());
+    for (size_t i = 0; i < frame.size(); i++)
+    {
+        ObjectStateStruct *state = replay.GetState(frame[i].id);
+        ASSERT_NE(state, nullptr);
+        EXPECT_STREQ(state->name, ("obj" + std::to_string(frame[i].id)).c_str());
+        EXPECT_EQ(state->model_id, frame[i].id);
+        EXPECT_NEAR(state->timeStamp, frame[i].time, tolerance);
+        EXPECT_NEAR(state->pos.GetX(), frame[i].x, tolerance);
+        EXPECT_NEAR(state->pos.GetY(), frame[i].y, tolerance);
+        EXPECT_NEAR(state->pos.GetH(), frame[i].h, tolerance);
+        EXPECT_EQ(state->pos.GetTrackId(), frame[i].road_id);
+        EXPECT_EQ(state->pos.GetLaneId(), -1);
+        EXPECT_NEAR(state->pos.GetS(), frame[i].s, 10 * tolerance);
+        EXPECT_NEAR(state->speed, frame[i].speed, tolerance);
+        EXPECT_FLOAT_EQ(state->boundingbox.dimensions_.length_, frame[i].length);
+        EXPECT_FLOAT_EQ(state->boundingbox.dimensions_.width_, 2.0f);
+    }
+}
+
+// Read all frames in order, then seek to each one in reverse order, restoring decoder state from key frames
+static void TestRoundTrip(int flags, double tolerance)
+{
+    std::string filename = testing::TempDir() + "replay_test.dat";
+    std::vector<std::vector<ExpectedState> > frames = Record(filename, flags, REPLAY_TEST_N_STEPS);
+    ASSERT_EQ(frames.size(), REPLAY_TEST_N_STEPS - 1);
+
+    Replay replay(filename);
+    EXPECT_STREQ(replay.header_.odr_filename, "road.xodr");
+    EXPECT_EQ(replay.header_.flags, flags);
+    ASSERT_EQ(replay.GetNumberOfFrames(), (int)frames.size());
+    EXPECT_NEAR(replay.GetStartTime(), frames.front()[0].time, 1e-4);
+    EXPECT_NEAR(replay.GetStopTime(), frames.back()[0].time, 1e-4);
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        if (i > 0)
+        {
+            ASSERT_EQ(replay.GoToNextFrame(), 0);
+        }
+        CompareFrame(replay, frames[i], tolerance);
+    }
+    EXPECT_EQ(replay.GoToNextFrame(), -1);
+
+    for (int i = (int)frames.size() - 1; i >= 0; i--)
+    {
+        ASSERT_EQ(replay.GoToTime(frames[i][0].time), 0);
+        CompareFrame(replay, frames[i], tolerance);
+    }
+}
+
+TEST(ReplayTest, RoundTrip)
+{
+    TestRoundTrip(0, 1e-5);
+}
+
+TEST(ReplayTest, RoundTripDelta)
+{
+    // Quantization unit is 1e-4 for most fields
+    TestRoundTrip(REPLAY_FLAG_DELTA, 1e-4);
+}
+
+TEST(ReplayTest, DeltaIsCompact)
+{
+    std::string filename = testing::TempDir() + "replay_test.dat";
+    std::string filename_delta = testing::TempDir() + "replay_test_delta.dat";
+    Record(filename, 0, REPLAY_TEST_N_STEPS);
+    Record(filename_delta, REPLAY_FLAG_DELTA, REPLAY_TEST_N_STEPS);
+
+    EXPECT_LT(FileSize(filename_delta), FileSize(filename) / 2);
+}
+
+TEST(ReplayTest, GoToArbitraryTime)
+{
+    std::string filename = testing::TempDir() + "replay_test.dat";
+    std::vector<std::vector<ExpectedState> > frames = Record(filename, REPLAY_FLAG_DELTA, REPLAY_TEST_N_STEPS);
+    Replay replay(filename);
+
+    // Between frames, around key frames (every REPLAY_KEY_FRAME_INTERVAL frame) and back and forth
+    int frame_idx[] = { 0, 57, 99, 100, 101, 250, 199, 200, 3, 348, 300, 299, 150, 151, 150 };
+    for (size_t i = 0; i < sizeof(frame_idx) / sizeof(int); i++)
+    {
+        std::vector<ExpectedState> &frame = frames[frame_idx[i]];
+        ASSERT_EQ(replay.GoToTime(frame[0].time + 0.3 * REPLAY_TEST_DT), 0);
+        EXPECT_NEAR(replay.GetTime(), frame[0].time + 0.3 * REPLAY_TEST_DT, 1e-6);
+        CompareFrame(replay, frame, 1e-4);
+    }
+
+    // Outside the recording
+    ASSERT_EQ(replay.GoToTime(-10.0), 0);
+    CompareFrame(replay, frames.front(), 1e-4);
+    ASSERT_EQ(replay.GoToTime(1e4), 0);
+    CompareFrame(replay, frames.back(), 1e-4);
+}
+
+TEST(ReplayTest, StepBackwards)
+{
+    std::string filename = testing::TempDir() + "replay_test.dat";
+    std::vector<std::vector<ExpectedState> > frames = Record(filename, REPLAY_FLAG_DELTA, REPLAY_TEST_N_STEPS);
+    Replay replay(filename);
+
+    // Half a step into frames, to be robust against accumulated rounding of time
+    ASSERT_EQ(replay.GoToTime(frames[205][0].time + 0.5 * REPLAY_TEST_DT), 0);
+    for (int i = 205; i >= 95; i--)
+    {
+        CompareFrame(replay, frames[i], 1e-4);
+        replay.Step(-REPLAY_TEST_DT);
+    }
+
+    // And forward again
+    for (int i = 94; i < 105; i++)
+    {
+        CompareFrame(replay, frames[i], 1e-4);
+        replay.Step(REPLAY_TEST_DT);
+    }
+
+    // Stepping back from start wraps around to end
+    ASSERT_EQ(replay.GoToTime(replay.GetStartTime()), 0);
+    replay.Step(-REPLAY_TEST_DT);
+    CompareFrame(replay, frames.back(), 1e-4);
+}
+
+TEST(ReplayTest, LegacyFormat)
+{
+    // Before version 2 recordings were two filenames followed by raw ObjectStateStruct, one per object and frame
+    std::string filename = testing::TempDir() + "replay_test_legacy.dat";
+    std::ofstream file(filename, std::ofstream::binary);
+    char odr_filename[REPLAY_FILENAME_SIZE] = "road.xodr";
+    char model_filename[REPLAY_FILENAME_SIZE] = "models.osgb";
+    file.write(odr_filename, sizeof(odr_filename));
+    file.write(model_filename, sizeof(model_filename));
+
+    std::vector<std::vector<ExpectedState> > frames;
+    for (int step = 0; step < REPLAY_TEST_N_STEPS; step++)
+    {
+        std::vector<ExpectedState> frame;
+        for (int id = 1; id <= 3; id++)
+        {
+            if (!ObjectExists(id, step))
+            {
+                continue;
+            }
+
+            ExpectedState expected = MakeState(id, step);
+            ObjectStateStruct state;
+            state.id = id;
+            state.model_id = id;
+            state.obj_type = 0;
+            state.obj_category = 0;
+            state.control = 1;
+            state.timeStamp = expected.time;
+            snprintf(state.name, NAME_LEN, "obj%d", id);
+            state.pos.SetInertiaPos(expected.x, expected.y, 0.0, expected.h, 0.0, 0.0, false);
+            state.pos.SetTrackId(expected.road_id);
+            state.pos.SetLaneId(-1);
+            state.pos.SetS(expected.s);
+            state.speed = expected.speed;
+            state.wheel_angle = 0.0f;
+            state.wheel_rot = 0.0f;
+            state.boundingbox.dimensions_.width_ = 2.0f;
+            state.boundingbox.dimensions_.length_ = expected.length;
+            state.boundingbox.dimensions_.height_ = 1.5f;
+            file.write((char*)&state, sizeof(state));
+            frame.push_back(expected);
+        }
+        frames.push_back(frame);
+    }
+    file.close();
+
+    Replay replay(filename);
+    EXPECT_STREQ(replay.header_.odr_filename, "road.xodr");
+    EXPECT_STREQ(replay.header_.model_filename, "models.osgb");
+    ASSERT_EQ(replay.GetNumberOfFrames(), (int)frames.size());
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        if (i > 0)
+        {
+            ASSERT_EQ(replay.GoToNextFrame(), 0);
+        }
+        CompareFrame(replay, frames[i], 1e-5);
+    }
+
+    ASSERT_EQ(replay.GoToTime(frames[123][0].time + 0.3 * REPLAY_TEST_DT), 0);
+    CompareFrame(replay, frames[123], 1e-5);
+}
+
+//////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////
+
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -4,6 +4,8 @@
 #include "RoadManager.hpp"
 #include <vector>
 #include <stdexcept>
+#include <random>
+#include <thread>
 
 using namespace roadmanager;
 
@@ -696,6 +698,89 @@ TODO: Remaining Test for this class is to test EvaluateDs function which inclide
 as extern void -> Check this later.
 */
 
+TEST_F(SpiralGeomTestFixture, TestEvaluateDsLookupTable)
+{
+    // Highway like clothoids, one starting from straight and one in between two radii, and a param poly3 curve
+    Spiral spiral_a = Spiral(0, 100, -50, 0.3, 150, 0.0, 0.004);
+    Spiral spiral_b = Spiral(0, -20, 10, 4.0, 300, -0.01, 0.002);
+    ParamPoly3 ppoly = ParamPoly3(0, 5, 5, 1.0, 120, 0, 1, 0.3, -0.1, 0, 0, 0.5, -0.2, ParamPoly3::P_RANGE_NORMALIZED);
+    Geometry *geom[] = { &spiral_a, &spiral_b, &ppoly };
+    double tolerance[] = { 1e-3, 1e-4, 1e-6 };
+
+    std::mt19937 rand_gen(1);
+    std::vector<double> ds(10000);
+
+    for (size_t i = 0; i < sizeof(geom) / sizeof(Geometry*); i++)
+    {
+        std::uniform_real_distribution<double> ds_dist(0.0, geom[i]->GetLength());
+        for (size_t j = 0; j < ds.size(); j++)
+        {
+            ds[j] = ds_dist(rand_gen);
+        }
+
+        for (size_t j = 0; j < sizeof(tolerance) / sizeof(double); j++)
+        {
+            Geometry::SetUseLookupTable(true);
+            Geometry::SetLookupTableTolerance(tolerance[j]);
+
+            // Evaluation never builds the table, it's exact until the table is updated for the new tolerance
+            GeometryLookupTable *lut = geom[i]->GetType() == Geometry::GEOMETRY_TYPE_SPIRAL ? 
+                &((Spiral*)geom[i])->GetLookupTable() : &((ParamPoly3*)geom[i])->GetLookupTable();
+            int n_samples = lut->GetNumberOfSamples();
+            double x_exact, y_exact, h_exact, x_eval, y_eval, h_eval;
+            geom[i]->EvaluateDS(0.3 * geom[i]->GetLength(), &x_eval, &y_eval, &h_eval);
+            Geometry::SetUseLookupTable(false);
+            geom[i]->EvaluateDS(0.3 * geom[i]->GetLength(), &x_exact, &y_exact, &h_exact);
+            Geometry::SetUseLookupTable(true);
+            EXPECT_EQ(x_eval, x_exact);
+            EXPECT_EQ(y_eval, y_exact);
+            EXPECT_EQ(h_eval, h_exact);
+            EXPECT_EQ(lut->GetNumberOfSamples(), n_samples);
+            geom[i]->UpdateLookupTable();
+            EXPECT_EQ(lut->GetTolerance(), tolerance[j]);
+
+            double max_pos_err = 0.0, max_h_err = 0.0, max_curv_err = 0.0;
+            for (size_t k = 0; k < ds.size(); k++)
+            {
+                double x0, y0, h0, x1, y1, h1;
+                Geometry::SetUseLookupTable(false);
+                geom[i]->EvaluateDS(ds[k], &x0, &y0, &h0);
+                double curv0 = geom[i]->EvaluateCurvatureDS(ds[k]);
+                Geometry::SetUseLookupTable(true);
+                geom[i]->EvaluateDS(ds[k], &x1, &y1, &h1);
+                max_pos_err = std::max(max_pos_err, sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)));
+                max_h_err = std::max(max_h_err, GetAbsAngleDifference(h0, h1));
+                if (geom[i]->GetType() == Geometry::GEOMETRY_TYPE_SPIRAL)
+                {
+                    max_curv_err = std::max(max_curv_err, fabs(geom[i]->EvaluateCurvatureDS(ds[k]) - curv0));
+                }
+            }
+            EXPECT_LT(max_pos_err, tolerance[j]);
+            EXPECT_LT(max_h_err, tolerance[j]);
+            EXPECT_LT(max_curv_err, 1e-9);  // heading of a spiral is quadratic, reproduced by the cubic interpolation
+
+            // Exact at geometry start and end
+            double x0, y0, h0, x1, y1, h1;
+            for (double s : { 0.0, geom[i]->GetLength() })
+            {
+                Geometry::SetUseLookupTable(false);
+                geom[i]->EvaluateDS(s, &x0, &y0, &h0);
+                Geometry::SetUseLookupTable(true);
+                geom[i]->EvaluateDS(s, &x1, &y1, &h1);
+                EXPECT_NEAR(x0, x1, 1e-9);
+                EXPECT_NEAR(y0, y1, 1e-9);
+                EXPECT_NEAR(h0, h1, 1e-9);
+            }
+        }
+    }
+
+    // Moving the spiral invalidates its table
+    spiral_a.SetX(0.0);
+    ASSERT_TRUE(spiral_a.GetLookupTable().IsEmpty());
+
+    Geometry::SetUseLookupTable(false);
+}
+
 //////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////
@@ -1352,6 +1437,50 @@ TEST_F(LaneTestFixture, TestLaneGetWidth)
     delete lanewidth_second;
 }
 
+TEST(LaneSectionTest, TestLaneTable)
+{
+    LaneSection lane_section(10.0);
+    Lane lanes[] = { Lane(2, Lane::LANE_TYPE_SIDEWALK), Lane(1, Lane::LANE_TYPE_DRIVING), Lane(0, Lane::LANE_TYPE_NONE),
+        Lane(-1, Lane::LANE_TYPE_DRIVING), Lane(-2, Lane::LANE_TYPE_DRIVING), Lane(-4, Lane::LANE_TYPE_BORDER) };
+    LaneWidth widths[] = { LaneWidth(0.0, 2.0, 0.0, 0.0, 0.0), LaneWidth(0.0, 3.5, 0.0, 0.0, 0.0), LaneWidth(0.0, 3.0, 0.1, 0.0, 0.0),
+        LaneWidth(5.0, 3.5, 0.0, -0.01, 0.0), LaneWidth(0.0, 3.0, 0.0, 0.0, 0.0), LaneWidth(0.0, 0.5, 0.0, 0.0, 0.0) };
+    int width_lane_idx[] = { 0, 1, 3, 3, 4, 5 };
+
+    for (int i = 0; i < 6; i++)
+    {
+        lane_section.AddLane(&lanes[i]);
+        lanes[width_lane_idx[i]].AddLaneWidth(&widths[i]);
+    }
+
+    // Lane table must give same results as the lane list
+    std::vector<double> reference;
+    for (double s = 10.0; s < 30.0; s += 0.7)
+    {
+        for (int id = -4; id < 3; id++)
+        {
+            reference.push_back(lane_section.GetWidth(s, id));
+            reference.push_back(lane_section.GetCenterOffset(s, id));
+            reference.push_back(lane_section.GetLaneIdxById(id));
+        }
+    }
+
+    lane_section.BuildLaneTable();
+    std::vector<double> values;
+    for (double s = 10.0; s < 30.0; s += 0.7)
+    {
+        for (int id = -4; id < 3; id++)
+        {
+            values.push_back(lane_section.GetWidth(s, id));
+            values.push_back(lane_section.GetCenterOffset(s, id));
+            values.push_back(lane_section.GetLaneIdxById(id));
+        }
+    }
+    ASSERT_EQ(values, reference);
+    ASSERT_EQ(lane_section.GetLaneById(-4), &lanes[5]);
+    ASSERT_EQ(lane_section.GetLaneById(-3), nullptr);
+    ASSERT_DOUBLE_EQ(lane_section.GetCenterOffset(20.0, -2), 3.5 - 0.01 * 5.0 * 5.0 + 3.0 / 2);
+}
+
 TEST_F(LaneTestFixture, TestLaneGetRoadMark)
 {
     LaneRoadMark *laneroadmark = new LaneRoadMark(2.0, LaneRoadMark::RoadMarkType::BROKEN, LaneRoadMark::RoadMarkWeight::STANDARD,
@@ -1376,6 +1505,598 @@ TEST_F(LaneTestFixture, TestLaneGetRoadMark)
     delete laneroadmark;
 }
 
+//////////////////////////////////////////////////////////////////////
+////////// TESTS FOR CLASS -> RoadGrid //////////
+//////////////////////////////////////////////////////////////////////
+
+// Create a road network of unconnected, straight roads laid out in a square pattern
+// Optionally add empty junctions, with ids starting from first_id as well
+static void CreateStraightRoadsFile(const char *filename, int n_roads, int first_id = 1, double length = 100.0, int n_junctions = 0)
+{
+    int n_cols = (int)ceil(sqrt(n_roads));
+    FILE *file = fopen(filename, "w");
+    ASSERT_NE(file, nullptr);
+
+    fprintf(file, "<?xml version=\"1.0\" standalone=\"yes\"?>\n<OpenDRIVE>\n<header revMajor=\"1\" revMinor=\"4\"/>\n");
+    for (int i = 0; i < n_roads; i++)
+    {
+        fprintf(file, "<road length=\"%.1f\" id=\"%d\" junction=\"-1\">\n<link/>\n<planView>\n", length, first_id + i);
+        fprintf(file, "<geometry s=\"0.0\" x=\"%.1f\" y=\"%.1f\" hdg=\"0.0\" length=\"%.1f\"><line/></geometry>\n",
+            (length + 20.0) * (i % n_cols), 30.0 * (i / n_cols), length);
+        fprintf(file, "</planView>\n<lanes>\n<laneSection s=\"0.0\">\n");
+        fprintf(file, "<left><lane id=\"1\" type=\"driving\" level=\"false\"><link/><width sOffset=\"0.0\" a=\"3.5\" b=\"0.0\" c=\"0.0\" d=\"0.0\"/></lane></left>\n");
+        fprintf(file, "<center><lane id=\"0\" type=\"driving\" level=\"false\"><link/></lane></center>\n");
+        fprintf(file, "<right><lane id=\"-1\" type=\"driving\" level=\"false\"><link/><width sOffset=\"0.0\" a=\"3.5\" b=\"0.0\" c=\"0.0\" d=\"0.0\"/></lane></right>\n");
+        fprintf(file, "</laneSection>\n</lanes>\n</road>\n");
+    }
+    for (int i = 0; i < n_junctions; i++)
+    {
+        fprintf(file, "<junction id=\"%d\" name=\"\"/>\n", first_id + i);
+    }
+    fprintf(file, "</OpenDRIVE>\n");
+    fclose(file);
+}
+
+TEST(RoadGridTest, TestXYZH2TrackPosScaling)
+{
+    const char *filename = "road_grid_test.xodr";
+    int n_roads[] = { 16, 128, 1024 };
+    std::mt19937 rand_gen(1);
+    OpenDrive *odr = Position::GetOpenDrive();
+
+    for (size_t n = 0; n < sizeof(n_roads) / sizeof(int); n++)
+    {
+        CreateStraightRoadsFile(filename, n_roads[n]);
+        ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+        ASSERT_EQ(odr->GetNumOfRoads(), n_roads[n]);
+
+        // Random positions within the road network, also some outside
+        int n_cols = (int)ceil(sqrt(n_roads[n]));
+        std::uniform_real_distribution<double> x_dist(-50, 120.0 * n_cols + 50);
+        std::uniform_real_distribution<double> y_dist(-50, 30.0 * n_cols + 50);
+        std::vector<double> x(200), y(200);
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            x[i] = x_dist(rand_gen);
+            y[i] = y_dist(rand_gen);
+        }
+
+        // Make sure the spatial index finds the same road position as the exhaustive search
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            Position pos_grid, pos_all;
+            odr->SetUseRoadGrid(true);
+            pos_grid.XYZH2TrackPos(x[i], y[i], 0, 0);
+            odr->SetUseRoadGrid(false);
+            pos_all.XYZH2TrackPos(x[i], y[i], 0, 0);
+            ASSERT_EQ(pos_grid.GetTrackId(), pos_all.GetTrackId());
+            ASSERT_NEAR(pos_grid.GetS(), pos_all.GetS(), 1e-6);
+            ASSERT_NEAR(pos_grid.GetT(), pos_all.GetT(), 1e-6);
+        }
+        odr->SetUseRoadGrid(true);
+    }
+
+    remove(filename);
+}
+
+TEST(RoadGridTest, TestRoadsInRadius)
+{
+    const char *filename = "road_grid_test.xodr";
+    std::mt19937 rand_gen(1);
+    std::uniform_real_distribution<double> x_dist(-100, 1500);
+    std::uniform_real_distribution<double> y_dist(-100, 400);
+    OpenDrive *odr = Position::GetOpenDrive();
+    std::vector<int> road_idx;
+
+    CreateStraightRoadsFile(filename, 128);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+
+    for (int i = 0; i < 200; i++)
+    {
+        double x = x_dist(rand_gen);
+        double y = y_dist(rand_gen);
+        double radius = 50.0;
+
+        odr->GetRoadGrid()->GetRoadsInRadius(x, y, radius, road_idx);
+        ASSERT_LT(road_idx.size(), (size_t)odr->GetNumOfRoads());
+
+        // Any road with center line inside the circle must be among the candidates
+        for (int j = 0; j < odr->GetNumOfRoads(); j++)
+        {
+            Geometry *geom = odr->GetRoadByIdx(j)->GetGeometry(0);
+            double x_closest = std::max(geom->GetX(), std::min(x, geom->GetX() + geom->GetLength()));
+            if (PointDistance2D(x, y, x_closest, geom->GetY()) < radius)
+            {
+                ASSERT_NE(std::find(road_idx.begin(), road_idx.end(), j), road_idx.end());
+            }
+        }
+    }
+
+    remove(filename);
+}
+
+TEST(OpenDriveTest, TestLookupById)
+{
+    const char *filename = "lookup_test.xodr";
+    const int n_roads = 10000;
+    const int n_junctions = 1000;
+    OpenDrive *odr = Position::GetOpenDrive();
+
+    // Load two networks, the second one merged into the first one
+    CreateStraightRoadsFile(filename, n_roads / 2, 1, 10.0, n_junctions / 2);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    CreateStraightRoadsFile(filename, n_roads / 2, n_roads / 2 + 1, 10.0, n_junctions / 2);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename, false));
+    remove(filename);
+    ASSERT_EQ(odr->GetNumOfRoads(), n_roads);
+    ASSERT_EQ(odr->GetNumOfJunctions(), n_junctions);
+
+    for (int i = 0; i < n_roads; i++)
+    {
+        ASSERT_EQ(odr->GetTrackIdxById(i + 1), i);
+        ASSERT_EQ(odr->GetRoadById(i + 1)->GetId(), i + 1);
+    }
+    for (int i = 0; i < n_junctions / 2; i++)
+    {
+        ASSERT_EQ(odr->GetJunctionById(i + 1), odr->GetJunctionByIdx(i));
+        ASSERT_EQ(odr->GetJunctionById(n_roads / 2 + i + 1), odr->GetJunctionByIdx(n_junctions / 2 + i));
+    }
+    ASSERT_EQ(odr->GetRoadById(n_roads + 1), nullptr);
+    ASSERT_EQ(odr->GetJunctionById(n_junctions / 2 + 1), nullptr);
+
+    // Reset road network, replace with empty one
+    ASSERT_FALSE(odr->LoadOpenDriveFile(""));
+    ASSERT_EQ(odr->GetRoadById(1), nullptr);
+}
+
+TEST(OpenDriveTest, TestConnectivity)
+{
+    OpenDrive *odr = Position::GetOpenDrive();
+    ASSERT_TRUE(odr->LoadOpenDriveFile("../../../resources/xodr/fabriksgatan.xodr"));
+
+    // Road 0 leads into junction, with connecting roads 5, 8, 9, 10, 11 and 14 at its predecessor end
+    double angle = -1;
+    ASSERT_EQ(odr->IsDirectlyConnected(0, 8, angle), -1);
+    ASSERT_NEAR(angle, 1.589754, 1e-5);
+    ASSERT_EQ(odr->IsDirectlyConnected(0, 9, angle), -1);
+    ASSERT_NEAR(angle, 0.029480, 1e-5);
+    ASSERT_EQ(odr->IsDirectlyConnected(0, 1, angle), 0);
+    ASSERT_EQ(odr->IsDirectlyConnected(8, 1, angle), 1);
+    ASSERT_NEAR(angle, 0.0, 1e-5);
+    ASSERT_EQ(odr->IsDirectlyConnected(8, 0, angle), -1);
+
+    // Lane 2 of road 0 connects to lane -2 of road 1 via lane -2 of connecting road 8
+    int connecting_road_id = -1;
+    int connecting_lane_id = 0;
+    int *connecting_road_id_ptr = &connecting_road_id;
+    int *connecting_lane_id_ptr = &connecting_lane_id;
+    ASSERT_TRUE(odr->IsIndirectlyConnected(0, 1, connecting_road_id_ptr, connecting_lane_id_ptr, 2, -2));
+    ASSERT_EQ(connecting_road_id, 8);
+    ASSERT_EQ(connecting_lane_id, -2);
+    ASSERT_FALSE(odr->IsIndirectlyConnected(0, 1, connecting_road_id_ptr, connecting_lane_id_ptr, 2, 2));
+    ASSERT_TRUE(odr->IsIndirectlyConnected(1, 0, connecting_road_id_ptr, connecting_lane_id_ptr, 1, -1));
+    ASSERT_EQ(connecting_road_id, 5);
+    ASSERT_EQ(connecting_lane_id, -1);
+}
+
+TEST(RoadPathTest, TestShortestPathCached)
+{
+    OpenDrive *odr = Position::GetOpenDrive();
+    ASSERT_TRUE(odr->LoadOpenDriveFile("../../../resources/xodr/multi_intersections.xodr"));
+    ASSERT_EQ(odr->GetRoadPathCache()->GetNumberOfEntries(), 0);
+
+    Position start_pos(235, -1, 50, 0);
+    Position target_pos(281, -1, 30, 0);
+    int expected_path[] = { 235, 209, 207, 202, 222, 221, 227, 281 };
+    double dist = 0;
+
+    RoadPath path(&start_pos, &target_pos);
+    ASSERT_EQ(path.Calculate(dist), 0);
+    ASSERT_NEAR(dist, 564.701, 1e-3);
+    ASSERT_THAT(path.path_, testing::ElementsAreArray(expected_path));
+    int n_misses = odr->GetRoadPathCache()->GetNumberOfMisses();
+
+    // Same roads, other s values. Expect cached road to road result and no new search.
+    start_pos.SetLanePos(235, -1, 40, 0);
+    target_pos.SetLanePos(281, -1, 40, 0);
+    RoadPath path2(&start_pos, &target_pos);
+    ASSERT_EQ(path2.Calculate(dist), 0);
+    ASSERT_NEAR(dist, 564.701 + 20, 1e-3);
+    ASSERT_EQ(odr->GetRoadPathCache()->GetNumberOfMisses(), n_misses);
+    ASSERT_GT(odr->GetRoadPathCache()->GetNumberOfHits(), 0);
+
+    // Least recently used entries are dropped when cache is full
+    odr->GetRoadPathCache()->SetCapacity(1);
+    ASSERT_EQ(odr->GetRoadPathCache()->GetNumberOfEntries(), 1);
+    odr->GetRoadPathCache()->SetCapacity(256);
+}
+
+TEST(RoadPathTest, TestLanePath)
+{
+    OpenDrive *odr = Position::GetOpenDrive();
+    ASSERT_TRUE(odr->LoadOpenDriveFile("../../../resources/xodr/multi_intersections.xodr"));
+    double dist = 0;
+
+    // Driving along the road direction, shortest road path is also lane connected
+    Position start_pos(235, -1, 50, 0);
+    Position target_pos(281, -1, 30, 0);
+    RoadPath path(&start_pos, &target_pos);
+    ASSERT_EQ(path.CalculateLanePath(dist), 0);
+    ASSERT_NEAR(dist, 564.701, 1e-3);
+    ASSERT_EQ(path.lane_path_.size(), 8);
+    ASSERT_EQ(path.lane_path_[1].road_id, 209);
+    ASSERT_EQ(path.lane_path_[1].lane_id, 1);
+    ASSERT_EQ(path.lane_path_.back().road_id, 281);
+    ASSERT_EQ(path.lane_path_.back().lane_id, -1);
+
+    // Driving in left lanes, the opposite direction, a longer way is needed
+    start_pos.SetLanePos(235, 1, 50, 0);
+    target_pos.SetLanePos(281, 1, 30, 0);
+    RoadPath path2(&start_pos, &target_pos);
+    ASSERT_EQ(path2.CalculateLanePath(dist), 0);
+    ASSERT_NEAR(dist, 815.197, 1e-3);
+    ASSERT_EQ(path2.lane_path_.size(), 8);
+    ASSERT_EQ(path2.lane_path_[1].road_id, 231);
+}
+
+static std::vector<double> GetAllOSIPoints(OpenDrive *odr)
+{
+    std::vector<double> values;
+
+    for (int i = 0; i < odr->GetNumOfRoads(); i++)
+    {
+        Road *road = odr->GetRoadByIdx(i);
+        odr->SetRoadOSI(road);
+        for (int j = 0; j < road->GetNumberOfLaneSections(); j++)
+        {
+            LaneSection *lane_section = road->GetLaneSectionByIdx(j);
+            for (int k = 0; k < lane_section->GetNumberOfLanes(); k++)
+            {
+                Lane *lane = lane_section->GetLaneByIdx(k);
+                OSIPoints *points[2] = { lane->GetOSIPoints(), lane->GetLaneBoundary() ? &lane->GetLaneBoundary()->osi_points_ : 0 };
+                for (int m = 0; m < 2 && points[m]; m++)
+                {
+                    values.push_back(m == 0 ? lane->GetGlobalId() : lane->GetLaneBoundaryGlobalId());
+                    values.insert(values.end(), points[m]->GetX().begin(), points[m]->GetX().end());
+                    values.insert(values.end(), points[m]->GetY().begin(), points[m]->GetY().end());
+                    values.insert(values.end(), points[m]->GetH().begin(), points[m]->GetH().end());
+                }
+            }
+        }
+    }
+
+    return values;
+}
+
+TEST(OpenDriveTest, TestOSIPointsParallelAndLazy)
+{
+    const char *filename = "../../../resources/xodr/multi_intersections.xodr";
+    OpenDrive *odr = Position::GetOpenDrive();
+
+    odr->SetOSIPointsThreads(1);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    std::vector<double> serial = GetAllOSIPoints(odr);
+
+    odr->SetOSIPointsThreads(4);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    ASSERT_EQ(GetAllOSIPoints(odr), serial);
+
+    // In lazy mode only reference lanes are done at load
+    odr->SetOSIPointsMode(OpenDrive::OSI_POINTS_LAZY);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    Road *road = odr->GetRoadByIdx(0);
+    ASSERT_FALSE(road->GetOSIPointsDone());
+    ASSERT_GT(road->GetLaneSectionByIdx(0)->GetLaneById(0)->GetOSIPoints()->GetNumOfOSIPoints(), 1);
+    ASSERT_EQ(road->GetLaneSectionByIdx(0)->GetLaneById(-1)->GetOSIPoints()->GetNumOfOSIPoints(), 0);
+    ASSERT_EQ(GetAllOSIPoints(odr), serial);
+    ASSERT_TRUE(road->GetOSIPointsDone());
+
+    // Lane boundary ids are consecutive per road, from a base given by the roads before, regardless of query order
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    int expected_id = odr->GetRoadByIdx(0)->GetLaneBoundaryIdBase();
+    ASSERT_GE(expected_id, 0);
+    for (int i = 0; i < odr->GetNumOfRoads(); i++)
+    {
+        road = odr->GetRoadByIdx(i);
+        ASSERT_EQ(road->GetLaneBoundaryIdBase(), expected_id);
+        for (int j = 0; j < road->GetNumberOfLaneSections(); j++)
+        {
+            LaneSection *lane_section = road->GetLaneSectionByIdx(j);
+            for (int k = 0; k < lane_section->GetNumberOfLanes(); k++)
+            {
+                Lane *lane = lane_section->GetLaneByIdx(k);
+                if (lane->GetNumberOfRoadMarks() == 0)
+                {
+                    ASSERT_NE(lane->GetLaneBoundary(), nullptr);
+                    ASSERT_EQ(lane->GetLaneBoundaryGlobalId(), expected_id++);
+                }
+            }
+        }
+    }
+    ASSERT_GT(expected_id, odr->GetRoadByIdx(0)->GetLaneBoundaryIdBase());
+    for (int i = odr->GetNumOfRoads() - 1; i >= 0; i--)
+    {
+        odr->SetRoadOSI(odr->GetRoadByIdx(i));
+    }
+    ASSERT_EQ(GetAllOSIPoints(odr), serial);
+
+    odr->SetOSIPointsMode(OpenDrive::OSI_POINTS_EAGER);
+    odr->SetOSIPointsThreads(0);
+}
+
+TEST(OpenDriveTest, TestRoadCache)
+{
+    const char *filename = "../../../resources/xodr/multi_intersections.xodr";
+    OpenDrive *odr = Position::GetOpenDrive();
+
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    std::vector<double> reference = GetAllOSIPoints(odr);
+
+    // First load creates the cache file, second one reads it
+    odr->SetCacheDir(".");
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    ASSERT_FALSE(odr->GetCacheUsed());
+    ASSERT_FALSE(odr->GetCacheFilename().empty());
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    ASSERT_TRUE(odr->GetCacheUsed());
+    ASSERT_EQ(GetAllOSIPoints(odr), reference);
+
+    // Corrupt cache is ignored and replaced
+    FILE *file = fopen(odr->GetCacheFilename().c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    fputs("garbage", file);
+    fclose(file);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    ASSERT_FALSE(odr->GetCacheUsed());
+    ASSERT_EQ(GetAllOSIPoints(odr), reference);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    ASSERT_TRUE(odr->GetCacheUsed());
+
+    // Points of first polyline, right after the 40 byte header, not adding up to the total
+    unsigned long long n_points = 0;
+    file = fopen(odr->GetCacheFilename().c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    fseek(file, 40, SEEK_SET);
+    ASSERT_EQ(fread(&n_points, sizeof(n_points), 1, file), 1);
+    n_points += 1000;
+    fseek(file, 40, SEEK_SET);
+    fwrite(&n_points, sizeof(n_points), 1, file);
+    fclose(file);
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+    ASSERT_FALSE(odr->GetCacheUsed());
+    ASSERT_EQ(GetAllOSIPoints(odr), reference);
+
+    remove(odr->GetCacheFilename().c_str());
+    odr->SetCacheDir("");
+}
+
+TEST(OpenDriveTest, TestLookupByS)
+{
+    const char *filename = "../../../resources/xodr/soderleden.xodr";
+    std::mt19937 rand_gen(1);
+    OpenDrive *odr = Position::GetOpenDrive();
+    ASSERT_TRUE(odr->LoadOpenDriveFile(filename));
+
+    for (int i = 0; i < odr->GetNumOfRoads(); i++)
+    {
+        Road *road = odr->GetRoadByIdx(i);
+        std::uniform_real_distribution<double> s_dist(0.0, road->GetLength());
+
+        // Random access, from any start index
+        for (int j = 0; j < 100; j++)
+        {
+            double s = s_dist(rand_gen);
+            int ls_idx = road->GetLaneSectionIdxByS(s, rand_gen() % road->GetNumberOfLaneSections());
+            LaneSection *ls = road->GetLaneSectionByIdx(ls_idx);
+            ASSERT_TRUE(s >= ls->GetS() || ls_idx == 0);
+            ASSERT_TRUE(s < ls->GetS() + ls->GetLength() || ls_idx == road->GetNumberOfLaneSections() - 1);
+
+            int g_idx = road->GetGeometryIdxByS(s, rand_gen() % road->GetNumberOfGeometries());
+            Geometry *geom = road->GetGeometry(g_idx);
+            ASSERT_TRUE(s >= geom->GetS() || g_idx == 0);
+            ASSERT_TRUE(s < geom->GetS() + geom->GetLength() || g_idx == road->GetNumberOfGeometries() - 1);
+        }
+
+        // Sequential access, moving along the road, must match random access from scratch
+        Position pos(road->GetId(), 0.0, 0.0);
+        int ls_idx = 0;
+        for (double s = 0.0; s < road->GetLength(); s += 0.5)
+        {
+            pos.SetTrackPos(road->GetId(), s, 0.0);
+            Position pos_random(road->GetId(), s, 0.0);
+            ASSERT_DOUBLE_EQ(pos.GetX(), pos_random.GetX());
+            ASSERT_DOUBLE_EQ(pos.GetY(), pos_random.GetY());
+            ASSERT_DOUBLE_EQ(pos.GetZ(), pos_random.GetZ());
+
+            ls_idx = road->GetLaneSectionIdxByS(s, ls_idx);
+            ASSERT_EQ(ls_idx, road->GetLaneSectionIdxByS(s));
+        }
+    }
+}
+
+TEST(OpenDriveTest, TestEvaluateLanePositions)
+{
+    const char *files[] = { "../../../resources/xodr/e6mini.xodr", "../../../resources/xodr/multi_intersections.xodr" };
+    std::mt19937 rand_gen(1);
+    OpenDrive *odr = Position::GetOpenDrive();
+
+    for (size_t f = 0; f < sizeof(files) / sizeof(char*); f++)
+    {
+        ASSERT_TRUE(odr->LoadOpenDriveFile(files[f]));
+
+        // Random positions in all lanes of all roads, in random order
+        std::vector<LanePositionQuery> query;
+        for (int i = 0; i < odr->GetNumOfRoads(); i++)
+        {
+            Road *road = odr->GetRoadByIdx(i);
+            std::uniform_real_distribution<double> s_dist(0.0, road->GetLength());
+            for (int j = 0; j < 50; j++)
+            {
+                double s = s_dist(rand_gen);
+                LaneSection *lane_section = road->GetLaneSectionByS(s);
+                for (int k = 0; k < lane_section->GetNumberOfLanes(); k++)
+                {
+                    query.push_back({ road->GetId(), lane_section->GetLaneByIdx(k)->GetId(), s, 0.1 * (j % 5) - 0.2 });
+                }
+            }
+        }
+        std::shuffle(query.begin(), query.end(), rand_gen);
+
+        std::vector<LanePositionResult> result(query.size());
+        ASSERT_EQ(odr->EvaluateLanePositions(query.data(), result.data(), (int)query.size()), 0);
+
+        // Same as one by one
+        std::vector<Position> pos(query.size());
+        for (size_t i = 0; i < query.size(); i++)
+        {
+            pos[i].SetLanePos(query[i].road_id, query[i].lane_id, query[i].s, query[i].offset);
+        }
+
+        for (size_t i = 0; i < query.size(); i++)
+        {
+            ASSERT_EQ(result[i].status, 0);
+            ASSERT_NEAR(result[i].x, pos[i].GetX(), 1e-9);
+            ASSERT_NEAR(result[i].y, pos[i].GetY(), 1e-9);
+            ASSERT_NEAR(result[i].z, pos[i].GetZ(), 1e-9);
+            ASSERT_NEAR(result[i].h, pos[i].GetHRoad(), 1e-9);
+            ASSERT_NEAR(result[i].p, pos[i].GetP(), 1e-9);
+        }
+
+        // Non existing road and lane
+        LanePositionQuery invalid[2] = { { -10, -1, 10.0, 0.0 }, { odr->GetRoadByIdx(0)->GetId(), -100, 10.0, 0.0 } };
+        ASSERT_EQ(odr->EvaluateLanePositions(invalid, result.data(), 2), -1);
+        EXPECT_EQ(result[0].status, -1);
+        EXPECT_EQ(result[1].status, -1);
+    }
+}
+
+// Road id, lane id, s and offset of given world positions, using the road network active on the calling thread
+static std::vector<double> GetRoadPositions(std::vector<double> &xy)
+{
+    std::vector<double> values;
+    Position pos;
+
+    for (size_t i = 0; i + 1 < xy.size(); i += 2)
+    {
+        pos.XYZH2TrackPos(xy[i], xy[i + 1], 0, 0);
+        values.push_back(pos.GetTrackId());
+        values.push_back(pos.GetLaneId());
+        values.push_back(pos.GetS());
+        values.push_back(pos.GetOffset());
+    }
+
+    return values;
+}
+
+static void MoveAlongRoad(OpenDriveContext *context, const char *filename, std::vector<double> *xy, std::vector<double> *road_pos)
+{
+    OpenDriveContext *previous = context->Activate();
+
+    if (Position::LoadOpenDrive(filename))
+    {
+        Position pos(Position::GetOpenDrive()->GetRoadByIdx(0)->GetId(), 1.0, -1.5);
+        for (int i = 0; i < 500; i++)
+        {
+            pos.MoveAlongS(1.0, 0, Junction::STRAIGHT);
+            xy->push_back(pos.GetX());
+            xy->push_back(pos.GetY());
+        }
+
+        // Map back to road coordinates, other threads query the same shared road grid meanwhile
+        for (int i = 0; i < 10; i++)
+        {
+            *road_pos = GetRoadPositions(*xy);
+        }
+    }
+
+    OpenDriveContext::Restore(previous);
+}
+
+TEST(OpenDriveContextTest, TestParallelContexts)
+{
+    const char *files[] = { "../../../resources/xodr/fabriksgatan.xodr", "../../../resources/xodr/multi_intersections.xodr" };
+    const int n_contexts = 6;
+    OpenDriveContext context[n_contexts];
+    std::vector<double> xy[n_contexts];
+    std::vector<double> road_pos[n_contexts];
+    std::vector<std::thread> threads;
+
+    // Reference, run sequentially
+    std::vector<double> ref[2];
+    std::vector<double> ref_road_pos[2];
+    for (int i = 0; i < 2; i++)
+    {
+        OpenDriveContext ref_context;
+        MoveAlongRoad(&ref_context, files[i], &ref[i], &ref_road_pos[i]);
+        ASSERT_EQ(ref[i].size(), 1000);
+        ASSERT_EQ(ref_road_pos[i].size(), 2000);
+    }
+    ASSERT_NE(ref[0], ref[1]);
+    ASSERT_EQ(OpenDriveContext::GetNumberOfSharedOpenDrives(), 0);
+
+    for (int i = 0; i < n_contexts; i++)
+    {
+        threads.push_back(std::thread(MoveAlongRoad, &context[i], files[i % 2], &xy[i], &road_pos[i]));
+    }
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    // Each context sees its own road network only, shared between contexts of same file
+    ASSERT_EQ(OpenDriveContext::GetNumberOfSharedOpenDrives(), 2);
+    for (int i = 0; i < n_contexts; i++)
+    {
+        ASSERT_EQ(xy[i], ref[i % 2]);
+        ASSERT_EQ(road_pos[i], ref_road_pos[i % 2]);
+        ASSERT_EQ(context[i].GetOpenDrive(), context[i % 2].GetOpenDrive());
+    }
+    ASSERT_NE(context[0].GetOpenDrive(), context[1].GetOpenDrive());
+
+    // The process wide default road network is not affected
+    ASSERT_EQ(OpenDriveContext::GetActive(), (OpenDriveContext*)0);
+    ASSERT_NE(Position::GetOpenDrive(), context[0].GetOpenDrive());
+    ASSERT_NE(Position::GetOpenDrive(), context[1].GetOpenDrive());
+}
+
+TEST(OpenDriveContextTest, TestContextLoadedNetwork)
+{
+    const char *files[] = { "../../../resources/xodr/e6mini.xodr", "../../../resources/xodr/multi_intersections.xodr" };
+    std::mt19937 rand_gen(1);
+
+    for (size_t f = 0; f < sizeof(files) / sizeof(char*); f++)
+    {
+        OpenDrive *odr = Position::GetOpenDrive();
+        ASSERT_TRUE(odr->LoadOpenDriveFile(files[f]));
+        std::vector<double> ref_points = GetAllOSIPoints(odr);
+
+        // Random world positions on and next to the roads
+        std::vector<double> xy;
+        for (int i = 0; i < odr->GetNumOfRoads(); i++)
+        {
+            Road *road = odr->GetRoadByIdx(i);
+            std::uniform_real_distribution<double> s_dist(0.0, road->GetLength());
+            std::uniform_real_distribution<double> t_dist(-15.0, 15.0);
+            for (int j = 0; j < 10; j++)
+            {
+                Position pos(road->GetId(), s_dist(rand_gen), t_dist(rand_gen));
+                xy.push_back(pos.GetX());
+                xy.push_back(pos.GetY());
+            }
+        }
+        std::vector<double> ref_road_pos = GetRoadPositions(xy);
+
+        // Load same file via a context, while the default network holds another one
+        ASSERT_TRUE(odr->LoadOpenDriveFile(files[(f + 1) % 2]));
+        OpenDriveContext context;
+        OpenDriveContext *previous = context.Activate();
+        ASSERT_TRUE(Position::LoadOpenDrive(files[f]));
+        EXPECT_EQ(GetAllOSIPoints(context.GetOpenDrive()), ref_points);
+        EXPECT_EQ(GetRoadPositions(xy), ref_road_pos);
+        OpenDriveContext::Restore(previous);
+    }
+}
+
 //////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////
@@ -6,9 +6,11 @@
 #include "osi_sensorview.pb.h"
 #include "osi_version.pb.h"
 #include "scenarioenginedll.hpp"
+#include "SharedMemory.hpp"
 #include <vector>
 #include <stdexcept>
 #include <fstream>
+#include <thread>
 
 class GetNumberOfObjectsTest :public ::testing::TestWithParam<std::tuple<std::string,int>> {};
 // inp: scenario file
@@ -628,9 +630,291 @@ TEST(GetSensorViewTests, receive_SensorView_no_init) {
 
 	const char* sv = SE_GetOSISensorView(&sv_size);
 
-	EXPECT_EQ(sv_size, 0);  
+	EXPECT_EQ(sv_size, 0);
 }
 
+TEST(GetSensorViewTests, static_ground_truth_repeated_updates) {
+
+	int sv_size = 0;
+	osi3::SensorView osi_sv;
+
+	SE_Init("../../../resources/xosc/cut-in.xosc", 0, 0, 0, 0, 0);
+
+	for (int i = 0; i < 3; i++)
+	{
+		SE_StepDT(0.05f);
+		SE_UpdateOSISensorView();
+	}
+
+	const char* sv = SE_GetOSISensorView(&sv_size);
+	ASSERT_TRUE(osi_sv.ParseFromArray(sv, sv_size));
+
+	// Static road data reported once, objects once per object regardless of number of updates
+	EXPECT_EQ(osi_sv.global_ground_truth().lane_size(), 15);
+	EXPECT_EQ(osi_sv.global_ground_truth().moving_object_size(), SE_GetNumberOfObjects());
+	EXPECT_GT(osi_sv.global_ground_truth().lane_boundary_size(), 0);
+
+	SE_Close();
+}
+
+TEST(GetSensorViewTests, osi_radius) {
+
+	int sv_size = 0;
+	osi3::SensorView osi_sv;
+
+	SE_Init("../../../resources/xosc/highway_merge.xosc", 0, 0, 0, 0, 0);
+	SE_StepDT(0.05f);
+
+	// Radius covering entire road network
+	SE_SetOSIRadius(1e5f);
+	SE_UpdateOSISensorView();
+	const char* sv = SE_GetOSISensorView(&sv_size);
+	ASSERT_TRUE(osi_sv.ParseFromArray(sv, sv_size));
+	EXPECT_EQ(osi_sv.global_ground_truth().lane_size(), 40);
+	EXPECT_EQ(osi_sv.global_ground_truth().moving_object_size(), SE_GetNumberOfObjects());
+
+	// Small radius, only lanes close to the first object
+	SE_SetOSIRadius(10.0f);
+	SE_UpdateOSISensorView();
+	sv = SE_GetOSISensorView(&sv_size);
+	ASSERT_TRUE(osi_sv.ParseFromArray(sv, sv_size));
+	EXPECT_GT(osi_sv.global_ground_truth().lane_size(), 0);
+	EXPECT_LT(osi_sv.global_ground_truth().lane_size(), 40);
+	EXPECT_GE(osi_sv.global_ground_truth().moving_object_size(), 1);
+	EXPECT_GT(osi_sv.global_ground_truth().lane_boundary_size(), 0);
+
+	// Back to entire road network
+	SE_SetOSIRadius(0.0f);
+	SE_UpdateOSISensorView();
+	sv = SE_GetOSISensorView(&sv_size);
+	ASSERT_TRUE(osi_sv.ParseFromArray(sv, sv_size));
+	EXPECT_EQ(osi_sv.global_ground_truth().lane_size(), 40);
+
+	SE_Close();
+}
+
+TEST(GetSensorViewTests, raw_sensor_view) {
+
+	int sv_size = 0;
+	osi3::SensorView osi_sv;
+
+	EXPECT_EQ(SE_GetOSISensorViewRaw(), nullptr);
+
+	SE_Init("../../../resources/xosc/highway_merge.xosc", 0, 0, 0, 0, 0);
+	SE_StepDT(0.05f);
+	SE_SetOSIRadius(10.0f);
+
+	for (int i = 0; i < 3; i++)
+	{
+		SE_StepDT(0.05f);
+		SE_UpdateOSISensorView();
+
+		// Live message equals the serialized one, regardless of order of access
+		const osi3::SensorView *raw = (const osi3::SensorView*)SE_GetOSISensorViewRaw();
+		ASSERT_NE(raw, nullptr);
+		const char* sv = SE_GetOSISensorView(&sv_size);
+		ASSERT_TRUE(osi_sv.ParseFromArray(sv, sv_size));
+		EXPECT_EQ(raw->SerializeAsString(), osi_sv.SerializeAsString());
+		EXPECT_EQ(raw->global_ground_truth().lane_size(), osi_sv.global_ground_truth().lane_size());
+		EXPECT_EQ(raw->global_ground_truth().moving_object_size(), osi_sv.global_ground_truth().moving_object_size());
+	}
+
+	SE_SetOSIRadius(0.0f);
+	SE_UpdateOSISensorView();
+	EXPECT_EQ(((const osi3::SensorView*)SE_GetOSISensorViewRaw())->global_ground_truth().lane_size(), 40);
+
+	SE_Close();
+}
+
+TEST(GetSensorViewTests, shared_memory) {
+
+	int sv_size = 0;
+	osi3::SensorView osi_sv;
+	SE_SharedMemoryReader reader;
+
+	EXPECT_EQ(SE_OpenOSISharedMemory("esmini_test"), -1);
+
+	SE_Init("../../../resources/xosc/highway_merge.xosc", 0, 0, 0, 0, 0);
+	ASSERT_EQ(SE_OpenOSISharedMemory("esmini_test"), 0);
+	ASSERT_EQ(reader.Open("esmini_test"), 0);
+	EXPECT_EQ(reader.Acquire(0), 0);
+
+	for (int i = 0; i < 3; i++)
+	{
+		// Each step publishes a frame once shared memory is open
+		SE_StepDT(0.05f);
+
+		// Frame in shared memory equals the serialized message and the object states of the DLL
+		// Compare bytes, since re-serializing merges the separately appended static ground truth
+		ASSERT_EQ(reader.Acquire(100), 1);
+		ASSERT_TRUE(osi_sv.ParseFromArray(reader.GetMessageData(), reader.GetMessageSize()));
+		const char* sv = SE_GetOSISensorView(&sv_size);
+		EXPECT_EQ(std::string(sv, sv_size), std::string(reader.GetMessageData(), reader.GetMessageSize()));
+		EXPECT_EQ(osi_sv.global_ground_truth().lane_size(), 40);
+		ASSERT_EQ((int)reader.GetNumberOfObjects(), SE_GetNumberOfObjects());
+
+		SE_ScenarioObjectState state;
+		SE_GetObjectState(1, &state);
+		EXPECT_EQ(reader.GetObjects()[1].id, state.id);
+		EXPECT_NEAR(reader.GetObjects()[1].x, state.x, 1e-3);
+		EXPECT_NEAR(reader.GetObjects()[1].speed, state.speed, 1e-3);
+		EXPECT_TRUE(reader.Validate());
+	}
+	EXPECT_EQ(reader.GetNumberOfFrames(), 3ULL);
+	EXPECT_EQ(reader.GetNumberOfDropped(), 0ULL);
+
+	SE_Close();
+
+	// Reader keeps its mapping, but no new frames
+	EXPECT_EQ(reader.Acquire(0), 0);
+}
+
+static void RunScenarioInstance(const char *filename, std::vector<SE_ScenarioObjectState> *states, int *n_lanes)
+{
+	SE_Instance instance = SE_CreateInstance(filename, 0, 0);
+
+	if (instance == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < 200 && SE_InstanceGetQuitFlag(instance) == 0; i++)
+	{
+		SE_InstanceStepDT(instance, 0.05f);
+	}
+
+	for (int i = 0; i < SE_InstanceGetNumberOfObjects(instance); i++)
+	{
+		SE_ScenarioObjectState state;
+		SE_InstanceGetObjectState(instance, i, &state);
+		states->push_back(state);
+	}
+
+	int sv_size = 0;
+	osi3::SensorView osi_sv;
+	SE_InstanceUpdateOSISensorView(instance);
+	const char* sv = SE_InstanceGetOSISensorView(instance, &sv_size);
+	osi_sv.ParseFromArray(sv, sv_size);
+	*n_lanes = osi_sv.global_ground_truth().lane_size();
+
+	SE_DestroyInstance(instance);
+}
+
+TEST(InstanceTest, parallel_instances) {
+
+	const char *files[] = { "../../../resources/xosc/cut-in.xosc", "../../../resources/xosc/highway_merge.xosc" };
+	const int n_instances = 8;
+	std::vector<SE_ScenarioObjectState> ref_states[2];
+	int ref_n_lanes[2] = { 0, 0 };
+	std::vector<SE_ScenarioObjectState> states[n_instances];
+	int n_lanes[n_instances] = { 0 };
+	std::vector<std::thread> threads;
+
+	// Reference, one instance at a time
+	for (int i = 0; i < 2; i++)
+	{
+		RunScenarioInstance(files[i], &ref_states[i], &ref_n_lanes[i]);
+	}
+	ASSERT_EQ(ref_states[0].size(), 2);
+	ASSERT_EQ(ref_states[1].size(), 6);
+	EXPECT_EQ(ref_n_lanes[0], 15);
+	EXPECT_EQ(ref_n_lanes[1], 40);
+
+	for (int i = 0; i < n_instances; i++)
+	{
+		threads.push_back(std::thread(RunScenarioInstance, files[i % 2], &states[i], &n_lanes[i]));
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	// Instances running in parallel must not affect each other
+	for (int i = 0; i < n_instances; i++)
+	{
+		ASSERT_EQ(states[i].size(), ref_states[i % 2].size());
+		EXPECT_EQ(n_lanes[i], ref_n_lanes[i % 2]);
+		for (size_t j = 0; j < states[i].size(); j++)
+		{
+			EXPECT_EQ(states[i][j].id, ref_states[i % 2][j].id);
+			EXPECT_EQ(states[i][j].roadId, ref_states[i % 2][j].roadId);
+			EXPECT_EQ(states[i][j].x, ref_states[i % 2][j].x);
+			EXPECT_EQ(states[i][j].y, ref_states[i % 2][j].y);
+			EXPECT_EQ(states[i][j].h, ref_states[i % 2][j].h);
+		}
+	}
+
+	// Default instance is not affected
+	EXPECT_EQ(SE_GetNumberOfObjects(), 0);
+}
+
+TEST(InitWithArgsTest, fast_mode) {
+
+	const char *args[] = { "esmini", "--osc", "../../../resources/xosc/cut-in_simple.xosc", "--headless", "--fast", "--fixed_timestep", "0.025" };
+	ASSERT_EQ(SE_InitWithArgs(sizeof(args) / sizeof(char*), args), 0);
+	EXPECT_EQ(SE_GetNumberOfObjects(), 2);
+
+	// Fixed timestep, regardless of elapsed system time
+	float t0 = SE_GetSimulationTime();
+	SE_Step();
+	EXPECT_NEAR(SE_GetSimulationTime() - t0, 0.025, 1e-5);
+
+	int n_steps = 1;
+	for (int i = 0; i < 100000 && !SE_GetQuitFlag(); i++)
+	{
+		SE_Step();
+		n_steps++;
+	}
+	EXPECT_EQ(SE_GetQuitFlag(), 1);
+	SE_Close();
+
+	// Performance report is based on profiler statistics, collected in fast mode only
+	SE_ProfileData data;
+	ASSERT_EQ(SE_GetProfileSection(0, &data), 0);
+	EXPECT_EQ(data.count, n_steps);
+	EXPECT_GT(data.p99, 0.0);
+
+	// Missing scenario file
+	const char *bad_args[] = { "esmini", "--headless", "--fast" };
+	EXPECT_EQ(SE_InitWithArgs(sizeof(bad_args) / sizeof(char*), bad_args), -1);
+}
+
+TEST(ProfilerTest, step_sections) {
+
+	SE_ProfileData data;
+
+	SE_Init("../../../resources/xosc/cut-in.xosc", 0, 0, 0, 0, 0);
+	SE_ResetProfiler();
+	SE_EnableProfiler(1, 0);
+	for (int i = 0; i < 100; i++)
+	{
+		SE_StepDT(0.05f);
+	}
+	SE_EnableProfiler(0, 0);
+	SE_StepDT(0.05f);  // not measured
+	SE_Close();
+
+	ASSERT_EQ(SE_GetNumberOfProfileSections(), 10);
+	ASSERT_EQ(SE_GetProfileSection(0, &data), 0);
+	EXPECT_STREQ(data.name, "frame");
+	EXPECT_EQ(data.count, 100);
+	EXPECT_GT(data.total, 0.0);
+	EXPECT_GE(data.max, data.mean);
+	EXPECT_GE(data.p99, 0.0);
+	EXPECT_LE(data.p99, data.max);
+
+	double frame_total = data.total;
+	ASSERT_EQ(SE_GetProfileSection(1, &data), 0);
+	EXPECT_STREQ(data.name, "step");
+	EXPECT_EQ(data.count, 100);
+	EXPECT_LE(data.total, frame_total);
+
+	EXPECT_EQ(SE_GetProfileSection(10, &data), -1);
+
+	SE_ResetProfiler();
+	ASSERT_EQ(SE_GetProfileSection(0, &data), 0);
+	EXPECT_EQ(data.count, 0);
+}
 
 
 
@@ -1052,6 +1052,7 @@ bool Viewer::CreateRoadMarkLines(roadmanager::OpenDrive* od)
 	for (int r = 0; r < od->GetNumOfRoads(); r++)
 	{
 		roadmanager::Road *road = od->GetRoadByIdx(r);
+		od->SetRoadOSI(road);  // make sure OSI points are calculated, in case of lazy mode
 		for (int i = 0; i < road->GetNumberOfLaneSections(); i++)
 		{
 			roadmanager::LaneSection *lane_section = road->GetLaneSectionByIdx(i);
@@ -1187,6 +1188,7 @@ bool Viewer::CreateRoadLines(roadmanager::OpenDrive* od)
 	for (int r = 0; r < od->GetNumOfRoads(); r++)
 	{
 		roadmanager::Road *road = od->GetRoadByIdx(r);
+		od->SetRoadOSI(road);  // make sure OSI points are calculated, in case of lazy mode
 
 		// Road key points
 		osg::ref_ptr<osg::Geometry> kp_geom = new osg::Geometry;